@@ -0,0 +1,236 @@
+/**
+ * @file embed_bench.cpp
+ * @brief ArcFace embedding throughput: faces per second against batch size
+ *
+ * Loads the ONNX model through ModelLoader and embeds the same set of
+ * synthetic 112x112 face crops with ModelLoader::inference_batch() at each
+ * batch size (1 is the per-face path). Models with a fixed batch axis
+ * ignore the requested size and run their own.
+ *
+ * Every call is timed on its own for the p50/p99 latency (jitter is p99 - p50),
+ * and a counting operator new reports the heap allocations per face made by
+ * the steady-state calls, i.e. after the first call of each batch size.
+ *
+ * With --callers, the faces are then split between that many threads, each
+ * embedding one face per call as concurrent recognition and enrollment do,
+ * and the aggregate faces per second is reported for each caller count.
+ * --sessions and --threads set the session pool size and the shared
+ * intra-op thread budget.
+ *
+ * Each result is printed to stdout as one JSON object per line (JSON Lines);
+ * a readable table goes to stderr.
+ *
+ * Usage: embed_bench [--model models/arcface_w600k_r50.onnx] [--batches 1,2,4,8,16]
+ *                    [--faces 256] [--callers 1,2,3,4] [--sessions 2] [--threads 4]
+ *                    [--output results.jsonl]
+ */
+
+#include "model_loader.h"
+#include "config.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Counts every heap allocation of the process
+static std::atomic<size_t> g_allocations{0};
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string model = "models/arcface_w600k_r50.onnx";
+    std::vector<int> batches = {1, 2, 4, 8, 16};
+    int faces = 256;
+    std::vector<int> callers;
+    int sessions = 0;  // 0 keeps Config::ARCFACE_SESSIONS
+    int threads = Config::INFERENCE_INTRA_OP_THREADS;
+    std::string output;
+};
+
+std::vector<int> parse_list(const std::string& list) {
+    std::vector<int> items;
+    std::istringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(std::atoi(item.c_str()));
+        }
+    }
+    return items;
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--model") {
+            options.model = value;
+        } else if (arg == "--batches") {
+            options.batches = parse_list(value);
+        } else if (arg == "--faces") {
+            options.faces = std::atoi(value.c_str());
+        } else if (arg == "--callers") {
+            options.callers = parse_list(value);
+        } else if (arg == "--sessions") {
+            options.sessions = std::atoi(value.c_str());
+        } else if (arg == "--threads") {
+            options.threads = std::atoi(value.c_str());
+        } else if (arg == "--output") {
+            options.output = value;
+        } else {
+            return false;
+        }
+    }
+    return options.faces > 0 && !options.batches.empty() &&
+           std::all_of(options.batches.begin(), options.batches.end(), [](int b) { return b > 0; }) &&
+           std::all_of(options.callers.begin(), options.callers.end(), [](int c) { return c > 0; });
+}
+
+double percentile(std::vector<double> values, double p) {
+    std::sort(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+    return values[std::min(rank, values.size() - 1)];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--model file.onnx] [--batches 1,2,4,8,16] [--faces 256] "
+                  << "[--callers 1,2,3,4] [--sessions n] [--threads n] [--output file.jsonl]" << std::endl;
+        return 1;
+    }
+
+    ModelLoader loader;
+    loader.set_session_count(options.sessions);
+    loader.set_thread_budget(options.threads, Config::INFERENCE_INTER_OP_THREADS);
+    if (!loader.load_model(options.model)) {
+        return 1;
+    }
+
+    FILE* output = stdout;
+    if (!options.output.empty()) {
+        output = std::fopen(options.output.c_str(), "a");
+        if (!output) {
+            std::cerr << "Error: Could not open " << options.output << std::endl;
+            return 1;
+        }
+    }
+
+    // Random crops: the network's cost does not depend on the pixel values
+    cv::RNG rng(42);
+    std::vector<cv::Mat> faces(options.faces);
+    for (cv::Mat& face : faces) {
+        face.create(loader.get_input_height(), loader.get_input_width(), CV_8UC3);
+        rng.fill(face, cv::RNG::UNIFORM, 0, 256);
+    }
+    loader.inference_batch(std::vector<cv::Mat>(faces.begin(), faces.begin() + 1));  // Warm-up
+
+    std::fprintf(stderr, "Model batch axis: %s, hardware threads: %u, sessions: %d, intra-op threads: %d\n",
+                 loader.has_dynamic_batch() ? "dynamic" : "fixed", std::thread::hardware_concurrency(),
+                 loader.get_session_count(), options.threads);
+    std::fprintf(stderr, "%8s %8s %10s %12s %12s %8s %8s %8s %12s\n", "batch", "faces", "total_ms", "faces_per_s",
+                 "ms_per_call", "p50_ms", "p99_ms", "jitter", "allocs/face");
+    std::vector<std::vector<float>> embeddings;
+    for (int batch : options.batches) {
+        loader.set_max_batch_size(batch);
+        int effective = loader.get_max_batch_size();
+
+        // One inference_batch() call per group, as a frame with that many faces would make
+        std::vector<std::vector<cv::Mat>> groups;
+        for (size_t first = 0; first < faces.size(); first += effective) {
+            size_t last = std::min(faces.size(), first + effective);
+            groups.emplace_back(faces.begin() + first, faces.begin() + last);
+        }
+        loader.inference_batch(groups[0], embeddings);  // Binds this batch size
+
+        std::vector<double> latencies;
+        latencies.reserve(groups.size());
+        size_t allocations = g_allocations.load();
+        auto start = Clock::now();
+        for (const std::vector<cv::Mat>& group : groups) {
+            auto call_start = Clock::now();
+            loader.inference_batch(group, embeddings);
+            latencies.push_back(std::chrono::duration<double, std::milli>(Clock::now() - call_start).count());
+        }
+        double total_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        double allocs_per_face = static_cast<double>(g_allocations.load() - allocations) / faces.size();
+        double faces_per_second = 1000.0 * faces.size() / total_ms;
+        size_t calls = groups.size();
+        double p50 = percentile(latencies, 0.50);
+        double p99 = percentile(latencies, 0.99);
+
+        std::fprintf(output, "{\"batch\":%d,\"faces\":%zu,\"total_ms\":%.1f,\"faces_per_s\":%.1f,"
+                     "\"ms_per_call\":%.2f,\"p50_ms\":%.2f,\"p99_ms\":%.2f,\"jitter_ms\":%.2f,"
+                     "\"allocs_per_face\":%.2f,\"dynamic_batch\":%s}\n",
+                     effective, faces.size(), total_ms, faces_per_second, total_ms / calls, p50, p99, p99 - p50,
+                     allocs_per_face, loader.has_dynamic_batch() ? "true" : "false");
+        std::fflush(output);
+        std::fprintf(stderr, "%8d %8zu %10.1f %12.1f %12.2f %8.2f %8.2f %8.2f %12.2f\n", effective, faces.size(),
+                     total_ms, faces_per_second, total_ms / calls, p50, p99, p99 - p50, allocs_per_face);
+    }
+
+    if (!options.callers.empty()) {
+        std::fprintf(stderr, "%8s %8s %10s %12s\n", "callers", "faces", "total_ms", "faces_per_s");
+    }
+    for (int callers : options.callers) {
+        // Each caller embeds its share of the faces one per call
+        auto start = Clock::now();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < callers; t++) {
+            threads.emplace_back([&, t]() {
+                std::vector<std::vector<float>> caller_embeddings;
+                std::vector<cv::Mat> face(1);
+                for (size_t i = t; i < faces.size(); i += callers) {
+                    face[0] = faces[i];
+                    loader.inference_batch(face, caller_embeddings);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        double total_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        double faces_per_second = 1000.0 * faces.size() / total_ms;
+
+        std::fprintf(output, "{\"callers\":%d,\"sessions\":%d,\"intra_op_threads\":%d,\"faces\":%zu,"
+                     "\"total_ms\":%.1f,\"faces_per_s\":%.1f}\n",
+                     callers, loader.get_session_count(), options.threads, faces.size(), total_ms, faces_per_second);
+        std::fflush(output);
+        std::fprintf(stderr, "%8d %8zu %10.1f %12.1f\n", callers, faces.size(), total_ms, faces_per_second);
+    }
+
+    if (output != stdout) {
+        std::fclose(output);
+    }
+    return 0;
+}
@@ -0,0 +1,456 @@
+/**
+ * @file index_bench.cpp
+ * @brief Gallery index benchmark: build time, memory, latency and recall
+ *
+ * Generates L2-normalized synthetic embeddings with clustered identities
+ * (five noisy samples around each identity center), builds every index mode
+ * at each gallery size and searches held-out queries drawn from the same
+ * identities. Recall@k is measured against the exact float32 scan.
+ *
+ * The exact scan is also timed through search_batch() on frames of
+ * BATCH_FACES queries; it is the only mode with a batched path (the others
+ * search each query of a batch separately), so only "flat" reports batch_qps.
+ *
+ * Each result is printed to stdout as one JSON object per line (JSON Lines),
+ * so runs can be diffed or collected between releases; a readable table goes
+ * to stderr.
+ *
+ * Usage: index_bench [--sizes 1000,20000,100000,500000] [--modes flat,ivf,...]
+ *                    [--queries 200] [--dim 512] [--effort nprobe|efSearch]
+ *                    [--threads n] [--output results.jsonl]
+ */
+
+#include "faiss_index.h"
+#include "hnsw_index.h"
+#include "faiss_library_index.h"
+#include "scan_pool.h"
+#include "vector_kernels.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include <malloc.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int RECALL_K = 5;
+constexpr int SAMPLES_PER_IDENTITY = 5;
+constexpr float SAMPLE_NOISE = 0.045f;  // Per-dimension noise around an identity center
+constexpr size_t ADD_CHUNK = 10000;     // Rows converted and added per add_vectors() call
+constexpr size_t BATCH_FACES = 4;       // Queries per search_batch() call, like faces in a frame
+
+struct Options {
+    std::vector<int> sizes = {1000, 20000, 100000, 500000};
+    std::vector<std::string> modes;
+    int queries = 200;
+    int dimension = 512;
+    int effort = 0;  // nprobe / efSearch; 0 keeps each backend's default
+    int threads = 0;  // Scan threads; 0 keeps Config::SCAN_THREADS
+    std::string output;
+};
+
+struct Dataset {
+    int dimension = 0;
+    size_t count = 0;
+    std::vector<float> rows;                   // count x dimension
+    std::vector<std::vector<float>> queries;
+};
+
+struct Result {
+    std::string mode;
+    std::string backend;
+    int effort = 0;
+    double build_ms = 0.0;
+    double rss_mb = 0.0;
+    double index_mb = -1.0;  // Only backends that report their own footprint
+    double qps = 0.0;
+    double p50_ms = 0.0;
+    double p99_ms = 0.0;
+    double recall_at_1 = 0.0;
+    double recall_at_5 = 0.0;
+    double batch_qps = -1.0;           // Only modes with a batched path
+    double batch_recall_at_1 = 0.0;
+};
+
+double elapsed_ms(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+double resident_mb() {
+    long pages = 0, resident = 0;
+    FILE* statm = std::fopen("/proc/self/statm", "r");
+    if (statm) {
+        if (std::fscanf(statm, "%ld %ld", &pages, &resident) != 2) {
+            resident = 0;
+        }
+        std::fclose(statm);
+    }
+    return static_cast<double>(resident) * sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+}
+
+void normalize(float* vec, int dimension) {
+    float norm = 0.0f;
+    for (int d = 0; d < dimension; d++) {
+        norm += vec[d] * vec[d];
+    }
+    norm = std::sqrt(norm);
+    for (int d = 0; d < dimension; d++) {
+        vec[d] /= norm;
+    }
+}
+
+Dataset make_dataset(size_t count, int dimension, int num_queries) {
+    Dataset data;
+    data.dimension = dimension;
+    data.count = count;
+
+    std::mt19937 rng(static_cast<uint32_t>(count));
+    std::normal_distribution<float> gaussian;
+    size_t identities = std::max<size_t>(1, count / SAMPLES_PER_IDENTITY);
+    std::vector<float> centers(identities * dimension);
+    for (size_t i = 0; i < identities; i++) {
+        float* center = centers.data() + i * dimension;
+        for (int d = 0; d < dimension; d++) {
+            center[d] = gaussian(rng);
+        }
+        normalize(center, dimension);
+    }
+
+    auto sample = [&](size_t identity, float* out) {
+        const float* center = centers.data() + identity * dimension;
+        for (int d = 0; d < dimension; d++) {
+            out[d] = center[d] + SAMPLE_NOISE * gaussian(rng);
+        }
+        normalize(out, dimension);
+    };
+
+    data.rows.resize(count * dimension);
+    for (size_t i = 0; i < count; i++) {
+        sample(i / SAMPLES_PER_IDENTITY % identities, data.rows.data() + i * dimension);
+    }
+
+    // Held-out captures of enrolled identities, like live recognition queries
+    std::uniform_int_distribution<size_t> pick(0, identities - 1);
+    data.queries.assign(num_queries, std::vector<float>(dimension));
+    for (auto& query : data.queries) {
+        sample(pick(rng), query.data());
+    }
+    return data;
+}
+
+std::unique_ptr<VectorIndexBase> create_index(const std::string& mode, int dimension) {
+    if (mode == "flat" || mode == "ivf") {
+        return std::make_unique<FAISSIndex>(dimension, Config::IndexStorage::FLOAT32);
+    }
+    if (mode == "fp16" || mode == "ivf-fp16") {
+        return std::make_unique<FAISSIndex>(dimension, Config::IndexStorage::FP16);
+    }
+    if (mode == "int8" || mode == "ivf-int8") {
+        return std::make_unique<FAISSIndex>(dimension, Config::IndexStorage::INT8);
+    }
+    if (mode == "hnsw") {
+        return std::make_unique<HNSWIndex>(dimension);
+    }
+#ifdef HAVE_FAISS
+    if (mode == "faiss-flat") {
+        return std::make_unique<FaissLibraryIndex>(dimension, Config::FaissIndexType::FLAT_IP);
+    }
+    if (mode == "faiss-ivf") {
+        return std::make_unique<FaissLibraryIndex>(dimension, Config::FaissIndexType::IVF_FLAT);
+    }
+    if (mode == "faiss-hnsw") {
+        return std::make_unique<FaissLibraryIndex>(dimension, Config::FaissIndexType::HNSW_FLAT);
+    }
+    if (mode == "faiss-ivfpq") {
+        return std::make_unique<FaissLibraryIndex>(dimension, Config::FaissIndexType::IVF_PQ);
+    }
+#endif
+    return nullptr;
+}
+
+std::vector<std::string> default_modes() {
+    std::vector<std::string> modes = {"flat", "ivf", "fp16", "int8", "ivf-int8", "hnsw"};
+#ifdef HAVE_FAISS
+    for (const char* mode : {"faiss-flat", "faiss-ivf", "faiss-hnsw", "faiss-ivfpq"}) {
+        modes.push_back(mode);
+    }
+#endif
+    return modes;
+}
+
+bool build(const std::string& mode, const Dataset& data, VectorIndexBase& index) {
+    if (!index.build_index(static_cast<int>(data.count))) {
+        return false;
+    }
+
+    // Row i is stored under id i, so recall compares exact rows
+    std::vector<int> ids;
+    std::vector<std::vector<float>> chunk;
+    for (size_t first = 0; first < data.count; first += ADD_CHUNK) {
+        size_t last = std::min(data.count, first + ADD_CHUNK);
+        ids.clear();
+        chunk.clear();
+        for (size_t i = first; i < last; i++) {
+            const float* row = data.rows.data() + i * data.dimension;
+            ids.push_back(static_cast<int>(i));
+            chunk.emplace_back(row, row + data.dimension);
+        }
+        if (!index.add_vectors(ids, chunk)) {
+            return false;
+        }
+    }
+
+    // "flat", "fp16" and "int8" stay exhaustive scans; "ivf*" always partition
+    auto* flat = dynamic_cast<FAISSIndex*>(&index);
+    if (flat) {
+        if (flat->needs_int8_training() && !flat->train_int8_ranges()) {
+            return false;
+        }
+        if (mode.compare(0, 3, "ivf") == 0 && !flat->train_ivf()) {
+            return false;
+        }
+        return true;
+    }
+    return !index.needs_training() || index.train();
+}
+
+Result run_mode(const std::string& mode, const Dataset& data, int effort,
+                const std::vector<std::vector<int>>& exact, std::vector<std::vector<int>>* exact_out) {
+    Result result;
+    result.mode = mode;
+
+    malloc_trim(0);
+    double rss_before = resident_mb();
+    std::unique_ptr<VectorIndexBase> index = create_index(mode, data.dimension);
+    if (!index) {
+        throw std::runtime_error("unknown mode " + mode);
+    }
+    result.backend = index->get_backend_name();
+
+    auto start = Clock::now();
+    if (!build(mode, data, *index)) {
+        throw std::runtime_error("building " + mode + " failed");
+    }
+    result.build_ms = elapsed_ms(start);
+    if (effort > 0) {
+        index->set_search_effort(effort);
+    }
+    result.effort = index->get_search_effort();
+    result.rss_mb = resident_mb() - rss_before;
+    if (auto* flat = dynamic_cast<FAISSIndex*>(index.get())) {
+        result.index_mb = flat->get_memory_bytes() / (1024.0 * 1024.0);
+        result.effort = flat->is_ivf_trained() ? flat->get_probe_count() : 0;
+    }
+
+    // One query at a time, as the recognizer issues them
+    std::vector<double> latencies;
+    std::vector<std::vector<int>> found;
+    std::vector<double> confidences;
+    auto search_start = Clock::now();
+    for (const auto& query : data.queries) {
+        auto query_start = Clock::now();
+        found.push_back(index->search_k(query, RECALL_K, confidences));
+        latencies.push_back(elapsed_ms(query_start));
+    }
+    double total_ms = elapsed_ms(search_start);
+
+    // The same queries a frame at a time; only the exact scan has a batched path
+    std::vector<std::vector<int>> batch_found;
+    if (mode == "flat") {
+        std::vector<std::vector<std::vector<float>>> frames;
+        for (size_t first = 0; first < data.queries.size(); first += BATCH_FACES) {
+            size_t last = std::min(data.queries.size(), first + BATCH_FACES);
+            frames.emplace_back(data.queries.begin() + first, data.queries.begin() + last);
+        }
+        std::vector<std::vector<double>> batch_confidences;
+        auto batch_start = Clock::now();
+        for (const auto& frame : frames) {
+            for (std::vector<int>& ids : index->search_batch(frame, RECALL_K, batch_confidences)) {
+                batch_found.push_back(std::move(ids));
+            }
+        }
+        result.batch_qps = batch_found.size() / (elapsed_ms(batch_start) / 1000.0);
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    result.qps = latencies.size() / (total_ms / 1000.0);
+    result.p50_ms = latencies[latencies.size() / 2];
+    result.p99_ms = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+
+    if (exact_out) {
+        *exact_out = found;  // This mode is the exact reference
+    }
+    const std::vector<std::vector<int>>& truth = exact_out ? found : exact;
+    size_t hits_at_1 = 0, hits_at_5 = 0;
+    for (size_t q = 0; q < found.size(); q++) {
+        if (!found[q].empty() && !truth[q].empty() && found[q][0] == truth[q][0]) {
+            hits_at_1++;
+        }
+        for (int id : found[q]) {
+            if (std::find(truth[q].begin(), truth[q].end(), id) != truth[q].end()) {
+                hits_at_5++;
+            }
+        }
+    }
+    result.recall_at_1 = static_cast<double>(hits_at_1) / found.size();
+    result.recall_at_5 = static_cast<double>(hits_at_5) / (found.size() * RECALL_K);
+
+    size_t batch_hits = 0;
+    for (size_t q = 0; q < batch_found.size(); q++) {
+        if (!batch_found[q].empty() && !truth[q].empty() && batch_found[q][0] == truth[q][0]) {
+            batch_hits++;
+        }
+    }
+    result.batch_recall_at_1 = batch_found.empty() ? 0.0 : static_cast<double>(batch_hits) / batch_found.size();
+    return result;
+}
+
+std::string to_json(const Result& r, const Dataset& data) {
+    std::ostringstream json;
+    json.setf(std::ios::fixed);
+    json.precision(3);
+    json << "{\"bench\":\"index\",\"mode\":\"" << r.mode << "\",\"backend\":\"" << r.backend << "\""
+         << ",\"kernel\":\"" << VectorKernels::get_active_isa() << "\""
+         << ",\"n\":" << data.count << ",\"dim\":" << data.dimension
+         << ",\"queries\":" << data.queries.size() << ",\"k\":" << RECALL_K << ",\"effort\":" << r.effort
+         << ",\"threads\":" << ScanPool::shared()->get_num_threads()
+         << ",\"build_ms\":" << r.build_ms << ",\"rss_mb\":" << r.rss_mb << ",\"index_mb\":";
+    if (r.index_mb < 0.0) {
+        json << "null";
+    } else {
+        json << r.index_mb;
+    }
+    json << ",\"qps\":" << r.qps << ",\"p50_ms\":" << r.p50_ms << ",\"p99_ms\":" << r.p99_ms
+         << ",\"batch_qps\":";
+    if (r.batch_qps < 0.0) {
+        json << "null";
+    } else {
+        json << r.batch_qps;
+    }
+    json.precision(4);
+    json << ",\"recall_at_1\":" << r.recall_at_1 << ",\"recall_at_5\":" << r.recall_at_5;
+    if (r.batch_qps >= 0.0) {
+        json << ",\"batch_recall_at_1\":" << r.batch_recall_at_1;
+    }
+    json << "}";
+    return json.str();
+}
+
+std::vector<std::string> split(const std::string& list) {
+    std::vector<std::string> items;
+    std::istringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--sizes") {
+            options.sizes.clear();
+            for (const std::string& size : split(value)) {
+                options.sizes.push_back(std::atoi(size.c_str()));
+            }
+        } else if (arg == "--modes") {
+            options.modes = split(value);
+        } else if (arg == "--queries") {
+            options.queries = std::atoi(value.c_str());
+        } else if (arg == "--dim") {
+            options.dimension = std::atoi(value.c_str());
+        } else if (arg == "--effort") {
+            options.effort = std::atoi(value.c_str());
+        } else if (arg == "--threads") {
+            options.threads = std::atoi(value.c_str());
+        } else if (arg == "--output") {
+            options.output = value;
+        } else {
+            return false;
+        }
+    }
+    return options.queries > 0 && options.dimension > 0 &&
+           std::all_of(options.sizes.begin(), options.sizes.end(), [](int n) { return n > 0; });
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--sizes 1000,20000,100000,500000] [--modes "
+                  << "flat,ivf,fp16,int8,ivf-int8,hnsw] [--queries 200] [--dim 512] [--effort n] [--threads n] "
+                  << "[--output file.jsonl]"
+                  << std::endl;
+        return 1;
+    }
+    if (options.modes.empty()) {
+        options.modes = default_modes();
+    }
+    if (options.threads > 0) {
+        ScanPool::set_shared_threads(options.threads);
+    }
+    // The exact scan is the recall reference, so it always runs first
+    options.modes.erase(std::remove(options.modes.begin(), options.modes.end(), "flat"), options.modes.end());
+    options.modes.insert(options.modes.begin(), "flat");
+
+    FILE* output = stdout;
+    if (!options.output.empty()) {
+        output = std::fopen(options.output.c_str(), "a");
+        if (!output) {
+            std::cerr << "Error: Could not open " << options.output << std::endl;
+            return 1;
+        }
+    }
+
+    // Index progress messages go to std::cout; keep stdout for the JSON lines
+    std::cout.setstate(std::ios::failbit);
+
+    std::fprintf(stderr, "Scan threads: %d\n", ScanPool::shared()->get_num_threads());
+    std::fprintf(stderr, "%-10s %8s %10s %9s %9s %9s %8s %8s %8s %10s\n",
+                 "mode", "n", "build_ms", "rss_mb", "qps", "p50_ms", "p99_ms", "R@1", "R@5", "batch_qps");
+    for (int size : options.sizes) {
+        Dataset data = make_dataset(static_cast<size_t>(size), options.dimension, options.queries);
+        std::vector<std::vector<int>> exact;
+        for (const std::string& mode : options.modes) {
+            try {
+                Result result = run_mode(mode, data, options.effort, exact, mode == "flat" ? &exact : nullptr);
+                std::fprintf(output, "%s\n", to_json(result, data).c_str());
+                std::fflush(output);
+                std::fprintf(stderr, "%-10s %8zu %10.1f %9.1f %9.1f %9.3f %8.3f %8.4f %8.4f ",
+                             result.mode.c_str(), data.count, result.build_ms, result.rss_mb, result.qps,
+                             result.p50_ms, result.p99_ms, result.recall_at_1, result.recall_at_5);
+                if (result.batch_qps < 0.0) {
+                    std::fprintf(stderr, "%10s\n", "-");
+                } else {
+                    std::fprintf(stderr, "%10.1f\n", result.batch_qps);
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Error: " << mode << " at n=" << size << ": " << e.what() << std::endl;
+            }
+        }
+    }
+
+    if (output != stdout) {
+        std::fclose(output);
+    }
+    return 0;
+}
@@ -0,0 +1,309 @@
+/**
+ * @file model_compare.cpp
+ * @brief FP32 against INT8 ArcFace: embedding drift, recall@1 and latency
+ *
+ * Crops the largest face of every photo in a labeled folder (one
+ * subdirectory per person, the dataset/ layout) exactly as training does,
+ * embeds each crop with both models through ModelLoader, one face per call,
+ * and reports:
+ *   - cosine similarity between the FP32 and INT8 embedding of each face
+ *     (mean, 1st percentile, minimum)
+ *   - leave-one-out recall@1 for each model, and for INT8 queries against an
+ *     FP32 gallery (a kiosk that switched models without retraining)
+ *   - p50 and mean latency per face for each model
+ *
+ * With --export-crops the face crops are written to DIR/<person>/ instead,
+ * as calibration faces for tools/quantize_arcface.py.
+ *
+ * The result is printed to stdout as one JSON object (JSON Lines); a
+ * readable summary goes to stderr.
+ *
+ * Usage: model_compare [--fp32 models/arcface_w600k_r50.onnx]
+ *                      [--int8 models/arcface_w600k_r50_int8.onnx]
+ *                      [--dataset dataset] [--export-crops DIR] [--output results.jsonl]
+ */
+
+#include "model_loader.h"
+#include "face_detector.h"
+#include "config.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string fp32_model = Config::ARCFACE_FP32_MODEL_PATH;
+    std::string int8_model = Config::ARCFACE_INT8_MODEL_PATH;
+    std::string dataset = "dataset";
+    std::string export_crops;
+    std::string output;
+};
+
+struct LabeledFace {
+    cv::Mat crop;
+    int label;
+    std::string person;
+    std::string file;
+};
+
+struct ModelRun {
+    std::string quantization;
+    std::vector<std::vector<float>> embeddings;  // Empty for faces the model failed on
+    std::vector<double> latencies_ms;
+};
+
+bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--fp32") {
+            options.fp32_model = value;
+        } else if (arg == "--int8") {
+            options.int8_model = value;
+        } else if (arg == "--dataset") {
+            options.dataset = value;
+        } else if (arg == "--export-crops") {
+            options.export_crops = value;
+        } else if (arg == "--output") {
+            options.output = value;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool is_image(const fs::path& path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == ".jpg" || extension == ".jpeg" || extension == ".png" || extension == ".bmp";
+}
+
+// Largest face of every photo, labeled by its person directory
+std::vector<LabeledFace> load_faces(const std::string& dataset, FaceDetector& detector) {
+    std::vector<LabeledFace> faces;
+    std::vector<fs::path> people;
+    for (const auto& entry : fs::directory_iterator(dataset)) {
+        if (entry.is_directory()) {
+            people.push_back(entry.path());
+        }
+    }
+    std::sort(people.begin(), people.end());
+
+    for (size_t label = 0; label < people.size(); label++) {
+        std::vector<fs::path> files;
+        for (const auto& entry : fs::directory_iterator(people[label])) {
+            if (entry.is_regular_file() && is_image(entry.path())) {
+                files.push_back(entry.path());
+            }
+        }
+        std::sort(files.begin(), files.end());
+
+        for (const fs::path& file : files) {
+            cv::Mat image = cv::imread(file.string());
+            if (image.empty()) {
+                continue;
+            }
+            cv::Rect region = detector.largest_face_region(image);
+            if (region.empty()) {
+                continue;
+            }
+            faces.push_back({image(region).clone(), static_cast<int>(label),
+                             people[label].filename().string(), file.filename().string()});
+        }
+    }
+    return faces;
+}
+
+bool embed_all(const std::string& model_path, const std::vector<LabeledFace>& faces, ModelRun& run) {
+    ModelLoader loader;
+    loader.set_session_count(1);
+    if (!loader.load_model(model_path)) {
+        return false;
+    }
+    run.quantization = loader.get_quantization().empty() ? "fp32" : loader.get_quantization();
+
+    std::vector<cv::Mat> face(1);
+    std::vector<std::vector<float>> output;
+    face[0] = faces[0].crop;
+    loader.inference_batch(face, output);  // Warm-up
+
+    for (const LabeledFace& labeled : faces) {
+        face[0] = labeled.crop;
+        auto start = Clock::now();
+        loader.inference_batch(face, output);
+        run.latencies_ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        run.embeddings.push_back(output.empty() ? std::vector<float>() : output[0]);
+    }
+    return true;
+}
+
+float dot(const std::vector<float>& a, const std::vector<float>& b) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < a.size() && i < b.size(); i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+// Leave-one-out: is each query's nearest other gallery face the same person?
+// Only faces whose person has another face count.
+double recall_at_1(const std::vector<LabeledFace>& faces, const std::vector<std::vector<float>>& queries,
+                   const std::vector<std::vector<float>>& gallery) {
+    size_t evaluated = 0;
+    size_t correct = 0;
+    for (size_t i = 0; i < faces.size(); i++) {
+        if (queries[i].empty()) {
+            continue;
+        }
+        int best = -1;
+        float best_score = -2.0f;
+        bool has_mate = false;
+        for (size_t j = 0; j < faces.size(); j++) {
+            if (j == i || gallery[j].empty()) {
+                continue;
+            }
+            has_mate = has_mate || faces[j].label == faces[i].label;
+            float score = dot(queries[i], gallery[j]);
+            if (score > best_score) {
+                best_score = score;
+                best = static_cast<int>(j);
+            }
+        }
+        if (!has_mate) {
+            continue;
+        }
+        evaluated++;
+        correct += (best >= 0 && faces[best].label == faces[i].label) ? 1 : 0;
+    }
+    return evaluated > 0 ? static_cast<double>(correct) / evaluated : 0.0;
+}
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+    return values[std::min(rank, values.size() - 1)];
+}
+
+double mean(const std::vector<double>& values) {
+    double sum = 0.0;
+    for (double value : values) {
+        sum += value;
+    }
+    return values.empty() ? 0.0 : sum / values.size();
+}
+
+int export_crops(const std::vector<LabeledFace>& faces, const std::string& directory) {
+    size_t written = 0;
+    for (const LabeledFace& face : faces) {
+        fs::path person_dir = fs::path(directory) / face.person;
+        fs::create_directories(person_dir);
+        fs::path path = person_dir / fs::path(face.file).replace_extension(".png");
+        if (!cv::imwrite(path.string(), face.crop)) {
+            std::cerr << "Error: Could not write " << path << std::endl;
+            return 1;
+        }
+        written++;
+    }
+    std::fprintf(stderr, "Wrote %zu face crops to %s\n", written, directory.c_str());
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--fp32 file.onnx] [--int8 file.onnx] [--dataset dir] "
+                  << "[--export-crops dir] [--output file.jsonl]" << std::endl;
+        return 1;
+    }
+    if (!fs::is_directory(options.dataset)) {
+        std::cerr << "Error: " << options.dataset << " is not a directory" << std::endl;
+        return 1;
+    }
+
+    FaceDetector detector;
+    if (!detector.initialize()) {
+        std::cerr << "Error: Could not initialize the face detector" << std::endl;
+        return 1;
+    }
+    std::vector<LabeledFace> faces = load_faces(options.dataset, detector);
+    if (faces.empty()) {
+        std::cerr << "Error: No faces found in " << options.dataset << std::endl;
+        return 1;
+    }
+    if (!options.export_crops.empty()) {
+        return export_crops(faces, options.export_crops);
+    }
+
+    ModelRun fp32;
+    ModelRun int8;
+    if (!embed_all(options.fp32_model, faces, fp32) || !embed_all(options.int8_model, faces, int8)) {
+        return 1;
+    }
+
+    std::vector<double> cosines;
+    for (size_t i = 0; i < faces.size(); i++) {
+        if (!fp32.embeddings[i].empty() && !int8.embeddings[i].empty()) {
+            cosines.push_back(dot(fp32.embeddings[i], int8.embeddings[i]));
+        }
+    }
+    double cosine_mean = mean(cosines);
+    double cosine_p1 = percentile(cosines, 0.01);
+    double cosine_min = cosines.empty() ? 0.0 : *std::min_element(cosines.begin(), cosines.end());
+
+    double recall_fp32 = recall_at_1(faces, fp32.embeddings, fp32.embeddings);
+    double recall_int8 = recall_at_1(faces, int8.embeddings, int8.embeddings);
+    double recall_mixed = recall_at_1(faces, int8.embeddings, fp32.embeddings);
+
+    double fp32_p50 = percentile(fp32.latencies_ms, 0.50);
+    double int8_p50 = percentile(int8.latencies_ms, 0.50);
+    double fp32_mean = mean(fp32.latencies_ms);
+    double int8_mean = mean(int8.latencies_ms);
+    int people = faces.back().label + 1;
+
+    FILE* output = stdout;
+    if (!options.output.empty()) {
+        output = std::fopen(options.output.c_str(), "a");
+        if (!output) {
+            std::cerr << "Error: Could not open " << options.output << std::endl;
+            return 1;
+        }
+    }
+    std::fprintf(output, "{\"faces\":%zu,\"people\":%d,\"quantization\":\"%s\",\"cosine_mean\":%.5f,"
+                 "\"cosine_p1\":%.5f,\"cosine_min\":%.5f,\"recall1_fp32\":%.4f,\"recall1_int8\":%.4f,"
+                 "\"recall1_int8_vs_fp32_gallery\":%.4f,\"fp32_ms_p50\":%.2f,\"fp32_ms_mean\":%.2f,"
+                 "\"int8_ms_p50\":%.2f,\"int8_ms_mean\":%.2f,\"speedup\":%.2f}\n",
+                 faces.size(), people, int8.quantization.c_str(), cosine_mean, cosine_p1, cosine_min,
+                 recall_fp32, recall_int8, recall_mixed, fp32_p50, fp32_mean, int8_p50, int8_mean,
+                 int8_mean > 0.0 ? fp32_mean / int8_mean : 0.0);
+    std::fflush(output);
+    if (output != stdout) {
+        std::fclose(output);
+    }
+
+    std::fprintf(stderr, "%zu faces of %d people, %s against fp32\n", faces.size(), people,
+                 int8.quantization.c_str());
+    std::fprintf(stderr, "  cosine(fp32, int8): mean %.4f, p1 %.4f, min %.4f\n", cosine_mean, cosine_p1, cosine_min);
+    std::fprintf(stderr, "  recall@1: fp32 %.4f, int8 %.4f, int8 queries on fp32 gallery %.4f\n",
+                 recall_fp32, recall_int8, recall_mixed);
+    std::fprintf(stderr, "  ms per face: fp32 p50 %.2f mean %.2f, int8 p50 %.2f mean %.2f (%.2fx)\n",
+                 fp32_p50, fp32_mean, int8_p50, int8_mean, int8_mean > 0.0 ? fp32_mean / int8_mean : 0.0);
+    return 0;
+}
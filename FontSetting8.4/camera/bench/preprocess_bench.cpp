@@ -0,0 +1,158 @@
+/**
+ * @file preprocess_bench.cpp
+ * @brief Fused face preprocessing: SIMD kernel against the scalar reference
+ *
+ * Preprocesses random 8-bit face crops of several sizes and channel counts
+ * into a 112x112 CHW tensor, once with the kernel selected for this CPU and
+ * once with the scalar reference. The crops are ROIs inside a wider frame,
+ * as the camera pipeline passes them. Both outputs must be bit-identical;
+ * the exit status is 1 if any differ.
+ *
+ * Each result is printed to stdout as one JSON object per line (JSON Lines);
+ * a readable table goes to stderr.
+ *
+ * Usage: preprocess_bench [--sizes 64,112,160,256,480] [--channels 1,3,4]
+ *                         [--iterations 2000] [--output results.jsonl]
+ */
+
+#include "face_preprocess.h"
+#include "config.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int OUTPUT_SIZE = 112;     // ArcFace input width and height
+constexpr int FRAME_MARGIN = 37;     // Extra frame columns around the crop, so stride != width
+
+struct Options {
+    std::vector<int> sizes = {64, 112, 160, 256, 480};
+    std::vector<int> channels = {1, 3, 4};
+    int iterations = 2000;
+    std::string output;
+};
+
+std::vector<int> parse_list(const std::string& list) {
+    std::vector<int> items;
+    std::istringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(std::atoi(item.c_str()));
+        }
+    }
+    return items;
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--sizes") {
+            options.sizes = parse_list(value);
+        } else if (arg == "--channels") {
+            options.channels = parse_list(value);
+        } else if (arg == "--iterations") {
+            options.iterations = std::atoi(value.c_str());
+        } else if (arg == "--output") {
+            options.output = value;
+        } else {
+            return false;
+        }
+    }
+    auto positive = [](int v) { return v > 0; };
+    return options.iterations > 0 && !options.sizes.empty() && !options.channels.empty() &&
+           std::all_of(options.sizes.begin(), options.sizes.end(), positive) &&
+           std::all_of(options.channels.begin(), options.channels.end(),
+                       [](int c) { return c == 1 || c == 3 || c == 4; });
+}
+
+using PreprocessFn = bool (*)(const FacePreprocess::SourceImage&, float*, int, int, float, float);
+
+// Mean microseconds per face
+double time_preprocess(PreprocessFn fn, const FacePreprocess::SourceImage& source, float* chw, int iterations) {
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        fn(source, chw, OUTPUT_SIZE, OUTPUT_SIZE, Config::ARCFACE_NORM_MEAN, Config::ARCFACE_NORM_SCALE);
+    }
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / iterations;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--sizes 64,112,160,256,480] [--channels 1,3,4] "
+                  << "[--iterations 2000] [--output file.jsonl]" << std::endl;
+        return 1;
+    }
+
+    FILE* output = stdout;
+    if (!options.output.empty()) {
+        output = std::fopen(options.output.c_str(), "a");
+        if (!output) {
+            std::cerr << "Error: Could not open " << options.output << std::endl;
+            return 1;
+        }
+    }
+
+    const char* isa = FacePreprocess::get_active_isa();
+    std::vector<float> reference(3 * OUTPUT_SIZE * OUTPUT_SIZE);
+    std::vector<float> result(reference.size());
+    std::mt19937 rng(42);
+    bool all_exact = true;
+
+    std::fprintf(stderr, "Selected kernel: %s\n", isa);
+    std::fprintf(stderr, "%8s %8s %8s %12s %12s %8s %8s\n", "source", "channels", "isa", "scalar_us",
+                 "simd_us", "speedup", "exact");
+    for (int size : options.sizes) {
+        for (int channels : options.channels) {
+            // The crop sits inside a wider frame, like a detection ROI
+            size_t stride = static_cast<size_t>(size + 2 * FRAME_MARGIN) * channels;
+            std::vector<uint8_t> frame(stride * (size + 2));
+            for (uint8_t& byte : frame) {
+                byte = static_cast<uint8_t>(rng());
+            }
+            FacePreprocess::SourceImage source{frame.data() + stride + FRAME_MARGIN * channels,
+                                               size, size, stride, channels};
+
+            FacePreprocess::preprocess_scalar(source, reference.data(), OUTPUT_SIZE, OUTPUT_SIZE,
+                                              Config::ARCFACE_NORM_MEAN, Config::ARCFACE_NORM_SCALE);
+            FacePreprocess::preprocess(source, result.data(), OUTPUT_SIZE, OUTPUT_SIZE,
+                                       Config::ARCFACE_NORM_MEAN, Config::ARCFACE_NORM_SCALE);
+            bool exact = std::memcmp(reference.data(), result.data(), reference.size() * sizeof(float)) == 0;
+            all_exact = all_exact && exact;
+
+            double scalar_us = time_preprocess(FacePreprocess::preprocess_scalar, source, reference.data(),
+                                               options.iterations);
+            double simd_us = time_preprocess(FacePreprocess::preprocess, source, result.data(),
+                                             options.iterations);
+
+            std::fprintf(output, "{\"source\":%d,\"channels\":%d,\"isa\":\"%s\",\"scalar_us\":%.2f,"
+                         "\"simd_us\":%.2f,\"speedup\":%.2f,\"exact\":%s}\n",
+                         size, channels, isa, scalar_us, simd_us, scalar_us / simd_us, exact ? "true" : "false");
+            std::fflush(output);
+            std::fprintf(stderr, "%8d %8d %8s %12.2f %12.2f %8.2f %8s\n", size, channels, isa, scalar_us,
+                         simd_us, scalar_us / simd_us, exact ? "yes" : "NO");
+        }
+    }
+
+    if (output != stdout) {
+        std::fclose(output);
+    }
+    return all_exact ? 0 : 1;
+}
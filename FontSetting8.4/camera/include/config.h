@@ -143,8 +143,224 @@ namespace Config {
     /// Normalization scale for ArcFace preprocessing
     constexpr float ARCFACE_NORM_SCALE = 128.0f;
 
+    /// Faces packed into one session call by ModelLoader::inference_batch()
+    /// Models exported with a fixed batch axis use their own batch size instead
+    constexpr int ARCFACE_MAX_BATCH = 8;
+
+    /// ArcFace sessions in ModelLoader's pool; more concurrent callers wait for one.
+    /// The sessions share one environment and one copy of the prepacked weights
+    constexpr int ARCFACE_SESSIONS = 2;
+
+    /// Intra-op threads shared by every inference session (0 = one per core).
+    /// Concurrent session calls split this budget instead of each bringing their own pool
+    constexpr int INFERENCE_INTRA_OP_THREADS = 4;
+
+    /// Inter-op threads shared by every inference session (used by parallel execution only)
+    constexpr int INFERENCE_INTER_OP_THREADS = 1;
+
+    /// FP32 model (InsightFace w600k_r50), relative to application directory
+    constexpr const char* ARCFACE_FP32_MODEL_PATH = "models/arcface_w600k_r50.onnx";
+
+    /// INT8-quantized model written by `make quantize-model`
+    constexpr const char* ARCFACE_INT8_MODEL_PATH = "models/arcface_w600k_r50_int8.onnx";
+
+    /// Load the INT8 model instead of the FP32 one. Its embeddings differ
+    /// slightly, so retrain from the dataset after switching (compare the
+    /// two first with `make compare-models`)
+    constexpr bool ARCFACE_USE_INT8 = false;
+
     /// Model file path relative to application directory
-    extern const char* ARCFACE_MODEL_PATH;
+    constexpr const char* ARCFACE_MODEL_PATH = ARCFACE_USE_INT8 ? ARCFACE_INT8_MODEL_PATH : ARCFACE_FP32_MODEL_PATH;
+
+    // ========================
+    // FAISS Index Parameters
+    // ========================
+
+    /// Gallery search backends
+    enum class IndexBackend {
+        FLAT,          ///< Exact SIMD scan, IVF-partitioned once the gallery is large if IVF_ENABLED
+        HNSW,          ///< Hierarchical navigable small-world graph (approximate, incremental)
+        FAISS_LIBRARY  ///< libfaiss index of type FAISS_INDEX_TYPE (needs faiss/lib/libfaiss.so at build time)
+    };
+
+    /// Backend used by DeepFaceRecognizer
+    constexpr IndexBackend INDEX_BACKEND = IndexBackend::FLAT;
+
+    /// libfaiss index types for IndexBackend::FAISS_LIBRARY
+    /// Without libfaiss, FLAT_IP/IVF_FLAT/IVF_PQ fall back to FLAT and HNSW_FLAT to HNSW
+    enum class FaissIndexType {
+        FLAT_IP,    ///< faiss::IndexFlatIP (exact)
+        IVF_FLAT,   ///< faiss::IndexIVFFlat, trained at IVF_MIN_VECTORS
+        HNSW_FLAT,  ///< faiss::IndexHNSWFlat (HNSW_M, HNSW_EF_CONSTRUCTION, HNSW_EF_SEARCH)
+        IVF_PQ      ///< faiss::IndexIVFPQ, compressed to FAISS_PQ_SUBQUANTIZERS bytes per vector
+    };
+
+    /// Index type built by IndexBackend::FAISS_LIBRARY
+    constexpr FaissIndexType FAISS_INDEX_TYPE = FaissIndexType::IVF_FLAT;
+
+    /// IVF_PQ sub-quantizers (bytes per vector at 8 bits); must divide the embedding dimension
+    constexpr int FAISS_PQ_SUBQUANTIZERS = 64;
+
+    /// IVF_PQ bits per sub-quantizer code
+    /// PQ training needs about 39 * 2^bits vectors, so IVF_PQ trains later than IVF_FLAT
+    constexpr int FAISS_PQ_BITS = 8;
+
+    /// Partition the flat backend's gallery with IVF (inverted-file) lists once it is large
+    /// Off by default: IVF is approximate, and on index_bench's synthetic gallery it only
+    /// beats the exact (parallel) scan ~1.5x at 100k rows at IVF_PROBE_FRACTION's recall
+    constexpr bool IVF_ENABLED = false;
+
+    /// Gallery size at which the IVF partitioning is trained (IVF_ENABLED, IVF_FLAT, IVF_PQ)
+    /// Smaller galleries are scanned exhaustively, which is already sub-millisecond
+    constexpr int IVF_MIN_VECTORS = 2000;
+
+    /// Fraction of the inverted lists probed per query, unless set_search_effort() sets nprobe
+    /// Target recall@1 >= 0.98 against the exact scan. index_bench (synthetic, 512-d):
+    /// 0.5 gives 0.985 at 5k rows / 64 lists, 0.995 at 20k / 128 and 0.98 at 100k / 256,
+    /// where a fixed nprobe of 16 gave 0.955, 0.905 and 0.885
+    constexpr double IVF_PROBE_FRACTION = 0.5;
+
+    /// Lloyd iterations used when training IVF centroids
+    constexpr int IVF_TRAINING_ITERATIONS = 10;
+
+    /// Training sample cap per centroid (bounds k-means cost on large galleries)
+    constexpr int IVF_MAX_TRAINING_POINTS_PER_CLUSTER = 256;
+
+    /// Storage format of gallery vectors in RAM (flat/IVF backend)
+    enum class IndexStorage {
+        FLOAT32,  ///< Full precision, 4 bytes per dimension
+        FP16,     ///< Half precision, 2 bytes per dimension
+        INT8      ///< Per-dimension scale/offset, 1 byte per dimension
+    };
+
+    /// Storage used by the flat/IVF backend
+    /// Quantized modes keep the float rows in a spill file for the exact rerank
+    constexpr IndexStorage INDEX_STORAGE = IndexStorage::FLOAT32;
+
+    /// Candidates re-scored with full-precision vectors in quantized modes
+    constexpr int QUANTIZED_RERANK_CANDIDATES = 32;
+
+    /// Rows scanned per block by FAISSIndex::search_batch() (sized for L1/L2)
+    constexpr int BATCH_SEARCH_BLOCK_BYTES = 32 * 1024;
+
+    /// Threads (including the searching thread) that scan one large gallery in parallel
+    /// 0 = all hardware threads, 1 = single-threaded; ScanPool::set_shared_threads() overrides it
+    constexpr int SCAN_THREADS = 0;
+
+    /// Galleries with fewer rows are scanned on the calling thread only
+    /// (waking the workers costs more than it saves on small scans)
+    constexpr int PARALLEL_SCAN_MIN_ROWS = 20000;
+
+    /// Rows handed to a scan thread at a time (sized for L2, so partitions balance across cores)
+    constexpr int SCAN_PARTITION_BYTES = 256 * 1024;
+
+    /// How search_identities() scores a person with several gallery embeddings
+    enum class IdentityAggregation {
+        BEST,        ///< Closest embedding of the person
+        MEAN_TOP_M   ///< Mean over the person's IDENTITY_TOP_M closest embeddings
+    };
+
+    /// Aggregation used by DeepFaceRecognizer::recognize_top_k()
+    constexpr IdentityAggregation IDENTITY_AGGREGATION = IdentityAggregation::BEST;
+
+    /// Embeddings per person averaged by MEAN_TOP_M
+    constexpr int IDENTITY_TOP_M = 3;
+
+    /// Approximate backends fetch k * m * this many rows before aggregating by person
+    constexpr int IDENTITY_CANDIDATE_FACTOR = 4;
+
+    /// Filtered searches that allow at most this fraction of the gallery's people
+    /// score those people's rows directly (via the per-person directory) instead
+    /// of scanning or probing the whole index and skipping excluded rows
+    constexpr double FILTER_DIRECT_SCAN_FRACTION = 0.1;
+
+    /// Two-stage search in the flat float32 backend: score the query against one
+    /// prototype per person (normalized mean of their rows), then rerank every row
+    /// of the best PROTOTYPE_RERANK_PEOPLE people exactly
+    constexpr bool PROTOTYPE_PREFILTER = true;
+
+    /// People whose rows are reranked exactly after the prototype stage
+    /// Range: 8-256 (higher = closer to brute force, slower)
+    constexpr int PROTOTYPE_RERANK_PEOPLE = 32;
+
+    /// Galleries with fewer rows per person than this are scanned row by row
+    /// (a prototype per person would save almost nothing)
+    constexpr double PROTOTYPE_MIN_ROWS_PER_PERSON = 2.0;
+
+    /// Gallery size at which int8 ranges are fitted to the data (default range is [-1, 1])
+    constexpr int INT8_MIN_TRAINING_VECTORS = 100;
+
+    /// Directory for the float spill file of quantized galleries (should not be tmpfs)
+    constexpr const char* INDEX_SPILL_DIRECTORY = ".";
+
+    /// Also verify the row and code checksums when loading the index file. Off by
+    /// default: it reads every page at startup, which defeats the mapping. The
+    /// header, section table and the small sections (norms, person ids, IVF,
+    /// int8 ranges) are always verified, and saves are fsync'd before the rename
+    constexpr bool INDEX_VERIFY_CHECKSUMS = false;
+
+    /// Enrollments are appended to "<index file>.wal" instead of rewriting the index;
+    /// once the log holds this many records it is merged into the index file in the background
+    constexpr int INDEX_LOG_COMPACT_RECORDS = 256;
+
+    /// Deleted people leave tombstoned rows that searches skip; once they make up
+    /// this fraction of the gallery, a compacted index is rebuilt in the background
+    constexpr double INDEX_COMPACT_DELETED_FRACTION = 0.2;
+
+    /// Embeddings kept per person in the search index (0 = unlimited)
+    /// A person captured more often is condensed in the background to this many
+    /// representatives; the database keeps every capture, and retraining condenses again
+    constexpr int MAX_EMBEDDINGS_PER_PERSON = 8;
+
+    /// How a person over MAX_EMBEDDINGS_PER_PERSON is condensed
+    enum class CondensationMode {
+        MEDOIDS,  ///< The MAX_EMBEDDINGS_PER_PERSON captures that best cover the rest
+        CENTROID  ///< One similarity-weighted mean (smallest index, loses pose/lighting spread)
+    };
+
+    /// Condensation used by DeepFaceRecognizer
+    constexpr CondensationMode CONDENSATION_MODE = CondensationMode::MEDOIDS;
+
+    /// Newest captures considered when condensing a person (bounds the O(n²) similarity matrix)
+    constexpr int CONDENSATION_MAX_SAMPLES = 256;
+
+    /// Captures a condensed person may gain before being condensed again
+    /// Enrollment condenses once a person reaches MAX_EMBEDDINGS_PER_PERSON + this many
+    /// indexed embeddings, so each pass (tombstones, log records) covers this many captures
+    constexpr int CONDENSATION_MARGIN = 8;
+
+    /// Dropped captures searched after condensing, to report whether they still find their person
+    constexpr int CONDENSATION_RECALL_SAMPLES = 16;
+
+    /// Principal components the gallery and queries are projected onto before indexing (0 = off)
+    /// Trained from the gallery on retrain; 128 or 256 cut index memory and scan time 2-4x.
+    /// Projected similarities differ from raw ones, so recalibrate CONFIDENCE_THRESHOLD when enabling it
+    constexpr int PCA_DIMENSION = 0;
+
+    /// Scale each principal component to unit variance (whitening) after projecting
+    constexpr bool PCA_WHITEN = false;
+
+    /// Gallery size below which no projection is trained (the covariance would be noise)
+    constexpr int PCA_MIN_TRAINING_VECTORS = 1000;
+
+    /// Embeddings sampled for the covariance when training the projection
+    constexpr int PCA_MAX_TRAINING_VECTORS = 50000;
+
+    /// Payload bytes per checksummed chunk of a gallery snapshot (gallery_snapshot.h)
+    /// Export and import hold about one chunk in memory, whatever the gallery size
+    constexpr size_t SNAPSHOT_CHUNK_BYTES = 4 * 1024 * 1024;
+
+    /// HNSW links per node on upper layers (layer 0 keeps 2*M)
+    /// Range: 8-48 (higher = better recall, more memory and slower inserts)
+    constexpr int HNSW_M = 16;
+
+    /// HNSW candidate list size while inserting
+    /// Range: 100-400 (higher = better graph quality, slower inserts)
+    constexpr int HNSW_EF_CONSTRUCTION = 200;
+
+    /// HNSW candidate list size while searching
+    /// Range: k-512 (higher = better recall, slower search)
+    constexpr int HNSW_EF_SEARCH = 64;
 
     // ========================
     // Threading and Queue Parameters
@@ -170,6 +386,23 @@ namespace Config {
     /// Recommended images per person for best results
     constexpr int RECOMMENDED_IMAGES_PER_PERSON = 5;
 
+    /// What a capture does when the face already matches a different enrolled person
+    enum class DuplicateCapturePolicy {
+        REFUSE,  ///< Reject the capture and report the matching people
+        MERGE,   ///< Enroll the photo under the best-matching person instead
+        ALLOW    ///< Enroll under the requested ID anyway (logged as a warning)
+    };
+
+    /// Policy applied by the capture dialog and the capture socket command
+    constexpr DuplicateCapturePolicy DUPLICATE_CAPTURE_POLICY = DuplicateCapturePolicy::REFUSE;
+
+    /// Similarity (0-1) at which a captured face counts as an enrolled person
+    /// Stricter than RECOGNITION_CONFIDENCE_THRESHOLD so a lookalike is not refused
+    constexpr double DUPLICATE_FACE_SIMILARITY = 0.80;
+
+    /// Matching people listed in a refused capture's message
+    constexpr int DUPLICATE_FACE_REPORT_LIMIT = 3;
+
     // ========================
     // Database Parameters
     // ========================
@@ -2,15 +2,20 @@
 #define DEEP_FACE_RECOGNIZER_H
 
 #include "model_loader.h"
-#include "faiss_index.h"
+#include "vector_index_base.h"
 #include "face_database.h"
 #include "face_detector.h"
 #include "face_recognizer_base.h"
+#include "index_log.h"
 #include <opencv2/opencv.hpp>
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
 
 /**
  * @brief Deep learning-based face recognizer using ArcFace + FAISS
@@ -19,27 +24,62 @@
  * and FAISS for fast similarity search. Suitable for large-scale applications
  * supporting 20,000+ people.
  *
- * @thread_safety NOT thread-safe for recognize() calls. Database and index
- *                operations should be synchronized by caller.
+ * @thread_safety Recognition may run while another thread trains or enrolls.
+ *                The search index is published as an immutable snapshot:
+ *                recognize*() take the current snapshot without waiting, and
+ *                writers (training, enrollment, loading) build a replacement
+ *                and swap it in atomically. Writers are serialized internally.
  */
 class DeepFaceRecognizer : public FaceRecognizerBase {
 private:
     std::unique_ptr<ModelLoader> model_loader;
-    std::unique_ptr<FAISSIndex> faiss_index;
+    // Published search index (Flat/IVF or HNSW, see Config::INDEX_BACKEND).
+    // Only accessed through current_index() / publish_index(); never modified
+    // after publication.
+    std::shared_ptr<VectorIndexBase> vector_index;
+    std::mutex index_update_mutex;  // Serializes writers that publish a new index
+    Config::IndexBackend index_backend = Config::INDEX_BACKEND;
     std::unique_ptr<FaceDetector> face_detector;  // For detecting faces in training images
 
     std::map<int, std::string> person_id_to_name;
     std::map<std::string, int> name_to_person_id;
+    mutable std::mutex labels_mutex;  // Guards both label maps
+
+    // Access groups (zones, shifts) as person bitmaps, loaded with the labels.
+    // Kept beside the index rather than in it, so membership changes never
+    // republish the index. The access filter is the union of the groups this
+    // camera admits; recognition only matches people it allows.
+    std::map<std::string, PersonFilter> group_filters;
+    std::vector<std::string> access_groups;  // Empty: everyone is admitted
+    std::shared_ptr<const PersonFilter> access_filter;  // atomic_load / atomic_store
+    mutable std::mutex groups_mutex;  // Guards group_filters and access_groups
 
     double confidence_threshold = 0.70;  // 70% threshold for reliable face recognition
     int min_face_size_for_recognition = 80;  // Minimum face size (width/height) for reliable recognition (>70% confidence)
     FaceDatabase* db = nullptr;
-    bool model_trained = false;
+    std::atomic<bool> model_trained{false};
     std::string model_path;
+    uint64_t model_hash = 0;  // Checksum of the ONNX model file, stamped into saved indexes
+
+    // Index persistence: full saves on (re)training, logged appends in between
+    std::string index_path = "faiss_index.bin";
+    IndexLog index_log;                    // "<index_path>.wal"
+    std::mutex index_file_mutex;           // Serializes writers of index_path
+    std::thread compaction_thread;
+    std::atomic<bool> compaction_running{false};
+    std::thread row_compaction_thread;     // Drops tombstoned rows from the live index and trains it
+    std::atomic<bool> row_compaction_running{false};
+
+    // People over Config::MAX_EMBEDDINGS_PER_PERSON + Config::CONDENSATION_MARGIN, condensed one at a time
+    // by a background thread that exits once the queue is empty
+    std::set<int> condensation_queue;
+    std::mutex condensation_mutex;         // Guards the queue, the thread handle and the flag
+    std::thread condensation_thread;
+    bool condensation_running = false;
 
 public:
     DeepFaceRecognizer();
-    ~DeepFaceRecognizer() = default;
+    ~DeepFaceRecognizer();
 
     // Model and database setup
     bool load_model(const std::string& onnx_model_path);
@@ -53,9 +93,41 @@ public:
     bool retrain_model() override;
     bool add_training_data(const cv::Mat& face_image, int person_id) override;
 
+    // Gallery maintenance. Rows are tombstoned in the published index (no
+    // rebuild); once Config::INDEX_COMPACT_DELETED_FRACTION of the index is
+    // deleted, a background pass rebuilds it without them.
+    int remove_person(int person_id);  // Index only; returns embeddings removed
+    bool replace_person_embeddings(int person_id, const std::vector<std::vector<float>>& embeddings);
+    bool delete_person(int person_id);  // Database, index and labels
+    bool compact_deleted_rows();  // Also runs the backend's training (needs_training())
+    // Reduce a person's indexed embeddings to Config::MAX_EMBEDDINGS_PER_PERSON
+    // representatives of their stored captures (the database keeps them all).
+    // Runs in the background once enrollments take a person
+    // Config::CONDENSATION_MARGIN captures past the budget.
+    bool condense_person(int person_id);
+
+    // Access groups. Recognition (including recognize_batch) only matches
+    // people in one of the access groups; a person outside them is "Unknown"
+    // even if they are the closest match. The access groups are saved in the
+    // database and restored by set_database().
+    bool add_person_to_group(int person_id, const std::string& group);
+    bool remove_person_from_group(int person_id, const std::string& group);
+    bool set_access_groups(const std::vector<std::string>& groups);  // Empty: no restriction
+    std::vector<std::string> get_access_groups() const;
+    std::vector<std::string> get_groups() const;
+    PersonFilter get_group_filter(const std::vector<std::string>& groups) const;  // Union of the groups
+
     // Recognition methods - override base class
     int recognize(const cv::Mat& face_image, double& confidence) override;
+    // Matches only people the given filter allows (instead of the access groups)
+    int recognize(const cv::Mat& face_image, const PersonFilter& filter, double& confidence);
+    std::vector<int> recognize_batch(const std::vector<cv::Mat>& face_images,
+                                     std::vector<double>& confidences) override;
     std::string recognize_with_name(const cv::Mat& face_image, double& confidence) override;
+    // 1:1 verification of a claimed identity (badge, PIN): scores only that
+    // person's embeddings, so the cost does not grow with the gallery. False
+    // below the confidence threshold or when the access groups exclude the person.
+    bool verify(const cv::Mat& face_image, int person_id, double& confidence);
 
     // Label management - override base class
     int register_person(const std::string& name) override;
@@ -83,20 +155,82 @@ public:
 
     // Embedding extraction and analysis
     std::vector<float> extract_embedding(const cv::Mat& face_image);
+    // Same, into a caller-owned vector whose capacity is reused; false for an invalid face
+    bool extract_embedding(const cv::Mat& face_image, std::vector<float>& embedding);
+    // Several faces in batched model calls (see ModelLoader::inference_batch); empty entries for invalid faces
+    std::vector<std::vector<float>> extract_embeddings(const std::vector<cv::Mat>& face_images);
+    // Same, into caller-owned vectors (one per face, capacities reused)
+    void extract_embeddings(const std::vector<cv::Mat>& face_images, std::vector<std::vector<float>>& embeddings);
     double compare_embeddings(const std::vector<float>& emb1, const std::vector<float>& emb2);
     
-    // Advanced recognition with top-k results
+    // Advanced recognition: the k most similar distinct people
     std::vector<std::pair<std::string, double>> recognize_top_k(const cv::Mat& face_image, int k = 3);
+    // Every enrolled person at min_similarity or above, most similar first
+    // (duplicate-enrollment check; ignores the access groups)
+    std::vector<int> find_matching_people(const std::vector<float>& embedding, double min_similarity,
+                                          std::vector<double>& similarities) const;
 
     // Index management
     bool save_index(const std::string& filepath);
-    bool load_index(const std::string& filepath);
+    // Also replays "<filepath>.wal"; read_only leaves the file and its log untouched (exports)
+    bool load_index(const std::string& filepath, bool read_only = false);
+    // Merge the enrollment log into the index file (runs in the background after
+    // Config::INDEX_LOG_COMPACT_RECORDS enrollments)
+    bool compact_index_log();
+    void wait_for_compaction();  // Joins every background thread; call without index_update_mutex held
+    size_t get_pending_log_records() const { return index_log.get_num_records(); }
+    // Gallery snapshots (gallery_snapshot.h): people, groups, stored embeddings
+    // and the saved index in one checksummed file. Importing replaces the whole
+    // gallery in one database transaction, committed only once the new index has
+    // loaded (or been rebuilt), and needs no re-embedding; snapshots of another
+    // embedding model are refused.
+    bool export_snapshot(const std::string& path);
+    bool import_snapshot(const std::string& path);
+    uint64_t get_model_hash() const { return model_hash; }
+    void set_index_backend(Config::IndexBackend backend);
+    Config::IndexBackend get_index_backend() const { return index_backend; }
+    // nprobe for the flat/IVF backend, efSearch for HNSW
+    void set_search_effort(int effort);
+    int get_search_effort() const { return current_index()->get_search_effort(); }
     void clear();
 
 private:
     // Helper methods
-    cv::Mat preprocess_face(const cv::Mat& face_image);
     bool validate_face_image(const cv::Mat& image);
+    std::shared_ptr<VectorIndexBase> current_index() const { return std::atomic_load(&vector_index); }
+    void publish_index(std::shared_ptr<VectorIndexBase> index) { std::atomic_store(&vector_index, std::move(index)); }
+    std::shared_ptr<VectorIndexBase> create_empty_index(int embedding_dim) const;
+    // Index file (and its PCA sidecar) checked against the model; null if unusable
+    std::shared_ptr<VectorIndexBase> read_index_file(const std::string& filepath) const;
+    // Budgeted, projected and trained index of a training set; nothing is saved or published
+    std::shared_ptr<VectorIndexBase> build_gallery_index(const std::vector<int>& person_ids,
+                                                         const std::vector<std::vector<float>>& embeddings) const;
+    bool read_database_embeddings(std::vector<int>& person_ids, std::vector<std::vector<float>>& embeddings) const;
+    // PCA projection for a training set (Config::PCA_DIMENSION), null when disabled or too few samples
+    std::shared_ptr<const EmbeddingProjection> train_projection(const std::vector<std::vector<float>>& embeddings) const;
+    // Raw embedding as stored in the index: projected when the index has a projection
+    static std::vector<float> to_index_space(const VectorIndexBase& index, const std::vector<float>& embedding);
+    // Query embedding of a face in the index's space, held in the calling thread's
+    // reused recognition buffers until its next call; empty for an invalid face
+    const std::vector<float>& query_embedding(const VectorIndexBase& index, const cv::Mat& face_image);
+    std::shared_ptr<const PersonFilter> current_access_filter() const { return std::atomic_load(&access_filter); }
+    void update_access_filter();  // Call with groups_mutex held
+    int recognize_filtered(const cv::Mat& face_image, const PersonFilter* filter, double& confidence);
+    bool open_index_log(const VectorIndexBase& index);
+    bool persist_index(VectorIndexBase& index, const std::string& filepath);
+    // Writes (or removes) "<filepath>.pca" for a just-saved index; call with index_file_mutex held
+    bool save_projection_sidecar(const VectorIndexBase& index, const std::string& filepath);
+    bool merge_log_into_file(Config::IndexBackend backend, int embedding_dim);
+    void start_compaction();
+    void start_row_compaction_if_needed(const VectorIndexBase& index);
+    void start_condensation(int person_id);
+    bool publish_person_embeddings(int person_id, const std::vector<std::vector<float>>& embeddings);  // Call with index_update_mutex held
+    // Condensed copy of a training set for people over the budget; false if nobody is
+    static bool apply_embedding_budget(const std::vector<int>& person_ids,
+                                       const std::vector<std::vector<float>>& embeddings,
+                                       std::vector<int>& budget_ids,
+                                       std::vector<std::vector<float>>& budget_embeddings);
+    static bool apply_log_records(VectorIndexBase& index, std::vector<IndexLog::Record>& records);
     std::vector<std::pair<int, std::vector<float>>>
         extract_embeddings_from_directory(const std::string& dataset_path);
 };
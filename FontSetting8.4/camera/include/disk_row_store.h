@@ -0,0 +1,58 @@
+#ifndef DISK_ROW_STORE_H
+#define DISK_ROW_STORE_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @file disk_row_store.h
+ * @brief Fixed-size rows kept in an anonymous spill file instead of RAM
+ *
+ * Quantized galleries scan compact codes in memory and only need the
+ * full-precision float rows for the final rerank of a few candidates.
+ * Those rows live in an unlinked temporary file and are read back with
+ * pread(), so they cost page cache (reclaimable) rather than heap memory.
+ */
+class DiskRowStore {
+public:
+    DiskRowStore() = default;
+    ~DiskRowStore();
+
+    DiskRowStore(const DiskRowStore&) = delete;
+    DiskRowStore& operator=(const DiskRowStore&) = delete;
+
+    /**
+     * @brief Create an empty store in the given directory
+     *
+     * The file is unlinked right away and disappears when the store closes.
+     *
+     * @param directory Directory for the spill file (must be on disk, not tmpfs, to save RAM)
+     * @param row_bytes Size of every row in bytes
+     * @return true if successful, false otherwise
+     */
+    bool open(const std::string& directory, size_t row_bytes);
+
+    /**
+     * @brief Write (or overwrite) row at index
+     */
+    bool write_row(size_t index, const void* data);
+
+    /**
+     * @brief Read row at index into out (row_bytes bytes)
+     */
+    bool read_row(size_t index, void* out) const;
+
+    /**
+     * @brief Close the store and release its disk space
+     */
+    void close();
+
+    bool is_open() const { return fd >= 0; }
+    size_t get_row_bytes() const { return row_bytes; }
+
+private:
+    int fd = -1;
+    size_t row_bytes = 0;
+};
+
+#endif // DISK_ROW_STORE_H
@@ -0,0 +1,64 @@
+#ifndef EMBEDDING_CONDENSER_H
+#define EMBEDDING_CONDENSER_H
+
+#include <cstddef>
+#include <vector>
+#include "config.h"
+
+/**
+ * @file embedding_condenser.h
+ * @brief Reduce one person's gallery embeddings to a few representatives
+ *
+ * Every capture of a frequent visitor adds a near-identical embedding, which
+ * lengthens every scan without making the person easier to find. The
+ * captures are reduced to k medoids (the samples that best cover the others
+ * by cosine similarity) or to a single weighted centroid, so the index grows
+ * with the number of people rather than the number of captures.
+ */
+namespace EmbeddingCondenser {
+
+/// Representatives of a set of embeddings, and how well they cover it
+struct Result {
+    std::vector<std::vector<float>> embeddings;  ///< Representatives to index
+    std::vector<int> kept;       ///< Input position of each medoid (empty for a centroid)
+    double mean_coverage = 1.0;  ///< Mean over the inputs of the best similarity (0-1) to a representative
+    double min_coverage = 1.0;   ///< Worst input's best similarity (0-1) to a representative
+};
+
+/**
+ * @brief Pick the k samples that best cover the set
+ *
+ * Greedy k-medoids: each step adds the sample that most raises the summed
+ * similarity of every sample to its closest medoid, then a few Voronoi
+ * passes move each medoid to the center of the samples it covers.
+ * O(n² · dimension) for the similarity matrix, O(k · n²) for the selection.
+ *
+ * @param embeddings Samples of one person (any norm)
+ * @param k Medoids to keep
+ * @return Positions of the medoids in embeddings, at most k of them
+ */
+std::vector<int> select_medoids(const std::vector<std::vector<float>>& embeddings, int k);
+
+/**
+ * @brief Mean of the samples weighted by their similarity to the others
+ *
+ * Each sample is weighted by its mean cosine similarity to the other
+ * samples, so outliers (poor crops, motion blur) count less. The result is
+ * L2-normalized like the embeddings it summarizes.
+ */
+std::vector<float> weighted_centroid(const std::vector<std::vector<float>>& embeddings);
+
+/**
+ * @brief Reduce embeddings to at most k representatives
+ *
+ * Sets of k or fewer samples are returned unchanged.
+ *
+ * @param embeddings Samples of one person
+ * @param k Budget (MEDOIDS); CENTROID always returns one vector
+ * @param mode Medoids or weighted centroid
+ */
+Result condense(const std::vector<std::vector<float>>& embeddings, int k, Config::CondensationMode mode);
+
+}  // namespace EmbeddingCondenser
+
+#endif // EMBEDDING_CONDENSER_H
@@ -0,0 +1,100 @@
+#ifndef EMBEDDING_PROJECTION_H
+#define EMBEDDING_PROJECTION_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "vector_kernels.h"
+
+/**
+ * @file embedding_projection.h
+ * @brief Learned PCA projection that shrinks embeddings before indexing
+ *
+ * ArcFace embeddings carry most of their variance in far fewer directions
+ * than their 512 dimensions. Projecting the gallery and every query onto the
+ * leading principal components of the enrolled gallery cuts index memory and
+ * scan time in proportion to the dimension, at nearly the same recall.
+ */
+
+/**
+ * @brief PCA (optionally whitening) projection trained from gallery embeddings
+ *
+ * Projected vectors are L2-normalized, so they can be indexed and compared
+ * exactly like the model's own embeddings. Similarities between projected
+ * vectors are not those of the raw embeddings: the confidence threshold has
+ * to be calibrated for the projection in use.
+ *
+ * @thread_safety Immutable after train() or load(); project() may be called
+ *                from any number of threads.
+ */
+class EmbeddingProjection {
+public:
+    /**
+     * @brief Fit a projection to a set of embeddings
+     *
+     * Covariance of the (evenly subsampled) samples, then a symmetric
+     * eigendecomposition (Householder tridiagonalization + implicit QL) in
+     * double precision. O(samples · dimension²) + O(dimension³).
+     *
+     * @param samples Embeddings of input_dimension floats each
+     * @param output_dimension Principal components kept
+     * @param whiten Scale each component to unit variance
+     * @param max_samples Samples used for the covariance (0 = all)
+     * @return Trained projection, nullptr if there are too few samples or the
+     *         dimensions are inconsistent
+     */
+    static std::shared_ptr<EmbeddingProjection> train(const std::vector<std::vector<float>>& samples,
+                                                      int output_dimension, bool whiten,
+                                                      size_t max_samples = 0);
+
+    /**
+     * @brief Project one embedding (L2-normalized result)
+     *
+     * @return output_dimension floats, empty if the input has the wrong size
+     */
+    std::vector<float> project(const std::vector<float>& embedding) const;
+
+    /**
+     * @brief Project several embeddings; wrong-sized inputs give empty vectors
+     */
+    std::vector<std::vector<float>> project(const std::vector<std::vector<float>>& embeddings) const;
+
+    /**
+     * @brief Write the projection beside an index file
+     *
+     * @param model_hash Embedding model the projection was trained for (0 = unknown)
+     * @param index_stamp IndexFile::stamp_file() of the saved index it belongs to
+     */
+    bool save(const std::string& filepath, uint64_t model_hash, uint64_t index_stamp) const;
+
+    /**
+     * @brief Read a projection written by save()
+     *
+     * @param model_hash Expected embedding model (0 disables the check)
+     * @param index_stamp IndexFile::stamp_file() of the index file being loaded (0 disables the check)
+     * @return Projection, nullptr if the file is missing, corrupt, for another
+     *         model or stamped for another index file
+     */
+    static std::shared_ptr<EmbeddingProjection> load(const std::string& filepath, uint64_t model_hash,
+                                                     uint64_t index_stamp);
+
+    int get_input_dimension() const { return input_dimension; }
+    int get_output_dimension() const { return output_dimension; }
+    bool is_whitened() const { return whiten; }
+
+    /// Fraction (0-1) of the training samples' variance kept by the components
+    double get_retained_variance() const { return retained_variance; }
+
+private:
+    int input_dimension = 0;
+    int output_dimension = 0;
+    int stride = 0;               // Padded length of mean and component rows
+    bool whiten = false;
+    double retained_variance = 0.0;
+    VectorKernels::AlignedFloatVector mean;        // stride floats
+    std::vector<float> eigenvalues;                // Variance along each kept component
+    VectorKernels::AlignedFloatVector components;  // output_dimension rows of stride floats, whitening folded in
+};
+
+#endif // EMBEDDING_PROJECTION_H
@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <functional>
 
 struct PersonRecord {
     int id;
@@ -60,9 +61,30 @@ public:
     bool get_face_embeddings(int person_id, std::vector<FaceEmbedding>& embeddings);
     bool get_all_face_embeddings(std::vector<FaceEmbedding>& embeddings);
     bool delete_face_embedding(int id);
+    bool delete_person_embeddings(int person_id);
     bool clear_all_embeddings();  // Clear all embeddings for retraining
     bool update_face_count(int person_id);
 
+    // Access groups (zones, shifts): a person can belong to any number of groups
+    bool add_person_to_group(int person_id, const std::string& group);
+    bool remove_person_from_group(int person_id, const std::string& group);
+    bool get_person_groups(int person_id, std::vector<std::string>& groups);
+    bool get_all_group_members(std::vector<std::pair<int, std::string>>& memberships);  // (person_id, group)
+    // Groups this kiosk's door admits (empty: everyone); not part of the gallery
+    bool set_access_groups(const std::vector<std::string>& groups);
+    bool get_access_groups(std::vector<std::string>& groups);
+
+    // Bulk access for gallery snapshots (gallery_snapshot.h)
+    // Streams every embedding row without loading them all; stops early when the callback returns false
+    bool for_each_face_embedding(const std::function<bool(const FaceEmbedding&)>& callback);
+    bool begin_transaction();
+    bool commit_transaction();
+    bool rollback_transaction();
+    bool clear_gallery();  // People, images, embeddings and groups
+    bool restore_people(const std::vector<PersonRecord>& people);  // Keeps ids, face counts and timestamps
+    bool restore_face_embeddings(const std::vector<FaceEmbedding>& embeddings);  // Face counts are left as restored
+    bool restore_group_members(const std::vector<std::pair<int, std::string>>& memberships);
+
     // Query
     bool person_exists(const std::string& name);
     bool is_open_connection() const;
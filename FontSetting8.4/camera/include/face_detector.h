@@ -36,6 +36,10 @@ public:
     std::vector<Face> detect_faces(const cv::Mat& frame);
     std::vector<Face> detect_faces_with_id(const cv::Mat& frame, const std::vector<int>& face_ids);
 
+    // Region of the largest face in a photo, widened by 10% on each side for
+    // context (how enrollment photos are cropped); empty if no face is found
+    cv::Rect largest_face_region(const cv::Mat& image);
+
     void set_scale_factor(double scale);
     void set_min_neighbors(int neighbors);
     void set_min_face_size(int width, int height);
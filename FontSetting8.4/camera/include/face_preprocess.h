@@ -0,0 +1,68 @@
+#ifndef FACE_PREPROCESS_H
+#define FACE_PREPROCESS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @file face_preprocess.h
+ * @brief Fused face crop preprocessing for the embedding model
+ *
+ * Turns an 8-bit face crop (a view into the camera frame, no copy) into the
+ * model's planar float input in one pass: bilinear resize, BGR to RGB,
+ * (x - mean) / scale and HWC to CHW, written straight into the input tensor.
+ *
+ * The resize uses OpenCV's INTER_LINEAR geometry (pixel centres, clamped
+ * borders) in float, so it matches cv::resize to within OpenCV's 8-bit
+ * rounding. The best kernel for the running CPU (AVX2, NEON or scalar) is
+ * selected once at startup; every kernel performs the same float operations
+ * in the same order, so they produce bit-identical output to the scalar
+ * reference.
+ */
+
+namespace FacePreprocess {
+
+/// Largest output width supported (the per-column tables live on the stack)
+constexpr int MAX_OUTPUT_WIDTH = 1024;
+
+/**
+ * @brief An 8-bit interleaved source image
+ *
+ * Channels are 1 (gray), 3 (BGR) or 4 (BGRA). stride is the byte distance
+ * between rows, so a cv::Mat ROI can be passed as-is.
+ */
+struct SourceImage {
+    const uint8_t* data;
+    int width;
+    int height;
+    size_t stride;
+    int channels;
+};
+
+/**
+ * @brief Preprocess one face into a CHW float tensor slot
+ *
+ * @param source Face crop
+ * @param chw Output, 3 planes of out_width * out_height floats (R, G, B)
+ * @param out_width Model input width
+ * @param out_height Model input height
+ * @param mean Subtracted from every pixel value
+ * @param scale Divides every pixel value after the mean is subtracted
+ * @return false if the source or output size is unsupported
+ */
+bool preprocess(const SourceImage& source, float* chw, int out_width, int out_height, float mean, float scale);
+
+/**
+ * @brief Scalar reference implementation (always available)
+ */
+bool preprocess_scalar(const SourceImage& source, float* chw, int out_width, int out_height,
+                       float mean, float scale);
+
+/**
+ * @brief Name of the selected instruction set ("avx2", "neon", "scalar")
+ */
+const char* get_active_isa();
+
+} // namespace FacePreprocess
+
+#endif // FACE_PREPROCESS_H
@@ -55,6 +55,26 @@ public:
      */
     virtual int recognize(const cv::Mat& face_image, double& confidence) = 0;
 
+    /**
+     * @brief Recognize several faces from the same frame
+     *
+     * Implementations may share one gallery search between all faces; the
+     * default calls recognize() for each face.
+     *
+     * @param face_images Face images to recognize (preprocessed)
+     * @param[out] confidences Recognition confidence of each face (0.0-1.0)
+     * @return Person ID (>0) or -1 for each face, in input order
+     */
+    virtual std::vector<int> recognize_batch(const std::vector<cv::Mat>& face_images,
+                                             std::vector<double>& confidences) {
+        std::vector<int> person_ids(face_images.size(), -1);
+        confidences.assign(face_images.size(), 0.0);
+        for (size_t i = 0; i < face_images.size(); i++) {
+            person_ids[i] = recognize(face_images[i], confidences[i]);
+        }
+        return person_ids;
+    }
+
     /**
      * @brief Recognize face and return person name
      *
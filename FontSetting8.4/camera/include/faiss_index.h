@@ -5,51 +5,213 @@
 #include <map>
 #include <string>
 #include <memory>
+#include <fstream>
+#include <cstdint>
+#include "vector_kernels.h"
+#include "vector_index_base.h"
+#include "disk_row_store.h"
+#include "index_file.h"
+#include "person_directory.h"
+#include "scan_pool.h"
+#include "config.h"
 
-// Forward declare FAISS opaque pointer types
-typedef struct FaissIndex FaissIndex;
-
-class FAISSIndex {
+class FAISSIndex : public VectorIndexBase {
 private:
-    void* index = nullptr;  // Opaque pointer (not used in simple implementation)
     std::vector<int> person_ids;  // Maps FAISS vector index to person_id
-    std::vector<std::vector<float>> embeddings;  // In-memory embedding storage
+    PersonDirectory directory;  // person_id -> rows, and tombstones of deleted rows
+    // Row-major gallery, each row 64-byte aligned (FLOAT32 only). Shared with
+    // clone()s, which append past the rows this index can see.
+    VectorKernels::SharedRowBuffer<float> matrix;
+    std::vector<float> norms;  // Squared L2 norm of each row (exact, from the float row)
     int dimension = 128;
+    int stride = VectorKernels::padded_stride(128);  // Floats per row (dimension padded to a cache line)
     int num_clusters = 0;
     bool is_built = false;
 
-    // Helper for normalized L2 distance to similarity
-    double distance_to_similarity(float distance) const;
+    // IVF (inverted-file) partitioning, trained by train_ivf()
+    VectorKernels::AlignedFloatVector centroids;  // num_clusters rows, same stride as matrix
+    std::vector<float> centroid_norms;  // Squared L2 norm of each centroid
+    std::vector<std::vector<int>> inverted_lists;  // Posting list of matrix rows per centroid
+    int nprobe = 0;  // Lists probed per query; 0 = Config::IVF_PROBE_FRACTION of them
+    size_t ivf_trained_size = 0;  // Gallery size when centroids were last trained
+
+    // Quantized storage (FP16 / INT8 modes)
+    Config::IndexStorage storage = Config::INDEX_STORAGE;
+    VectorKernels::SharedRowBuffer<uint16_t> half_codes;  // FP16 rows, same stride as matrix
+    VectorKernels::SharedRowBuffer<uint8_t> byte_codes;  // INT8 rows, same stride as matrix
+    std::vector<float> int8_scale;  // Per-dimension step: x ≈ offset + scale * code
+    std::vector<float> int8_offset;
+    size_t int8_trained_size = 0;  // Gallery size when int8 ranges were last fitted
+    std::shared_ptr<DiskRowStore> float_rows;  // Full-precision rows for the exact rerank
+    VectorKernels::AlignedFloatVector row_scratch;
+
+    // Per-person prototypes for the two-stage search (FLOAT32 only): the
+    // normalized mean of each person's rows, located through the directory.
+    // Appended, never rewritten, so clones share them like the matrix; an
+    // updated person's previous prototype is retired instead. Saved with the
+    // index and mapped at load like the rows.
+    VectorKernels::SharedRowBuffer<float> prototypes;  // stride floats per prototype
+    std::vector<int> prototype_person;  // Person of each prototype, -1 once retired
+    size_t num_retired_prototypes = 0;
+    const float* mapped_prototypes = nullptr;  // The PROTOTYPES_F32 section while prototypes_mapped
+    bool prototypes_mapped = false;
+
+    // Read-only mapping of a loaded index file. Rows and codes are scanned in
+    // place until the first mutation copies them into the owned buffers.
+    std::shared_ptr<IndexFile::MappedFile> mapping;
+    const float* matrix_rows = nullptr;  // matrix.data() or the mapped ROWS_F32 section
+    const uint16_t* half_rows = nullptr;  // half_codes.data() or the mapped CODES_F16 section
+    const uint8_t* byte_rows = nullptr;  // byte_codes.data() or the mapped CODES_U8 section
+    bool rows_mapped = false;
+    bool codes_mapped = false;
+
+    // Matrix helpers
+    const float* row(size_t i) const { return matrix_rows + i * stride; }
+    void sync_views();
+    void materialize();
+    bool open_float_rows();
+    void append_row(int person_id, const float* embedding);
+    VectorKernels::AlignedFloatVector pad_query(const std::vector<float>& query, float& query_norm) const;
+
+    // Quantization helpers
+    bool is_quantized() const { return storage != Config::IndexStorage::FLOAT32; }
+    void reset_quantizer();
+    void encode_row(const float* vec, void* codes) const;
+    void* mutable_code_row(size_t i);
+    const float* training_row(size_t i, float* scratch) const;
+    bool read_float_row(size_t i, float* out) const;
+    bool has_float_rows_in_memory() const { return storage == Config::IndexStorage::FLOAT32 || rows_mapped; }
+    std::vector<std::pair<float, int>> quantized_nearest(const float* query, float query_norm, int k,
+                                                         const PersonFilter* filter = nullptr) const;
+    std::vector<int> search_rows(const std::vector<float>& query_embedding, int k, const PersonFilter* filter,
+                                 std::vector<double>& confidences);
+    void take_top_k(std::vector<std::pair<float, int>>& distances, int k,
+                    std::vector<int>& results, std::vector<double>& confidences) const;
 
 public:
-    FAISSIndex(int embedding_dimension = 128);
-    ~FAISSIndex();
+    FAISSIndex(int embedding_dimension = 128,
+               Config::IndexStorage storage_mode = Config::INDEX_STORAGE);
+    ~FAISSIndex() override;
 
     // Index management
-    bool build_index(int num_vectors);
-    bool add_vector(int person_id, const std::vector<float>& embedding);
-    bool add_vectors(const std::vector<int>& ids, const std::vector<std::vector<float>>& embeddings);
+    bool build_index(int num_vectors) override;
+    bool add_vector(int person_id, const std::vector<float>& embedding) override;
+    bool add_vectors(const std::vector<int>& ids, const std::vector<std::vector<float>>& embeddings) override;
+
+    // IVF clustering
+    // Trains k-means centroids over the current gallery and builds posting lists.
+    // nlist <= 0 picks the cluster count from calculate_optimal_clusters().
+    bool train_ivf(int nlist = 0);
+    bool is_ivf_trained() const { return !inverted_lists.empty(); }
+    bool needs_ivf_training() const;
+    // nprobe 0 probes Config::IVF_PROBE_FRACTION of the lists, scaling with their number
+    void set_nprobe(int probes) { nprobe = probes > 0 ? probes : 0; }
+    int get_nprobe() const { return nprobe; }
+    int get_probe_count() const;  // Lists actually probed
+    bool needs_training() const override;
+    bool train() override;
+    void set_search_effort(int effort) override { set_nprobe(effort); }
+    int get_search_effort() const override { return nprobe; }
+
+    // Scalar quantization
+    // INT8 ranges are fitted per dimension by train_int8_ranges(); FP16 needs no training.
+    bool needs_int8_training() const;
+    bool train_int8_ranges();
+    Config::IndexStorage get_storage() const { return storage; }
+    const char* get_storage_name() const;
 
     // Search
     // Returns person_id of nearest neighbor and confidence (0-1)
-    int search(const std::vector<float>& query_embedding, double& confidence);
-    std::vector<int> search_k(const std::vector<float>& query_embedding, int k, std::vector<double>& confidences);
+    // Unfiltered float32 searches score one prototype per person first and rerank
+    // the best people's rows exactly when that is cheaper (Config::PROTOTYPE_PREFILTER)
+    using VectorIndexBase::search;
+    int search(const std::vector<float>& query_embedding, double& confidence) override;
+    std::vector<int> search_k(const std::vector<float>& query_embedding, int k, std::vector<double>& confidences) override;
+    // Excluded rows are skipped in the scan; few allowed people are scored via the directory
+    std::vector<int> search_k(const std::vector<float>& query_embedding, int k, const PersonFilter& filter,
+                              std::vector<double>& confidences) override;
+    // Exact scan of all queries in one blocked pass over the float32 matrix.
+    // Only without probed IVF lists, FP16/int8 codes or the prototype shortlist:
+    // those search each query separately, as VectorIndexBase does
+    std::vector<std::vector<int>> search_batch(const std::vector<std::vector<float>>& queries, int k,
+                                               std::vector<std::vector<double>>& confidences) override;
+    // Exact per-person aggregation over every scanned row (float32)
+    std::vector<int> search_identities(const std::vector<float>& query_embedding, int k,
+                                       std::vector<double>& confidences,
+                                       Config::IdentityAggregation aggregation = Config::IDENTITY_AGGREGATION,
+                                       int top_m = Config::IDENTITY_TOP_M) override;
+    // Every person within the threshold, from one exact pass (float32)
+    std::vector<int> range_search(const std::vector<float>& query_embedding, double min_similarity,
+                                  std::vector<double>& confidences) override;
+    // Exact float distances to the person's directory rows (quantized modes read the float rows)
+    int verify(const std::vector<float>& query_embedding, int person_id, double& confidence) override;
 
     // Persistence
-    bool save_index(const std::string& filepath);
-    bool load_index(const std::string& filepath);
+    // Writes the versioned IndexFile layout; loads it with mmap (zero-copy) or
+    // falls back to the legacy unversioned layout.
+    bool save_index(const std::string& filepath) override;
+    bool load_index(const std::string& filepath) override;
+    bool is_mapped() const { return mapping != nullptr; }
+
+    // Copy of row i (dimension floats) and its person_id
+    bool get_vector(int i, std::vector<float>& embedding, int& person_id) const;
+
+    // Deletion
+    // Tombstones a person's rows via the directory; compacted() drops them
+    int remove_person(int person_id) override;
+    int get_num_deleted() const override { return static_cast<int>(directory.get_num_deleted()); }
+    int get_person_vector_count(int person_id) const override { return static_cast<int>(directory.count_of(person_id)); }
+    std::unique_ptr<VectorIndexBase> compacted() const override;
 
     // State
-    bool is_index_built() const { return is_built; }
-    int get_num_vectors() const;
-    int get_dimension() const { return dimension; }
+    bool is_index_built() const override { return is_built; }
+    int get_num_vectors() const override;
+    int get_dimension() const override { return dimension; }
     int get_num_clusters() const { return num_clusters; }
-    void clear();
+    size_t get_memory_bytes() const;  // RAM held by vectors, codes and IVF structures
+    const char* get_backend_name() const override { return "flat"; }
+    void clear() override;
+    std::unique_ptr<VectorIndexBase> clone() const override;
 
 private:
     // FAISS helper methods
     int calculate_optimal_clusters(int num_vectors);
     void setup_index_parameters();
+
+    // IVF helper methods
+    static constexpr uint32_t IVF_TRAILER_MAGIC = 0x31465649;  // "IVF1"
+    static constexpr uint32_t INT8_TRAILER_MAGIC = 0x31385149;  // "IQ81"
+    void reset_ivf();
+    bool load_ivf_trailer(std::ifstream& file);
+    bool load_int8_trailer(std::ifstream& file);
+    bool load_legacy_index(const std::string& filepath);
+    bool load_mapped_index(const std::string& filepath);
+    void rebuild_inverted_lists(const int32_t* assignment);
+    void compute_centroid_norms();
+    int nearest_centroid(const float* vec) const;
+    std::vector<int> probe_lists(const float* query) const;
+    bool scores_allowed_rows_directly(const PersonFilter& filter) const;
+
+    // Prototype helpers
+    bool keeps_prototypes() const { return Config::PROTOTYPE_PREFILTER && storage == Config::IndexStorage::FLOAT32; }
+    bool uses_prototypes(int k) const;
+    void refresh_prototype(int person_id);
+    void retire_prototype(int person_id);
+    void rebuild_prototypes();
+    void own_prototypes();
+    bool map_prototypes(const float* rows, const int32_t* persons, size_t count);
+    const float* prototype_data() const { return prototypes_mapped ? mapped_prototypes : prototypes.data(); }
+    std::vector<std::pair<float, int>> prototype_nearest(const float* query, float query_norm, int k) const;
+    template <typename Visitor>
+    void for_each_candidate(const float* query, const PersonFilter* filter, Visitor&& visit) const;
+
+    // Parallel scan helpers (see ScanPool)
+    bool scans_in_parallel(const PersonFilter* filter, const ScanPool& pool) const;
+    size_t rows_per_partition() const;
+    // k smallest score(i) over the candidates; the full scan runs on the shared pool
+    template <typename Score>
+    std::vector<std::pair<float, int>> nearest_candidates(const float* query, const PersonFilter* filter,
+                                                          size_t k, Score&& score) const;
 };
 
 #endif // FAISS_INDEX_H
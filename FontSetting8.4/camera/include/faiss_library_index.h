@@ -0,0 +1,141 @@
+#ifndef FAISS_LIBRARY_INDEX_H
+#define FAISS_LIBRARY_INDEX_H
+
+/**
+ * @file faiss_library_index.h
+ * @brief Gallery index backed by the real FAISS library (libfaiss)
+ *
+ * Adapter that lets DeepFaceRecognizer use FAISS's own index structures
+ * (IndexFlatIP, IndexIVFFlat, IndexHNSWFlat, IndexIVFPQ) through the
+ * VectorIndexBase interface. Only compiled when the Makefile finds
+ * faiss/lib/libfaiss.so (HAVE_FAISS); otherwise create_vector_index() falls
+ * back to the in-house FAISSIndex / HNSWIndex.
+ *
+ * FAISS ids are row numbers in insertion order; person_ids, norms and the
+ * per-person directory live beside the FAISS index, as in FAISSIndex.
+ * Scores are inner products, converted to the same L2-based similarity as
+ * the in-house backends using the stored row norms.
+ *
+ * FAISS structures cannot share storage, so clone() does not copy them:
+ * every copy shares one writer-owned FAISS index that rows are only ever
+ * appended to, under an exclusive lock, and each copy searches the first
+ * person_ids.size() rows. A copy-on-write enrollment costs O(N) small
+ * per-row metadata (~12 bytes a row) instead of a deep copy of the vectors
+ * (~2 KB a row at 512 dimensions). Training and compaction build a new
+ * FAISS index, so snapshots still being searched keep the old one.
+ */
+
+#ifdef HAVE_FAISS
+
+#include <algorithm>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "person_directory.h"
+#include "vector_index_base.h"
+
+namespace faiss {
+struct Index;
+}
+
+class FaissLibraryIndex : public VectorIndexBase {
+private:
+    Config::FaissIndexType index_type;
+    int dimension;
+    bool is_built = false;
+
+    // The FAISS index, shared by clone() copies (see the file comment)
+    struct SharedIndex {
+        std::unique_ptr<faiss::Index> index;
+        std::shared_mutex mutex;  // add() exclusive; search and reconstruct shared
+    };
+
+    // IVF types start as an IndexFlatIP and switch to the IVF structure in
+    // train(); HNSW and flat types use their final structure from the start.
+    std::shared_ptr<SharedIndex> shared;
+    bool ivf_trained = false;
+    size_t trained_size = 0;  // Rows the IVF structure was trained on
+
+    std::vector<int> person_ids;  // FAISS id (row) -> person_id
+    std::vector<float> norms;     // Squared L2 norm of each row
+    PersonDirectory directory;    // person_id -> rows, and tombstones of deleted rows
+    int search_effort;            // nprobe (IVF types; 0 = Config::IVF_PROBE_FRACTION of the lists) or efSearch (HNSW)
+
+    bool is_ivf_type() const;
+    size_t min_training_vectors() const;
+    std::unique_ptr<faiss::Index> create_initial_index() const;
+    std::unique_ptr<faiss::Index> create_ivf_index(size_t num_rows) const;
+    static std::shared_ptr<SharedIndex> share(std::unique_ptr<faiss::Index> index);
+    bool appends_to_shared() const;  // Nobody else appended past this copy's rows
+    bool detach();                   // Continue on a private FAISS index of this copy's rows
+    bool append_rows(const std::vector<int>& ids, const float* rows, size_t count);
+    bool collect_live_rows(std::vector<int>& ids, std::vector<float>& rows) const;
+    void search_rows(const float* queries, size_t num_queries, int k, const PersonFilter* filter,
+                     std::vector<float>& scores, std::vector<int64_t>& rows) const;
+    std::vector<std::vector<int>> search_queries(const std::vector<std::vector<float>>& queries, int k,
+                                                 const PersonFilter* filter,
+                                                 std::vector<std::vector<double>>& confidences);
+    double row_similarity(float query_norm, float score, int64_t row) const;
+    bool load_flat_index(const std::string& filepath);
+
+public:
+    explicit FaissLibraryIndex(int embedding_dimension = 128,
+                               Config::FaissIndexType type = Config::FAISS_INDEX_TYPE);
+    ~FaissLibraryIndex() override;
+
+    // Index management
+    bool build_index(int num_vectors) override;
+    bool add_vector(int person_id, const std::vector<float>& embedding) override;
+    bool add_vectors(const std::vector<int>& ids, const std::vector<std::vector<float>>& embeddings) override;
+
+    // Search (FAISS batches several queries in one call)
+    using VectorIndexBase::search;
+    int search(const std::vector<float>& query_embedding, double& confidence) override;
+    std::vector<int> search_k(const std::vector<float>& query_embedding, int k, std::vector<double>& confidences) override;
+    // Excluded people are skipped through the same IDSelector as tombstones
+    std::vector<int> search_k(const std::vector<float>& query_embedding, int k, const PersonFilter& filter,
+                              std::vector<double>& confidences) override;
+    std::vector<std::vector<int>> search_batch(const std::vector<std::vector<float>>& queries, int k,
+                                               std::vector<std::vector<double>>& confidences) override;
+    // Reconstructs the person's rows (directory slots) instead of searching with a selector;
+    // IVF_PQ scores the decoded codes
+    int verify(const std::vector<float>& query_embedding, int person_id, double& confidence) override;
+
+    // Deletion
+    // Tombstoned rows are filtered with an IDSelector; compacted() re-adds the live rows
+    int remove_person(int person_id) override;
+    int get_num_deleted() const override { return static_cast<int>(directory.get_num_deleted()); }
+    int get_person_vector_count(int person_id) const override { return static_cast<int>(directory.count_of(person_id)); }
+    std::unique_ptr<VectorIndexBase> compacted() const override;
+
+    // Persistence
+    // Also accepts the flat faiss_index.bin layout and re-adds its rows
+    bool save_index(const std::string& filepath) override;
+    bool load_index(const std::string& filepath) override;
+
+    // IVF training (no-op for flat and HNSW types)
+    bool needs_training() const override;
+    bool train() override;
+
+    // Tuning
+    void set_search_effort(int effort) override { search_effort = std::max(effort, is_ivf_type() ? 0 : 1); }
+    int get_search_effort() const override { return search_effort; }
+
+    // State
+    bool is_index_built() const override { return is_built; }
+    int get_num_vectors() const override { return static_cast<int>(person_ids.size() - directory.get_num_deleted()); }
+    int get_dimension() const override { return dimension; }
+    const char* get_backend_name() const override;
+    void clear() override;
+    std::unique_ptr<VectorIndexBase> clone() const override;
+
+private:
+    static constexpr uint32_t FILE_MAGIC = 0x42494C46;  // "FLIB"
+    static constexpr int FILE_VERSION = 1;
+};
+
+#endif // HAVE_FAISS
+
+#endif // FAISS_LIBRARY_INDEX_H
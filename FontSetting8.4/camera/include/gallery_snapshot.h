@@ -0,0 +1,219 @@
+#ifndef GALLERY_SNAPSHOT_H
+#define GALLERY_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "index_file.h"
+
+/**
+ * @file gallery_snapshot.h
+ * @brief Self-describing single-file export of a whole gallery
+ *
+ * Provisions a new kiosk without copying the database, the index and the
+ * dataset/ images separately, and without re-embedding anything: the
+ * snapshot carries the people, their access groups, the stored embeddings
+ * and the saved index file (with its PCA sidecar) of the exporting kiosk.
+ *
+ * Layout (native little-endian):
+ *
+ *   SnapshotHeader          fixed size, carries its own checksum
+ *   chunk*                  ChunkHeader + payload, each payload checksummed
+ *   END chunk               chunk count and a checksum over every chunk header
+ *
+ * A section (people, embeddings, ...) spans as many consecutive chunks as it
+ * needs; no chunk is larger than the header's max_chunk_bytes, so writing and
+ * reading hold one chunk in memory. Record sections pack whole records per
+ * chunk (i32 / u32 length-prefixed strings and blobs), file sections are the
+ * raw bytes of the file split at the chunk size. Readers skip section types
+ * they do not know.
+ *
+ * Images are not included: their embeddings are.
+ */
+
+namespace GallerySnapshot {
+
+/// File magic ("GALSNAP1")
+constexpr char MAGIC[8] = {'G', 'A', 'L', 'S', 'N', 'A', 'P', '1'};
+
+/// Current format version; bump on any incompatible layout change
+constexpr uint32_t VERSION = 1;
+
+/// Largest chunk a reader accepts, whatever the header declares
+constexpr uint64_t MAX_CHUNK_BYTES = 256ull * 1024 * 1024;
+
+/// Section types
+enum class SectionType : uint32_t {
+    PEOPLE = 1,       ///< id, face_count, name, created_at, updated_at
+    GROUPS = 2,       ///< person_id, group name
+    EMBEDDINGS = 3,   ///< person_id, image_path, created_at, embedding blob
+    INDEX = 4,        ///< Bytes of an IndexFile written by save_index()
+    PROJECTION = 5,   ///< Bytes of the index's ".pca" sidecar
+    END = 0xFFFF      ///< u64 chunk count, u64 checksum over the preceding chunk headers
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;         ///< sizeof(SnapshotHeader)
+    uint64_t model_hash;          ///< Hash of the embedding model (0 = unknown)
+    uint32_t dimension;           ///< Embedding dimension, before any projection
+    uint32_t max_chunk_bytes;     ///< Largest chunk payload in the file
+    uint64_t num_people;
+    uint64_t num_embeddings;
+    int64_t created_at;           ///< Unix time of the export
+    uint64_t header_checksum;     ///< Over the header with this field zeroed
+};
+
+struct ChunkHeader {
+    uint32_t type;                ///< SectionType
+    uint32_t reserved;
+    uint64_t size;                ///< Payload bytes
+    uint64_t checksum;            ///< Over the payload
+};
+
+static_assert(sizeof(SnapshotHeader) == 64, "SnapshotHeader layout changed");
+static_assert(sizeof(ChunkHeader) == 24, "ChunkHeader layout changed");
+
+/**
+ * @brief Builds one record of a record section
+ */
+class RecordEncoder {
+public:
+    void clear() { bytes.clear(); }
+    void put_i32(int32_t value);
+    void put_string(const std::string& value);
+    void put_blob(const void* data, size_t size);
+    const std::vector<unsigned char>& get_bytes() const { return bytes; }
+
+private:
+    std::vector<unsigned char> bytes;
+};
+
+/**
+ * @brief Reads the records of one chunk payload
+ *
+ * Every getter fails (and leaves the decoder failed) past the end of the payload.
+ */
+class RecordDecoder {
+public:
+    RecordDecoder(const unsigned char* data, size_t size) : data(data), size(size) {}
+    bool get_i32(int32_t& value);
+    bool get_string(std::string& value);
+    bool get_blob(std::vector<unsigned char>& value);
+    bool at_end() const { return offset == size; }
+
+private:
+    bool get_length(uint32_t& length);
+
+    const unsigned char* data;
+    size_t size;
+    size_t offset = 0;
+};
+
+/**
+ * @brief Streams a snapshot to "<path>.tmp" and renames it into place on finish()
+ */
+class Writer {
+public:
+    Writer() = default;
+    ~Writer();
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    /**
+     * @brief Create the file and write a provisional header
+     *
+     * @param chunk_bytes Payload bytes per chunk (Config::SNAPSHOT_CHUNK_BYTES)
+     */
+    bool open(const std::string& path, uint64_t model_hash, int dimension, size_t chunk_bytes);
+
+    /**
+     * @brief Append one record to a record section
+     *
+     * Records of a section must be appended consecutively. A chunk is written
+     * whenever the next record would not fit.
+     */
+    bool append_record(SectionType type, const RecordEncoder& record);
+
+    /**
+     * @brief Append a whole file as a file section, one chunk at a time
+     */
+    bool append_file(SectionType type, const std::string& file_path);
+
+    /**
+     * @brief Write the END chunk and the final header, sync and rename into place
+     */
+    bool finish(uint64_t num_people, uint64_t num_embeddings);
+
+    /// Delete the partial file (also done by the destructor unless finish() succeeded)
+    void abort();
+
+    uint64_t get_bytes_written() const { return bytes_written; }
+
+private:
+    bool flush_chunk();
+    bool write_chunk(SectionType type, const unsigned char* payload, size_t size);
+    bool write_bytes(const void* data, size_t size);
+
+    std::FILE* file = nullptr;
+    std::string path;
+    std::string temp_path;
+    SnapshotHeader header{};
+    size_t chunk_bytes = 0;
+    SectionType pending_type = SectionType::END;
+    std::vector<unsigned char> pending;
+    IndexFile::Checksum chain;     // Over every chunk header written so far
+    uint64_t num_chunks = 0;
+    uint64_t bytes_written = 0;
+    bool failed = false;
+};
+
+/**
+ * @brief Reads a snapshot chunk by chunk, verifying every checksum
+ */
+class Reader {
+public:
+    Reader() = default;
+    ~Reader();
+
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    /**
+     * @brief Open the file and verify its header
+     */
+    bool open(const std::string& path);
+    const SnapshotHeader& get_header() const { return header; }
+
+    /**
+     * @brief Read and verify the next chunk
+     *
+     * @param[out] type Section of the chunk
+     * @param[out] payload Chunk payload (reused between calls)
+     * @return false at the END chunk or on error; is_complete() tells them apart
+     */
+    bool next_chunk(SectionType& type, std::vector<unsigned char>& payload);
+
+    /**
+     * @brief True once the END chunk was read and matched every chunk before it
+     */
+    bool is_complete() const { return complete; }
+
+private:
+    bool read_bytes(void* data, size_t size);
+
+    std::FILE* file = nullptr;
+    std::string path;
+    SnapshotHeader header{};
+    IndexFile::Checksum chain;
+    uint64_t num_chunks = 0;
+    bool complete = false;
+};
+
+} // namespace GallerySnapshot
+
+#endif // GALLERY_SNAPSHOT_H
@@ -76,7 +76,8 @@ private:
     std::thread training_thread;
     std::atomic<bool> training_success;
 
-    // Face recognition mutex (ONNX Runtime is not thread-safe)
+    // Guards the cached recognition result read by stream clients
+    // (concurrent inference is coordinated by ModelLoader's session pool)
     std::mutex recognition_mutex;
 
     // Static callback wrappers
@@ -98,6 +99,12 @@ private:
     void on_training_finished();
     void on_camera_stop_finished();
     void capture_photo();
+    // Duplicate-enrollment check for a capture of person_name. Returns an empty
+    // string to go ahead (person_name is switched to the matching person under
+    // DuplicateCapturePolicy::MERGE) or the reason the capture is refused.
+    std::string check_duplicate_capture(const cv::Mat& frame, std::string& person_name);
+    // Largest detected face that lies inside the frame, empty if there is none
+    cv::Rect find_largest_face(const cv::Mat& frame);
     void update_ui();
     GdkPixbuf* mat_to_pixbuf(const cv::Mat& mat);
     void draw_faces_on_frame(cv::Mat& frame, const std::vector<Face>& faces);
@@ -111,6 +118,11 @@ private:
     std::string handle_registering(const std::string& args);
     std::string handle_status(const std::string& args);
     std::string handle_list_persons(const std::string& args);
+    std::string handle_delete_person(const std::string& args);
+    std::string handle_group(const std::string& args, bool add);
+    std::string handle_door(const std::string& args);
+    std::string handle_verify(const std::string& args);
+    std::string handle_snapshot(const std::string& args, bool import);
     void handle_stream_recognition(int client_fd);
 
     // Thread-safe camera control (for use from socket server thread)
@@ -0,0 +1,141 @@
+#ifndef HNSW_INDEX_H
+#define HNSW_INDEX_H
+
+#include <vector>
+#include <string>
+#include <random>
+#include <cstdint>
+#include <fstream>
+#include "vector_kernels.h"
+#include "vector_index_base.h"
+#include "person_directory.h"
+#include "config.h"
+
+/**
+ * @file hnsw_index.h
+ * @brief HNSW (hierarchical navigable small-world) graph index
+ *
+ * Approximate nearest-neighbor backend for large galleries. Every vector is
+ * a graph node; a query greedily descends the sparse upper layers and then
+ * runs a best-first search with efSearch candidates on layer 0, so only a
+ * few thousand distances are computed regardless of gallery size.
+ * Inserts are incremental, which suits one-face-at-a-time enrollment.
+ */
+class HNSWIndex : public VectorIndexBase {
+private:
+    // Vector storage (same layout as FAISSIndex)
+    std::vector<int> person_ids;
+    VectorKernels::SharedRowBuffer<float> matrix;  // Row-major, each row 64-byte aligned; shared with clone()s
+    std::vector<float> norms;  // Squared L2 norm of each row
+    PersonDirectory directory;  // person_id -> nodes, and tombstones of deleted nodes
+    int dimension = 128;
+    int stride = VectorKernels::padded_stride(128);
+    bool is_built = false;
+
+    // Graph parameters
+    int max_links = Config::HNSW_M;  // M: links per node on layers >= 1
+    int max_links_base = 2 * Config::HNSW_M;  // Links per node on layer 0
+    int ef_construction = Config::HNSW_EF_CONSTRUCTION;
+    int ef_search = Config::HNSW_EF_SEARCH;
+    double level_multiplier = 0.0;  // 1 / ln(M)
+
+    // Graph structure
+    // Layer 0 links are one flat block: node n owns [count, id0, id1, ...] of size max_links_base + 1.
+    // Upper layers are per node: level l (>= 1) starts at (l - 1) * (max_links + 1).
+    std::vector<int> node_levels;
+    std::vector<int> base_links;
+    std::vector<std::vector<int>> upper_links;
+    int entry_point = -1;
+    int max_level = -1;
+    std::mt19937 level_rng{42};
+
+    // Visited marks for graph traversal, reset by bumping the tag
+    struct VisitedMarks {
+        std::vector<uint32_t> tags;
+        uint32_t tag = 0;
+    };
+    static VisitedMarks& begin_visit(size_t num_nodes);
+
+    // Matrix helpers
+    const float* row(size_t i) const { return matrix.data() + i * stride; }
+    VectorKernels::AlignedFloatVector pad_query(const std::vector<float>& query, float& query_norm) const;
+
+    // Graph helpers
+    int* links_of(int node, int level);
+    const int* links_of(int node, int level) const;
+    int max_links_at(int level) const { return level == 0 ? max_links_base : max_links; }
+    int random_level();
+    float distance(const float* query, float query_norm, int node) const;
+
+    using Candidate = std::pair<float, int>;  // (squared distance, node)
+    int greedy_descend(const float* query, float query_norm, int start, int from_level, int to_level) const;
+    std::vector<Candidate> search_layer(const float* query, float query_norm, int start, int ef, int level,
+                                        bool skip_deleted = false, const PersonFilter* filter = nullptr) const;
+    std::vector<int> select_neighbors(std::vector<Candidate> candidates, int max_count) const;
+    void connect(int node, int neighbor, int level);
+    std::vector<int> search_nodes(const std::vector<float>& query_embedding, int k, const PersonFilter* filter,
+                                  std::vector<double>& confidences) const;
+    void insert_node(int node);
+
+    bool append_node(int person_id, const float* embedding);
+    bool load_graph(std::ifstream& file);
+    bool load_flat_index(const std::string& filepath);
+
+public:
+    HNSWIndex(int embedding_dimension = 128,
+              int M = Config::HNSW_M,
+              int ef_construction = Config::HNSW_EF_CONSTRUCTION);
+    ~HNSWIndex() override;
+
+    // Index management
+    bool build_index(int num_vectors) override;
+    bool add_vector(int person_id, const std::vector<float>& embedding) override;
+    bool add_vectors(const std::vector<int>& ids, const std::vector<std::vector<float>>& embeddings) override;
+
+    // Search
+    // Returns person_id of nearest neighbor and confidence (0-1)
+    using VectorIndexBase::search;
+    int search(const std::vector<float>& query_embedding, double& confidence) override;
+    std::vector<int> search_k(const std::vector<float>& query_embedding, int k, std::vector<double>& confidences) override;
+    // The graph walk returns only allowed nodes; when that walk would cost more than
+    // scoring the allowed nodes, they are scored exactly via the directory instead
+    std::vector<int> search_k(const std::vector<float>& query_embedding, int k, const PersonFilter& filter,
+                              std::vector<double>& confidences) override;
+    // Scores the person's nodes (found via the directory) without walking the graph
+    int verify(const std::vector<float>& query_embedding, int person_id, double& confidence) override;
+
+    // Deletion
+    // Tombstones a person's nodes via the directory; compacted() rebuilds the graph without them
+    int remove_person(int person_id) override;
+    int get_num_deleted() const override { return static_cast<int>(directory.get_num_deleted()); }
+    int get_person_vector_count(int person_id) const override { return static_cast<int>(directory.count_of(person_id)); }
+    std::unique_ptr<VectorIndexBase> compacted() const override;
+
+    // Persistence
+    // Also accepts the flat faiss_index.bin layout and builds the graph from it
+    bool save_index(const std::string& filepath) override;
+    bool load_index(const std::string& filepath) override;
+
+    // Tuning
+    void set_ef_search(int ef) { ef_search = ef > 0 ? ef : 1; }
+    int get_ef_search() const { return ef_search; }
+    int get_M() const { return max_links; }
+    int get_ef_construction() const { return ef_construction; }
+    void set_search_effort(int effort) override { set_ef_search(effort); }
+    int get_search_effort() const override { return ef_search; }
+
+    // State
+    bool is_index_built() const override { return is_built; }
+    int get_num_vectors() const override { return static_cast<int>(person_ids.size() - directory.get_num_deleted()); }
+    int get_dimension() const override { return dimension; }
+    int get_max_level() const { return max_level; }
+    const char* get_backend_name() const override { return "hnsw"; }
+    void clear() override;
+    std::unique_ptr<VectorIndexBase> clone() const override;
+
+private:
+    static constexpr uint32_t FILE_MAGIC = 0x57534E48;  // "HNSW"
+    static constexpr int FILE_VERSION = 3;  // v2 adds the model hash, v3 the log sequence
+};
+
+#endif // HNSW_INDEX_H
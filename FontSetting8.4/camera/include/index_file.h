@@ -0,0 +1,162 @@
+#ifndef INDEX_FILE_H
+#define INDEX_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @file index_file.h
+ * @brief Versioned, memory-mappable on-disk layout for the gallery index
+ *
+ * Layout (native little-endian):
+ *
+ *   IndexFileHeader                  fixed size, carries its own checksum
+ *   IndexFileSection[section_count]  covered by the header checksum
+ *   payload sections                 each 64-byte aligned, each checksummed
+ *
+ * Rows are stored padded to the in-memory stride, so a read-only mapping of
+ * the file can be scanned directly without copying anything at startup.
+ */
+
+namespace IndexFile {
+
+/// File magic ("FAISSIDX")
+constexpr char MAGIC[8] = {'F', 'A', 'I', 'S', 'S', 'I', 'D', 'X'};
+
+/// Current format version; bump on any incompatible layout change
+constexpr uint32_t VERSION = 2;
+
+/// Alignment of every payload section
+constexpr uint64_t SECTION_ALIGNMENT = 64;
+
+/// Payload section types
+enum class SectionType : uint32_t {
+    ROWS_F32 = 1,      ///< count * stride floats (zero-padded rows)
+    NORMS = 2,         ///< count floats, squared L2 norm of each row
+    PERSON_IDS = 3,    ///< count int32
+    CODES_F16 = 4,     ///< count * stride uint16 half-precision codes
+    CODES_U8 = 5,      ///< count * stride uint8 codes
+    INT8_RANGES = 6,   ///< stride floats of scale, then stride floats of offset
+    IVF_CENTROIDS = 7, ///< nlist * stride floats
+    IVF_ASSIGN = 8,    ///< count int32, posting list of each row
+    LOG_SEQUENCE = 9,  ///< uint64, last IndexLog record merged into this file
+    PROTOTYPES_F32 = 10,   ///< people * stride floats, one prototype row per person
+    PROTOTYPE_PERSONS = 11 ///< people int32, person of each prototype row
+};
+
+/// Maximum number of sections a header may declare
+constexpr uint32_t MAX_SECTIONS = 16;
+
+struct IndexFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;         ///< sizeof(IndexFileHeader)
+    uint32_t dimension;
+    uint32_t stride;              ///< Floats per padded row
+    uint64_t count;               ///< Number of vectors
+    uint64_t model_hash;          ///< Hash of the embedding model (0 = unknown)
+    uint32_t storage;             ///< Config::IndexStorage of the codes section
+    uint32_t nlist;               ///< IVF lists (0 = not trained)
+    uint64_t ivf_trained_size;
+    uint64_t int8_trained_size;
+    uint32_t section_count;
+    uint32_t reserved;
+    uint64_t header_checksum;     ///< Over header (this field zeroed) and section table
+};
+
+struct IndexFileSection {
+    uint32_t type;                ///< SectionType
+    uint32_t reserved;
+    uint64_t offset;              ///< From start of file, SECTION_ALIGNMENT aligned
+    uint64_t size;                ///< In bytes
+    uint64_t checksum;            ///< Over the section bytes
+};
+
+static_assert(sizeof(IndexFileHeader) == 80, "IndexFileHeader layout changed");
+static_assert(sizeof(IndexFileSection) == 32, "IndexFileSection layout changed");
+
+/**
+ * @brief Streaming 64-bit checksum (multiply-rotate, 4 lanes, ~10 GB/s)
+ *
+ * Detects corruption and truncation; not a cryptographic hash.
+ */
+class Checksum {
+public:
+    explicit Checksum(uint64_t seed = 0);
+    void update(const void* data, size_t size);
+    uint64_t digest() const;
+
+private:
+    uint64_t lanes[4];
+    unsigned char buffer[32];
+    size_t buffered = 0;
+    uint64_t total = 0;
+};
+
+/// One-shot checksum of a buffer
+uint64_t checksum(const void* data, size_t size);
+
+/**
+ * @brief Checksum of a whole file, used as the embedding model hash
+ *
+ * @return Checksum, or 0 if the file cannot be read
+ */
+uint64_t checksum_file(const std::string& path);
+
+/**
+ * @brief checksum_file(), remembered in "<path>.hash" by size and modification time
+ *
+ * The embedding model is hashed once rather than read in full at every start.
+ * The sidecar is best-effort: if it cannot be written the checksum is still
+ * returned, and a sidecar that does not match the file is recomputed.
+ */
+uint64_t cached_checksum_file(const std::string& path);
+
+/**
+ * @brief Identifies the contents of an index file without reading all of it
+ *
+ * For files in this layout it is the header checksum, which covers the
+ * section table and so every section's checksum. Other backends' files fall
+ * back to cached_checksum_file().
+ *
+ * @return Stamp, or 0 if the file cannot be read
+ */
+uint64_t stamp_file(const std::string& path);
+
+/**
+ * @brief Durably move a fully written temporary file over path
+ *
+ * fsyncs the temporary file, renames it into place and fsyncs the directory,
+ * so a crash leaves either the old file or the complete new one. The
+ * temporary file is removed on failure.
+ */
+bool replace_file(const std::string& temp_path, const std::string& path);
+
+/**
+ * @brief Read-only memory mapping of a whole file
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    void swap(MappedFile& other);
+
+    bool is_open() const { return data != nullptr; }
+    const unsigned char* get_data() const { return data; }
+    size_t get_size() const { return size; }
+
+private:
+    unsigned char* data = nullptr;
+    size_t size = 0;
+};
+
+} // namespace IndexFile
+
+#endif // INDEX_FILE_H
@@ -0,0 +1,145 @@
+#ifndef INDEX_LOG_H
+#define INDEX_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @file index_log.h
+ * @brief Append-only write-ahead log of gallery insertions and deletions
+ *
+ * New embeddings (and person deletions) are appended to a small log beside the index file and
+ * fsync'd, instead of rewriting the whole index for every enrollment.
+ * Every record carries a sequence number; the index file remembers the last
+ * sequence it contains (VectorIndexBase::get_log_sequence()), so replay after
+ * a crash and compaction never apply a record twice.
+ *
+ * Layout (native little-endian):
+ *
+ *   IndexLogHeader
+ *   record*   sequence (u64), person_id (i32), kind (u32),
+ *             dimension floats, checksum (u64) over the preceding fields
+ *
+ * kind was a zero reserved field before deletions were logged, so older
+ * logs read as all insertions. A deletion record carries no embedding
+ * (its floats are zero).
+ *
+ * A torn or corrupt record ends the log; it and anything after it are
+ * truncated when the log is opened.
+ */
+
+class IndexLog {
+public:
+    enum class RecordKind : uint32_t {
+        INSERT = 0,         // Add embedding for person_id
+        DELETE_PERSON = 1   // Remove every embedding of person_id
+    };
+
+    /// One logged change
+    struct Record {
+        uint64_t sequence = 0;
+        int person_id = -1;
+        RecordKind kind = RecordKind::INSERT;
+        std::vector<float> embedding;
+    };
+
+    IndexLog() = default;
+    ~IndexLog();
+
+    IndexLog(const IndexLog&) = delete;
+    IndexLog& operator=(const IndexLog&) = delete;
+
+    /**
+     * @brief Open (or create) the log and recover it
+     *
+     * A log written for another dimension or model is discarded.
+     *
+     * @param path Log file path
+     * @param dimension Embedding dimension
+     * @param model_hash Hash of the embedding model (0 = unknown)
+     * @param base_sequence Last sequence already contained in the index file
+     * @return true if the log is ready for appends
+     */
+    bool open(const std::string& path, int dimension, uint64_t model_hash, uint64_t base_sequence);
+
+    /**
+     * @brief Open an existing log only to read its records
+     *
+     * Nothing is written: an incompatible log reads as empty and a torn tail
+     * is skipped, not truncated. Appends fail.
+     *
+     * @return false if the log does not exist or cannot be read
+     */
+    bool open_read_only(const std::string& path, int dimension, uint64_t model_hash, uint64_t base_sequence);
+    void close();
+    bool is_open() const;
+
+    /**
+     * @brief Append a record and fsync it
+     *
+     * @param[out] sequence Sequence number assigned to the record
+     */
+    bool append(int person_id, const std::vector<float>& embedding, uint64_t& sequence);
+
+    /**
+     * @brief Append a deletion of every embedding of a person and fsync it
+     *
+     * @param[out] sequence Sequence number assigned to the record
+     */
+    bool append_delete(int person_id, uint64_t& sequence);
+
+    /**
+     * @brief Read all records with a sequence greater than after_sequence
+     */
+    bool read_records(uint64_t after_sequence, std::vector<Record>& records) const;
+
+    /**
+     * @brief Drop records up to and including sequence (they are now in the index file)
+     *
+     * Later records are kept; the log is rewritten and renamed into place.
+     */
+    bool discard_through(uint64_t sequence);
+
+    size_t get_num_records() const;
+    uint64_t get_last_sequence() const;
+    const std::string& get_path() const { return path; }
+    int get_dimension() const { return dimension; }
+
+    /**
+     * @brief fsync a file and the directory entry that names it
+     */
+    static bool sync_path(const std::string& file_path);
+
+private:
+    struct IndexLogHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t dimension;
+        uint64_t model_hash;
+    };
+    static_assert(sizeof(IndexLogHeader) == 24, "IndexLogHeader layout changed");
+
+    static constexpr char MAGIC[8] = {'F', 'A', 'I', 'S', 'S', 'L', 'O', 'G'};
+    static constexpr uint32_t VERSION = 1;
+
+    bool open_file(const std::string& path, int dimension, uint64_t model_hash, uint64_t base_sequence, int flags);
+    size_t record_size() const;
+    bool write_header(int file_descriptor) const;
+    void encode_record(const Record& record, std::vector<unsigned char>& buffer) const;
+    bool append_record(Record& record, uint64_t& sequence);
+    bool recover(bool repair);
+    bool read_records_locked(uint64_t after_sequence, std::vector<Record>& records) const;
+
+    mutable std::mutex mutex;  // Appends come from the UI thread, compaction from a worker
+    std::string path;
+    int fd = -1;
+    int dimension = 0;
+    uint64_t model_hash = 0;
+    size_t num_records = 0;
+    uint64_t last_sequence = 0;
+};
+
+#endif // INDEX_LOG_H
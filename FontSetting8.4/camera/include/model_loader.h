@@ -6,37 +6,112 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
 
 class ModelLoader {
 private:
-    std::unique_ptr<Ort::Env> env;
-    std::unique_ptr<Ort::Session> session;
+    std::unique_ptr<Ort::Env> env;  // Owns the global thread pools; created by the first load_model()
+    std::unique_ptr<Ort::PrepackedWeightsContainer> prepacked_weights;  // Shared by the pooled sessions
     std::vector<std::string> input_names;
     std::vector<std::string> output_names;
     std::vector<const char*> input_names_cstr;
     std::vector<const char*> output_names_cstr;
     std::vector<int64_t> input_shape;
     std::vector<int64_t> output_shape;
+    std::string quantization;  // "quantization" metadata of the model ("" for float models)
     bool is_loaded = false;
+    int max_batch = 0;  // Faces per call for dynamic-batch models (0 = Config::ARCFACE_MAX_BATCH)
+    int pool_size = 0;  // Sessions created by load_model() (0 = Config::ARCFACE_SESSIONS)
+    int intra_op_threads;
+    int inter_op_threads;
 
-    // Helper methods
-    std::vector<float> preprocess_image(const cv::Mat& image);
-    cv::Mat normalize_image(const cv::Mat& image);
+    // Input and output tensors of one batch size, bound to a session once
+    // through Ort::IoBinding and reused by every call of that size
+    struct BatchBinding {
+        std::vector<float> input;    // [batch, C, H, W]
+        std::vector<float> output;   // [batch, embedding]; empty if the output shape is only known at run time
+        Ort::Value input_tensor{nullptr};
+        Ort::Value output_tensor{nullptr};
+        std::unique_ptr<Ort::IoBinding> binding;
+    };
+
+    // One session of the pool with its bindings and scratch buffers; used by
+    // one caller at a time between acquire_session() and release_session()
+    struct PooledSession {
+        std::unique_ptr<Ort::Session> session;
+        std::vector<std::unique_ptr<BatchBinding>> bindings;  // Indexed by batch size, created on first use
+        cv::Mat depth_scratch;           // Non-8-bit crops converted for the preprocessing kernel
+        std::vector<size_t> slot_faces;  // Face of each batch slot
+    };
+    std::vector<std::unique_ptr<PooledSession>> sessions;
+    std::vector<PooledSession*> idle_sessions;
+    int busy_sessions = 0;
+    bool loading = false;             // load_model() is replacing the pool
+    std::mutex pool_mutex;            // Guards the pool and is_loaded
+    std::condition_variable pool_cv;  // Signalled when a session is returned or a load finishes
+
+    // Build the pool for a model (pool_mutex held, no session checked out)
+    bool create_sessions(const std::string& model_path);
+
+    // Check a session out of the pool, waiting while all are busy; nullptr if no model is loaded
+    PooledSession* acquire_session();
+    void release_session(PooledSession* pooled);
+
+    // Helper methods (on a checked-out session)
+    bool preprocess_into(PooledSession& pooled, const cv::Mat& image, float* chw);  // One CHW image into a batch tensor slot
+    BatchBinding* get_binding(PooledSession& pooled, int batch);
+    // One session call on the bound tensors; writes the L2-normalized embedding of each slot's face
+    bool run_batch(PooledSession& pooled, BatchBinding& bound, int batch, std::vector<float>* embeddings);
+    // Every inference call: count faces into embeddings[0..count), reusing their capacity
+    bool run_faces(const cv::Mat* face_images, size_t count, std::vector<float>* embeddings);
 
 public:
     ModelLoader();
     ~ModelLoader() = default;
 
-    // Load ONNX model
+    // Load ONNX model into a pool of sessions. Waits for calls in flight
+    // on the previous model to finish.
     bool load_model(const std::string& model_path);
 
+    // Sessions created by the next load_model() (0 restores Config::ARCFACE_SESSIONS).
+    // Up to this many inference calls run at once; further callers wait.
+    void set_session_count(int count) { pool_size = count; }
+    int get_session_count() const;
+
+    // Thread budget shared by all sessions (0 = ONNX Runtime's default).
+    // Only takes effect before the first load_model(), which creates the environment.
+    void set_thread_budget(int intra_op, int inter_op) { intra_op_threads = intra_op; inter_op_threads = inter_op; }
+
     // Check if model is loaded
     bool is_model_loaded() const { return is_loaded; }
 
+    // How the model was quantized ("int8-static", "int8-dynamic"), "" for a float model.
+    // Read from the metadata tools/quantize_arcface.py writes.
+    const std::string& get_quantization() const { return quantization; }
+
     // Run inference on a face image
     // Input: BGR image of detected face
     // Output: 128-dimensional embedding vector
     std::vector<float> inference(const cv::Mat& face_image);
+    // Same, into a caller-owned vector: reusing it between calls keeps
+    // steady-state inference free of heap allocations. False if the call failed.
+    bool inference(const cv::Mat& face_image, std::vector<float>& embedding);
+
+    // Run inference on several faces with as few session calls as possible:
+    // up to Config::ARCFACE_MAX_BATCH faces per call when the model's batch
+    // axis is dynamic, otherwise chunks of the model's fixed batch size.
+    // Returns one embedding per face, empty for faces that failed.
+    std::vector<std::vector<float>> inference_batch(const std::vector<cv::Mat>& face_images);
+    // Same, into caller-owned vectors: reusing them between calls keeps
+    // steady-state inference free of heap allocations. False if a call failed.
+    bool inference_batch(const std::vector<cv::Mat>& face_images, std::vector<std::vector<float>>& embeddings);
+
+    // Faces per session call used by inference_batch(); the setter only
+    // affects models with a dynamic batch axis (0 restores the default)
+    int get_max_batch_size() const;
+    void set_max_batch_size(int faces) { max_batch = faces; }
+    bool has_dynamic_batch() const { return !input_shape.empty() && input_shape[0] < 0; }
 
     // Get model input/output information
     int get_embedding_dimension() const;
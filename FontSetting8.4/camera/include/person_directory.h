@@ -0,0 +1,186 @@
+#ifndef PERSON_DIRECTORY_H
+#define PERSON_DIRECTORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @file person_directory.h
+ * @brief Per-person row lists and tombstones for gallery indexes
+ *
+ * Maps each person_id to the rows (slots) holding their embeddings, so one
+ * person can be found and deleted without scanning the gallery. Deleted rows
+ * are only marked: searches skip them right away and a compaction pass
+ * rebuilds the index without them later.
+ *
+ * Everything lives in flat arrays (an open-addressed person table, a per-row
+ * chain and a tombstone bitset), so copying the directory along with a
+ * copy-on-write index clone is a few memcpys rather than one allocation per
+ * person.
+ */
+class PersonDirectory {
+public:
+    void clear() {
+        table.clear();
+        previous.clear();
+        tombstones.clear();
+        num_used = 0;
+        num_people = 0;
+        num_deleted = 0;
+    }
+
+    /// Record that row slot (the next free row) holds an embedding of person_id
+    void add(int person_id, size_t slot) {
+        if (previous.size() <= slot) {
+            previous.resize(slot + 1, NONE);
+            tombstones.resize(slot / 64 + 1, 0);
+        }
+        Entry& entry = find_or_insert(person_id);
+        if (entry.newest < 0) {
+            num_people++;
+        }
+        previous[slot] = entry.newest;
+        entry.newest = static_cast<int>(slot);
+    }
+
+    /// Live rows of a person, newest first (empty if unknown or deleted)
+    std::vector<int> slots_of(int person_id) const {
+        std::vector<int> slots;
+        for_each_slot(person_id, [&](size_t slot) { slots.push_back(static_cast<int>(slot)); });
+        return slots;
+    }
+
+    /// Call fn(slot) for each live row of a person, newest first, without allocating
+    template <typename Fn>
+    void for_each_slot(int person_id, Fn&& fn) const {
+        size_t i = find(person_id);
+        for (int slot = i == NOT_FOUND ? NONE : table[i].newest; slot >= 0; slot = previous[slot]) {
+            fn(static_cast<size_t>(slot));
+        }
+    }
+
+    /// Number of live rows of a person
+    size_t count_of(int person_id) const {
+        size_t count = 0;
+        for_each_slot(person_id, [&](size_t) { count++; });
+        return count;
+    }
+
+    /// Tombstone every row of a person; returns the number of rows removed
+    int remove(int person_id) {
+        size_t i = find(person_id);
+        if (i == NOT_FOUND || table[i].newest < 0) {
+            return 0;
+        }
+        int removed = 0;
+        for (int slot = table[i].newest; slot >= 0; slot = previous[slot]) {
+            tombstones[static_cast<size_t>(slot) / 64] |= uint64_t(1) << (slot % 64);
+            removed++;
+        }
+        table[i].newest = NONE;
+        num_people--;
+        num_deleted += static_cast<size_t>(removed);
+        return removed;
+    }
+
+    bool is_deleted(size_t slot) const {
+        return num_deleted > 0 && (tombstones[slot / 64] >> (slot % 64)) & 1;
+    }
+
+    /// Call fn(person_id) for each person with live rows
+    template <typename Fn>
+    void for_each_person(Fn&& fn) const {
+        for (const Entry& entry : table) {
+            if (entry.newest >= 0) {
+                fn(entry.person_id);
+            }
+        }
+    }
+
+    /// Slot of a person's prototype in the owning index (-1 if it keeps none)
+    int prototype_of(int person_id) const {
+        size_t i = find(person_id);
+        return i == NOT_FOUND ? NONE : table[i].prototype;
+    }
+
+    void set_prototype(int person_id, int slot) {
+        size_t i = find(person_id);
+        if (i != NOT_FOUND) {
+            table[i].prototype = slot;
+        }
+    }
+
+    bool has_deletions() const { return num_deleted > 0; }
+    size_t get_num_deleted() const { return num_deleted; }
+    size_t get_num_people() const { return num_people; }
+
+private:
+    static constexpr int NONE = -1;   // End of a row chain / person without live rows
+    static constexpr int EMPTY = -2;  // Unused table entry
+
+    struct Entry {
+        int person_id = 0;
+        int newest = EMPTY;  // Newest live row of the person
+        int prototype = NONE;  // Per-person summary row kept by the index, if any
+    };
+
+    size_t home(int person_id) const {
+        // Fibonacci hashing; the table size is a power of two
+        return (static_cast<uint32_t>(person_id) * 2654435769u) & (table.size() - 1);
+    }
+
+    static constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+
+    /// Table position of person_id, or NOT_FOUND
+    size_t find(int person_id) const {
+        if (table.empty()) {
+            return NOT_FOUND;
+        }
+        for (size_t i = home(person_id);; i = (i + 1) & (table.size() - 1)) {
+            if (table[i].newest == EMPTY) {
+                return NOT_FOUND;
+            }
+            if (table[i].person_id == person_id) {
+                return i;
+            }
+        }
+    }
+
+    Entry& find_or_insert(int person_id) {
+        // Keep the load factor under 3/4 so probe runs stay short
+        if ((num_used + 1) * 4 > table.size() * 3) {
+            std::vector<Entry> old(table.size() < 16 ? 16 : table.size() * 2);
+            old.swap(table);
+            for (const Entry& entry : old) {
+                if (entry.newest != EMPTY) {
+                    size_t i = home(entry.person_id);
+                    while (table[i].newest != EMPTY) {
+                        i = (i + 1) & (table.size() - 1);
+                    }
+                    table[i] = entry;
+                }
+            }
+        }
+
+        size_t i = home(person_id);
+        while (table[i].newest != EMPTY && table[i].person_id != person_id) {
+            i = (i + 1) & (table.size() - 1);
+        }
+        if (table[i].newest == EMPTY) {
+            table[i].person_id = person_id;
+            table[i].newest = NONE;
+            num_used++;
+        }
+        return table[i];
+    }
+
+    std::vector<Entry> table;         // person_id -> newest row; deleted people keep an entry
+    std::vector<int> previous;        // Per row: the same person's next older row, or NONE
+    std::vector<uint64_t> tombstones; // One bit per row
+    size_t num_used = 0;              // Table entries in use
+    size_t num_people = 0;            // People with live rows
+    size_t num_deleted = 0;
+};
+
+#endif // PERSON_DIRECTORY_H
@@ -0,0 +1,105 @@
+#ifndef PERSON_FILTER_H
+#define PERSON_FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @file person_filter.h
+ * @brief Bitmap of person_ids a filtered search may return
+ *
+ * One bit per person_id (database ids are small and dense), so a group of
+ * 20,000 people is 2.5 KB and a membership test is a shift and a mask.
+ * Access groups (zones, shifts) are kept as one PersonFilter each and
+ * combined with unite() / intersect() for a door's rule.
+ *
+ * An empty filter allows nobody.
+ */
+class PersonFilter {
+public:
+    PersonFilter() = default;
+
+    explicit PersonFilter(const std::vector<int>& person_ids) {
+        for (int person_id : person_ids) {
+            add(person_id);
+        }
+    }
+
+    void add(int person_id) {
+        if (person_id < 0) {
+            return;
+        }
+        size_t word = static_cast<size_t>(person_id) / 64;
+        if (words.size() <= word) {
+            words.resize(word + 1, 0);
+        }
+        uint64_t bit = uint64_t(1) << (person_id % 64);
+        if (!(words[word] & bit)) {
+            words[word] |= bit;
+            num_people++;
+        }
+    }
+
+    void remove(int person_id) {
+        if (allows(person_id)) {
+            words[static_cast<size_t>(person_id) / 64] &= ~(uint64_t(1) << (person_id % 64));
+            num_people--;
+        }
+    }
+
+    bool allows(int person_id) const {
+        size_t word = static_cast<size_t>(person_id) / 64;
+        return person_id >= 0 && word < words.size() && (words[word] >> (person_id % 64)) & 1;
+    }
+
+    /// Allow the people of either filter (e.g. two zones)
+    PersonFilter& unite(const PersonFilter& other) {
+        if (words.size() < other.words.size()) {
+            words.resize(other.words.size(), 0);
+        }
+        for (size_t w = 0; w < other.words.size(); w++) {
+            words[w] |= other.words[w];
+        }
+        recount();
+        return *this;
+    }
+
+    /// Allow only the people in both filters (e.g. zone and shift)
+    PersonFilter& intersect(const PersonFilter& other) {
+        if (words.size() > other.words.size()) {
+            words.resize(other.words.size());
+        }
+        for (size_t w = 0; w < words.size(); w++) {
+            words[w] &= other.words[w];
+        }
+        recount();
+        return *this;
+    }
+
+    /// Call fn(person_id) for every allowed person, in ascending order
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        for (size_t w = 0; w < words.size(); w++) {
+            for (uint64_t bits = words[w]; bits != 0; bits &= bits - 1) {
+                fn(static_cast<int>(w * 64 + __builtin_ctzll(bits)));
+            }
+        }
+    }
+
+    size_t count() const { return num_people; }
+    bool empty() const { return num_people == 0; }
+
+private:
+    void recount() {
+        num_people = 0;
+        for (uint64_t word : words) {
+            num_people += static_cast<size_t>(__builtin_popcountll(word));
+        }
+    }
+
+    std::vector<uint64_t> words;
+    size_t num_people = 0;
+};
+
+#endif // PERSON_FILTER_H
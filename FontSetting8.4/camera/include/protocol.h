@@ -47,6 +47,9 @@ enum class MessageType : uint16_t {
     REQ_LIST_PERSONS = 0x0009,
     REQ_GET_SETTINGS = 0x000A,
     REQ_SET_SETTINGS = 0x000B,
+    REQ_VERIFY = 0x000F,
+    REQ_EXPORT_SNAPSHOT = 0x0010,
+    REQ_IMPORT_SNAPSHOT = 0x0011,
 
     // Response messages (Server -> Client)
     RESP_SUCCESS = 0x1001,
@@ -239,6 +242,56 @@ public:
     }
 };
 
+/**
+ * @brief 1:1 verification request
+ *
+ * Checks the face in front of the camera against the claimed person only
+ * (ID from a badge or PIN), instead of searching the whole gallery.
+ */
+class VerifyMessage : public Message {
+public:
+    uint64_t person_id;
+
+    VerifyMessage(uint64_t id)
+        : Message(MessageType::REQ_VERIFY),
+          person_id(id) {
+        write_uint64(person_id);
+        finalize();
+    }
+
+    static VerifyMessage from_message(const Message& msg) {
+        size_t offset = 0;
+        uint64_t id = msg.read_uint64(offset);
+        return VerifyMessage(id);
+    }
+};
+
+/**
+ * @brief Gallery snapshot export/import request
+ *
+ * The path names a file on the kiosk. Importing replaces the whole gallery
+ * (people, groups, embeddings and index) with the snapshot's.
+ */
+class SnapshotMessage : public Message {
+public:
+    bool import;
+    std::string path;
+
+    SnapshotMessage(bool import_snapshot, const std::string& snapshot_path)
+        : Message(import_snapshot ? MessageType::REQ_IMPORT_SNAPSHOT : MessageType::REQ_EXPORT_SNAPSHOT),
+          import(import_snapshot),
+          path(snapshot_path) {
+        write_string(path);
+        finalize();
+    }
+
+    static SnapshotMessage from_message(const Message& msg) {
+        size_t offset = 0;
+        std::string snapshot_path = msg.read_string(offset);
+        return SnapshotMessage(msg.header.get_type() == MessageType::REQ_IMPORT_SNAPSHOT, snapshot_path);
+    }
+};
+
 /**
  * @brief Train model request
  */
@@ -637,11 +690,14 @@ enum class ErrorCode : uint32_t {
     NO_FACE_DETECTED = 21,
     EMBEDDING_EXTRACTION_FAILED = 22,
     REGISTRATION_FAILED = 23,
+    DUPLICATE_FACE = 24,  // Face already enrolled under another ID (message lists the matches)
     TRAINING_IN_PROGRESS = 30,
     TRAINING_FAILED = 31,
     PERSON_NOT_FOUND = 40,
+    VERIFICATION_FAILED = 41,  // Face does not match the claimed ID (message has the similarity)
     INVALID_PARAMETERS = 50,
     DATABASE_ERROR = 60,
+    SNAPSHOT_REJECTED = 61,  // Snapshot missing, corrupt or exported for another model
 };
 
 } // namespace Protocol
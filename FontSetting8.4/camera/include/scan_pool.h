@@ -0,0 +1,95 @@
+#ifndef SCAN_POOL_H
+#define SCAN_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @file scan_pool.h
+ * @brief Persistent worker threads for partitioned gallery scans
+ *
+ * A single search of a large gallery is memory-bound work that one core
+ * cannot saturate the memory bus with. The gallery is split into
+ * partitions that the calling thread and the pool's workers scan together;
+ * each participant keeps its own partial result, and the caller merges them.
+ * Workers stay parked between searches, so a search pays a wake-up rather
+ * than a thread start.
+ */
+
+/**
+ * @brief Fixed set of worker threads that run the partitions of one job at a time
+ *
+ * @thread_safety run() may be called from several threads at once; their
+ *                jobs queue up and the workers take them in order. The caller
+ *                always works on its own job, so a busy pool never stalls it.
+ */
+class ScanPool {
+public:
+    /// Task callback: partition index and participant slot (0 = caller, 1.. = workers)
+    using TaskFn = std::function<void(size_t task, int slot)>;
+
+    /**
+     * @param num_threads Participants including the calling thread
+     *                    (<= 0 = hardware concurrency, 1 = no workers)
+     */
+    explicit ScanPool(int num_threads);
+    ~ScanPool();
+
+    ScanPool(const ScanPool&) = delete;
+    ScanPool& operator=(const ScanPool&) = delete;
+
+    /**
+     * @brief Run task(0) .. task(num_tasks - 1) on the caller and the workers
+     *
+     * Returns once every task has finished. A slot runs one task at a time,
+     * so per-slot state needs no locking; size it with get_num_threads().
+     */
+    void run(size_t num_tasks, const TaskFn& task);
+
+    /// Participants including the caller (1 = everything runs inline)
+    int get_num_threads() const { return static_cast<int>(workers.size()) + 1; }
+
+    /**
+     * @brief Pool shared by all gallery indexes
+     *
+     * Created with Config::SCAN_THREADS on first use. Callers keep the
+     * returned pointer for the whole scan, so a resize never pulls the pool
+     * out from under a running search.
+     */
+    static std::shared_ptr<ScanPool> shared();
+
+    /**
+     * @brief Replace the shared pool with one of num_threads participants
+     *
+     * Searches already running finish on the old pool, which stops once the
+     * last of them releases it.
+     */
+    static void set_shared_threads(int num_threads);
+
+private:
+    struct Job {
+        const TaskFn* task = nullptr;
+        size_t num_tasks = 0;
+        std::atomic<size_t> next{0};  // Next unclaimed task
+        std::atomic<size_t> done{0};  // Finished tasks
+    };
+
+    void worker_loop(int slot);
+    void run_tasks(Job& job, int slot);
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable work_ready;
+    std::condition_variable job_done;
+    std::deque<std::shared_ptr<Job>> jobs;  // Jobs with unclaimed tasks, oldest first
+    bool stopping = false;
+};
+
+#endif // SCAN_POOL_H
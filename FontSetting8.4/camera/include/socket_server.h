@@ -24,6 +24,8 @@ namespace Protocol {
  * - capture: Capture and register new person
  * - registering: Train recognition model
  * - status: Get application status
+ * - verify: Check the face in front of the camera against one claimed ID
+ * - export / import: Write or load a gallery snapshot file (provisioning)
  */
 class SocketServer {
 public:
@@ -0,0 +1,125 @@
+#ifndef TOP_K_H
+#define TOP_K_H
+
+#include <algorithm>
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "config.h"
+
+/**
+ * @file top_k.h
+ * @brief Bounded top-k selection and per-identity aggregation of search hits
+ *
+ * Both work on a "smaller is better" key (a squared distance, or a negated
+ * similarity), so every index backend can share them.
+ */
+
+/**
+ * @brief Keeps the k entries with the smallest key seen so far
+ *
+ * A max-heap of at most k entries: each push is O(log k) and most rows are
+ * rejected by a single comparison with the current worst entry.
+ */
+class TopKSelector {
+public:
+    using Entry = std::pair<float, int>;  // (key, index)
+
+    explicit TopKSelector(size_t k) : capacity(k) { heap.reserve(k); }
+
+    /// Would an entry with this key be kept?
+    bool accepts(float key) const {
+        return heap.size() < capacity || (capacity > 0 && key < heap.front().first);
+    }
+
+    void push(float key, int index) {
+        if (heap.size() < capacity) {
+            heap.emplace_back(key, index);
+            std::push_heap(heap.begin(), heap.end());
+        } else if (accepts(key)) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back() = Entry(key, index);
+            std::push_heap(heap.begin(), heap.end());
+        }
+    }
+
+    size_t size() const { return heap.size(); }
+
+    /// Kept entries ordered from smallest to largest key; empties the selector
+    std::vector<Entry> take_sorted() {
+        std::sort_heap(heap.begin(), heap.end());
+        std::vector<Entry> sorted;
+        sorted.swap(heap);
+        return sorted;
+    }
+
+private:
+    size_t capacity;
+    std::vector<Entry> heap;
+};
+
+/**
+ * @brief Folds per-embedding hits into one score per person
+ *
+ * A person usually has several gallery embeddings. BEST scores a person by
+ * their closest embedding, MEAN_TOP_M by the mean key of their m closest.
+ */
+class IdentityAggregator {
+public:
+    using Entry = std::pair<float, int>;  // (aggregated key, person_id)
+
+    IdentityAggregator(Config::IdentityAggregation mode, int top_m)
+        : m(mode == Config::IdentityAggregation::BEST ? 1 : std::max(1, top_m)) {}
+
+    void add(int person_id, float key) {
+        auto inserted = slot_of.emplace(person_id, static_cast<int>(counts.size()));
+        size_t slot = static_cast<size_t>(inserted.first->second);
+        if (inserted.second) {
+            counts.push_back(0);
+            keys.resize(keys.size() + m);
+            persons.push_back(person_id);
+        }
+
+        // Per-person keys stay sorted ascending; m is small
+        float* best = keys.data() + slot * m;
+        int& count = counts[slot];
+        if (count == m && key >= best[m - 1]) {
+            return;
+        }
+        int pos = count < m ? count++ : m - 1;
+        while (pos > 0 && best[pos - 1] > key) {
+            best[pos] = best[pos - 1];
+            pos--;
+        }
+        best[pos] = key;
+    }
+
+    /// The k best people ordered from best to worst
+    std::vector<Entry> top(int k) const {
+        TopKSelector selector(static_cast<size_t>(std::max(0, k)));
+        for (size_t slot = 0; slot < counts.size(); slot++) {
+            const float* best = keys.data() + slot * m;
+            float sum = 0.0f;
+            for (int j = 0; j < counts[slot]; j++) {
+                sum += best[j];
+            }
+            selector.push(sum / counts[slot], static_cast<int>(slot));
+        }
+
+        std::vector<Entry> ranked = selector.take_sorted();
+        for (Entry& entry : ranked) {
+            entry.second = persons[entry.second];
+        }
+        return ranked;
+    }
+
+private:
+    int m;
+    std::unordered_map<int, int> slot_of;
+    std::vector<int> persons;
+    std::vector<int> counts;
+    std::vector<float> keys;  // m per person
+};
+
+#endif // TOP_K_H
@@ -0,0 +1,335 @@
+#ifndef VECTOR_INDEX_BASE_H
+#define VECTOR_INDEX_BASE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "person_filter.h"
+#include "embedding_projection.h"
+
+/**
+ * @file vector_index_base.h
+ * @brief Abstract base class for face embedding search indexes
+ *
+ * Provides a common interface for the gallery search backends (exact scan
+ * with IVF partitioning, HNSW graph), so DeepFaceRecognizer can switch
+ * between them without touching the recognition code.
+ */
+
+/**
+ * @brief Abstract base class for nearest-neighbor embedding indexes
+ *
+ * Each vector is stored together with the person_id it belongs to. Search
+ * returns person_ids with a 0-1 similarity derived from the L2 distance
+ * between L2-normalized embeddings.
+ *
+ * @thread_safety Searches may run concurrently with each other, but not with
+ *                any modification. DeepFaceRecognizer never modifies an index
+ *                that readers can see: it changes a clone() and publishes it.
+ */
+class VectorIndexBase {
+public:
+    virtual ~VectorIndexBase() = default;
+
+    /**
+     * @brief Initialize an empty index
+     *
+     * @param num_vectors Expected number of vectors (capacity hint)
+     * @return true if successful, false otherwise
+     */
+    virtual bool build_index(int num_vectors) = 0;
+
+    /**
+     * @brief Add a single embedding (incremental insert)
+     *
+     * @param person_id Person the embedding belongs to
+     * @param embedding Embedding of get_dimension() floats
+     * @return true if added, false otherwise
+     */
+    virtual bool add_vector(int person_id, const std::vector<float>& embedding) = 0;
+
+    /**
+     * @brief Add a batch of embeddings
+     *
+     * @param ids Person ID of each embedding
+     * @param embeddings Embeddings, same length as ids
+     * @return true if all were added, false otherwise
+     */
+    virtual bool add_vectors(const std::vector<int>& ids,
+                             const std::vector<std::vector<float>>& embeddings) = 0;
+
+    /**
+     * @brief Find the nearest stored embedding
+     *
+     * @param query_embedding Query of get_dimension() floats
+     * @param[out] confidence Similarity of the best match (0.0-1.0)
+     * @return person_id of the nearest neighbor, -1 on error
+     */
+    virtual int search(const std::vector<float>& query_embedding, double& confidence) = 0;
+
+    /**
+     * @brief Find the k nearest stored embeddings
+     *
+     * @param query_embedding Query of get_dimension() floats
+     * @param k Number of neighbors
+     * @param[out] confidences Similarity of each returned neighbor
+     * @return person_ids ordered from nearest to farthest
+     */
+    virtual std::vector<int> search_k(const std::vector<float>& query_embedding, int k,
+                                      std::vector<double>& confidences) = 0;
+
+    /**
+     * @brief Find the k nearest stored embeddings of the people a filter allows
+     *
+     * Rows of excluded people are skipped inside the search instead of being
+     * dropped from its result, so a closer match outside the filter (another
+     * zone, another shift) never hides the right person. Backends score the
+     * allowed rows directly when the filter names few people
+     * (Config::FILTER_DIRECT_SCAN_FRACTION), so restrictive filters are
+     * cheaper than an unfiltered search. The default widens search_k() until
+     * k allowed rows are found.
+     *
+     * @param query_embedding Query of get_dimension() floats
+     * @param k Number of neighbors
+     * @param filter People that may be returned
+     * @param[out] confidences Similarity of each returned neighbor
+     * @return person_ids ordered from nearest to farthest (empty if the filter
+     *         allows nobody in the index)
+     */
+    virtual std::vector<int> search_k(const std::vector<float>& query_embedding, int k,
+                                      const PersonFilter& filter, std::vector<double>& confidences);
+
+    /**
+     * @brief Find the nearest stored embedding of the people a filter allows
+     *
+     * @return person_id of the nearest allowed neighbor, -1 if there is none
+     */
+    int search(const std::vector<float>& query_embedding, const PersonFilter& filter, double& confidence);
+
+    /**
+     * @brief Find the k nearest stored embeddings for several queries at once
+     *
+     * Backends that can share one pass over the gallery between queries
+     * override this; the default runs search_k() per query.
+     *
+     * @param queries Queries of get_dimension() floats each
+     * @param k Number of neighbors per query
+     * @param[out] confidences Per query, similarity of each returned neighbor
+     * @return Per query, person_ids ordered from nearest to farthest
+     */
+    virtual std::vector<std::vector<int>> search_batch(const std::vector<std::vector<float>>& queries, int k,
+                                                       std::vector<std::vector<double>>& confidences);
+
+    /**
+     * @brief Find the k nearest distinct people
+     *
+     * Hits are aggregated per person_id, so a person with many embeddings
+     * appears once. The default aggregates an enlarged search_k() result;
+     * exact backends aggregate over every scanned row.
+     *
+     * @param query_embedding Query of get_dimension() floats
+     * @param k Number of people
+     * @param[out] confidences Aggregated similarity of each returned person
+     * @param aggregation Best match or mean of the top_m matches per person
+     * @param top_m Matches averaged per person for MEAN_TOP_M
+     * @return person_ids ordered from most to least similar
+     */
+    virtual std::vector<int> search_identities(const std::vector<float>& query_embedding, int k,
+                                               std::vector<double>& confidences,
+                                               Config::IdentityAggregation aggregation = Config::IDENTITY_AGGREGATION,
+                                               int top_m = Config::IDENTITY_TOP_M);
+
+    /**
+     * @brief Find every person with an embedding at least min_similarity to the query
+     *
+     * Used to catch duplicate enrollments: unlike search_identities() the
+     * caller does not guess how many people may match. Each person appears
+     * once, scored by their closest embedding. The default widens
+     * search_identities() until a person below the threshold is reached;
+     * exact backends collect the matches in a single scan.
+     *
+     * @param query_embedding Query of get_dimension() floats
+     * @param min_similarity Similarity threshold (0.0-1.0)
+     * @param[out] confidences Similarity of each returned person
+     * @return person_ids ordered from most to least similar
+     */
+    virtual std::vector<int> range_search(const std::vector<float>& query_embedding, double min_similarity,
+                                          std::vector<double>& confidences);
+
+    /**
+     * @brief Score a query against one person's embeddings only (1:1 verification)
+     *
+     * For flows where the claimed identity is already known (badge, PIN):
+     * the backends walk the person's rows through the per-person directory,
+     * so the cost depends on how many embeddings the person has, not on the
+     * size of the gallery. The default runs a single-person filtered search.
+     *
+     * @param query_embedding Query of get_dimension() floats
+     * @param person_id Claimed identity
+     * @param[out] confidence Similarity (0.0-1.0) of the person's closest embedding, 0.0 if none
+     * @return Number of the person's embeddings scored (0 if the person is not indexed)
+     */
+    virtual int verify(const std::vector<float>& query_embedding, int person_id, double& confidence);
+
+    /**
+     * @brief Delete every embedding of a person
+     *
+     * Rows are tombstoned through the per-person directory: searches skip
+     * them immediately, and compacted() leaves them out of a rebuilt copy.
+     *
+     * @param person_id Person to remove
+     * @return Number of embeddings removed (0 if the person has none)
+     */
+    virtual int remove_person(int person_id) = 0;
+
+    /**
+     * @brief Replace all embeddings of a person with a new set
+     *
+     * The old rows are tombstoned and the new ones appended; nothing else in
+     * the index is rebuilt.
+     *
+     * @return true if all new embeddings were added
+     */
+    virtual bool replace_person(int person_id, const std::vector<std::vector<float>>& embeddings);
+
+    /**
+     * @brief Number of live embeddings of one person
+     */
+    virtual int get_person_vector_count(int person_id) const = 0;
+
+    /**
+     * @brief Number of tombstoned rows still taking up space
+     */
+    virtual int get_num_deleted() const = 0;
+
+    /**
+     * @brief Copy of the index without tombstoned rows
+     *
+     * Same backend, settings and trained state; the original is untouched.
+     */
+    virtual std::unique_ptr<VectorIndexBase> compacted() const = 0;
+
+    /**
+     * @brief Persist the index to a file
+     */
+    virtual bool save_index(const std::string& filepath) = 0;
+
+    /**
+     * @brief Load the index from a file written by save_index()
+     */
+    virtual bool load_index(const std::string& filepath) = 0;
+
+    /**
+     * @brief Check whether the index has been built or loaded
+     */
+    virtual bool is_index_built() const = 0;
+
+    /**
+     * @brief Number of stored embeddings (tombstoned rows excluded)
+     */
+    virtual int get_num_vectors() const = 0;
+
+    /**
+     * @brief Embedding dimension
+     */
+    virtual int get_dimension() const = 0;
+
+    /**
+     * @brief Remove all embeddings and reset to the unbuilt state
+     */
+    virtual void clear() = 0;
+
+    /**
+     * @brief Deep copy of the index, for copy-on-write updates
+     *
+     * Modifying the copy never affects searches running on the original.
+     */
+    virtual std::unique_ptr<VectorIndexBase> clone() const = 0;
+
+    /**
+     * @brief Check whether the index would benefit from train()
+     *
+     * Backends without a training step always return false.
+     */
+    virtual bool needs_training() const { return false; }
+
+    /**
+     * @brief Run the backend's training step over the current gallery
+     *
+     * @return true if successful (or nothing to train), false otherwise
+     */
+    virtual bool train() { return true; }
+
+    /**
+     * @brief Set the speed/recall knob of the backend
+     *
+     * nprobe for the IVF backend, efSearch for the HNSW backend.
+     */
+    virtual void set_search_effort(int effort) = 0;
+    virtual int get_search_effort() const = 0;
+
+    /**
+     * @brief Short backend name for logs ("flat", "hnsw")
+     */
+    virtual const char* get_backend_name() const = 0;
+
+    /**
+     * @brief Identify the embedding model the vectors come from
+     *
+     * Stored in saved index files; loading a file written for a different
+     * model is rejected. 0 means unknown and disables the check.
+     */
+    void set_model_hash(uint64_t hash) { model_hash = hash; }
+    uint64_t get_model_hash() const { return model_hash; }
+
+    /**
+     * @brief Last IndexLog sequence number contained in this index
+     *
+     * Saved with the index so log replay skips records already merged into
+     * the file. Reset to 0 by clear().
+     */
+    void set_log_sequence(uint64_t sequence) { log_sequence = sequence; }
+    uint64_t get_log_sequence() const { return log_sequence; }
+
+    /**
+     * @brief PCA projection the stored vectors went through (null if none)
+     *
+     * Kept on the index so a snapshot and the projection its rows need are
+     * published together; clone() and compacted() carry it over. Queries must
+     * be projected with it before searching. The backends do not save it.
+     */
+    void set_projection(std::shared_ptr<const EmbeddingProjection> pca) { projection = std::move(pca); }
+    const std::shared_ptr<const EmbeddingProjection>& get_projection() const { return projection; }
+
+    /**
+     * @brief Dimension of the embeddings fed to the index, before any projection
+     */
+    int get_input_dimension() const {
+        return projection ? projection->get_input_dimension() : get_dimension();
+    }
+
+protected:
+    uint64_t model_hash = 0;
+    uint64_t log_sequence = 0;
+    std::shared_ptr<const EmbeddingProjection> projection;
+
+    /**
+     * @brief Convert the L2 distance between normalized embeddings to a 0-1 similarity
+     */
+    static double distance_to_similarity(float distance);
+
+};  // class VectorIndexBase
+
+/**
+ * @brief Create an empty index for the given backend
+ *
+ * @param backend Backend to instantiate
+ * @param embedding_dimension Embedding dimension
+ * @return Index instance (never null)
+ */
+std::unique_ptr<VectorIndexBase> create_vector_index(Config::IndexBackend backend,
+                                                     int embedding_dimension);
+
+#endif // VECTOR_INDEX_BASE_H
@@ -0,0 +1,238 @@
+#ifndef VECTOR_KERNELS_H
+#define VECTOR_KERNELS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+/**
+ * @file vector_kernels.h
+ * @brief SIMD inner-product kernels and aligned storage for embedding search
+ *
+ * The gallery is scanned once per query, so the dot-product kernel is the
+ * hot loop of recognition. The best implementation for the running CPU
+ * (AVX2+FMA, SSE, NEON or scalar) is selected once at startup.
+ */
+
+namespace VectorKernels {
+
+/// Alignment of every gallery row (one cache line)
+constexpr std::size_t ROW_ALIGNMENT = 64;
+
+/// Number of floats per cache line; row strides are padded to a multiple of this
+constexpr int FLOATS_PER_LINE = static_cast<int>(ROW_ALIGNMENT / sizeof(float));
+
+/**
+ * @brief Minimal allocator returning cache-line aligned memory
+ *
+ * Used with std::vector so the embedding matrix stays contiguous and every
+ * row starts on a 64-byte boundary.
+ */
+template <typename T>
+struct AlignedAllocator {
+    using value_type = T;
+
+    AlignedAllocator() noexcept = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        std::size_t bytes = n * sizeof(T);
+        bytes = (bytes + ROW_ALIGNMENT - 1) / ROW_ALIGNMENT * ROW_ALIGNMENT;
+        void* ptr = std::aligned_alloc(ROW_ALIGNMENT, bytes);
+        if (!ptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, std::size_t) noexcept {
+        std::free(ptr);
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U>&) const noexcept { return false; }
+};
+
+/// Contiguous, cache-line aligned float buffer
+using AlignedFloatVector = std::vector<float, AlignedAllocator<float>>;
+
+/**
+ * @brief Aligned, append-only buffer whose copies share storage
+ *
+ * Copying is O(1): copies share one allocation, and each sees only the
+ * elements that existed when it was made. An append writes past that point,
+ * so it never touches anything another copy can read. A copy-on-write index
+ * update therefore costs the rows it adds, not the whole gallery.
+ *
+ * Rewriting existing elements goes through mutable_data(), which first
+ * gives this copy a private allocation if the current one is shared.
+ */
+template <typename T>
+class SharedRowBuffer {
+public:
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    std::size_t capacity() const { return block ? block->capacity : 0; }
+    const T* data() const { return block ? block->data : nullptr; }
+
+    void clear() {
+        block.reset();
+        count = 0;
+    }
+
+    void reserve(std::size_t n) {
+        if (n > capacity()) {
+            reallocate(n);
+        }
+    }
+
+    /// Grow by n elements set to value; returns the first new element
+    T* append(std::size_t n, T value = T()) {
+        // Only the copy that wrote the allocation's last element may extend it in place
+        if (!block || block->used != count || count + n > block->capacity) {
+            reallocate(std::max(count + n, 2 * capacity()));
+        }
+        T* tail = block->data + count;
+        std::fill(tail, tail + n, value);
+        count += n;
+        block->used = count;
+        return tail;
+    }
+
+    void assign(const T* first, const T* last) {
+        clear();
+        std::copy(first, last, append(static_cast<std::size_t>(last - first)));
+    }
+
+    /// Writable view of all elements; unshares the allocation first
+    T* mutable_data() {
+        if (block && block.use_count() > 1) {
+            reallocate(block->capacity);
+        }
+        return block ? block->data : nullptr;
+    }
+
+private:
+    struct Block {
+        explicit Block(std::size_t n) : data(AlignedAllocator<T>().allocate(n)), capacity(n) {}
+        ~Block() { AlignedAllocator<T>().deallocate(data, capacity); }
+        Block(const Block&) = delete;
+        Block& operator=(const Block&) = delete;
+
+        T* data;
+        std::size_t capacity;
+        std::size_t used = 0;  // Elements written by any copy
+    };
+
+    void reallocate(std::size_t new_capacity) {
+        auto fresh = std::make_shared<Block>(std::max<std::size_t>(new_capacity, 1));
+        if (count > 0) {
+            std::copy(block->data, block->data + count, fresh->data);
+        }
+        fresh->used = count;
+        block = std::move(fresh);
+    }
+
+    std::shared_ptr<Block> block;
+    std::size_t count = 0;
+};
+
+/**
+ * @brief Round a dimension up to a whole number of cache lines
+ *
+ * @param dimension Embedding dimension
+ * @return Row stride in floats
+ */
+inline int padded_stride(int dimension) {
+    return (dimension + FLOATS_PER_LINE - 1) / FLOATS_PER_LINE * FLOATS_PER_LINE;
+}
+
+/// Signature shared by all dot-product implementations
+using DotProductFn = float (*)(const float* a, const float* b, int n);
+
+/**
+ * @brief Inner product of two float vectors
+ *
+ * Dispatches to the fastest kernel supported by the CPU.
+ *
+ * @param a First vector
+ * @param b Second vector
+ * @param n Number of elements
+ * @return Sum of a[i] * b[i]
+ */
+float dot_product(const float* a, const float* b, int n);
+
+/**
+ * @brief Scalar reference implementation (always available)
+ */
+float dot_product_scalar(const float* a, const float* b, int n);
+
+/**
+ * @brief Get the kernel selected for this CPU
+ */
+DotProductFn get_dot_product_fn();
+
+/**
+ * @brief Name of the selected instruction set ("avx2", "sse", "neon", "scalar")
+ */
+const char* get_active_isa();
+
+// ========================
+// Quantized storage kernels
+// ========================
+
+/// Contiguous, cache-line aligned code buffers for quantized galleries
+using AlignedHalfVector = std::vector<uint16_t, AlignedAllocator<uint16_t>>;
+using AlignedByteVector = std::vector<uint8_t, AlignedAllocator<uint8_t>>;
+
+/// IEEE 754 half-precision conversion (round to nearest even)
+uint16_t float_to_half(float value);
+float half_to_float(uint16_t value);
+
+/// Signatures of the quantized dot-product kernels
+using DotProductF16Fn = float (*)(const float* a, const uint16_t* b, int n);
+using DotProductU8Fn = float (*)(const float* a, const uint8_t* b, int n);
+
+/**
+ * @brief Inner product of a float query with an FP16 row
+ *
+ * Uses F16C conversion on x86 and NEON conversion on ARM.
+ */
+DotProductF16Fn get_dot_product_f16_fn();
+
+/**
+ * @brief Inner product of a float query with an unsigned 8-bit row
+ *
+ * The caller folds the per-dimension scale into the query and adds the
+ * offset term separately: q·x = Σ q[i]·offset[i] + Σ (q[i]·scale[i])·code[i].
+ */
+DotProductU8Fn get_dot_product_u8_fn();
+
+// ========================
+// Multi-query kernels
+// ========================
+
+/// Queries scored together against each gallery row
+constexpr int QUERY_BLOCK = 4;
+
+/// Signature of the multi-query kernel: out[j] = queries[j] · row for j < QUERY_BLOCK
+using DotProductX4Fn = void (*)(const float* const* queries, const float* row, int n, float* out);
+
+/**
+ * @brief Inner products of QUERY_BLOCK queries with one row
+ *
+ * Each row element is loaded once and reused for every query, which turns
+ * a multi-face search into one pass over the gallery instead of one per face.
+ */
+DotProductX4Fn get_dot_product_x4_fn();
+
+} // namespace VectorKernels
+
+#endif // VECTOR_KERNELS_H
@@ -1,18 +1,45 @@
 #include "deep_face_recognizer.h"
+#include "index_file.h"
+#include "embedding_condenser.h"
+#include "gallery_snapshot.h"
 #include <iostream>
 #include <filesystem>
+#include <fstream>
 #include <algorithm>
 #include <cmath>
+#include <chrono>
 
 namespace fs = std::filesystem;
 
+namespace {
+
+// Recognition runs on the camera thread and on socket server threads. Each
+// thread reuses its own buffers, so steady-state embedding extraction does
+// not allocate per face (PCA projection, when enabled, still does).
+struct RecognitionBuffers {
+    std::vector<float> embedding;                // Model output of a single face
+    std::vector<float> projected;                // Query in the index's PCA space
+    std::vector<cv::Mat> faces;                  // Valid faces of a batch (pixels shared)
+    std::vector<size_t> face_of_input;           // Input position of each valid face
+    std::vector<std::vector<float>> valid_embeddings;  // Model outputs of the valid faces
+    std::vector<std::vector<float>> extracted;   // Embedding of every face of a recognize_batch() call
+};
+
+thread_local RecognitionBuffers recognition_buffers;
+
+}  // namespace
+
 DeepFaceRecognizer::DeepFaceRecognizer() {
     model_loader = std::make_unique<ModelLoader>();
-    faiss_index = std::make_unique<FAISSIndex>(128);  // Will be resized when model loads
+    publish_index(create_empty_index(128));  // Will be resized when model loads
     face_detector = std::make_unique<FaceDetector>();
     face_detector->initialize();  // Initialize Haar cascade for face detection
 }
 
+DeepFaceRecognizer::~DeepFaceRecognizer() {
+    wait_for_compaction();
+}
+
 bool DeepFaceRecognizer::load_model(const std::string& onnx_model_path) {
     if (!model_loader) {
         return false;
@@ -26,8 +53,12 @@ bool DeepFaceRecognizer::load_model(const std::string& onnx_model_path) {
     // For multi-dimensional outputs, use the flattened size
     int embedding_dim = model_loader->get_flattened_output_size();
 
-    // Recreate FAISS index with the correct embedding dimension
-    faiss_index = std::make_unique<FAISSIndex>(embedding_dim);
+    // Recreate the search index with the correct embedding dimension.
+    // The model hash keeps index files from another model from being loaded.
+    std::lock_guard<std::mutex> lock(index_update_mutex);
+    model_hash = IndexFile::cached_checksum_file(onnx_model_path);
+    publish_index(create_empty_index(embedding_dim));
+    index_log.close();  // Reopened for the new index on the next load or enrollment
 
     model_path = onnx_model_path;
     return true;
@@ -35,29 +66,14 @@ bool DeepFaceRecognizer::load_model(const std::string& onnx_model_path) {
 
 void DeepFaceRecognizer::set_database(FaceDatabase* database) {
     db = database;
-    load_labels_from_database();
-}
 
-cv::Mat DeepFaceRecognizer::preprocess_face(const cv::Mat& face_image) {
-    if (face_image.empty()) {
-        return cv::Mat();
+    // The door's access groups outlive restarts; the filter is built by the label load below
+    std::vector<std::string> groups;
+    if (db && db->get_access_groups(groups)) {
+        std::lock_guard<std::mutex> lock(groups_mutex);
+        access_groups.swap(groups);
     }
-
-    cv::Mat processed = face_image.clone();
-
-    // Convert grayscale to BGR if needed
-    if (processed.channels() == 1) {
-        cv::cvtColor(processed, processed, cv::COLOR_GRAY2BGR);
-    } else if (processed.channels() == 4) {
-        cv::cvtColor(processed, processed, cv::COLOR_BGRA2BGR);
-    }
-
-    // Resize directly to match model input (112x112 for ArcFace)
-    // No padding - ArcFace expects the face to fill the frame
-    int target_size = model_loader->get_input_width();
-    cv::resize(processed, processed, cv::Size(target_size, target_size), 0, 0, cv::INTER_LINEAR);
-
-    return processed;
+    load_labels_from_database();
 }
 
 bool DeepFaceRecognizer::validate_face_image(const cv::Mat& image) {
@@ -79,25 +95,65 @@ bool DeepFaceRecognizer::is_face_size_sufficient(int width, int height) const {
 }
 
 std::vector<float> DeepFaceRecognizer::extract_embedding(const cv::Mat& face_image) {
+    std::vector<float> embedding;
+    extract_embedding(face_image, embedding);
+    return embedding;
+}
+
+bool DeepFaceRecognizer::extract_embedding(const cv::Mat& face_image, std::vector<float>& embedding) {
+    embedding.clear();
     if (!model_loader || !model_loader->is_model_loaded()) {
-        return std::vector<float>();
+        return false;
     }
 
     if (!validate_face_image(face_image)) {
-        return std::vector<float>();
+        return false;
     }
 
-    // Preprocess
-    cv::Mat processed = preprocess_face(face_image);
+    // Extract embedding using ONNX model (it resizes and normalizes the crop itself)
+    return model_loader->inference(face_image, embedding);
+}
+
+std::vector<std::vector<float>> DeepFaceRecognizer::extract_embeddings(const std::vector<cv::Mat>& face_images) {
+    std::vector<std::vector<float>> embeddings;
+    extract_embeddings(face_images, embeddings);
+    return embeddings;
+}
 
-    // Extract embedding using ONNX model
-    std::vector<float> embedding = model_loader->inference(processed);
+void DeepFaceRecognizer::extract_embeddings(const std::vector<cv::Mat>& face_images,
+                                            std::vector<std::vector<float>>& embeddings) {
+    embeddings.resize(face_images.size());
+    for (std::vector<float>& embedding : embeddings) {
+        embedding.clear();  // Keeps the capacity
+    }
+    if (!model_loader || !model_loader->is_model_loaded()) {
+        return;
+    }
 
-    if (embedding.empty()) {
-        return std::vector<float>();
+    // Every face valid (the usual frame): straight into the caller's vectors
+    if (std::all_of(face_images.begin(), face_images.end(),
+                    [this](const cv::Mat& face) { return validate_face_image(face); })) {
+        model_loader->inference_batch(face_images, embeddings);
+        return;
     }
 
-    return embedding;
+    // Invalid faces are left out of the batch and get an empty embedding
+    RecognitionBuffers& buffers = recognition_buffers;
+    buffers.faces.clear();
+    buffers.face_of_input.clear();
+    for (size_t i = 0; i < face_images.size(); i++) {
+        if (validate_face_image(face_images[i])) {
+            buffers.faces.push_back(face_images[i]);  // Shares the pixels; no copy
+            buffers.face_of_input.push_back(i);
+        }
+    }
+
+    // One session call per ModelLoader batch instead of one per face
+    model_loader->inference_batch(buffers.faces, buffers.valid_embeddings);
+    for (size_t i = 0; i < buffers.valid_embeddings.size(); i++) {
+        std::swap(embeddings[buffers.face_of_input[i]], buffers.valid_embeddings[i]);
+    }
+    buffers.faces.clear();  // Drop the frame references
 }
 
 std::vector<std::pair<int, std::vector<float>>>
@@ -124,7 +180,9 @@ DeepFaceRecognizer::extract_embeddings_from_directory(const std::string& dataset
             int person_id = register_person(person_name);
             int image_count = 0;
 
-            // Extract embeddings from person's images
+            // Crop the person's faces, then embed them in batched model calls
+            std::vector<cv::Mat> face_crops;
+            std::vector<std::string> crop_paths;
             for (const auto& image_file : fs::directory_iterator(person_dir)) {
                 if (!fs::is_regular_file(image_file)) continue;
 
@@ -143,38 +201,21 @@ DeepFaceRecognizer::extract_embeddings_from_directory(const std::string& dataset
                     continue;
                 }
 
-                // Detect faces in the image
-                std::vector<Face> detected_faces = face_detector->detect_faces(image);
-
-                if (detected_faces.empty()) {
+                // Largest face in the image, with some context around it
+                cv::Rect face_region = face_detector->largest_face_region(image);
+                if (face_region.empty()) {
                     continue;
                 }
 
-                // Use the largest face detected (most likely the main subject)
-                cv::Rect best_face = detected_faces[0].bbox;
-                for (const auto& face : detected_faces) {
-                    if (face.bbox.area() > best_face.area()) {
-                        best_face = face.bbox;
-                    }
-                }
-
-                // Expand the face region slightly to include some context
-                int expand_x = static_cast<int>(best_face.width * 0.1);
-                int expand_y = static_cast<int>(best_face.height * 0.1);
-                cv::Rect expanded_face(
-                    std::max(0, best_face.x - expand_x),
-                    std::max(0, best_face.y - expand_y),
-                    std::min(image.cols - best_face.x + expand_x, best_face.width + 2 * expand_x),
-                    std::min(image.rows - best_face.y + expand_y, best_face.height + 2 * expand_y)
-                );
-
                 // Crop the face region
-                cv::Mat face_crop = image(expanded_face).clone();
+                face_crops.push_back(image(face_region).clone());
+                crop_paths.push_back(image_file.path().string());
+            }
 
-                // Extract embedding from cropped face
-                std::vector<float> embedding = extract_embedding(face_crop);
+            std::vector<std::vector<float>> embeddings = extract_embeddings(face_crops);
+            for (size_t i = 0; i < embeddings.size(); i++) {
+                std::vector<float>& embedding = embeddings[i];
                 if (!embedding.empty()) {
-                    result.push_back({person_id, embedding});
                     image_count++;
                     total_images++;
 
@@ -184,8 +225,9 @@ DeepFaceRecognizer::extract_embeddings_from_directory(const std::string& dataset
                             reinterpret_cast<unsigned char*>(embedding.data()),
                             reinterpret_cast<unsigned char*>(embedding.data()) + embedding.size() * sizeof(float)
                         );
-                        db->add_face_embedding(person_id, image_file.path().string(), embedding_bytes);
+                        db->add_face_embedding(person_id, crop_paths[i], embedding_bytes);
                     }
+                    result.push_back({person_id, std::move(embedding)});
                 }
             }
 
@@ -205,19 +247,14 @@ bool DeepFaceRecognizer::train_from_images(const std::string& dataset_path) {
         return false;
     }
 
-
-    // Clear existing FAISS index and embeddings before retraining
-    faiss_index->clear();
+    // The current index keeps serving recognition until train_from_embeddings()
+    // swaps in the rebuilt one, so it is not cleared here.
 
     // Clear old embeddings from database
     if (db) {
         db->clear_all_embeddings();
     }
 
-    // Clear in-memory label maps (will be rebuilt during extraction)
-    person_id_to_name.clear();
-    name_to_person_id.clear();
-
     // Extract embeddings from all images
     // Note: This will call register_person() for each person folder,
     // which adds them to both the database and the label maps
@@ -245,50 +282,98 @@ bool DeepFaceRecognizer::train_from_images(const std::string& dataset_path) {
 
 bool DeepFaceRecognizer::train_from_embeddings(const std::vector<int>& person_ids,
                                               const std::vector<std::vector<float>>& embeddings) {
-    if (person_ids.empty() || embeddings.empty()) {
+    std::lock_guard<std::mutex> lock(index_update_mutex);
+
+    // Build the new index off to the side; recognition keeps searching the
+    // published one and never sees a partially built index
+    std::shared_ptr<VectorIndexBase> rebuilt = build_gallery_index(person_ids, embeddings);
+    if (!rebuilt) {
         return false;
     }
 
+    // Save index to disk (in project root directory); this supersedes the log
+    persist_index(*rebuilt, index_path);
+
+    // Atomic swap: searches already running finish on the old snapshot
+    publish_index(rebuilt);
+    model_trained = true;
+
+    // CRITICAL: Reload label maps from database after training
+    // This ensures person_id -> name mappings are available for recognition
+    load_labels_from_database();
+    return true;
+}
+
+std::shared_ptr<VectorIndexBase>
+DeepFaceRecognizer::build_gallery_index(const std::vector<int>& person_ids,
+                                        const std::vector<std::vector<float>>& embeddings) const {
+    if (person_ids.empty() || embeddings.empty()) {
+        return nullptr;
+    }
+
     if (person_ids.size() != embeddings.size()) {
-        return false;
+        return nullptr;
     }
 
     try {
+        // People captured more often than the budget are indexed as their
+        // representatives; the caller's (database) embeddings are left as they are
+        std::vector<int> budget_ids;
+        std::vector<std::vector<float>> budget_embeddings;
+        bool condensed = apply_embedding_budget(person_ids, embeddings, budget_ids, budget_embeddings);
+        const std::vector<int>& indexed_ids = condensed ? budget_ids : person_ids;
+        const std::vector<std::vector<float>>* indexed_embeddings = condensed ? &budget_embeddings : &embeddings;
+
+        // Large galleries can be indexed in a smaller PCA space learned from themselves
+        std::shared_ptr<const EmbeddingProjection> projection = train_projection(*indexed_embeddings);
+        std::vector<std::vector<float>> projected_embeddings;
+        if (projection) {
+            projected_embeddings = projection->project(*indexed_embeddings);
+            indexed_embeddings = &projected_embeddings;
+        }
 
+        std::shared_ptr<VectorIndexBase> current = current_index();
+        int index_dim = projection ? projection->get_output_dimension() : current->get_input_dimension();
+        std::shared_ptr<VectorIndexBase> rebuilt = create_empty_index(index_dim);
+        rebuilt->set_search_effort(current->get_search_effort());
+        rebuilt->set_projection(projection);
 
         // Build FAISS index
-        if (!faiss_index->build_index(embeddings.size())) {
-            return false;
+        if (!rebuilt->build_index(indexed_embeddings->size())) {
+            return nullptr;
         }
 
         // Add all embeddings to index
-        if (!faiss_index->add_vectors(person_ids, embeddings)) {
-            return false;
+        if (!rebuilt->add_vectors(indexed_ids, *indexed_embeddings)) {
+            return nullptr;
         }
 
-        // Save index to disk (in project root directory)
-        std::string index_path = "faiss_index.bin";
-        if (!faiss_index->save_index(index_path)) {
-        } else {
+        // Let the backend train on large galleries (IVF partitioning; no-op for HNSW)
+        if (rebuilt->needs_training()) {
+            rebuilt->train();
         }
-
-        model_trained = true;
-
-        // CRITICAL: Reload label maps from database after training
-        // This ensures person_id -> name mappings are available for recognition
-        load_labels_from_database();
-        return true;
+        return rebuilt;
 
     } catch (const std::exception& e) {
-        return false;
+        return nullptr;
     }
 }
 
 bool DeepFaceRecognizer::train_from_database() {
-    if (!db) {
+    std::vector<int> person_ids;
+    std::vector<std::vector<float>> embeddings;
+    if (!read_database_embeddings(person_ids, embeddings)) {
         return false;
     }
 
+    return train_from_embeddings(person_ids, embeddings);
+}
+
+bool DeepFaceRecognizer::read_database_embeddings(std::vector<int>& person_ids,
+                                                  std::vector<std::vector<float>>& embeddings) const {
+    if (!db) {
+        return false;
+    }
 
     // Load all embeddings from database
     std::vector<FaceEmbedding> db_embeddings;
@@ -301,9 +386,8 @@ bool DeepFaceRecognizer::train_from_database() {
     }
 
     // Convert to vectors
-    std::vector<int> person_ids;
-    std::vector<std::vector<float>> embeddings;
-
+    person_ids.clear();
+    embeddings.clear();
     for (const auto& emb : db_embeddings) {
         person_ids.push_back(emb.person_id);
 
@@ -314,8 +398,7 @@ bool DeepFaceRecognizer::train_from_database() {
         );
         embeddings.push_back(embedding_vec);
     }
-
-    return train_from_embeddings(person_ids, embeddings);
+    return true;
 }
 
 bool DeepFaceRecognizer::retrain_model() {
@@ -323,8 +406,13 @@ bool DeepFaceRecognizer::retrain_model() {
         return false;
     }
 
-    clear();
-    return train_from_database();
+    // train_from_embeddings() replaces the index in one swap, so recognition
+    // keeps running on the current gallery while the new one is built
+    if (train_from_database()) {
+        return true;
+    }
+    clear();  // Nothing usable to train on: end up with an empty model as before
+    return false;
 }
 
 bool DeepFaceRecognizer::add_training_data(const cv::Mat& face_image, int person_id) {
@@ -342,15 +430,21 @@ bool DeepFaceRecognizer::add_training_data(const cv::Mat& face_image, int person
         return false;
     }
 
+    // Copy-on-write: recognition may be searching the published index, so the
+    // embedding is added to a copy that replaces it once complete
+    std::lock_guard<std::mutex> lock(index_update_mutex);
+    std::shared_ptr<VectorIndexBase> updated = current_index()->clone();
+
     // If index isn't built yet, build it with some initial capacity
-    if (!faiss_index->is_index_built()) {
-        if (!faiss_index->build_index(1000)) {
+    if (!updated->is_index_built()) {
+        if (!updated->build_index(1000)) {
             return false;
         }
     }
 
-    // Add the embedding to the FAISS index
-    if (!faiss_index->add_vector(person_id, embedding)) {
+    // Add the embedding to the FAISS index (the database keeps the raw embedding)
+    std::vector<float> indexed_embedding = to_index_space(*updated, embedding);
+    if (!updated->add_vector(person_id, indexed_embedding)) {
         return false;
     }
 
@@ -378,6 +472,7 @@ bool DeepFaceRecognizer::add_training_data(const cv::Mat& face_image, int person
         PersonRecord person;
         if (db->get_person(person_id, person)) {
             // Make sure this person is in our label map
+            std::lock_guard<std::mutex> labels_lock(labels_mutex);
             if (person_id_to_name.find(person_id) == person_id_to_name.end()) {
                 person_id_to_name[person_id] = person.name;
                 name_to_person_id[person.name] = person_id;
@@ -385,32 +480,207 @@ bool DeepFaceRecognizer::add_training_data(const cv::Mat& face_image, int person
         }
     }
 
-    model_trained = (faiss_index->get_num_vectors() > 0);
+    // Persist by appending to the log (O(1) I/O) instead of rewriting the index file
+    bool start_merge = false;
+    if (updated->get_num_vectors() > 0 && (index_log.is_open() || open_index_log(*updated))) {
+        uint64_t sequence = 0;
+        if (index_log.append(person_id, indexed_embedding, sequence)) {
+            updated->set_log_sequence(sequence);
+            size_t pending = index_log.get_num_records();
+            start_merge = pending > 0 && pending % Config::INDEX_LOG_COMPACT_RECORDS == 0;
+        }
+    }
 
-    // Save FAISS index to disk for persistence
-    if (model_trained) {
-        std::string index_path = "faiss_index.bin";
-        faiss_index->save_index(index_path);
+    publish_index(updated);
+    model_trained = (updated->get_num_vectors() > 0);
+    if (start_merge) {
+        start_compaction();
+    }
+    start_row_compaction_if_needed(*updated);  // Retries a compaction or training a concurrent update invalidated
+    // Hysteresis: a person just condensed to the budget collects
+    // Config::CONDENSATION_MARGIN more captures before the next pass
+    if (Config::MAX_EMBEDDINGS_PER_PERSON > 0 &&
+        updated->get_person_vector_count(person_id) >=
+            Config::MAX_EMBEDDINGS_PER_PERSON + std::max(1, Config::CONDENSATION_MARGIN)) {
+        start_condensation(person_id);
     }
 
     return true;
 }
 
+int DeepFaceRecognizer::remove_person(int person_id) {
+    std::lock_guard<std::mutex> lock(index_update_mutex);
+    std::shared_ptr<VectorIndexBase> current = current_index();
+    if (!current->is_index_built()) {
+        return 0;
+    }
+
+    // Tombstoning is O(rows of the person); the copy shares the row storage
+    std::shared_ptr<VectorIndexBase> updated = current->clone();
+    int removed = updated->remove_person(person_id);
+    if (removed == 0) {
+        return 0;
+    }
+
+    uint64_t sequence = 0;
+    if ((index_log.is_open() || open_index_log(*updated)) && index_log.append_delete(person_id, sequence)) {
+        updated->set_log_sequence(sequence);
+    }
+
+    publish_index(updated);
+    model_trained = (updated->get_num_vectors() > 0);
+    start_row_compaction_if_needed(*updated);
+    return removed;
+}
+
+bool DeepFaceRecognizer::replace_person_embeddings(int person_id,
+                                                   const std::vector<std::vector<float>>& embeddings) {
+    std::lock_guard<std::mutex> lock(index_update_mutex);
+    if (!publish_person_embeddings(person_id, embeddings)) {
+        return false;
+    }
+
+    if (db) {
+        db->delete_person_embeddings(person_id);
+        for (const std::vector<float>& embedding : embeddings) {
+            std::vector<unsigned char> embedding_bytes(
+                reinterpret_cast<const unsigned char*>(embedding.data()),
+                reinterpret_cast<const unsigned char*>(embedding.data()) + embedding.size() * sizeof(float));
+            db->add_face_embedding(person_id, "", embedding_bytes);
+        }
+    }
+    return true;
+}
+
+bool DeepFaceRecognizer::publish_person_embeddings(int person_id,
+                                                   const std::vector<std::vector<float>>& embeddings) {
+    std::shared_ptr<VectorIndexBase> updated = current_index()->clone();
+    if (!updated->is_index_built() && !updated->build_index(std::max<int>(1000, embeddings.size()))) {
+        return false;
+    }
+
+    // Readers may be scanning the old rows, so they are tombstoned and the new
+    // embeddings appended rather than overwritten
+    std::vector<std::vector<float>> projected;
+    if (updated->get_projection()) {
+        projected = updated->get_projection()->project(embeddings);
+    }
+    const std::vector<std::vector<float>>& indexed = updated->get_projection() ? projected : embeddings;
+    if (!updated->replace_person(person_id, indexed)) {
+        return false;
+    }
+
+    // Logged as one deletion followed by the new insertions
+    if (index_log.is_open() || open_index_log(*updated)) {
+        uint64_t sequence = 0;
+        bool logged = index_log.append_delete(person_id, sequence);
+        for (size_t i = 0; logged && i < indexed.size(); i++) {
+            logged = index_log.append(person_id, indexed[i], sequence);
+        }
+        if (logged) {
+            updated->set_log_sequence(sequence);
+        }
+    }
+
+    publish_index(updated);
+    model_trained = (updated->get_num_vectors() > 0);
+    start_row_compaction_if_needed(*updated);
+    return true;
+}
+
+bool DeepFaceRecognizer::delete_person(int person_id) {
+    if (db && !db->delete_person(person_id)) {
+        return false;
+    }
+    remove_person(person_id);
+
+    {
+        std::lock_guard<std::mutex> lock(groups_mutex);
+        for (auto& [group, members] : group_filters) {
+            members.remove(person_id);
+        }
+        update_access_filter();
+    }
+
+    std::lock_guard<std::mutex> lock(labels_mutex);
+    auto it = person_id_to_name.find(person_id);
+    if (it != person_id_to_name.end()) {
+        name_to_person_id.erase(it->second);
+        person_id_to_name.erase(it);
+    }
+    return true;
+}
+
+bool DeepFaceRecognizer::compact_deleted_rows() {
+    // A few attempts: an update published while compacting makes the result stale
+    for (int attempt = 0; attempt < 3; attempt++) {
+        std::shared_ptr<VectorIndexBase> snapshot = current_index();
+        if (snapshot->get_num_deleted() == 0 && !snapshot->needs_training()) {
+            return true;
+        }
+
+        try {
+            auto start_time = std::chrono::steady_clock::now();
+
+            // Rebuilt without the writer lock: recognition and enrollment go on meanwhile.
+            // Training (IVF centroids, int8 ranges) runs here too, never on the capture path.
+            std::shared_ptr<VectorIndexBase> rebuilt(snapshot->get_num_deleted() > 0 ? snapshot->compacted()
+                                                                                     : snapshot->clone());
+            if (!rebuilt) {
+                return false;
+            }
+            if (rebuilt->needs_training()) {
+                rebuilt->train();
+            }
+
+            std::lock_guard<std::mutex> lock(index_update_mutex);
+            if (current_index() != snapshot) {
+                continue;
+            }
+            publish_index(rebuilt);
+
+            auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start_time).count();
+            std::cout << "Compacted search index: dropped " << snapshot->get_num_deleted() << " deleted rows"
+                      << (snapshot->needs_training() ? ", retrained" : "") << " ("
+                      << rebuilt->get_num_vectors() << " vectors, " << elapsed_ms << "ms)" << std::endl;
+            return true;
+
+        } catch (const std::exception& e) {
+            std::cerr << "Error compacting search index: " << e.what() << std::endl;
+            return false;
+        }
+    }
+    return false;
+}
+
 int DeepFaceRecognizer::recognize(const cv::Mat& face_image, double& confidence) {
-    if (!model_trained || !faiss_index->is_index_built()) {
+    std::shared_ptr<const PersonFilter> filter = current_access_filter();
+    return recognize_filtered(face_image, filter.get(), confidence);
+}
+
+int DeepFaceRecognizer::recognize(const cv::Mat& face_image, const PersonFilter& filter, double& confidence) {
+    return recognize_filtered(face_image, &filter, confidence);
+}
+
+int DeepFaceRecognizer::recognize_filtered(const cv::Mat& face_image, const PersonFilter* filter,
+                                           double& confidence) {
+    std::shared_ptr<VectorIndexBase> index = current_index();  // Stable for this call
+    if (!model_trained || !index->is_index_built()) {
         confidence = 0.0;
         return -1;
     }
 
-    // Extract embedding
-    std::vector<float> embedding = extract_embedding(face_image);
+    // Extract embedding, in the index's (possibly PCA-projected) space
+    const std::vector<float>& embedding = query_embedding(*index, face_image);
     if (embedding.empty()) {
         confidence = 0.0;
         return -1;
     }
 
-    // Search FAISS index
-    int person_id = faiss_index->search(embedding, confidence);
+    // Search FAISS index (people outside the filter are skipped, not just hidden)
+    int person_id = filter ? index->search(embedding, *filter, confidence)
+                           : index->search(embedding, confidence);
 
     // Apply threshold
     if (confidence < confidence_threshold) {
@@ -422,6 +692,93 @@ int DeepFaceRecognizer::recognize(const cv::Mat& face_image, double& confidence)
     return person_id;
 }
 
+bool DeepFaceRecognizer::verify(const cv::Mat& face_image, int person_id, double& confidence) {
+    confidence = 0.0;
+    std::shared_ptr<VectorIndexBase> index = current_index();  // Stable for this call
+    if (!model_trained || !index->is_index_built()) {
+        return false;
+    }
+
+    // A claimed person outside this door's groups is refused like an unknown face
+    std::shared_ptr<const PersonFilter> filter = current_access_filter();
+    if (filter && !filter->allows(person_id)) {
+        return false;
+    }
+
+    const std::vector<float>& embedding = query_embedding(*index, face_image);
+    if (embedding.empty()) {
+        return false;
+    }
+
+    // Only the claimed person's rows are scored
+    if (index->verify(embedding, person_id, confidence) == 0) {
+        return false;  // Not enrolled
+    }
+    return confidence >= confidence_threshold;
+}
+
+std::vector<int> DeepFaceRecognizer::recognize_batch(const std::vector<cv::Mat>& face_images,
+                                                     std::vector<double>& confidences) {
+    std::vector<int> person_ids(face_images.size(), -1);
+    confidences.assign(face_images.size(), 0.0);
+    std::shared_ptr<VectorIndexBase> index = current_index();  // Stable for this call
+    if (!model_trained || !index->is_index_built()) {
+        return person_ids;
+    }
+
+    // Extract embeddings in batches, into this thread's reused buffers
+    RecognitionBuffers& buffers = recognition_buffers;
+    extract_embeddings(face_images, buffers.extracted);
+
+    // Every face extracted and no projection (the usual frame): query them as they
+    // are. Otherwise collect the valid ones in the index's space, remembering their faces.
+    const std::vector<std::vector<float>>* queries = &buffers.extracted;
+    std::vector<std::vector<float>> embeddings;
+    std::vector<size_t> face_of_query;
+    bool direct = !index->get_projection() &&
+                  std::none_of(buffers.extracted.begin(), buffers.extracted.end(),
+                               [](const std::vector<float>& embedding) { return embedding.empty(); });
+    if (!direct) {
+        for (size_t i = 0; i < face_images.size(); i++) {
+            std::vector<float> embedding = to_index_space(*index, buffers.extracted[i]);
+            if (!embedding.empty()) {
+                embeddings.push_back(std::move(embedding));
+                face_of_query.push_back(i);
+            }
+        }
+        queries = &embeddings;
+    }
+    if (queries->empty()) {
+        return person_ids;
+    }
+
+    // One pass over the gallery for all faces in the frame; filtered searches
+    // skip different rows per query, so they run one at a time
+    std::vector<std::vector<double>> match_confidences;
+    std::vector<std::vector<int>> matches;
+    std::shared_ptr<const PersonFilter> filter = current_access_filter();
+    if (filter) {
+        matches.resize(queries->size());
+        match_confidences.resize(queries->size());
+        for (size_t q = 0; q < queries->size(); q++) {
+            matches[q] = index->search_k((*queries)[q], 1, *filter, match_confidences[q]);
+        }
+    } else {
+        matches = index->search_batch(*queries, 1, match_confidences);
+    }
+    for (size_t q = 0; q < matches.size(); q++) {
+        if (matches[q].empty()) {
+            continue;
+        }
+        size_t face = direct ? q : face_of_query[q];
+        confidences[face] = match_confidences[q][0];  // Kept for display even when below threshold
+        if (confidences[face] >= confidence_threshold) {
+            person_ids[face] = matches[q][0];
+        }
+    }
+    return person_ids;
+}
+
 std::string DeepFaceRecognizer::recognize_with_name(const cv::Mat& face_image,
                                                    double& confidence) {
     int person_id = recognize(face_image, confidence);
@@ -435,9 +792,9 @@ std::string DeepFaceRecognizer::recognize_with_name(const cv::Mat& face_image,
 
 int DeepFaceRecognizer::register_person(const std::string& name) {
     // Check if person already registered in memory
-    auto it = name_to_person_id.find(name);
-    if (it != name_to_person_id.end()) {
-        return it->second;
+    int known_id = get_label_from_name(name);
+    if (known_id >= 0) {
+        return known_id;
     }
 
     int new_id = -1;
@@ -458,6 +815,8 @@ int DeepFaceRecognizer::register_person(const std::string& name) {
         }
     }
 
+    std::lock_guard<std::mutex> lock(labels_mutex);
+
     // Fallback: generate ID if database not available
     if (new_id < 0) {
         new_id = 1;
@@ -476,12 +835,14 @@ int DeepFaceRecognizer::register_person(const std::string& name) {
 }
 
 bool DeepFaceRecognizer::set_label_name(int person_id, const std::string& name) {
+    std::lock_guard<std::mutex> lock(labels_mutex);
     person_id_to_name[person_id] = name;
     name_to_person_id[name] = person_id;
     return true;
 }
 
 std::string DeepFaceRecognizer::get_label_name(int person_id) const {
+    std::lock_guard<std::mutex> lock(labels_mutex);
     auto it = person_id_to_name.find(person_id);
     if (it != person_id_to_name.end()) {
         return it->second;
@@ -490,6 +851,7 @@ std::string DeepFaceRecognizer::get_label_name(int person_id) const {
 }
 
 int DeepFaceRecognizer::get_label_from_name(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(labels_mutex);
     auto it = name_to_person_id.find(name);
     if (it != name_to_person_id.end()) {
         return it->second;
@@ -500,16 +862,112 @@ int DeepFaceRecognizer::get_label_from_name(const std::string& name) const {
 void DeepFaceRecognizer::load_labels_from_database() {
     if (!db) return;
 
-    person_id_to_name.clear();
-    name_to_person_id.clear();
-
+    // Build the maps first so lookups never see them half filled
+    std::map<int, std::string> id_to_name;
+    std::map<std::string, int> name_to_id;
     std::vector<PersonRecord> people;
     if (db->get_all_people(people)) {
         for (const auto& person : people) {
-            person_id_to_name[person.id] = person.name;
-            name_to_person_id[person.name] = person.id;
+            id_to_name[person.id] = person.name;
+            name_to_id[person.name] = person.id;
         }
     }
+
+    std::map<std::string, PersonFilter> groups;
+    std::vector<std::pair<int, std::string>> memberships;
+    if (db->get_all_group_members(memberships)) {
+        for (const auto& [person_id, group] : memberships) {
+            groups[group].add(person_id);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(labels_mutex);
+        person_id_to_name.swap(id_to_name);
+        name_to_person_id.swap(name_to_id);
+    }
+
+    std::lock_guard<std::mutex> lock(groups_mutex);
+    group_filters.swap(groups);
+    update_access_filter();
+}
+
+bool DeepFaceRecognizer::add_person_to_group(int person_id, const std::string& group) {
+    if (db && !db->add_person_to_group(person_id, group)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(groups_mutex);
+    group_filters[group].add(person_id);
+    update_access_filter();
+    return true;
+}
+
+bool DeepFaceRecognizer::remove_person_from_group(int person_id, const std::string& group) {
+    if (db && !db->remove_person_from_group(person_id, group)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(groups_mutex);
+    auto it = group_filters.find(group);
+    if (it != group_filters.end()) {
+        it->second.remove(person_id);
+        if (it->second.empty()) {
+            group_filters.erase(it);
+        }
+    }
+    update_access_filter();
+    return true;
+}
+
+bool DeepFaceRecognizer::set_access_groups(const std::vector<std::string>& groups) {
+    if (db && !db->set_access_groups(groups)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(groups_mutex);
+    access_groups = groups;
+    update_access_filter();
+    return true;
+}
+
+std::vector<std::string> DeepFaceRecognizer::get_access_groups() const {
+    std::lock_guard<std::mutex> lock(groups_mutex);
+    return access_groups;
+}
+
+std::vector<std::string> DeepFaceRecognizer::get_groups() const {
+    std::lock_guard<std::mutex> lock(groups_mutex);
+    std::vector<std::string> names;
+    for (const auto& [group, members] : group_filters) {
+        names.push_back(group);
+    }
+    return names;
+}
+
+PersonFilter DeepFaceRecognizer::get_group_filter(const std::vector<std::string>& groups) const {
+    std::lock_guard<std::mutex> lock(groups_mutex);
+    PersonFilter filter;
+    for (const std::string& group : groups) {
+        auto it = group_filters.find(group);
+        if (it != group_filters.end()) {
+            filter.unite(it->second);
+        }
+    }
+    return filter;
+}
+
+void DeepFaceRecognizer::update_access_filter() {
+    // Rebuilt as a new bitmap and swapped in, so recognition never waits on it
+    std::shared_ptr<const PersonFilter> filter;
+    if (!access_groups.empty()) {
+        auto allowed = std::make_shared<PersonFilter>();
+        for (const std::string& group : access_groups) {
+            auto it = group_filters.find(group);
+            if (it != group_filters.end()) {
+                allowed->unite(it->second);
+            }
+        }
+        filter = std::move(allowed);
+    }
+    std::atomic_store(&access_filter, filter);
 }
 
 void DeepFaceRecognizer::set_confidence_threshold(double threshold) {
@@ -517,6 +975,7 @@ void DeepFaceRecognizer::set_confidence_threshold(double threshold) {
 }
 
 int DeepFaceRecognizer::get_person_count() const {
+    std::lock_guard<std::mutex> lock(labels_mutex);
     return person_id_to_name.size();
 }
 
@@ -525,44 +984,801 @@ bool DeepFaceRecognizer::is_model_loaded() const {
 }
 
 bool DeepFaceRecognizer::save_index(const std::string& filepath) {
-    if (!faiss_index) {
+    std::lock_guard<std::mutex> lock(index_update_mutex);
+    return persist_index(*current_index(), filepath);
+}
+
+bool DeepFaceRecognizer::load_index(const std::string& filepath, bool read_only) {
+    {
+        std::lock_guard<std::mutex> update_lock(index_update_mutex);
+
+        // Compaction must not swap the file and trim the log between our load and replay
+        std::lock_guard<std::mutex> lock(index_file_mutex);
+
+        // Load into a new index; the published one serves searches until the swap
+        std::shared_ptr<VectorIndexBase> loaded = read_index_file(filepath);
+        if (!loaded) {
+            return false;
+        }
+
+        // Crash recovery: re-apply enrollments logged after the file was written.
+        // A read-only load reads the log as it is and becomes no log's writer.
+        IndexLog log_reader;
+        bool log_open = false;
+        if (read_only) {
+            log_open = log_reader.open_read_only(filepath + ".wal", loaded->get_dimension(), model_hash,
+                                                 loaded->get_log_sequence());
+        } else {
+            index_path = filepath;
+            log_open = open_index_log(*loaded);
+        }
+        const IndexLog& log = read_only ? log_reader : index_log;
+        std::vector<IndexLog::Record> records;
+        if (log_open && log.read_records(loaded->get_log_sequence(), records) && !records.empty()) {
+            if (apply_log_records(*loaded, records)) {
+                std::cout << "Replayed " << records.size() << " logged changes from "
+                          << log.get_path() << std::endl;
+            }
+        }
+        publish_index(loaded);
+        if (!read_only) {
+            start_row_compaction_if_needed(*loaded);
+        }
+    }
+
+    // IMPORTANT: Reload label maps from database after loading FAISS index
+    // The FAISS index contains person_ids, but the label maps (person_id -> name)
+    // need to be loaded from the database to resolve names
+    load_labels_from_database();
+
+    model_trained = true;
+    return true;
+}
+
+std::shared_ptr<VectorIndexBase> DeepFaceRecognizer::read_index_file(const std::string& filepath) const {
+    std::shared_ptr<VectorIndexBase> current = current_index();
+    std::shared_ptr<VectorIndexBase> loaded = create_empty_index(current->get_dimension());
+    loaded->set_search_effort(current->get_search_effort());
+    if (!loaded->load_index(filepath)) {
+        return nullptr;
+    }
+
+    // A PCA sidecar means the rows (and the log) are in the projected space;
+    // it must carry the checksum of this very file
+    std::shared_ptr<const EmbeddingProjection> projection;
+    if (fs::exists(filepath + ".pca")) {
+        projection = EmbeddingProjection::load(filepath + ".pca", model_hash, IndexFile::stamp_file(filepath));
+        if (!projection) {
+            std::cerr << "Error: " << filepath << " has no valid PCA projection (retrain to rebuild it)"
+                      << std::endl;
+            return nullptr;
+        }
+    }
+    int model_dim = (model_loader && model_loader->is_model_loaded())
+                        ? model_loader->get_flattened_output_size() : 0;
+    if ((projection && projection->get_output_dimension() != loaded->get_dimension()) ||
+        (model_dim > 0 && (projection ? projection->get_input_dimension() : loaded->get_dimension()) != model_dim)) {
+        std::cerr << "Error: " << filepath << " does not match the embedding dimension of the model"
+                  << " (retrain to rebuild it)" << std::endl;
+        return nullptr;
+    }
+    loaded->set_projection(projection);
+    return loaded;
+}
+
+bool DeepFaceRecognizer::export_snapshot(const std::string& path) {
+    if (!db) {
         return false;
     }
+    auto start_time = std::chrono::steady_clock::now();
+
+    // Enrollments wait for the export, so the stored rows and the index agree
+    std::lock_guard<std::mutex> update_lock(index_update_mutex);
+    std::shared_ptr<VectorIndexBase> index = current_index();
+    std::string staged_index = path + ".index";
+    bool has_index = index->is_index_built() && index->get_num_vectors() > 0;
+    bool ok = !has_index || persist_index(*index, staged_index);
 
-    return faiss_index->save_index(filepath);
+    GallerySnapshot::Writer writer;
+    ok = ok && writer.open(path, model_hash, index->get_input_dimension(), Config::SNAPSHOT_CHUNK_BYTES);
+
+    GallerySnapshot::RecordEncoder record;
+    std::vector<PersonRecord> people;
+    ok = ok && db->get_all_people(people);
+    for (size_t i = 0; ok && i < people.size(); i++) {
+        record.clear();
+        record.put_i32(people[i].id);
+        record.put_i32(people[i].face_count);
+        record.put_string(people[i].name);
+        record.put_string(people[i].created_at);
+        record.put_string(people[i].updated_at);
+        ok = writer.append_record(GallerySnapshot::SectionType::PEOPLE, record);
+    }
+
+    std::vector<std::pair<int, std::string>> memberships;
+    ok = ok && db->get_all_group_members(memberships);
+    for (size_t i = 0; ok && i < memberships.size(); i++) {
+        record.clear();
+        record.put_i32(memberships[i].first);
+        record.put_string(memberships[i].second);
+        ok = writer.append_record(GallerySnapshot::SectionType::GROUPS, record);
+    }
+
+    // Streamed row by row; only the current chunk is held in memory
+    uint64_t num_embeddings = 0;
+    ok = ok && db->for_each_face_embedding([&](const FaceEmbedding& emb) {
+        record.clear();
+        record.put_i32(emb.person_id);
+        record.put_string(emb.image_path);
+        record.put_string(emb.created_at);
+        record.put_blob(emb.embedding_data.data(), emb.embedding_data.size());
+        num_embeddings++;
+        return writer.append_record(GallerySnapshot::SectionType::EMBEDDINGS, record);
+    });
+
+    // The prebuilt index (and its projection) spare the importer a rebuild
+    if (ok && has_index) {
+        ok = writer.append_file(GallerySnapshot::SectionType::INDEX, staged_index);
+        if (ok && fs::exists(staged_index + ".pca")) {
+            ok = writer.append_file(GallerySnapshot::SectionType::PROJECTION, staged_index + ".pca");
+        }
+    }
+    ok = ok && writer.finish(people.size(), num_embeddings);
+
+    std::error_code ec;
+    fs::remove(staged_index, ec);
+    fs::remove(staged_index + ".pca", ec);
+    if (!ok) {
+        writer.abort();
+        std::cerr << "Error: Could not export gallery snapshot " << path << std::endl;
+        return false;
+    }
+
+    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+    std::cout << "Exported " << people.size() << " people and " << num_embeddings << " embeddings to "
+              << path << " (" << writer.get_bytes_written() / (1024 * 1024) << " MB, " << elapsed_ms << " ms)"
+              << std::endl;
+    return true;
 }
 
-bool DeepFaceRecognizer::load_index(const std::string& filepath) {
-    if (!faiss_index) {
+bool DeepFaceRecognizer::import_snapshot(const std::string& path) {
+    if (!db) {
         return false;
     }
+    auto start_time = std::chrono::steady_clock::now();
 
-    if (!faiss_index->load_index(filepath)) {
+    GallerySnapshot::Reader reader;
+    if (!reader.open(path)) {
+        return false;
+    }
+    const GallerySnapshot::SnapshotHeader& header = reader.get_header();
+    int model_dim = (model_loader && model_loader->is_model_loaded())
+                        ? model_loader->get_flattened_output_size() : 0;
+    if ((model_hash != 0 && header.model_hash != 0 && header.model_hash != model_hash) ||
+        (model_dim > 0 && static_cast<int>(header.dimension) != model_dim)) {
+        std::cerr << "Error: " << path << " was exported for a different embedding model" << std::endl;
         return false;
     }
 
-    // IMPORTANT: Reload label maps from database after loading FAISS index
-    // The FAISS index contains person_ids, but the label maps (person_id -> name)
-    // need to be loaded from the database to resolve names
+    // Background passes must not write the old gallery back over the new one
+    wait_for_compaction();
+
+    std::string staged_index = index_path + ".import";
+    std::string staged_projection = staged_index + ".pca";
+    std::shared_ptr<VectorIndexBase> imported;
+    {
+        std::lock_guard<std::mutex> update_lock(index_update_mutex);
+
+        // Nothing is visible until every chunk has been verified and the new index
+        // is ready: the database changes commit at the end, the index files are
+        // staged beside the live ones
+        std::error_code ec;
+        fs::remove(staged_index, ec);
+        fs::remove(staged_projection, ec);
+        if (!db->begin_transaction()) {
+            return false;
+        }
+        bool has_index = false;
+        bool ok = db->clear_gallery();
+        bool malformed = false;
+        size_t embedding_bytes = sizeof(float) * header.dimension;
+        std::ofstream index_out;
+        std::ofstream projection_out;
+
+        std::vector<unsigned char> payload;
+        std::vector<PersonRecord> people;
+        std::vector<std::pair<int, std::string>> memberships;
+        std::vector<FaceEmbedding> embeddings;
+        GallerySnapshot::SectionType type;
+        while (ok && reader.next_chunk(type, payload)) {
+            GallerySnapshot::RecordDecoder decoder(payload.data(), payload.size());
+            int32_t id = 0;
+            int32_t count = 0;
+            switch (type) {
+                case GallerySnapshot::SectionType::PEOPLE:
+                    people.clear();
+                    while (ok && !decoder.at_end()) {
+                        PersonRecord person;
+                        ok = decoder.get_i32(id) && decoder.get_i32(count) && decoder.get_string(person.name) &&
+                             decoder.get_string(person.created_at) && decoder.get_string(person.updated_at);
+                        person.id = id;
+                        person.face_count = count;
+                        people.push_back(std::move(person));
+                    }
+                    malformed = !ok;
+                    ok = ok && db->restore_people(people);
+                    break;
+                case GallerySnapshot::SectionType::GROUPS:
+                    memberships.clear();
+                    while (ok && !decoder.at_end()) {
+                        std::string group;
+                        ok = decoder.get_i32(id) && decoder.get_string(group);
+                        memberships.emplace_back(id, std::move(group));
+                    }
+                    malformed = !ok;
+                    ok = ok && db->restore_group_members(memberships);
+                    break;
+                case GallerySnapshot::SectionType::EMBEDDINGS:
+                    embeddings.clear();
+                    while (ok && !decoder.at_end()) {
+                        FaceEmbedding emb;
+                        ok = decoder.get_i32(id) && decoder.get_string(emb.image_path) &&
+                             decoder.get_string(emb.created_at) && decoder.get_blob(emb.embedding_data) &&
+                             emb.embedding_data.size() == embedding_bytes;
+                        emb.id = 0;
+                        emb.person_id = id;
+                        embeddings.push_back(std::move(emb));
+                    }
+                    malformed = !ok;
+                    ok = ok && db->restore_face_embeddings(embeddings);
+                    break;
+                case GallerySnapshot::SectionType::INDEX:
+                    if (!index_out.is_open()) {
+                        index_out.open(staged_index, std::ios::binary | std::ios::trunc);
+                    }
+                    ok = static_cast<bool>(index_out.write(reinterpret_cast<const char*>(payload.data()),
+                                                           static_cast<std::streamsize>(payload.size())));
+                    has_index = true;
+                    break;
+                case GallerySnapshot::SectionType::PROJECTION:
+                    if (!projection_out.is_open()) {
+                        projection_out.open(staged_projection, std::ios::binary | std::ios::trunc);
+                    }
+                    ok = static_cast<bool>(projection_out.write(reinterpret_cast<const char*>(payload.data()),
+                                                                static_cast<std::streamsize>(payload.size())));
+                    break;
+                default:
+                    break;  // Section of a newer exporter that this version does not use
+            }
+        }
+        if (malformed) {
+            std::cerr << "Error: Malformed record in gallery snapshot " << path << std::endl;
+        }
+        index_out.close();
+        projection_out.close();
+        ok = ok && !index_out.fail() && !projection_out.fail() && reader.is_complete();
+
+        // The shipped index is used if it loads here; one of another backend (or
+        // none) is rebuilt from the imported rows, which this transaction already sees
+        if (ok && has_index) {
+            imported = read_index_file(staged_index);
+        }
+        if (ok && !imported && header.num_embeddings > 0) {
+            std::cout << "Rebuilding the index from the imported embeddings" << std::endl;
+            std::vector<int> person_ids;
+            std::vector<std::vector<float>> embeddings;
+            if (read_database_embeddings(person_ids, embeddings)) {
+                imported = build_gallery_index(person_ids, embeddings);
+            }
+            ok = imported && persist_index(*imported, staged_index);
+        }
+        ok = ok && (!imported || IndexLog::sync_path(staged_index));
+
+        if (!ok || !db->commit_transaction()) {
+            db->rollback_transaction();
+            fs::remove(staged_index, ec);
+            fs::remove(staged_projection, ec);
+            std::cerr << "Error: Could not import gallery snapshot " << path << " (gallery unchanged)" << std::endl;
+            return false;
+        }
+
+        // The log holds enrollments of the replaced gallery: it goes with the old file
+        bool installed = true;
+        {
+            std::lock_guard<std::mutex> lock(index_file_mutex);
+            index_log.close();
+            fs::remove(index_path + ".wal", ec);
+            fs::remove(index_path + ".pca", ec);
+            if (imported) {
+                fs::rename(staged_index, index_path, ec);
+                if (!ec && fs::exists(staged_projection)) {
+                    fs::rename(staged_projection, index_path + ".pca", ec);
+                }
+                if (ec) {
+                    std::cerr << "Warning: Could not install the imported index file: " << ec.message()
+                              << std::endl;
+                    installed = false;
+                }
+            } else {
+                fs::remove(index_path, ec);
+            }
+            fs::remove(staged_index, ec);
+            fs::remove(staged_projection, ec);
+        }
+        if (!installed) {
+            persist_index(*imported, index_path);
+        }
+
+        if (imported) {
+            publish_index(imported);
+            model_trained = true;
+            start_row_compaction_if_needed(*imported);
+        }
+    }
+    if (!imported) {
+        clear_model();
+    }
     load_labels_from_database();
 
-    model_trained = true;
+    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+    std::cout << "Imported " << header.num_people << " people and " << header.num_embeddings
+              << " embeddings from " << path << " (" << elapsed_ms << " ms)" << std::endl;
+    return true;
+}
+
+std::shared_ptr<const EmbeddingProjection>
+DeepFaceRecognizer::train_projection(const std::vector<std::vector<float>>& embeddings) const {
+    if (Config::PCA_DIMENSION <= 0 || embeddings.empty() ||
+        static_cast<int>(embeddings[0].size()) <= Config::PCA_DIMENSION) {
+        return nullptr;
+    }
+    if (embeddings.size() < static_cast<size_t>(std::max(Config::PCA_MIN_TRAINING_VECTORS, 2 * Config::PCA_DIMENSION))) {
+        std::cout << "PCA projection skipped: " << embeddings.size() << " embeddings are too few to train it"
+                  << std::endl;
+        return nullptr;
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    std::shared_ptr<const EmbeddingProjection> projection = EmbeddingProjection::train(
+        embeddings, Config::PCA_DIMENSION, Config::PCA_WHITEN, Config::PCA_MAX_TRAINING_VECTORS);
+    if (!projection) {
+        return nullptr;
+    }
+    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+    std::cout << "Trained PCA projection: " << projection->get_input_dimension() << " -> "
+              << projection->get_output_dimension() << " dimensions"
+              << (projection->is_whitened() ? ", whitened" : "") << " ("
+              << static_cast<int>(projection->get_retained_variance() * 100.0 + 0.5) << "% of variance, "
+              << elapsed_ms << "ms)" << std::endl;
+    return projection;
+}
+
+std::vector<float> DeepFaceRecognizer::to_index_space(const VectorIndexBase& index, const std::vector<float>& embedding) {
+    if (!index.get_projection() || embedding.empty()) {
+        return embedding;
+    }
+    return index.get_projection()->project(embedding);
+}
+
+const std::vector<float>& DeepFaceRecognizer::query_embedding(const VectorIndexBase& index, const cv::Mat& face_image) {
+    RecognitionBuffers& buffers = recognition_buffers;
+    if (!extract_embedding(face_image, buffers.embedding) || !index.get_projection()) {
+        return buffers.embedding;
+    }
+    buffers.projected = index.get_projection()->project(buffers.embedding);
+    return buffers.projected;
+}
+
+std::shared_ptr<VectorIndexBase> DeepFaceRecognizer::create_empty_index(int embedding_dim) const {
+    std::shared_ptr<VectorIndexBase> index = create_vector_index(index_backend, embedding_dim);
+    index->set_model_hash(model_hash);
+    return index;
+}
+
+bool DeepFaceRecognizer::open_index_log(const VectorIndexBase& index) {
+    return index_log.open(index_path + ".wal", index.get_dimension(), model_hash,
+                          index.get_log_sequence());
+}
+
+bool DeepFaceRecognizer::persist_index(VectorIndexBase& index, const std::string& filepath) {
+    std::lock_guard<std::mutex> lock(index_file_mutex);
+
+    // The in-memory index holds every logged record, so the saved file supersedes the log.
+    // A log of another dimension (the PCA projection changed) is reopened, which empties it.
+    bool is_log_target = (filepath == index_path) &&
+                         ((index_log.is_open() && index_log.get_dimension() == index.get_dimension()) ||
+                          open_index_log(index));
+    if (is_log_target) {
+        index.set_log_sequence(index_log.get_last_sequence());
+    }
+    if (!index.save_index(filepath) || !save_projection_sidecar(index, filepath)) {
+        return false;
+    }
+    if (is_log_target) {
+        index_log.discard_through(index.get_log_sequence());  // save_index() made the file durable
+    }
+    return true;
+}
+
+bool DeepFaceRecognizer::save_projection_sidecar(const VectorIndexBase& index, const std::string& filepath) {
+    // The projection travels beside the file, stamped with the file's header checksum:
+    // a crash between the two renames leaves a pair that loading refuses
+    std::string projection_path = filepath + ".pca";
+    if (index.get_projection()) {
+        return index.get_projection()->save(projection_path, model_hash, IndexFile::stamp_file(filepath));
+    }
+    if (fs::exists(projection_path)) {
+        fs::remove(projection_path);
+    }
+    return true;
+}
+
+bool DeepFaceRecognizer::compact_index_log() {
+    wait_for_compaction();
+    return merge_log_into_file(index_backend, current_index()->get_dimension());
+}
+
+void DeepFaceRecognizer::wait_for_compaction() {
+    if (compaction_thread.joinable()) {
+        compaction_thread.join();
+    }
+    if (row_compaction_thread.joinable()) {
+        row_compaction_thread.join();
+    }
+
+    // A running condensation thread drains the queue, including people queued meanwhile
+    std::thread condensation;
+    {
+        std::lock_guard<std::mutex> lock(condensation_mutex);
+        condensation = std::move(condensation_thread);
+    }
+    if (condensation.joinable()) {
+        condensation.join();
+    }
+}
+
+void DeepFaceRecognizer::start_compaction() {
+    if (compaction_running) {
+        return;
+    }
+    // Reap the previous, finished run only: callers hold index_update_mutex,
+    // which a running row compaction or condensation needs to publish
+    if (compaction_thread.joinable()) {
+        compaction_thread.join();
+    }
+
+    compaction_running = true;
+    Config::IndexBackend backend = index_backend;
+    int embedding_dim = current_index()->get_dimension();
+    compaction_thread = std::thread([this, backend, embedding_dim]() {
+        merge_log_into_file(backend, embedding_dim);
+        compaction_running = false;
+    });
+}
+
+void DeepFaceRecognizer::start_row_compaction_if_needed(const VectorIndexBase& index) {
+    int deleted = index.get_num_deleted();
+    int total = deleted + index.get_num_vectors();
+    bool compact = deleted > 0 && deleted >= total * Config::INDEX_COMPACT_DELETED_FRACTION;
+    if ((!compact && !index.needs_training()) || row_compaction_running) {
+        return;
+    }
+    if (row_compaction_thread.joinable()) {
+        row_compaction_thread.join();  // Reap the previous, finished run
+    }
+
+    row_compaction_running = true;
+    row_compaction_thread = std::thread([this]() {
+        compact_deleted_rows();
+        row_compaction_running = false;
+    });
+}
+
+void DeepFaceRecognizer::start_condensation(int person_id) {
+    std::lock_guard<std::mutex> lock(condensation_mutex);
+    condensation_queue.insert(person_id);
+    if (condensation_running) {
+        return;  // The running thread picks it up
+    }
+    if (condensation_thread.joinable()) {
+        condensation_thread.join();  // Reap the previous, finished run
+    }
+
+    condensation_running = true;
+    condensation_thread = std::thread([this]() {
+        for (;;) {
+            int next = -1;
+            {
+                std::lock_guard<std::mutex> queue_lock(condensation_mutex);
+                if (condensation_queue.empty()) {
+                    condensation_running = false;
+                    return;
+                }
+                next = *condensation_queue.begin();
+                condensation_queue.erase(condensation_queue.begin());
+            }
+            condense_person(next);
+        }
+    });
+}
+
+bool DeepFaceRecognizer::condense_person(int person_id) {
+    int budget = Config::MAX_EMBEDDINGS_PER_PERSON;
+    int rows_before = current_index()->get_person_vector_count(person_id);
+    if (budget <= 0 || rows_before <= budget) {
+        return true;
+    }
+    if (!db) {
+        return false;  // The captures to condense are read from the database
+    }
+
+    try {
+        auto start_time = std::chrono::steady_clock::now();
+
+        // Every stored capture, not the indexed rows, so repeated passes never
+        // condense representatives of representatives
+        std::vector<FaceEmbedding> stored;
+        if (!db->get_face_embeddings(person_id, stored) || stored.empty()) {
+            return false;
+        }
+        size_t dimension = static_cast<size_t>(current_index()->get_input_dimension());
+        size_t first = stored.size() > static_cast<size_t>(Config::CONDENSATION_MAX_SAMPLES)
+                           ? stored.size() - Config::CONDENSATION_MAX_SAMPLES : 0;
+        std::vector<std::vector<float>> samples;
+        for (size_t i = first; i < stored.size(); i++) {  // Oldest first: keep the newest
+            const std::vector<unsigned char>& bytes = stored[i].embedding_data;
+            if (bytes.size() != dimension * sizeof(float)) {
+                continue;  // Written for another model
+            }
+            const float* values = reinterpret_cast<const float*>(bytes.data());
+            samples.emplace_back(values, values + dimension);
+        }
+
+        EmbeddingCondenser::Result condensed =
+            EmbeddingCondenser::condense(samples, budget, Config::CONDENSATION_MODE);
+        if (condensed.embeddings.empty() || static_cast<int>(condensed.embeddings.size()) >= rows_before) {
+            return true;
+        }
+
+        std::shared_ptr<VectorIndexBase> index;
+        {
+            std::lock_guard<std::mutex> lock(index_update_mutex);
+            if (current_index()->get_person_vector_count(person_id) != rows_before) {
+                return false;  // Enrolled again meanwhile; that enrollment queues another pass
+            }
+            if (!publish_person_embeddings(person_id, condensed.embeddings)) {
+                return false;
+            }
+            index = current_index();
+        }
+
+        // Recall impact: do the captures that were dropped still find this person?
+        std::vector<bool> kept(samples.size(), false);
+        for (int i : condensed.kept) {
+            kept[i] = true;
+        }
+        std::vector<size_t> dropped;
+        for (size_t i = 0; i < samples.size(); i++) {
+            if (!kept[i]) {
+                dropped.push_back(i);
+            }
+        }
+        size_t step = std::max<size_t>(1, dropped.size() / Config::CONDENSATION_RECALL_SAMPLES);
+        int checked = 0;
+        int recognized = 0;
+        for (size_t j = 0; j < dropped.size() && checked < Config::CONDENSATION_RECALL_SAMPLES; j += step) {
+            std::vector<double> confidences;
+            std::vector<int> match = index->search_k(to_index_space(*index, samples[dropped[j]]), 1, confidences);
+            checked++;
+            if (!match.empty() && match[0] == person_id && confidences[0] >= confidence_threshold) {
+                recognized++;
+            }
+        }
+
+        auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time).count();
+        std::cout << "Condensed person " << person_id << ": " << rows_before << " -> "
+                  << condensed.embeddings.size() << " indexed embeddings from " << samples.size()
+                  << " captures (coverage mean " << condensed.mean_coverage << ", min " << condensed.min_coverage
+                  << "; dropped captures still recognized " << recognized << "/" << checked << ", "
+                  << elapsed_ms << "ms)" << std::endl;
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error condensing embeddings of person " << person_id << ": " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool DeepFaceRecognizer::apply_embedding_budget(const std::vector<int>& person_ids,
+                                                const std::vector<std::vector<float>>& embeddings,
+                                                std::vector<int>& budget_ids,
+                                                std::vector<std::vector<float>>& budget_embeddings) {
+    size_t budget = static_cast<size_t>(std::max(0, Config::MAX_EMBEDDINGS_PER_PERSON));
+    if (budget == 0) {
+        return false;
+    }
+
+    std::map<int, std::vector<size_t>> rows_of;  // In input (capture) order
+    for (size_t i = 0; i < person_ids.size(); i++) {
+        rows_of[person_ids[i]].push_back(i);
+    }
+    if (std::none_of(rows_of.begin(), rows_of.end(),
+                     [budget](const auto& person) { return person.second.size() > budget; })) {
+        return false;
+    }
+
+    budget_ids.clear();
+    budget_embeddings.clear();
+    int condensed_people = 0;
+    for (const auto& [person_id, rows] : rows_of) {
+        if (rows.size() <= budget) {
+            for (size_t i : rows) {
+                budget_ids.push_back(person_id);
+                budget_embeddings.push_back(embeddings[i]);
+            }
+            continue;
+        }
+
+        size_t first = rows.size() > static_cast<size_t>(Config::CONDENSATION_MAX_SAMPLES)
+                           ? rows.size() - Config::CONDENSATION_MAX_SAMPLES : 0;
+        std::vector<std::vector<float>> samples;
+        for (size_t j = first; j < rows.size(); j++) {
+            samples.push_back(embeddings[rows[j]]);
+        }
+        EmbeddingCondenser::Result condensed =
+            EmbeddingCondenser::condense(samples, static_cast<int>(budget), Config::CONDENSATION_MODE);
+        for (std::vector<float>& representative : condensed.embeddings) {
+            budget_ids.push_back(person_id);
+            budget_embeddings.push_back(std::move(representative));
+        }
+        condensed_people++;
+    }
+
+    std::cout << "Embedding budget: condensed " << condensed_people << " people, "
+              << person_ids.size() << " -> " << budget_ids.size() << " indexed embeddings" << std::endl;
     return true;
 }
 
+bool DeepFaceRecognizer::apply_log_records(VectorIndexBase& index, std::vector<IndexLog::Record>& records) {
+    // Applied in sequence order: a deletion covers only the insertions logged before it
+    std::vector<int> ids;
+    std::vector<std::vector<float>> embeddings;
+    auto flush_inserts = [&]() {
+        bool added = ids.empty() || index.add_vectors(ids, embeddings);
+        ids.clear();
+        embeddings.clear();
+        return added;
+    };
+
+    for (IndexLog::Record& record : records) {
+        if (record.kind == IndexLog::RecordKind::DELETE_PERSON) {
+            if (!flush_inserts()) {
+                return false;
+            }
+            index.remove_person(record.person_id);
+        } else {
+            ids.push_back(record.person_id);
+            embeddings.push_back(std::move(record.embedding));
+        }
+    }
+    if (!flush_inserts()) {
+        return false;
+    }
+    if (!records.empty()) {
+        index.set_log_sequence(records.back().sequence);
+    }
+    return true;
+}
+
+bool DeepFaceRecognizer::merge_log_into_file(Config::IndexBackend backend, int embedding_dim) {
+    std::lock_guard<std::mutex> lock(index_file_mutex);
+    if (!index_log.is_open()) {
+        return false;
+    }
+
+    try {
+        auto start_time = std::chrono::steady_clock::now();
+
+        // Merge into a private copy of the file; the live index is never touched
+        std::unique_ptr<VectorIndexBase> merged = create_vector_index(backend, embedding_dim);
+        merged->set_model_hash(model_hash);
+        if (fs::exists(index_path)) {
+            if (!merged->load_index(index_path)) {
+                std::cerr << "Error: Index log compaction could not load " << index_path << std::endl;
+                return false;
+            }
+
+            // The rewritten file needs its projection re-stamped; one that does not
+            // match the file now is left for load_index() to refuse, not blessed
+            if (fs::exists(index_path + ".pca")) {
+                std::shared_ptr<const EmbeddingProjection> projection = EmbeddingProjection::load(
+                    index_path + ".pca", model_hash, IndexFile::stamp_file(index_path));
+                if (!projection) {
+                    std::cerr << "Error: Index log compaction found no valid projection for " << index_path
+                              << std::endl;
+                    return false;
+                }
+                merged->set_projection(projection);
+            }
+        }
+
+        std::vector<IndexLog::Record> records;
+        if (!index_log.read_records(merged->get_log_sequence(), records)) {
+            return false;
+        }
+        if (records.empty()) {
+            return index_log.discard_through(merged->get_log_sequence());
+        }
+
+        size_t num_records = records.size();
+        if ((!merged->is_index_built() && !merged->build_index(static_cast<int>(num_records))) ||
+            !apply_log_records(*merged, records)) {
+            return false;
+        }
+        if (merged->needs_training()) {
+            merged->train();
+        }
+
+        // save_index() leaves out rows of people deleted in the log
+        if (!merged->save_index(index_path) || !save_projection_sidecar(*merged, index_path)) {
+            return false;
+        }
+        index_log.discard_through(merged->get_log_sequence());
+
+        auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time).count();
+        std::cout << "Merged " << num_records << " logged changes into " << index_path
+                  << " (" << merged->get_num_vectors() << " vectors, " << elapsed_ms << "ms)" << std::endl;
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error compacting index log: " << e.what() << std::endl;
+        return false;
+    }
+}
+
 void DeepFaceRecognizer::clear_model() {
-    if (faiss_index) {
-        faiss_index->clear();
+    {
+        std::lock_guard<std::mutex> lock(index_update_mutex);
+        publish_index(create_empty_index(current_index()->get_input_dimension()));
+        model_trained = false;
     }
+    std::lock_guard<std::mutex> lock(labels_mutex);
     person_id_to_name.clear();
     name_to_person_id.clear();
-    model_trained = false;
 }
 
 void DeepFaceRecognizer::clear() {
     clear_model();
 }
 
+void DeepFaceRecognizer::set_index_backend(Config::IndexBackend backend) {
+    std::lock_guard<std::mutex> lock(index_update_mutex);
+    if (backend == index_backend) {
+        return;
+    }
+
+    // The new backend starts empty; callers reload or retrain afterwards
+    index_backend = backend;
+    std::shared_ptr<VectorIndexBase> index = create_empty_index(current_index()->get_input_dimension());
+    publish_index(index);
+    index_log.close();  // Reopened for the new index on the next load or enrollment
+    model_trained = false;
+    std::cout << "Search index backend: " << index->get_backend_name() << std::endl;
+}
+
+void DeepFaceRecognizer::set_search_effort(int effort) {
+    // Searches read the knob, so it is changed on a copy like any other update
+    std::lock_guard<std::mutex> lock(index_update_mutex);
+    std::shared_ptr<VectorIndexBase> updated = current_index()->clone();
+    updated->set_search_effort(effort);
+    publish_index(updated);
+}
+
 double DeepFaceRecognizer::compare_embeddings(const std::vector<float>& emb1, 
                                               const std::vector<float>& emb2) {
     if (emb1.size() != emb2.size() || emb1.empty()) {
@@ -590,19 +1806,20 @@ std::vector<std::pair<std::string, double>>
 DeepFaceRecognizer::recognize_top_k(const cv::Mat& face_image, int k) {
     std::vector<std::pair<std::string, double>> results;
 
-    if (!model_trained || !faiss_index->is_index_built()) {
+    std::shared_ptr<VectorIndexBase> index = current_index();  // Stable for this call
+    if (!model_trained || !index->is_index_built()) {
         return results;
     }
 
     // Extract embedding
-    std::vector<float> embedding = extract_embedding(face_image);
+    const std::vector<float>& embedding = query_embedding(*index, face_image);
     if (embedding.empty()) {
         return results;
     }
 
-    // Get top-k matches
+    // Get the k most similar people (one entry per person, see Config::IDENTITY_AGGREGATION)
     std::vector<double> confidences;
-    std::vector<int> person_ids = faiss_index->search_k(embedding, k, confidences);
+    std::vector<int> person_ids = index->search_identities(embedding, k, confidences);
 
     // Convert to name-confidence pairs
     for (size_t i = 0; i < person_ids.size(); i++) {
@@ -612,3 +1829,16 @@ DeepFaceRecognizer::recognize_top_k(const cv::Mat& face_image, int k) {
 
     return results;
 }
+
+std::vector<int> DeepFaceRecognizer::find_matching_people(const std::vector<float>& embedding,
+                                                          double min_similarity,
+                                                          std::vector<double>& similarities) const {
+    similarities.clear();
+    std::shared_ptr<VectorIndexBase> index = current_index();  // Stable for this call
+    if (!model_trained || !index->is_index_built() || embedding.empty()) {
+        return std::vector<int>();
+    }
+
+    // Whole gallery: a duplicate outside this camera's access groups is still a duplicate
+    return index->range_search(to_index_space(*index, embedding), min_similarity, similarities);
+}
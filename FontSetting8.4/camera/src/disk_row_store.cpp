@@ -0,0 +1,83 @@
+#include "disk_row_store.h"
+#include <iostream>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+
+DiskRowStore::~DiskRowStore() {
+    close();
+}
+
+bool DiskRowStore::open(const std::string& directory, size_t bytes_per_row) {
+    close();
+
+    std::string pattern = directory + "/.faiss_rows_XXXXXX";
+    std::vector<char> path(pattern.begin(), pattern.end());
+    path.push_back('\0');
+
+    fd = mkstemp(path.data());
+    if (fd < 0) {
+        std::cerr << "Error: Could not create row spill file in " << directory
+                  << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Unlink immediately so the space is reclaimed even if the process dies
+    unlink(path.data());
+    row_bytes = bytes_per_row;
+    return true;
+}
+
+bool DiskRowStore::write_row(size_t index, const void* data) {
+    if (fd < 0) {
+        return false;
+    }
+
+    const char* buffer = static_cast<const char*>(data);
+    off_t offset = static_cast<off_t>(index * row_bytes);
+    size_t done = 0;
+    while (done < row_bytes) {
+        ssize_t written = pwrite(fd, buffer + done, row_bytes - done, offset + done);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            std::cerr << "Error: Row spill write failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        done += static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool DiskRowStore::read_row(size_t index, void* out) const {
+    if (fd < 0) {
+        return false;
+    }
+
+    char* buffer = static_cast<char*>(out);
+    off_t offset = static_cast<off_t>(index * row_bytes);
+    size_t done = 0;
+    while (done < row_bytes) {
+        ssize_t got = pread(fd, buffer + done, row_bytes - done, offset + done);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            std::cerr << "Error: Row spill read failed at row " << index << std::endl;
+            return false;
+        }
+        done += static_cast<size_t>(got);
+    }
+    return true;
+}
+
+void DiskRowStore::close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    row_bytes = 0;
+}
@@ -0,0 +1,224 @@
+#include "embedding_condenser.h"
+#include "vector_kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace EmbeddingCondenser {
+
+// Voronoi passes after the greedy selection; they usually settle in one or two
+static constexpr int MEDOID_REFINE_PASSES = 4;
+
+// Cosine similarity of every pair of samples, row-major n x n
+static std::vector<float> similarity_matrix(const std::vector<std::vector<float>>& embeddings) {
+    size_t n = embeddings.size();
+    std::vector<float> norms(n);
+    for (size_t i = 0; i < n; i++) {
+        const std::vector<float>& e = embeddings[i];
+        norms[i] = std::sqrt(std::max(VectorKernels::dot_product(e.data(), e.data(), static_cast<int>(e.size())),
+                                      std::numeric_limits<float>::min()));
+    }
+
+    std::vector<float> similarity(n * n, 1.0f);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = i + 1; j < n; j++) {
+            float dot = VectorKernels::dot_product(embeddings[i].data(), embeddings[j].data(),
+                                                   static_cast<int>(embeddings[i].size()));
+            float cosine = dot / (norms[i] * norms[j]);
+            similarity[i * n + j] = cosine;
+            similarity[j * n + i] = cosine;
+        }
+    }
+    return similarity;
+}
+
+// Cosine similarity mapped to the 0-1 scale of the index confidences
+static double to_similarity(float cosine) {
+    return (1.0 + std::max(-1.0f, std::min(1.0f, cosine))) / 2.0;
+}
+
+static std::vector<int> select_medoids(const std::vector<float>& similarity, size_t n, int k) {
+    std::vector<int> medoids;
+    if (k <= 0 || n == 0) {
+        return medoids;
+    }
+    if (static_cast<size_t>(k) >= n) {
+        for (size_t i = 0; i < n; i++) {
+            medoids.push_back(static_cast<int>(i));
+        }
+        return medoids;
+    }
+
+    // Greedy build: add the sample that most improves every sample's best match
+    std::vector<float> covered(n, -1.0f);  // Best similarity to a chosen medoid so far
+    std::vector<bool> chosen(n, false);
+    for (int step = 0; step < k; step++) {
+        int best = -1;
+        double best_gain = -1.0;
+        for (size_t c = 0; c < n; c++) {
+            if (chosen[c]) {
+                continue;
+            }
+            double gain = 0.0;
+            const float* row = similarity.data() + c * n;
+            for (size_t i = 0; i < n; i++) {
+                gain += std::max(0.0f, row[i] - covered[i]);
+            }
+            if (gain > best_gain) {
+                best_gain = gain;
+                best = static_cast<int>(c);
+            }
+        }
+        chosen[best] = true;
+        medoids.push_back(best);
+        const float* row = similarity.data() + static_cast<size_t>(best) * n;
+        for (size_t i = 0; i < n; i++) {
+            covered[i] = std::max(covered[i], row[i]);
+        }
+    }
+
+    // Voronoi refinement: each medoid moves to the member most similar to its cluster
+    std::vector<int> owner(n);
+    for (int pass = 0; pass < MEDOID_REFINE_PASSES; pass++) {
+        for (size_t i = 0; i < n; i++) {
+            int best = 0;
+            for (int m = 1; m < k; m++) {
+                if (similarity[i * n + medoids[m]] > similarity[i * n + medoids[best]]) {
+                    best = m;
+                }
+            }
+            owner[i] = best;
+        }
+
+        bool moved = false;
+        for (int m = 0; m < k; m++) {
+            int center = medoids[m];
+            double center_sum = -std::numeric_limits<double>::infinity();
+            for (size_t c = 0; c < n; c++) {
+                if (owner[c] != m) {
+                    continue;
+                }
+                double sum = 0.0;
+                for (size_t i = 0; i < n; i++) {
+                    if (owner[i] == m) {
+                        sum += similarity[c * n + i];
+                    }
+                }
+                if (sum > center_sum + 1e-9) {
+                    center_sum = sum;
+                    center = static_cast<int>(c);
+                }
+            }
+            if (center != medoids[m]) {
+                medoids[m] = center;
+                moved = true;
+            }
+        }
+        if (!moved) {
+            break;
+        }
+    }
+    return medoids;
+}
+
+static std::vector<float> weighted_centroid(const std::vector<std::vector<float>>& embeddings,
+                                            const std::vector<float>& similarity) {
+    size_t n = embeddings.size();
+    if (n == 0) {
+        return std::vector<float>();
+    }
+
+    size_t dimension = embeddings[0].size();
+    std::vector<double> sum(dimension, 0.0);
+    for (size_t i = 0; i < n; i++) {
+        // Weight: mean similarity to the other samples (1 for a single sample)
+        double weight = 1.0;
+        if (n > 1) {
+            weight = 0.0;
+            for (size_t j = 0; j < n; j++) {
+                if (j != i) {
+                    weight += std::max(0.0f, similarity[i * n + j]);
+                }
+            }
+            weight = std::max(weight / static_cast<double>(n - 1), 1e-6);
+        }
+
+        // Samples are normalized first so their norm does not act as a second weight
+        const std::vector<float>& e = embeddings[i];
+        double norm = std::sqrt(std::max<double>(
+            VectorKernels::dot_product(e.data(), e.data(), static_cast<int>(dimension)), 1e-12));
+        for (size_t d = 0; d < dimension; d++) {
+            sum[d] += weight * e[d] / norm;
+        }
+    }
+
+    double norm = 0.0;
+    for (double value : sum) {
+        norm += value * value;
+    }
+    norm = std::sqrt(std::max(norm, 1e-12));
+    std::vector<float> centroid(dimension);
+    for (size_t d = 0; d < dimension; d++) {
+        centroid[d] = static_cast<float>(sum[d] / norm);
+    }
+    return centroid;
+}
+
+std::vector<int> select_medoids(const std::vector<std::vector<float>>& embeddings, int k) {
+    return select_medoids(similarity_matrix(embeddings), embeddings.size(), k);
+}
+
+std::vector<float> weighted_centroid(const std::vector<std::vector<float>>& embeddings) {
+    return weighted_centroid(embeddings, similarity_matrix(embeddings));
+}
+
+Result condense(const std::vector<std::vector<float>>& embeddings, int k, Config::CondensationMode mode) {
+    Result result;
+    size_t n = embeddings.size();
+    if (n <= 1 || k <= 0 || (mode == Config::CondensationMode::MEDOIDS && n <= static_cast<size_t>(k))) {
+        result.embeddings = embeddings;
+        for (size_t i = 0; i < n; i++) {
+            result.kept.push_back(static_cast<int>(i));
+        }
+        return result;
+    }
+
+    std::vector<float> similarity = similarity_matrix(embeddings);
+    double total = 0.0;
+    result.min_coverage = 1.0;
+
+    if (mode == Config::CondensationMode::CENTROID) {
+        std::vector<float> centroid = weighted_centroid(embeddings, similarity);
+        float centroid_norm = std::sqrt(VectorKernels::dot_product(centroid.data(), centroid.data(),
+                                                                   static_cast<int>(centroid.size())));
+        for (const std::vector<float>& e : embeddings) {
+            float norm = std::sqrt(std::max(VectorKernels::dot_product(e.data(), e.data(), static_cast<int>(e.size())),
+                                            std::numeric_limits<float>::min()));
+            double coverage = to_similarity(VectorKernels::dot_product(e.data(), centroid.data(),
+                                                                       static_cast<int>(e.size())) /
+                                            (norm * centroid_norm));
+            total += coverage;
+            result.min_coverage = std::min(result.min_coverage, coverage);
+        }
+        result.embeddings.push_back(std::move(centroid));
+    } else {
+        result.kept = select_medoids(similarity, n, k);
+        for (size_t i = 0; i < n; i++) {
+            float best = -1.0f;
+            for (int m : result.kept) {
+                best = std::max(best, similarity[i * n + m]);
+            }
+            double coverage = to_similarity(best);
+            total += coverage;
+            result.min_coverage = std::min(result.min_coverage, coverage);
+        }
+        for (int m : result.kept) {
+            result.embeddings.push_back(embeddings[m]);
+        }
+    }
+
+    result.mean_coverage = total / static_cast<double>(n);
+    return result;
+}
+
+}  // namespace EmbeddingCondenser
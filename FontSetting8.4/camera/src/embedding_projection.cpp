@@ -0,0 +1,458 @@
+#include "embedding_projection.h"
+#include "index_file.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <numeric>
+
+static constexpr char FILE_MAGIC[8] = {'E', 'M', 'B', 'P', 'R', 'O', 'J', '1'};
+static constexpr uint32_t FILE_VERSION = 3;  // 2: index_checksum, 3: it is IndexFile::stamp_file()
+
+// Added to each eigenvalue before whitening so near-empty components are not blown up
+static constexpr double WHITEN_EPSILON_FRACTION = 1e-4;
+
+struct ProjectionFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t input_dimension;
+    uint32_t output_dimension;
+    uint32_t whiten;
+    uint64_t model_hash;
+    uint64_t index_stamp;     // IndexFile::stamp_file() of the index file this projection belongs to
+    double retained_variance;
+};
+
+static_assert(sizeof(ProjectionFileHeader) == 48, "ProjectionFileHeader layout changed");
+
+// Householder reduction of the symmetric matrix in v (n x n, row-major) to
+// tridiagonal form: diagonal in d, subdiagonal in e, transformation in v
+// (EISPACK tred2)
+static void tridiagonalize(std::vector<double>& v, std::vector<double>& d, std::vector<double>& e, int n) {
+    auto at = [&v, n](int row, int col) -> double& { return v[static_cast<size_t>(row) * n + col]; };
+
+    for (int j = 0; j < n; j++) {
+        d[j] = at(n - 1, j);
+    }
+
+    for (int i = n - 1; i > 0; i--) {
+        double scale = 0.0;
+        double h = 0.0;
+        for (int k = 0; k < i; k++) {
+            scale += std::fabs(d[k]);
+        }
+        if (scale == 0.0) {
+            e[i] = d[i - 1];
+            for (int j = 0; j < i; j++) {
+                d[j] = at(i - 1, j);
+                at(i, j) = 0.0;
+                at(j, i) = 0.0;
+            }
+        } else {
+            for (int k = 0; k < i; k++) {
+                d[k] /= scale;
+                h += d[k] * d[k];
+            }
+            double f = d[i - 1];
+            double g = std::sqrt(h);
+            if (f > 0) {
+                g = -g;
+            }
+            e[i] = scale * g;
+            h -= f * g;
+            d[i - 1] = f - g;
+            for (int j = 0; j < i; j++) {
+                e[j] = 0.0;
+            }
+
+            for (int j = 0; j < i; j++) {
+                f = d[j];
+                at(j, i) = f;
+                g = e[j] + at(j, j) * f;
+                for (int k = j + 1; k <= i - 1; k++) {
+                    g += at(k, j) * d[k];
+                    e[k] += at(k, j) * f;
+                }
+                e[j] = g;
+            }
+            f = 0.0;
+            for (int j = 0; j < i; j++) {
+                e[j] /= h;
+                f += e[j] * d[j];
+            }
+            double hh = f / (h + h);
+            for (int j = 0; j < i; j++) {
+                e[j] -= hh * d[j];
+            }
+            for (int j = 0; j < i; j++) {
+                f = d[j];
+                g = e[j];
+                for (int k = j; k <= i - 1; k++) {
+                    at(k, j) -= (f * e[k] + g * d[k]);
+                }
+                d[j] = at(i - 1, j);
+                at(i, j) = 0.0;
+            }
+        }
+        d[i] = h;
+    }
+
+    // Accumulate the transformations
+    for (int i = 0; i < n - 1; i++) {
+        at(n - 1, i) = at(i, i);
+        at(i, i) = 1.0;
+        double h = d[i + 1];
+        if (h != 0.0) {
+            for (int k = 0; k <= i; k++) {
+                d[k] = at(k, i + 1) / h;
+            }
+            for (int j = 0; j <= i; j++) {
+                double g = 0.0;
+                for (int k = 0; k <= i; k++) {
+                    g += at(k, i + 1) * at(k, j);
+                }
+                for (int k = 0; k <= i; k++) {
+                    at(k, j) -= g * d[k];
+                }
+            }
+        }
+        for (int k = 0; k <= i; k++) {
+            at(k, i + 1) = 0.0;
+        }
+    }
+    for (int j = 0; j < n; j++) {
+        d[j] = at(n - 1, j);
+        at(n - 1, j) = 0.0;
+    }
+    at(n - 1, n - 1) = 1.0;
+    e[0] = 0.0;
+}
+
+// Eigenvalues (d) and eigenvectors of the tridiagonal matrix by the implicit
+// QL method (EISPACK tql2). vt holds the transformation transposed, so each
+// rotation updates two contiguous rows; on return row i is the eigenvector of d[i].
+static void diagonalize(std::vector<double>& vt, std::vector<double>& d, std::vector<double>& e, int n) {
+    auto row = [&vt, n](int r) { return vt.data() + static_cast<size_t>(r) * n; };
+
+    for (int i = 1; i < n; i++) {
+        e[i - 1] = e[i];
+    }
+    e[n - 1] = 0.0;
+
+    double f = 0.0;
+    double tst1 = 0.0;
+    const double eps = std::numeric_limits<double>::epsilon();
+    for (int l = 0; l < n; l++) {
+        tst1 = std::max(tst1, std::fabs(d[l]) + std::fabs(e[l]));
+        int m = l;
+        while (m < n - 1 && std::fabs(e[m]) > eps * tst1) {
+            m++;
+        }
+
+        if (m > l) {
+            do {
+                double g = d[l];
+                double p = (d[l + 1] - g) / (2.0 * e[l]);
+                double r = std::hypot(p, 1.0);
+                if (p < 0) {
+                    r = -r;
+                }
+                d[l] = e[l] / (p + r);
+                d[l + 1] = e[l] * (p + r);
+                double dl1 = d[l + 1];
+                double h = g - d[l];
+                for (int i = l + 2; i < n; i++) {
+                    d[i] -= h;
+                }
+                f += h;
+
+                p = d[m];
+                double c = 1.0, c2 = 1.0, c3 = 1.0;
+                double el1 = e[l + 1];
+                double s = 0.0, s2 = 0.0;
+                for (int i = m - 1; i >= l; i--) {
+                    c3 = c2;
+                    c2 = c;
+                    s2 = s;
+                    g = c * e[i];
+                    h = c * p;
+                    r = std::hypot(p, e[i]);
+                    e[i + 1] = s * r;
+                    s = e[i] / r;
+                    c = p / r;
+                    p = c * d[i] - s * g;
+                    d[i + 1] = h + s * (c * g + s * d[i]);
+
+                    double* vi = row(i);
+                    double* vi1 = row(i + 1);
+                    for (int k = 0; k < n; k++) {
+                        h = vi1[k];
+                        vi1[k] = s * vi[k] + c * h;
+                        vi[k] = c * vi[k] - s * h;
+                    }
+                }
+                p = -s * s2 * c3 * el1 * e[l] / dl1;
+                e[l] = s * p;
+                d[l] = c * p;
+            } while (std::fabs(e[l]) > eps * tst1);
+        }
+        d[l] += f;
+        e[l] = 0.0;
+    }
+}
+
+std::shared_ptr<EmbeddingProjection> EmbeddingProjection::train(const std::vector<std::vector<float>>& samples,
+                                                                int output_dimension, bool whiten,
+                                                                size_t max_samples) {
+    if (samples.empty() || samples[0].empty()) {
+        return nullptr;
+    }
+    int dimension = static_cast<int>(samples[0].size());
+    if (output_dimension <= 0 || output_dimension >= dimension) {
+        std::cerr << "Error: PCA dimension " << output_dimension << " must be below the embedding dimension "
+                  << dimension << std::endl;
+        return nullptr;
+    }
+
+    // Evenly spaced subset: the covariance converges long before a large gallery is exhausted
+    size_t num_samples = samples.size();
+    size_t used = (max_samples > 0) ? std::min(num_samples, max_samples) : num_samples;
+    if (used < 2) {
+        return nullptr;
+    }
+    std::vector<size_t> picked(used);
+    for (size_t i = 0; i < used; i++) {
+        picked[i] = i * num_samples / used;
+        if (samples[picked[i]].size() != static_cast<size_t>(dimension)) {
+            std::cerr << "Error: Embedding dimension mismatch in PCA training data" << std::endl;
+            return nullptr;
+        }
+    }
+
+    std::vector<double> mean(dimension, 0.0);
+    for (size_t s : picked) {
+        for (int d = 0; d < dimension; d++) {
+            mean[d] += samples[s][d];
+        }
+    }
+    for (double& value : mean) {
+        value /= static_cast<double>(used);
+    }
+
+    // Centered samples stored by dimension, so each covariance entry is one SIMD dot product
+    size_t sample_stride = static_cast<size_t>(VectorKernels::padded_stride(static_cast<int>(used)));
+    VectorKernels::AlignedFloatVector columns(sample_stride * dimension, 0.0f);
+    for (size_t i = 0; i < used; i++) {
+        const std::vector<float>& sample = samples[picked[i]];
+        for (int d = 0; d < dimension; d++) {
+            columns[d * sample_stride + i] = static_cast<float>(sample[d] - mean[d]);
+        }
+    }
+
+    std::vector<double> covariance(static_cast<size_t>(dimension) * dimension);
+    double total_variance = 0.0;
+    for (int i = 0; i < dimension; i++) {
+        const float* column_i = columns.data() + i * sample_stride;
+        for (int j = i; j < dimension; j++) {
+            double value = VectorKernels::dot_product(column_i, columns.data() + j * sample_stride,
+                                                      static_cast<int>(used)) /
+                           static_cast<double>(used - 1);
+            covariance[static_cast<size_t>(i) * dimension + j] = value;
+            covariance[static_cast<size_t>(j) * dimension + i] = value;
+        }
+        total_variance += covariance[static_cast<size_t>(i) * dimension + i];
+    }
+    columns = VectorKernels::AlignedFloatVector();
+
+    // Eigenvectors end up as the rows of the transposed transformation
+    std::vector<double> values(dimension), off_diagonal(dimension);
+    tridiagonalize(covariance, values, off_diagonal, dimension);
+    std::vector<double> vectors(covariance.size());
+    for (int r = 0; r < dimension; r++) {
+        for (int c = 0; c < dimension; c++) {
+            vectors[static_cast<size_t>(c) * dimension + r] = covariance[static_cast<size_t>(r) * dimension + c];
+        }
+    }
+    covariance.clear();
+    diagonalize(vectors, values, off_diagonal, dimension);
+
+    std::vector<int> order(dimension);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&values](int a, int b) { return values[a] > values[b]; });
+
+    auto projection = std::make_shared<EmbeddingProjection>();
+    projection->input_dimension = dimension;
+    projection->output_dimension = output_dimension;
+    projection->stride = VectorKernels::padded_stride(dimension);
+    projection->whiten = whiten;
+    projection->mean.assign(projection->stride, 0.0f);
+    for (int d = 0; d < dimension; d++) {
+        projection->mean[d] = static_cast<float>(mean[d]);
+    }
+
+    double kept_variance = 0.0;
+    double epsilon = WHITEN_EPSILON_FRACTION * std::max(total_variance / dimension, 1e-12);
+    projection->components.assign(static_cast<size_t>(output_dimension) * projection->stride, 0.0f);
+    for (int c = 0; c < output_dimension; c++) {
+        double variance = std::max(values[order[c]], 0.0);
+        kept_variance += variance;
+        projection->eigenvalues.push_back(static_cast<float>(variance));
+
+        double scale = whiten ? 1.0 / std::sqrt(variance + epsilon) : 1.0;
+        const double* vector = vectors.data() + static_cast<size_t>(order[c]) * dimension;
+        float* component = projection->components.data() + static_cast<size_t>(c) * projection->stride;
+        for (int d = 0; d < dimension; d++) {
+            component[d] = static_cast<float>(vector[d] * scale);
+        }
+    }
+    projection->retained_variance = (total_variance > 0.0) ? kept_variance / total_variance : 0.0;
+    return projection;
+}
+
+std::vector<float> EmbeddingProjection::project(const std::vector<float>& embedding) const {
+    if (embedding.size() != static_cast<size_t>(input_dimension)) {
+        return std::vector<float>();
+    }
+
+    VectorKernels::AlignedFloatVector centered(stride, 0.0f);
+    for (int d = 0; d < input_dimension; d++) {
+        centered[d] = embedding[d] - mean[d];
+    }
+
+    std::vector<float> projected(output_dimension);
+    double norm = 0.0;
+    for (int c = 0; c < output_dimension; c++) {
+        projected[c] = VectorKernels::dot_product(components.data() + static_cast<size_t>(c) * stride,
+                                                  centered.data(), stride);
+        norm += static_cast<double>(projected[c]) * projected[c];
+    }
+
+    // Normalized like the model output, so the index's L2-to-similarity mapping still applies
+    float inverse_norm = static_cast<float>(1.0 / std::sqrt(std::max(norm, 1e-24)));
+    for (float& value : projected) {
+        value *= inverse_norm;
+    }
+    return projected;
+}
+
+std::vector<std::vector<float>> EmbeddingProjection::project(const std::vector<std::vector<float>>& embeddings) const {
+    std::vector<std::vector<float>> projected;
+    projected.reserve(embeddings.size());
+    for (const std::vector<float>& embedding : embeddings) {
+        projected.push_back(project(embedding));
+    }
+    return projected;
+}
+
+bool EmbeddingProjection::save(const std::string& filepath, uint64_t model_hash, uint64_t index_stamp) const {
+    ProjectionFileHeader header{};
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.version = FILE_VERSION;
+    header.input_dimension = static_cast<uint32_t>(input_dimension);
+    header.output_dimension = static_cast<uint32_t>(output_dimension);
+    header.whiten = whiten ? 1 : 0;
+    header.model_hash = model_hash;
+    header.index_stamp = index_stamp;
+    header.retained_variance = retained_variance;
+
+    // Header, mean, eigenvalues, components (unpadded rows), then a checksum of all of it
+    std::vector<char> buffer;
+    auto append = [&buffer](const void* data, size_t size) {
+        buffer.insert(buffer.end(), static_cast<const char*>(data), static_cast<const char*>(data) + size);
+    };
+    append(&header, sizeof(header));
+    append(mean.data(), sizeof(float) * input_dimension);
+    append(eigenvalues.data(), sizeof(float) * output_dimension);
+    for (int c = 0; c < output_dimension; c++) {
+        append(components.data() + static_cast<size_t>(c) * stride, sizeof(float) * input_dimension);
+    }
+    uint64_t checksum = IndexFile::checksum(buffer.data(), buffer.size());
+    append(&checksum, sizeof(checksum));
+
+    // Written beside the target and renamed into place, like the index files
+    std::string temp_path = filepath + ".tmp";
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Error: Could not open " << temp_path << " for writing" << std::endl;
+        return false;
+    }
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    file.close();
+    if (!file) {
+        std::cerr << "Error: Failed writing PCA projection to " << filepath << std::endl;
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return IndexFile::replace_file(temp_path, filepath);
+}
+
+std::shared_ptr<EmbeddingProjection> EmbeddingProjection::load(const std::string& filepath, uint64_t model_hash,
+                                                               uint64_t index_stamp) {
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file) {
+        return nullptr;
+    }
+    std::vector<char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    ProjectionFileHeader header{};
+    if (buffer.size() < sizeof(header) + sizeof(uint64_t)) {
+        std::cerr << "Error: PCA projection file " << filepath << " is truncated" << std::endl;
+        return nullptr;
+    }
+    std::memcpy(&header, buffer.data(), sizeof(header));
+    if (std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || header.version != FILE_VERSION ||
+        header.input_dimension == 0 || header.output_dimension == 0 ||
+        header.output_dimension >= header.input_dimension) {
+        std::cerr << "Error: " << filepath << " is not a PCA projection file" << std::endl;
+        return nullptr;
+    }
+    if (model_hash != 0 && header.model_hash != 0 && model_hash != header.model_hash) {
+        std::cerr << "Error: PCA projection was trained for a different embedding model" << std::endl;
+        return nullptr;
+    }
+    if (index_stamp != 0 && header.index_stamp != index_stamp) {
+        // Left over from an earlier save, or the index was replaced without it
+        std::cerr << "Error: PCA projection " << filepath << " does not belong to the index file" << std::endl;
+        return nullptr;
+    }
+
+    size_t input_dimension = header.input_dimension;
+    size_t output_dimension = header.output_dimension;
+    size_t payload_size = sizeof(header) +
+                          sizeof(float) * (input_dimension + output_dimension + output_dimension * input_dimension);
+    uint64_t stored_checksum = 0;
+    if (buffer.size() != payload_size + sizeof(stored_checksum)) {
+        std::cerr << "Error: PCA projection file " << filepath << " has the wrong size" << std::endl;
+        return nullptr;
+    }
+    std::memcpy(&stored_checksum, buffer.data() + payload_size, sizeof(stored_checksum));
+    if (IndexFile::checksum(buffer.data(), payload_size) != stored_checksum) {
+        std::cerr << "Error: PCA projection file " << filepath << " failed its checksum" << std::endl;
+        return nullptr;
+    }
+
+    auto projection = std::make_shared<EmbeddingProjection>();
+    projection->input_dimension = static_cast<int>(input_dimension);
+    projection->output_dimension = static_cast<int>(output_dimension);
+    projection->stride = VectorKernels::padded_stride(projection->input_dimension);
+    projection->whiten = header.whiten != 0;
+    projection->retained_variance = header.retained_variance;
+
+    const char* cursor = buffer.data() + sizeof(header);
+    projection->mean.assign(projection->stride, 0.0f);
+    std::memcpy(projection->mean.data(), cursor, sizeof(float) * input_dimension);
+    cursor += sizeof(float) * input_dimension;
+    projection->eigenvalues.resize(output_dimension);
+    std::memcpy(projection->eigenvalues.data(), cursor, sizeof(float) * output_dimension);
+    cursor += sizeof(float) * output_dimension;
+    projection->components.assign(output_dimension * projection->stride, 0.0f);
+    for (size_t c = 0; c < output_dimension; c++) {
+        std::memcpy(projection->components.data() + c * projection->stride, cursor, sizeof(float) * input_dimension);
+        cursor += sizeof(float) * input_dimension;
+    }
+    return projection;
+}
@@ -99,6 +99,34 @@ bool FaceDatabase::initialize() {
             return false;
         }
 
+        // Create person_groups table for access groups (zones, shifts)
+        const char* sql_groups = R"(
+            CREATE TABLE IF NOT EXISTS person_groups (
+                person_id INTEGER NOT NULL,
+                group_name TEXT NOT NULL,
+                PRIMARY KEY (person_id, group_name),
+                FOREIGN KEY (person_id) REFERENCES people(id) ON DELETE CASCADE
+            )
+        )";
+
+        if (!execute_sql(sql_groups)) {
+            std::cerr << "Failed to create person_groups table" << std::endl;
+            return false;
+        }
+
+        // Create door_access_groups table: the groups this kiosk admits (kiosk
+        // configuration, so it is kept across gallery imports)
+        const char* sql_door = R"(
+            CREATE TABLE IF NOT EXISTS door_access_groups (
+                group_name TEXT PRIMARY KEY
+            )
+        )";
+
+        if (!execute_sql(sql_door)) {
+            std::cerr << "Failed to create door_access_groups table" << std::endl;
+            return false;
+        }
+
         std::cout << "Database initialized successfully" << std::endl;
         return true;
     } catch (const std::exception& e) {
@@ -378,8 +406,13 @@ bool FaceDatabase::delete_person(int id) {
     if (!is_open) return false;
 
     try {
-        std::string sql = "DELETE FROM people WHERE id = " + std::to_string(id);
-        return execute_sql(sql);
+        // Foreign keys are not enabled on the connection, so ON DELETE CASCADE
+        // never fires: remove the person's images and embeddings explicitly
+        std::string person = std::to_string(id);
+        return execute_sql("DELETE FROM face_embeddings WHERE person_id = " + person) &&
+               execute_sql("DELETE FROM face_images WHERE person_id = " + person) &&
+               execute_sql("DELETE FROM person_groups WHERE person_id = " + person) &&
+               execute_sql("DELETE FROM people WHERE id = " + person);
     } catch (const std::exception& e) {
         std::cerr << "Exception in delete_person: " << e.what() << std::endl;
         return false;
@@ -620,6 +653,192 @@ bool FaceDatabase::delete_face_embedding(int id) {
     }
 }
 
+bool FaceDatabase::delete_person_embeddings(int person_id) {
+    if (!is_open || !db) return false;
+
+    try {
+        std::string sql = "DELETE FROM face_embeddings WHERE person_id = " + std::to_string(person_id);
+        return execute_sql(sql);
+    } catch (const std::exception& e) {
+        std::cerr << "Exception in delete_person_embeddings: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool FaceDatabase::add_person_to_group(int person_id, const std::string& group) {
+    if (!is_open || !db) return false;
+
+    try {
+        const char* sql = "INSERT OR IGNORE INTO person_groups (person_id, group_name) VALUES (?, ?)";
+        sqlite3_stmt* stmt;
+
+        int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+        if (rc != SQLITE_OK) {
+            std::cerr << "Failed to prepare SQL statement: " << sqlite3_errmsg(db) << std::endl;
+            return false;
+        }
+
+        sqlite3_bind_int(stmt, 1, person_id);
+        sqlite3_bind_text(stmt, 2, group.c_str(), -1, SQLITE_STATIC);
+
+        rc = sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+
+        if (rc != SQLITE_DONE) {
+            std::cerr << "Failed to add person to group: " << sqlite3_errmsg(db) << std::endl;
+            return false;
+        }
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Exception in add_person_to_group: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool FaceDatabase::remove_person_from_group(int person_id, const std::string& group) {
+    if (!is_open || !db) return false;
+
+    try {
+        const char* sql = "DELETE FROM person_groups WHERE person_id = ? AND group_name = ?";
+        sqlite3_stmt* stmt;
+
+        int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+        if (rc != SQLITE_OK) {
+            std::cerr << "Failed to prepare SQL statement: " << sqlite3_errmsg(db) << std::endl;
+            return false;
+        }
+
+        sqlite3_bind_int(stmt, 1, person_id);
+        sqlite3_bind_text(stmt, 2, group.c_str(), -1, SQLITE_STATIC);
+
+        rc = sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+        return rc == SQLITE_DONE;
+    } catch (const std::exception& e) {
+        std::cerr << "Exception in remove_person_from_group: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool FaceDatabase::get_person_groups(int person_id, std::vector<std::string>& groups) {
+    if (!is_open || !db) return false;
+
+    try {
+        const char* sql = "SELECT group_name FROM person_groups WHERE person_id = ? ORDER BY group_name";
+        sqlite3_stmt* stmt;
+
+        int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+        if (rc != SQLITE_OK) {
+            std::cerr << "Failed to prepare SQL statement: " << sqlite3_errmsg(db) << std::endl;
+            return false;
+        }
+
+        sqlite3_bind_int(stmt, 1, person_id);
+        groups.clear();
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            groups.push_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+        }
+
+        sqlite3_finalize(stmt);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Exception in get_person_groups: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool FaceDatabase::get_all_group_members(std::vector<std::pair<int, std::string>>& memberships) {
+    if (!is_open || !db) return false;
+
+    try {
+        const char* sql = "SELECT person_id, group_name FROM person_groups ORDER BY group_name, person_id";
+        sqlite3_stmt* stmt;
+
+        int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+        if (rc != SQLITE_OK) {
+            std::cerr << "Failed to prepare SQL statement: " << sqlite3_errmsg(db) << std::endl;
+            return false;
+        }
+
+        memberships.clear();
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            memberships.emplace_back(sqlite3_column_int(stmt, 0),
+                                     reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)));
+        }
+
+        sqlite3_finalize(stmt);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Exception in get_all_group_members: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool FaceDatabase::set_access_groups(const std::vector<std::string>& groups) {
+    if (!is_open || !db) return false;
+
+    // A savepoint, so the list is replaced whole even inside another transaction
+    if (!execute_sql("SAVEPOINT door_access_groups")) {
+        return false;
+    }
+    bool ok = execute_sql("DELETE FROM door_access_groups");
+    try {
+        const char* sql = "INSERT OR IGNORE INTO door_access_groups (group_name) VALUES (?)";
+        sqlite3_stmt* stmt = nullptr;
+
+        int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+        if (ok && rc != SQLITE_OK) {
+            std::cerr << "Failed to prepare SQL statement: " << sqlite3_errmsg(db) << std::endl;
+            ok = false;
+        }
+
+        for (size_t i = 0; ok && i < groups.size(); i++) {
+            sqlite3_bind_text(stmt, 1, groups[i].c_str(), -1, SQLITE_STATIC);
+            rc = sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+            if (rc != SQLITE_DONE) {
+                std::cerr << "Failed to save door access group: " << sqlite3_errmsg(db) << std::endl;
+                ok = false;
+            }
+        }
+        sqlite3_finalize(stmt);
+    } catch (const std::exception& e) {
+        std::cerr << "Exception in set_access_groups: " << e.what() << std::endl;
+        ok = false;
+    }
+
+    if (!ok) {
+        execute_sql("ROLLBACK TO door_access_groups");
+    }
+    return execute_sql("RELEASE door_access_groups") && ok;
+}
+
+bool FaceDatabase::get_access_groups(std::vector<std::string>& groups) {
+    if (!is_open || !db) return false;
+
+    try {
+        const char* sql = "SELECT group_name FROM door_access_groups ORDER BY group_name";
+        sqlite3_stmt* stmt;
+
+        int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+        if (rc != SQLITE_OK) {
+            std::cerr << "Failed to prepare SQL statement: " << sqlite3_errmsg(db) << std::endl;
+            return false;
+        }
+
+        groups.clear();
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            groups.push_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+        }
+
+        sqlite3_finalize(stmt);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Exception in get_access_groups: " << e.what() << std::endl;
+        return false;
+    }
+}
+
 bool FaceDatabase::clear_all_embeddings() {
     if (!is_open || !db) return false;
 
@@ -680,3 +899,171 @@ bool FaceDatabase::update_face_count(int person_id) {
         return false;
     }
 }
+
+bool FaceDatabase::for_each_face_embedding(const std::function<bool(const FaceEmbedding&)>& callback) {
+    if (!is_open || !db) return false;
+
+    try {
+        const char* sql = "SELECT id, person_id, image_path, embedding_data, created_at FROM face_embeddings ORDER BY id";
+        sqlite3_stmt* stmt;
+
+        int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+        if (rc != SQLITE_OK) {
+            std::cerr << "Failed to prepare SQL statement: " << sqlite3_errmsg(db) << std::endl;
+            return false;
+        }
+
+        // One row at a time: the gallery can be far larger than memory allows
+        FaceEmbedding emb;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            emb.id = sqlite3_column_int(stmt, 0);
+            emb.person_id = sqlite3_column_int(stmt, 1);
+            const unsigned char* image_path = sqlite3_column_text(stmt, 2);
+            emb.image_path = image_path ? reinterpret_cast<const char*>(image_path) : "";
+
+            const unsigned char* blob = static_cast<const unsigned char*>(sqlite3_column_blob(stmt, 3));
+            int blob_size = sqlite3_column_bytes(stmt, 3);
+            emb.embedding_data.assign(blob, blob + blob_size);
+
+            const unsigned char* created_at = sqlite3_column_text(stmt, 4);
+            emb.created_at = created_at ? reinterpret_cast<const char*>(created_at) : "";
+            if (!callback(emb)) {
+                break;
+            }
+        }
+
+        sqlite3_finalize(stmt);
+        return rc == SQLITE_ROW || rc == SQLITE_DONE;
+    } catch (const std::exception& e) {
+        std::cerr << "Exception in for_each_face_embedding: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool FaceDatabase::begin_transaction() {
+    return execute_sql("BEGIN IMMEDIATE TRANSACTION");
+}
+
+bool FaceDatabase::commit_transaction() {
+    return execute_sql("COMMIT");
+}
+
+bool FaceDatabase::rollback_transaction() {
+    return execute_sql("ROLLBACK");
+}
+
+bool FaceDatabase::clear_gallery() {
+    if (!is_open || !db) return false;
+
+    // Children first, so nothing depends on foreign key cascades being enabled
+    return execute_sql("DELETE FROM person_groups") &&
+           execute_sql("DELETE FROM face_embeddings") &&
+           execute_sql("DELETE FROM face_images") &&
+           execute_sql("DELETE FROM people");
+}
+
+bool FaceDatabase::restore_people(const std::vector<PersonRecord>& people) {
+    if (!is_open || !db) return false;
+
+    try {
+        const char* sql = "INSERT INTO people (id, name, face_count, created_at, updated_at) VALUES (?, ?, ?, ?, ?)";
+        sqlite3_stmt* stmt;
+
+        int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+        if (rc != SQLITE_OK) {
+            std::cerr << "Failed to prepare SQL statement: " << sqlite3_errmsg(db) << std::endl;
+            return false;
+        }
+
+        // One prepared statement for the whole batch
+        for (const PersonRecord& person : people) {
+            sqlite3_bind_int(stmt, 1, person.id);
+            sqlite3_bind_text(stmt, 2, person.name.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_int(stmt, 3, person.face_count);
+            sqlite3_bind_text(stmt, 4, person.created_at.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 5, person.updated_at.c_str(), -1, SQLITE_STATIC);
+            rc = sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+            if (rc != SQLITE_DONE) {
+                std::cerr << "Failed to restore person: " << person.name << " - " << sqlite3_errmsg(db) << std::endl;
+                sqlite3_finalize(stmt);
+                return false;
+            }
+        }
+
+        sqlite3_finalize(stmt);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Exception in restore_people: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool FaceDatabase::restore_face_embeddings(const std::vector<FaceEmbedding>& embeddings) {
+    if (!is_open || !db) return false;
+
+    try {
+        const char* sql = "INSERT INTO face_embeddings (person_id, image_path, embedding_data, created_at) VALUES (?, ?, ?, ?)";
+        sqlite3_stmt* stmt;
+
+        int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+        if (rc != SQLITE_OK) {
+            std::cerr << "Failed to prepare SQL statement: " << sqlite3_errmsg(db) << std::endl;
+            return false;
+        }
+
+        for (const FaceEmbedding& emb : embeddings) {
+            sqlite3_bind_int(stmt, 1, emb.person_id);
+            sqlite3_bind_text(stmt, 2, emb.image_path.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_blob(stmt, 3, emb.embedding_data.data(), static_cast<int>(emb.embedding_data.size()),
+                              SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 4, emb.created_at.c_str(), -1, SQLITE_STATIC);
+            rc = sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+            if (rc != SQLITE_DONE) {
+                std::cerr << "Failed to restore face embedding: " << sqlite3_errmsg(db) << std::endl;
+                sqlite3_finalize(stmt);
+                return false;
+            }
+        }
+
+        sqlite3_finalize(stmt);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Exception in restore_face_embeddings: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool FaceDatabase::restore_group_members(const std::vector<std::pair<int, std::string>>& memberships) {
+    if (!is_open || !db) return false;
+
+    try {
+        const char* sql = "INSERT OR IGNORE INTO person_groups (person_id, group_name) VALUES (?, ?)";
+        sqlite3_stmt* stmt;
+
+        int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+        if (rc != SQLITE_OK) {
+            std::cerr << "Failed to prepare SQL statement: " << sqlite3_errmsg(db) << std::endl;
+            return false;
+        }
+
+        for (const auto& membership : memberships) {
+            sqlite3_bind_int(stmt, 1, membership.first);
+            sqlite3_bind_text(stmt, 2, membership.second.c_str(), -1, SQLITE_STATIC);
+            rc = sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+            if (rc != SQLITE_DONE) {
+                std::cerr << "Failed to restore group membership: " << sqlite3_errmsg(db) << std::endl;
+                sqlite3_finalize(stmt);
+                return false;
+            }
+        }
+
+        sqlite3_finalize(stmt);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Exception in restore_group_members: " << e.what() << std::endl;
+        return false;
+    }
+}
@@ -126,6 +126,31 @@ std::vector<Face> FaceDetector::detect_faces_with_id(
     return faces;
 }
 
+cv::Rect FaceDetector::largest_face_region(const cv::Mat& image) {
+    std::vector<Face> detected_faces = detect_faces(image);
+    if (detected_faces.empty()) {
+        return cv::Rect();
+    }
+
+    // Use the largest face detected (most likely the main subject)
+    cv::Rect best_face = detected_faces[0].bbox;
+    for (const auto& face : detected_faces) {
+        if (face.bbox.area() > best_face.area()) {
+            best_face = face.bbox;
+        }
+    }
+
+    // Expand the face region slightly to include some context
+    int expand_x = static_cast<int>(best_face.width * 0.1);
+    int expand_y = static_cast<int>(best_face.height * 0.1);
+    return cv::Rect(
+        std::max(0, best_face.x - expand_x),
+        std::max(0, best_face.y - expand_y),
+        std::min(image.cols - best_face.x + expand_x, best_face.width + 2 * expand_x),
+        std::min(image.rows - best_face.y + expand_y, best_face.height + 2 * expand_y)
+    );
+}
+
 void FaceDetector::set_scale_factor(double scale) {
     if (scale > 1.0) {
         scale_factor = scale;
@@ -0,0 +1,258 @@
+#include "face_preprocess.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FACE_PREPROCESS_X86 1
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define FACE_PREPROCESS_NEON 1
+#endif
+
+namespace FacePreprocess {
+
+// Horizontal sampling positions, shared by every output row
+struct Columns {
+    int32_t x0[MAX_OUTPUT_WIDTH];   // Byte offset of the left source pixel
+    int32_t x1[MAX_OUTPUT_WIDTH];   // Byte offset of the right source pixel
+    float fx[MAX_OUTPUT_WIDTH];     // Weight of the right pixel
+    int vector_end;                 // Columns before this can load 4 bytes at x1 without leaving the row
+};
+
+// One output row: source rows above and below, and the three output plane rows
+struct RowJob {
+    const uint8_t* row0;
+    const uint8_t* row1;
+    float fy;                       // Weight of row1
+    const Columns* columns;
+    int channels;
+    float inv_scale;
+    float bias;                     // -mean / scale
+    float* planes[3];               // R, G, B
+};
+
+using RowFn = void (*)(const RowJob& job, int begin, int end);
+
+// Source byte holding output plane c (R, G, B) of a pixel
+static inline int source_channel(int channels, int c) {
+    return channels == 1 ? 0 : 2 - c;
+}
+
+// The vector kernels below perform exactly these operations, in this order,
+// one lane per output column. The build does not contract a * b + c into
+// fused multiply-adds (-std=c++17 implies -ffp-contract=off), so every
+// kernel rounds identically.
+static void row_scalar(const RowJob& job, int begin, int end) {
+    const Columns& columns = *job.columns;
+    for (int x = begin; x < end; x++) {
+        int o0 = columns.x0[x];
+        int o1 = columns.x1[x];
+        float fx = columns.fx[x];
+        for (int c = 0; c < 3; c++) {
+            int s = source_channel(job.channels, c);
+            float p00 = job.row0[o0 + s];
+            float p01 = job.row0[o1 + s];
+            float p10 = job.row1[o0 + s];
+            float p11 = job.row1[o1 + s];
+            float top = p00 + fx * (p01 - p00);
+            float bottom = p10 + fx * (p11 - p10);
+            float value = top + job.fy * (bottom - top);
+            job.planes[c][x] = value * job.inv_scale + job.bias;
+        }
+    }
+}
+
+#ifdef FACE_PREPROCESS_X86
+
+// Eight columns per step: one 32-bit gather per corner fetches every channel of the pixel
+__attribute__((target("avx2")))
+static void row_avx2(const RowJob& job, int begin, int end) {
+    const Columns& columns = *job.columns;
+    const int* row0 = reinterpret_cast<const int*>(job.row0);
+    const int* row1 = reinterpret_cast<const int*>(job.row1);
+    const __m256 fy = _mm256_set1_ps(job.fy);
+    const __m256 inv_scale = _mm256_set1_ps(job.inv_scale);
+    const __m256 bias = _mm256_set1_ps(job.bias);
+    const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+
+    int x = begin;
+    int vector_end = std::min(end, columns.vector_end);
+    for (; x + 8 <= vector_end; x += 8) {
+        __m256i o0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(columns.x0 + x));
+        __m256i o1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(columns.x1 + x));
+        __m256 fx = _mm256_loadu_ps(columns.fx + x);
+        __m256i a00 = _mm256_i32gather_epi32(row0, o0, 1);
+        __m256i a01 = _mm256_i32gather_epi32(row0, o1, 1);
+        __m256i a10 = _mm256_i32gather_epi32(row1, o0, 1);
+        __m256i a11 = _mm256_i32gather_epi32(row1, o1, 1);
+
+        for (int c = 0; c < 3; c++) {
+            __m128i shift = _mm_cvtsi32_si128(8 * source_channel(job.channels, c));
+            __m256 p00 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(a00, shift), byte_mask));
+            __m256 p01 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(a01, shift), byte_mask));
+            __m256 p10 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(a10, shift), byte_mask));
+            __m256 p11 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srl_epi32(a11, shift), byte_mask));
+            __m256 top = _mm256_add_ps(p00, _mm256_mul_ps(fx, _mm256_sub_ps(p01, p00)));
+            __m256 bottom = _mm256_add_ps(p10, _mm256_mul_ps(fx, _mm256_sub_ps(p11, p10)));
+            __m256 value = _mm256_add_ps(top, _mm256_mul_ps(fy, _mm256_sub_ps(bottom, top)));
+            _mm256_storeu_ps(job.planes[c] + x, _mm256_add_ps(_mm256_mul_ps(value, inv_scale), bias));
+        }
+    }
+    row_scalar(job, x, end);
+}
+
+#endif // FACE_PREPROCESS_X86
+
+#ifdef FACE_PREPROCESS_NEON
+
+// Four columns per step; NEON has no gather, so each corner pixel is one 32-bit load
+static void row_neon(const RowJob& job, int begin, int end) {
+    const Columns& columns = *job.columns;
+    const float32x4_t fy = vdupq_n_f32(job.fy);
+    const float32x4_t inv_scale = vdupq_n_f32(job.inv_scale);
+    const float32x4_t bias = vdupq_n_f32(job.bias);
+    const uint32x4_t byte_mask = vdupq_n_u32(0xFF);
+
+    int x = begin;
+    int vector_end = std::min(end, columns.vector_end);
+    for (; x + 4 <= vector_end; x += 4) {
+        uint32_t c00[4], c01[4], c10[4], c11[4];
+        for (int i = 0; i < 4; i++) {
+            std::memcpy(&c00[i], job.row0 + columns.x0[x + i], sizeof(uint32_t));
+            std::memcpy(&c01[i], job.row0 + columns.x1[x + i], sizeof(uint32_t));
+            std::memcpy(&c10[i], job.row1 + columns.x0[x + i], sizeof(uint32_t));
+            std::memcpy(&c11[i], job.row1 + columns.x1[x + i], sizeof(uint32_t));
+        }
+        uint32x4_t a00 = vld1q_u32(c00);
+        uint32x4_t a01 = vld1q_u32(c01);
+        uint32x4_t a10 = vld1q_u32(c10);
+        uint32x4_t a11 = vld1q_u32(c11);
+        float32x4_t fx = vld1q_f32(columns.fx + x);
+
+        for (int c = 0; c < 3; c++) {
+            int32x4_t shift = vdupq_n_s32(-8 * source_channel(job.channels, c));
+            float32x4_t p00 = vcvtq_f32_u32(vandq_u32(vshlq_u32(a00, shift), byte_mask));
+            float32x4_t p01 = vcvtq_f32_u32(vandq_u32(vshlq_u32(a01, shift), byte_mask));
+            float32x4_t p10 = vcvtq_f32_u32(vandq_u32(vshlq_u32(a10, shift), byte_mask));
+            float32x4_t p11 = vcvtq_f32_u32(vandq_u32(vshlq_u32(a11, shift), byte_mask));
+            float32x4_t top = vaddq_f32(p00, vmulq_f32(fx, vsubq_f32(p01, p00)));
+            float32x4_t bottom = vaddq_f32(p10, vmulq_f32(fx, vsubq_f32(p11, p10)));
+            float32x4_t value = vaddq_f32(top, vmulq_f32(fy, vsubq_f32(bottom, top)));
+            vst1q_f32(job.planes[c] + x, vaddq_f32(vmulq_f32(value, inv_scale), bias));
+        }
+    }
+    row_scalar(job, x, end);
+}
+
+#endif // FACE_PREPROCESS_NEON
+
+// Source pixel pair and weight for output position i (OpenCV INTER_LINEAR geometry)
+static void sample_position(int i, double ratio, int size, int& first, int& second, float& weight) {
+    double position = (i + 0.5) * ratio - 0.5;
+    first = static_cast<int>(std::floor(position));
+    weight = static_cast<float>(position - first);
+    if (first < 0) {
+        first = 0;
+        weight = 0.0f;
+    }
+    if (first >= size - 1) {
+        first = size - 1;
+        weight = 0.0f;
+    }
+    second = std::min(first + 1, size - 1);
+}
+
+static bool run(const SourceImage& source, float* chw, int out_width, int out_height,
+                float mean, float scale, RowFn row_fn) {
+    if (!source.data || source.width <= 0 || source.height <= 0 ||
+        (source.channels != 1 && source.channels != 3 && source.channels != 4) ||
+        source.stride < static_cast<size_t>(source.width) * source.channels) {
+        std::cerr << "Error: Unsupported face image (" << source.width << "x" << source.height
+                  << ", " << source.channels << " channels)" << std::endl;
+        return false;
+    }
+    if (out_width <= 0 || out_width > MAX_OUTPUT_WIDTH || out_height <= 0 || scale == 0.0f) {
+        std::cerr << "Error: Unsupported model input size " << out_width << "x" << out_height << std::endl;
+        return false;
+    }
+
+    Columns columns;
+    int row_bytes = source.width * source.channels;
+    columns.vector_end = out_width;
+    double ratio_x = static_cast<double>(source.width) / out_width;
+    for (int x = 0; x < out_width; x++) {
+        int x0, x1;
+        sample_position(x, ratio_x, source.width, x0, x1, columns.fx[x]);
+        columns.x0[x] = x0 * source.channels;
+        columns.x1[x] = x1 * source.channels;
+        // Offsets only grow with x, so the first column that would read past the row ends the prefix
+        if (columns.vector_end == out_width && columns.x1[x] + 4 > row_bytes) {
+            columns.vector_end = x;
+        }
+    }
+
+    RowJob job;
+    job.columns = &columns;
+    job.channels = source.channels;
+    job.inv_scale = 1.0f / scale;
+    job.bias = -mean / scale;
+
+    size_t plane_size = static_cast<size_t>(out_width) * out_height;
+    double ratio_y = static_cast<double>(source.height) / out_height;
+    for (int y = 0; y < out_height; y++) {
+        int y0, y1;
+        sample_position(y, ratio_y, source.height, y0, y1, job.fy);
+        job.row0 = source.data + static_cast<size_t>(y0) * source.stride;
+        job.row1 = source.data + static_cast<size_t>(y1) * source.stride;
+        for (int c = 0; c < 3; c++) {
+            job.planes[c] = chw + c * plane_size + static_cast<size_t>(y) * out_width;
+        }
+        row_fn(job, 0, out_width);
+    }
+    return true;
+}
+
+static RowFn select_row_fn() {
+#ifdef FACE_PREPROCESS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return row_avx2;
+    }
+#endif
+#ifdef FACE_PREPROCESS_NEON
+    return row_neon;
+#endif
+    return row_scalar;
+}
+
+static RowFn get_row_fn() {
+    // Resolved once, thread-safe static initialization
+    static const RowFn fn = select_row_fn();
+    return fn;
+}
+
+bool preprocess(const SourceImage& source, float* chw, int out_width, int out_height, float mean, float scale) {
+    return run(source, chw, out_width, out_height, mean, scale, get_row_fn());
+}
+
+bool preprocess_scalar(const SourceImage& source, float* chw, int out_width, int out_height,
+                       float mean, float scale) {
+    return run(source, chw, out_width, out_height, mean, scale, row_scalar);
+}
+
+const char* get_active_isa() {
+    RowFn fn = get_row_fn();
+#ifdef FACE_PREPROCESS_X86
+    if (fn == row_avx2) return "avx2";
+#endif
+#ifdef FACE_PREPROCESS_NEON
+    if (fn == row_neon) return "neon";
+#endif
+    (void)fn;
+    return "scalar";
+}
+
+} // namespace FacePreprocess
@@ -1,11 +1,26 @@
 #include "faiss_index.h"
+#include "top_k.h"
+#include "scan_pool.h"
 #include <iostream>
 #include <cmath>
 #include <algorithm>
 #include <cstring>
 #include <fstream>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+#include <random>
+#include <chrono>
+#include <stdexcept>
+#include <functional>
+#include <cstdio>
 
-FAISSIndex::FAISSIndex(int embedding_dimension) : dimension(embedding_dimension) {}
+FAISSIndex::FAISSIndex(int embedding_dimension, Config::IndexStorage storage_mode)
+    : dimension(embedding_dimension),
+      stride(VectorKernels::padded_stride(embedding_dimension)),
+      storage(storage_mode) {
+    reset_quantizer();
+}
 
 FAISSIndex::~FAISSIndex() {
     clear();
@@ -22,9 +37,10 @@ int FAISSIndex::calculate_optimal_clusters(int num_vectors) {
 }
 
 void FAISSIndex::setup_index_parameters() {
-    if (!index) return;
-    num_clusters = calculate_optimal_clusters(1000);
-    std::cout << "FAISS index setup - Clusters: " << num_clusters << std::endl;
+    if (!is_built) return;
+    std::cout << "FAISS index setup - Clusters: " << num_clusters
+              << ", nprobe: " << get_probe_count()
+              << (is_ivf_trained() ? " (IVF)" : " (exact scan)") << std::endl;
 }
 
 bool FAISSIndex::build_index(int num_vectors) {
@@ -34,22 +50,43 @@ bool FAISSIndex::build_index(int num_vectors) {
     }
 
     try {
-        // Simple approach: allocate embeddings storage
-        // index pointer is just a marker that we're initialized
-        index = (void*)1;  // Non-null to indicate initialized
+        is_built = false;
+        log_sequence = 0;
+        mapping.reset();
+        rows_mapped = false;
+        codes_mapped = false;
+        matrix.clear();
+        half_codes.clear();
+        byte_codes.clear();
+        norms.clear();
         person_ids.clear();
+        directory.clear();
+        prototypes.clear();
+        prototype_person.clear();
+        num_retired_prototypes = 0;
+        prototypes_mapped = false;
+        mapped_prototypes = nullptr;
+        reset_ivf();
+        reset_quantizer();
+        sync_views();
+
+        if (is_quantized() && !open_float_rows()) {
+            return false;
+        }
 
-        // Calculate optimal number of clusters
+        // Calculate optimal number of clusters (used once IVF is trained)
         num_clusters = calculate_optimal_clusters(num_vectors);
+        is_built = true;
 
         setup_index_parameters();
 
         std::cout << "FAISS index built successfully"
                   << " - Vectors: " << num_vectors
                   << ", Dimension: " << dimension
-                  << ", Clusters: " << num_clusters << std::endl;
-
-        is_built = true;
+                  << ", Clusters: " << num_clusters
+                  << ", Storage: " << get_storage_name()
+                  << ", Kernel: " << VectorKernels::get_active_isa()
+                  << ", Scan threads: " << ScanPool::shared()->get_num_threads() << std::endl;
         return true;
 
     } catch (const std::exception& e) {
@@ -59,7 +96,7 @@ bool FAISSIndex::build_index(int num_vectors) {
 }
 
 bool FAISSIndex::add_vector(int person_id, const std::vector<float>& embedding) {
-    if (!index) {
+    if (!is_built) {
         std::cerr << "Error: Index not built" << std::endl;
         return false;
     }
@@ -71,9 +108,10 @@ bool FAISSIndex::add_vector(int person_id, const std::vector<float>& embedding)
     }
 
     try {
-        // Store embedding - simple approach
-        embeddings.push_back(embedding);
-        person_ids.push_back(person_id);
+        append_row(person_id, embedding.data());
+        if (keeps_prototypes()) {
+            refresh_prototype(person_id);
+        }
         return true;
 
     } catch (const std::exception& e) {
@@ -84,7 +122,7 @@ bool FAISSIndex::add_vector(int person_id, const std::vector<float>& embedding)
 
 bool FAISSIndex::add_vectors(const std::vector<int>& ids,
                              const std::vector<std::vector<float>>& emb) {
-    if (!index) {
+    if (!is_built) {
         std::cerr << "Error: Index not built" << std::endl;
         return false;
     }
@@ -95,14 +133,39 @@ bool FAISSIndex::add_vectors(const std::vector<int>& ids,
     }
 
     try {
-        // Add all vectors at once
         for (size_t i = 0; i < emb.size(); i++) {
             if (emb[i].size() != static_cast<size_t>(dimension)) {
                 std::cerr << "Error: Embedding dimension mismatch" << std::endl;
                 return false;
             }
-            embeddings.push_back(emb[i]);
-            person_ids.push_back(ids[i]);
+        }
+
+        // Grow the matrix (or code buffer) once, then copy rows in
+        materialize();
+        size_t total_rows = person_ids.size() + emb.size();
+        if (storage == Config::IndexStorage::FP16) {
+            half_codes.reserve(total_rows * stride);
+        } else if (storage == Config::IndexStorage::INT8) {
+            byte_codes.reserve(total_rows * stride);
+        } else {
+            matrix.reserve(total_rows * stride);
+        }
+        norms.reserve(total_rows);
+        person_ids.reserve(total_rows);
+        sync_views();
+
+        for (size_t i = 0; i < emb.size(); i++) {
+            append_row(ids[i], emb[i].data());
+        }
+
+        // One new prototype per person in the batch, not one per row
+        if (keeps_prototypes()) {
+            std::vector<int> people(ids);
+            std::sort(people.begin(), people.end());
+            people.erase(std::unique(people.begin(), people.end()), people.end());
+            for (int person_id : people) {
+                refresh_prototype(person_id);
+            }
         }
 
         return true;
@@ -113,47 +176,728 @@ bool FAISSIndex::add_vectors(const std::vector<int>& ids,
     }
 }
 
-double FAISSIndex::distance_to_similarity(float distance) const {
-    // For ArcFace with L2-normalized embeddings:
-    // L2 distance range: [0, 2] where 0 = identical, 2 = opposite
-    //
-    // Typical thresholds for face recognition:
-    // - Same person: distance < 1.0 (similarity > 0.75)
-    // - Different person: distance > 1.2 (similarity < 0.64)
-    //
-    // Using cosine similarity derived from L2 distance:
-    // d² = 2 - 2·cos(θ)  =>  cos(θ) = 1 - d²/2
-    // Then map cos(θ) from [-1, 1] to [0, 1]
+void FAISSIndex::append_row(int person_id, const float* embedding) {
+    // A mapped index is read-only: copy it into owned buffers on first write
+    materialize();
+
+    // Rows are zero-padded up to stride so kernels never read past the data
+    size_t row_index = person_ids.size();
+    const float* padded = nullptr;
+
+    if (is_quantized()) {
+        // Codes stay in RAM; the float row goes to the spill file for rerank
+        if (!float_rows->write_row(row_index, embedding)) {
+            throw std::runtime_error("could not spill float row");
+        }
+        row_scratch.assign(stride, 0.0f);
+        std::memcpy(row_scratch.data(), embedding, sizeof(float) * dimension);
+        padded = row_scratch.data();
+
+        void* codes = nullptr;
+        if (storage == Config::IndexStorage::FP16) {
+            codes = half_codes.append(stride);
+        } else {
+            codes = byte_codes.append(stride);
+        }
+        sync_views();
+        encode_row(padded, codes);
+    } else {
+        float* new_row = matrix.append(stride);
+        std::memcpy(new_row, embedding, sizeof(float) * dimension);
+        padded = new_row;
+        sync_views();
+    }
+
+    norms.push_back(VectorKernels::dot_product(padded, padded, stride));
+    person_ids.push_back(person_id);
+    directory.add(person_id, row_index);
+
+    // Keep posting lists current for vectors added after IVF training
+    if (is_ivf_trained()) {
+        inverted_lists[nearest_centroid(padded)].push_back(static_cast<int>(row_index));
+    }
+}
+
+void FAISSIndex::sync_views() {
+    if (!rows_mapped) {
+        matrix_rows = matrix.data();
+    }
+    if (!codes_mapped) {
+        half_rows = half_codes.data();
+        byte_rows = byte_codes.data();
+    }
+}
+
+void FAISSIndex::materialize() {
+    if (!mapping) {
+        return;
+    }
+
+    size_t num_rows = person_ids.size();
+    size_t row_count = num_rows * stride;
+    if (rows_mapped) {
+        if (storage == Config::IndexStorage::FLOAT32) {
+            matrix.assign(matrix_rows, matrix_rows + row_count);
+        } else {
+            if (!open_float_rows()) {
+                throw std::runtime_error("could not open row spill file");
+            }
+            for (size_t i = 0; i < num_rows; i++) {
+                if (!float_rows->write_row(i, row(i))) {
+                    throw std::runtime_error("could not spill float row");
+                }
+            }
+        }
+    }
+    if (codes_mapped) {
+        if (storage == Config::IndexStorage::FP16) {
+            half_codes.assign(half_rows, half_rows + row_count);
+        } else {
+            byte_codes.assign(byte_rows, byte_rows + row_count);
+        }
+    }
+
+    own_prototypes();
+
+    rows_mapped = false;
+    codes_mapped = false;
+    matrix_rows = nullptr;
+    mapping.reset();
+    sync_views();
+}
+
+bool FAISSIndex::open_float_rows() {
+    // Never reopen a store in place: copies made by clone() may still read it
+    float_rows = std::make_shared<DiskRowStore>();
+    return float_rows->open(Config::INDEX_SPILL_DIRECTORY, sizeof(float) * dimension);
+}
+
+std::unique_ptr<VectorIndexBase> FAISSIndex::clone() const {
+    // Owned buffers are copied. The file mapping and the spill file are
+    // shared: both are only read or appended past the rows this copy holds.
+    auto copy = std::make_unique<FAISSIndex>(*this);
+    copy->sync_views();
+    return copy;
+}
+
+void FAISSIndex::reset_quantizer() {
+    // Default int8 range [-1, 1] covers any L2-normalized embedding until fitted
+    int8_scale.assign(stride, 0.0f);
+    int8_offset.assign(stride, 0.0f);
+    for (int d = 0; d < dimension; d++) {
+        int8_scale[d] = 2.0f / 255.0f;
+        int8_offset[d] = -1.0f;
+    }
+    int8_trained_size = 0;
+}
+
+void FAISSIndex::encode_row(const float* vec, void* destination) const {
+    if (storage == Config::IndexStorage::FP16) {
+        uint16_t* codes = static_cast<uint16_t*>(destination);
+        for (int d = 0; d < stride; d++) {
+            codes[d] = VectorKernels::float_to_half(vec[d]);
+        }
+        return;
+    }
+
+    uint8_t* codes = static_cast<uint8_t*>(destination);
+    for (int d = 0; d < stride; d++) {
+        if (int8_scale[d] <= 0.0f) {
+            codes[d] = 0;
+            continue;
+        }
+        float level = std::round((vec[d] - int8_offset[d]) / int8_scale[d]);
+        codes[d] = static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, level)));
+    }
+}
+
+void* FAISSIndex::mutable_code_row(size_t i) {
+    // Rewriting codes that a clone() may be reading needs a private copy first
+    if (storage == Config::IndexStorage::FP16) {
+        return half_codes.mutable_data() + i * stride;
+    }
+    return byte_codes.mutable_data() + i * stride;
+}
+
+const float* FAISSIndex::training_row(size_t i, float* scratch) const {
+    // Clustering only needs approximate rows, so quantized modes decode codes
+    if (storage == Config::IndexStorage::FLOAT32) {
+        return row(i);
+    }
+
+    if (storage == Config::IndexStorage::FP16) {
+        const uint16_t* codes = half_rows + i * stride;
+        for (int d = 0; d < stride; d++) {
+            scratch[d] = VectorKernels::half_to_float(codes[d]);
+        }
+    } else {
+        const uint8_t* codes = byte_rows + i * stride;
+        for (int d = 0; d < stride; d++) {
+            scratch[d] = int8_offset[d] + int8_scale[d] * codes[d];
+        }
+    }
+    return scratch;
+}
+
+bool FAISSIndex::read_float_row(size_t i, float* out) const {
+    if (has_float_rows_in_memory()) {
+        std::memcpy(out, row(i), sizeof(float) * dimension);
+        return true;
+    }
+    return float_rows && float_rows->read_row(i, out);
+}
+
+bool FAISSIndex::needs_int8_training() const {
+    size_t num_rows = person_ids.size();
+    if (storage != Config::IndexStorage::INT8 ||
+        num_rows < static_cast<size_t>(Config::INT8_MIN_TRAINING_VECTORS)) {
+        return false;
+    }
+    // Refit once the gallery has doubled since the ranges were fitted
+    return int8_trained_size == 0 || num_rows >= 2 * int8_trained_size;
+}
+
+bool FAISSIndex::train_int8_ranges() {
+    if (storage != Config::IndexStorage::INT8 || person_ids.empty()) {
+        return false;
+    }
+
+    try {
+        auto start_time = std::chrono::steady_clock::now();
+        materialize();  // Codes are rewritten in place
+        size_t num_rows = person_ids.size();
+        VectorKernels::AlignedFloatVector vec(stride, 0.0f);
+
+        // Per-dimension min/max over the exact float rows
+        std::vector<float> low(dimension, std::numeric_limits<float>::max());
+        std::vector<float> high(dimension, std::numeric_limits<float>::lowest());
+        for (size_t i = 0; i < num_rows; i++) {
+            if (!read_float_row(i, vec.data())) {
+                return false;
+            }
+            for (int d = 0; d < dimension; d++) {
+                low[d] = std::min(low[d], vec[d]);
+                high[d] = std::max(high[d], vec[d]);
+            }
+        }
+
+        for (int d = 0; d < dimension; d++) {
+            float range = std::max(high[d] - low[d], 1e-6f);
+            int8_scale[d] = range / 255.0f;
+            int8_offset[d] = low[d];
+        }
+
+        // Re-encode every row with the fitted ranges
+        for (size_t i = 0; i < num_rows; i++) {
+            if (!read_float_row(i, vec.data())) {
+                return false;
+            }
+            encode_row(vec.data(), mutable_code_row(i));
+        }
+        sync_views();
+        int8_trained_size = num_rows;
+
+        auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time).count();
+        std::cout << "FAISS int8 ranges fitted - Vectors: " << num_rows
+                  << ", Time: " << elapsed_ms << "ms" << std::endl;
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error fitting int8 ranges: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool FAISSIndex::needs_training() const {
+    return needs_int8_training() || needs_ivf_training();
+}
+
+bool FAISSIndex::train() {
+    // Ranges first: IVF clustering runs on the decoded codes
+    bool success = true;
+    if (needs_int8_training()) {
+        success = train_int8_ranges();
+    }
+    if (needs_ivf_training()) {
+        success = train_ivf() && success;
+    }
+    return success;
+}
+
+const char* FAISSIndex::get_storage_name() const {
+    switch (storage) {
+        case Config::IndexStorage::FP16: return "fp16";
+        case Config::IndexStorage::INT8: return "int8";
+        case Config::IndexStorage::FLOAT32:
+        default: return "float32";
+    }
+}
+
+size_t FAISSIndex::get_memory_bytes() const {
+    size_t bytes = matrix.capacity() * sizeof(float)
+                 + half_codes.capacity() * sizeof(uint16_t)
+                 + byte_codes.capacity() * sizeof(uint8_t)
+                 + norms.capacity() * sizeof(float)
+                 + person_ids.capacity() * sizeof(int)
+                 + centroids.capacity() * sizeof(float)
+                 + prototypes.capacity() * sizeof(float)
+                 + prototype_person.capacity() * sizeof(int);
+    for (const auto& list : inverted_lists) {
+        bytes += list.capacity() * sizeof(int);
+    }
+    return bytes;
+}
+
+void FAISSIndex::reset_ivf() {
+    centroids.clear();
+    centroid_norms.clear();
+    inverted_lists.clear();
+    ivf_trained_size = 0;
+}
+
+bool FAISSIndex::needs_ivf_training() const {
+    size_t num_rows = person_ids.size();
+    if (!Config::IVF_ENABLED || num_rows < static_cast<size_t>(Config::IVF_MIN_VECTORS)) {
+        return false;
+    }
+    // Retrain once the gallery has doubled since the centroids were fitted
+    return !is_ivf_trained() || num_rows >= 2 * ivf_trained_size;
+}
+
+int FAISSIndex::get_probe_count() const {
+    if (nprobe > 0) {
+        return nprobe;
+    }
+    return std::max(1, static_cast<int>(std::ceil(num_clusters * Config::IVF_PROBE_FRACTION)));
+}
+
+void FAISSIndex::compute_centroid_norms() {
+    centroid_norms.resize(num_clusters);
+    for (int c = 0; c < num_clusters; c++) {
+        const float* centroid = centroids.data() + static_cast<size_t>(c) * stride;
+        centroid_norms[c] = VectorKernels::dot_product(centroid, centroid, stride);
+    }
+}
+
+int FAISSIndex::nearest_centroid(const float* vec) const {
+    VectorKernels::DotProductFn dot = VectorKernels::get_dot_product_fn();
+    float best_score = -std::numeric_limits<float>::infinity();
+    int best = 0;
+    for (int c = 0; c < num_clusters; c++) {
+        const float* centroid = centroids.data() + static_cast<size_t>(c) * stride;
+        float score = 2.0f * dot(vec, centroid, stride) - centroid_norms[c];
+        if (score > best_score) {
+            best_score = score;
+            best = c;
+        }
+    }
+    return best;
+}
+
+bool FAISSIndex::train_ivf(int nlist) {
+    if (!is_built) {
+        std::cerr << "Error: Index not built" << std::endl;
+        return false;
+    }
+
+    size_t num_rows = person_ids.size();
+    if (nlist <= 0) {
+        nlist = calculate_optimal_clusters(static_cast<int>(num_rows));
+    }
+    if (num_rows < static_cast<size_t>(nlist)) {
+        std::cerr << "Error: Not enough vectors (" << num_rows
+                  << ") to train " << nlist << " IVF clusters" << std::endl;
+        return false;
+    }
+
+    try {
+        auto start_time = std::chrono::steady_clock::now();
+
+        // Train on a bounded random sample; all rows are assigned afterwards
+        std::mt19937 rng(1234);
+        std::vector<int> sample(num_rows);
+        std::iota(sample.begin(), sample.end(), 0);
+        std::shuffle(sample.begin(), sample.end(), rng);
+        size_t max_points = static_cast<size_t>(nlist) * Config::IVF_MAX_TRAINING_POINTS_PER_CLUSTER;
+        if (sample.size() > max_points) {
+            sample.resize(max_points);
+        }
+
+        // Initialize centroids from distinct random gallery rows
+        VectorKernels::AlignedFloatVector scratch(stride, 0.0f);
+        inverted_lists.clear();
+        num_clusters = nlist;
+        centroids.assign(static_cast<size_t>(nlist) * stride, 0.0f);
+        for (int c = 0; c < nlist; c++) {
+            std::memcpy(centroids.data() + static_cast<size_t>(c) * stride,
+                        training_row(sample[c], scratch.data()), sizeof(float) * stride);
+        }
+        compute_centroid_norms();
+
+        // Lloyd iterations
+        std::vector<int> assignment(sample.size());
+        std::vector<double> sums(static_cast<size_t>(nlist) * dimension);
+        std::vector<int> counts(nlist);
+        for (int iter = 0; iter < Config::IVF_TRAINING_ITERATIONS; iter++) {
+            std::fill(sums.begin(), sums.end(), 0.0);
+            std::fill(counts.begin(), counts.end(), 0);
+
+            for (size_t s = 0; s < sample.size(); s++) {
+                const float* vec = training_row(sample[s], scratch.data());
+                int c = nearest_centroid(vec);
+                assignment[s] = c;
+                counts[c]++;
+                double* sum = sums.data() + static_cast<size_t>(c) * dimension;
+                for (int d = 0; d < dimension; d++) {
+                    sum[d] += vec[d];
+                }
+            }
+
+            int largest = static_cast<int>(std::max_element(counts.begin(), counts.end()) - counts.begin());
+            for (int c = 0; c < nlist; c++) {
+                float* centroid = centroids.data() + static_cast<size_t>(c) * stride;
+                if (counts[c] == 0) {
+                    // Empty cluster: re-seed it from a member of the largest cluster
+                    for (size_t s = 0; s < sample.size(); s++) {
+                        if (assignment[s] == largest) {
+                            std::memcpy(centroid, training_row(sample[s], scratch.data()),
+                                        sizeof(float) * stride);
+                            assignment[s] = c;
+                            break;
+                        }
+                    }
+                    continue;
+                }
+                const double* sum = sums.data() + static_cast<size_t>(c) * dimension;
+                for (int d = 0; d < dimension; d++) {
+                    centroid[d] = static_cast<float>(sum[d] / counts[c]);
+                }
+            }
+            compute_centroid_norms();
+        }
+
+        // Assign every gallery row to its posting list
+        inverted_lists.assign(nlist, std::vector<int>());
+        for (size_t i = 0; i < num_rows; i++) {
+            inverted_lists[nearest_centroid(training_row(i, scratch.data()))].push_back(static_cast<int>(i));
+        }
+        ivf_trained_size = num_rows;
+
+        auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time).count();
+        std::cout << "FAISS IVF trained - Vectors: " << num_rows
+                  << ", Clusters: " << nlist
+                  << ", Training sample: " << sample.size()
+                  << ", Time: " << elapsed_ms << "ms" << std::endl;
+        setup_index_parameters();
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error training IVF index: " << e.what() << std::endl;
+        inverted_lists.clear();
+        return false;
+    }
+}
+
+std::vector<int> FAISSIndex::probe_lists(const float* query) const {
+    VectorKernels::DotProductFn dot = VectorKernels::get_dot_product_fn();
+    std::vector<std::pair<float, int>> scores(num_clusters);
+    for (int c = 0; c < num_clusters; c++) {
+        const float* centroid = centroids.data() + static_cast<size_t>(c) * stride;
+        scores[c] = {2.0f * dot(query, centroid, stride) - centroid_norms[c], c};
+    }
+
+    int probes = std::min(get_probe_count(), num_clusters);
+    std::partial_sort(scores.begin(), scores.begin() + probes, scores.end(),
+                      [](const std::pair<float, int>& a, const std::pair<float, int>& b) {
+                          return a.first > b.first;
+                      });
+
+    std::vector<int> lists(probes);
+    for (int p = 0; p < probes; p++) {
+        lists[p] = scores[p].second;
+    }
+    return lists;
+}
+
+bool FAISSIndex::scores_allowed_rows_directly(const PersonFilter& filter) const {
+    return filter.count() <= Config::FILTER_DIRECT_SCAN_FRACTION * directory.get_num_people();
+}
+
+template <typename Visitor>
+void FAISSIndex::for_each_candidate(const float* query, const PersonFilter* filter, Visitor&& visit) const {
+    // A filter naming few people: visit just their rows, exactly, even with IVF.
+    // Directory rows are live, so no tombstone check is needed.
+    if (filter && scores_allowed_rows_directly(*filter)) {
+        filter->for_each([&](int person_id) {
+            directory.for_each_slot(person_id, visit);
+        });
+        return;
+    }
+
+    // Probing every list is an exact search; the flat scan is cheaper then
+    // Tombstoned rows (deleted people) and rows outside the filter are skipped
+    if (is_ivf_trained() && get_probe_count() < num_clusters) {
+        for (int list : probe_lists(query)) {
+            for (int i : inverted_lists[list]) {
+                if (!directory.is_deleted(static_cast<size_t>(i)) && (!filter || filter->allows(person_ids[i]))) {
+                    visit(static_cast<size_t>(i));
+                }
+            }
+        }
+        return;
+    }
+
+    size_t num_rows = person_ids.size();
+    for (size_t i = 0; i < num_rows; i++) {
+        if (!directory.is_deleted(i) && (!filter || filter->allows(person_ids[i]))) {
+            visit(i);
+        }
+    }
+}
+
+bool FAISSIndex::scans_in_parallel(const PersonFilter* filter, const ScanPool& pool) const {
+    // Only the full scan is split: direct-scored filters and probed lists are already small
+    bool full_scan = !(filter && scores_allowed_rows_directly(*filter)) && !(is_ivf_trained() && get_probe_count() < num_clusters);
+    return full_scan && pool.get_num_threads() > 1 &&
+           person_ids.size() >= static_cast<size_t>(Config::PARALLEL_SCAN_MIN_ROWS);
+}
+
+size_t FAISSIndex::rows_per_partition() const {
+    return std::max<size_t>(1, static_cast<size_t>(Config::SCAN_PARTITION_BYTES) / (sizeof(float) * stride));
+}
+
+template <typename Score>
+std::vector<std::pair<float, int>> FAISSIndex::nearest_candidates(const float* query, const PersonFilter* filter,
+                                                                  size_t k, Score&& score) const {
+    // Small galleries: one bounded heap on the calling thread
+    std::shared_ptr<ScanPool> pool = ScanPool::shared();
+    if (!scans_in_parallel(filter, *pool)) {
+        TopKSelector nearest(k);
+        for_each_candidate(query, filter, [&](size_t i) {
+            nearest.push(score(i), static_cast<int>(i));
+        });
+        return nearest.take_sorted();
+    }
+
+    // Each thread keeps the top k of the partitions it scanned; the caller merges them
+    size_t num_rows = person_ids.size();
+    size_t partition_rows = rows_per_partition();
+    size_t num_partitions = (num_rows + partition_rows - 1) / partition_rows;
+    std::vector<TopKSelector> per_thread(static_cast<size_t>(pool->get_num_threads()), TopKSelector(k));
+    pool->run(num_partitions, [&](size_t partition, int slot) {
+        TopKSelector& nearest = per_thread[slot];
+        size_t end = std::min(num_rows, (partition + 1) * partition_rows);
+        for (size_t i = partition * partition_rows; i < end; i++) {
+            if (!directory.is_deleted(i) && (!filter || filter->allows(person_ids[i]))) {
+                nearest.push(score(i), static_cast<int>(i));
+            }
+        }
+    });
+
+    TopKSelector merged(k);
+    for (TopKSelector& nearest : per_thread) {
+        for (const TopKSelector::Entry& entry : nearest.take_sorted()) {
+            merged.push(entry.first, entry.second);
+        }
+    }
+    return merged.take_sorted();
+}
+
+bool FAISSIndex::uses_prototypes(int k) const {
+    size_t people = directory.get_num_people();
+    if (!keeps_prototypes() || k <= 0 || people == 0 || prototype_person.empty()) {
+        return false;
+    }
+    double rows_per_person = static_cast<double>(person_ids.size() - directory.get_num_deleted()) / people;
+    if (rows_per_person < Config::PROTOTYPE_MIN_ROWS_PER_PERSON) {
+        return false;
+    }
+
+    // Rows scored: every prototype plus the reranked people's rows, against the scan or the probed lists
+    size_t reranked = std::min(people, static_cast<size_t>(std::max(k, Config::PROTOTYPE_RERANK_PEOPLE)));
+    double prototype_cost = static_cast<double>(prototype_person.size()) + reranked * rows_per_person;
+    double scan_cost = static_cast<double>(person_ids.size());
+    if (is_ivf_trained() && get_probe_count() < num_clusters) {
+        scan_cost = scan_cost * get_probe_count() / num_clusters + num_clusters;
+    }
+    return prototype_cost < scan_cost;
+}
+
+void FAISSIndex::refresh_prototype(int person_id) {
+    retire_prototype(person_id);
+
+    // Mean of the normalized rows, so a badly exposed capture does not dominate
+    VectorKernels::AlignedFloatVector sum(stride, 0.0f);
+    size_t count = 0;
+    directory.for_each_slot(person_id, [&](size_t slot) {
+        const float* r = row(slot);
+        float inverse_norm = 1.0f / std::sqrt(std::max(norms[slot], std::numeric_limits<float>::min()));
+        for (int d = 0; d < dimension; d++) {
+            sum[d] += r[d] * inverse_norm;
+        }
+        count++;
+    });
+    float sum_norm = VectorKernels::dot_product(sum.data(), sum.data(), stride);
+    if (count == 0 || sum_norm <= 0.0f) {
+        return;
+    }
 
-    float d_squared = distance * distance;
+    float scale = 1.0f / std::sqrt(sum_norm);
+    own_prototypes();
+    float* prototype = prototypes.append(stride);
+    for (int d = 0; d < dimension; d++) {
+        prototype[d] = sum[d] * scale;
+    }
+    directory.set_prototype(person_id, static_cast<int>(prototype_person.size()));
+    prototype_person.push_back(person_id);
 
-    // Clamp d² to valid range [0, 4] for normalized vectors
-    d_squared = std::min(d_squared, 4.0f);
+    // Once most prototypes are retired, the stage-one scan is mostly skipping: start over
+    if (num_retired_prototypes > 64 && num_retired_prototypes * 2 > prototype_person.size()) {
+        rebuild_prototypes();
+    }
+}
 
-    float cos_theta = 1.0f - (d_squared / 2.0f);
+void FAISSIndex::retire_prototype(int person_id) {
+    // The directory keeps a deleted person's entry, so check the slot is really theirs
+    int slot = directory.prototype_of(person_id);
+    if (slot >= 0 && static_cast<size_t>(slot) < prototype_person.size() && prototype_person[slot] == person_id) {
+        prototype_person[slot] = -1;
+        num_retired_prototypes++;
+    }
+    directory.set_prototype(person_id, -1);
+}
+
+void FAISSIndex::rebuild_prototypes() {
+    prototypes.clear();
+    prototype_person.clear();
+    num_retired_prototypes = 0;
+    prototypes_mapped = false;
+    mapped_prototypes = nullptr;
+    if (!keeps_prototypes() || !matrix_rows) {
+        return;
+    }
+
+    std::vector<int> people;
+    people.reserve(directory.get_num_people());
+    directory.for_each_person([&](int person_id) { people.push_back(person_id); });
+    prototypes.reserve(people.size() * stride);
+    prototype_person.reserve(people.size());
+    for (int person_id : people) {
+        directory.set_prototype(person_id, -1);  // Slots of the old buffer
+        refresh_prototype(person_id);
+    }
+}
+
+void FAISSIndex::own_prototypes() {
+    if (prototypes_mapped) {
+        prototypes.assign(mapped_prototypes, mapped_prototypes + prototype_person.size() * stride);
+        prototypes_mapped = false;
+        mapped_prototypes = nullptr;
+    }
+}
+
+bool FAISSIndex::map_prototypes(const float* rows, const int32_t* persons, size_t count) {
+    // Stale unless the file holds exactly one prototype for each person in the directory
+    if (count != directory.get_num_people()) {
+        return false;
+    }
+    for (size_t p = 0; p < count; p++) {
+        if (directory.prototype_of(persons[p]) >= 0) {
+            return false;  // Listed twice
+        }
+        directory.set_prototype(persons[p], static_cast<int>(p));
+        if (directory.prototype_of(persons[p]) != static_cast<int>(p)) {
+            return false;  // Not in the directory
+        }
+    }
+    prototype_person.assign(persons, persons + count);
+    mapped_prototypes = rows;
+    prototypes_mapped = true;
+    return true;
+}
 
-    // Clamp to valid cosine range
-    cos_theta = std::max(-1.0f, std::min(1.0f, cos_theta));
+std::vector<std::pair<float, int>> FAISSIndex::prototype_nearest(const float* query, float query_norm,
+                                                                 int k) const {
+    // Stage 1: the people whose prototypes are most similar to the query
+    size_t people = std::min(directory.get_num_people(),
+                             static_cast<size_t>(std::max(k, Config::PROTOTYPE_RERANK_PEOPLE)));
+    TopKSelector best_people(people);
+    VectorKernels::DotProductFn dot = VectorKernels::get_dot_product_fn();
+    const float* prototype_rows = prototype_data();
+    for (size_t p = 0; p < prototype_person.size(); p++) {
+        if (prototype_person[p] >= 0) {
+            best_people.push(-dot(query, prototype_rows + p * stride, stride), static_cast<int>(p));
+        }
+    }
 
-    // Convert to 0-1 similarity (0 = opposite, 1 = identical)
-    double similarity = (1.0 + cos_theta) / 2.0;
+    // Stage 2: exact distances to every row of those people
+    TopKSelector nearest(static_cast<size_t>(k));
+    for (const TopKSelector::Entry& person : best_people.take_sorted()) {
+        directory.for_each_slot(prototype_person[person.second], [&](size_t i) {
+            float d_sq = query_norm + norms[i] - 2.0f * dot(query, row(i), stride);
+            nearest.push(d_sq, static_cast<int>(i));
+        });
+    }
+    return nearest.take_sorted();
+}
 
-    return similarity;
+VectorKernels::AlignedFloatVector FAISSIndex::pad_query(const std::vector<float>& query,
+                                                        float& query_norm) const {
+    VectorKernels::AlignedFloatVector padded(stride, 0.0f);
+    std::memcpy(padded.data(), query.data(), sizeof(float) * dimension);
+    query_norm = VectorKernels::dot_product(padded.data(), padded.data(), stride);
+    return padded;
 }
 
-// Simple L2 distance computation
-static float compute_l2_distance(const std::vector<float>& a, const std::vector<float>& b) {
-    if (a.size() != b.size()) return 1e9f;
-    float dist = 0.0f;
-    for (size_t i = 0; i < a.size(); i++) {
-        float diff = a[i] - b[i];
-        dist += diff * diff;
+std::vector<std::pair<float, int>> FAISSIndex::quantized_nearest(const float* query,
+                                                                float query_norm,
+                                                                int k,
+                                                                const PersonFilter* filter) const {
+    // Stage 1: approximate scores straight from the codes, keeping the shortlist
+    // in a bounded heap (keyed on the negated score: smaller is better)
+    size_t shortlist = static_cast<size_t>(std::max(k, Config::QUANTIZED_RERANK_CANDIDATES));
+    std::vector<TopKSelector::Entry> scores;
+    if (storage == Config::IndexStorage::FP16) {
+        VectorKernels::DotProductF16Fn dot_f16 = VectorKernels::get_dot_product_f16_fn();
+        scores = nearest_candidates(query, filter, shortlist, [&](size_t i) {
+            return norms[i] - 2.0f * dot_f16(query, half_rows + i * stride, stride);
+        });
+    } else {
+        // q·x ≈ Σ q·offset + Σ (q·scale)·code, with the scale folded into the query once
+        VectorKernels::DotProductU8Fn dot_u8 = VectorKernels::get_dot_product_u8_fn();
+        VectorKernels::AlignedFloatVector scaled_query(stride, 0.0f);
+        float offset_term = 0.0f;
+        for (int d = 0; d < stride; d++) {
+            scaled_query[d] = query[d] * int8_scale[d];
+            offset_term += query[d] * int8_offset[d];
+        }
+        scores = nearest_candidates(query, filter, shortlist, [&](size_t i) {
+            float approx = offset_term + dot_u8(scaled_query.data(), byte_rows + i * stride, stride);
+            return norms[i] - 2.0f * approx;
+        });
+    }
+
+    // Stage 2: exact float distances for the shortlist, so confidence is unchanged
+    VectorKernels::DotProductFn dot = VectorKernels::get_dot_product_fn();
+    VectorKernels::AlignedFloatVector vec(stride, 0.0f);
+    std::vector<std::pair<float, int>> distances;
+    distances.reserve(scores.size());
+    for (size_t j = 0; j < scores.size(); j++) {
+        int i = scores[j].second;
+        if (!read_float_row(i, vec.data())) {
+            continue;
+        }
+        float d_sq = query_norm + norms[i] - 2.0f * dot(query, vec.data(), stride);
+        distances.push_back({d_sq, i});
     }
-    return std::sqrt(dist);
+    std::sort(distances.begin(), distances.end());
+    return distances;
 }
 
 int FAISSIndex::search(const std::vector<float>& query_embedding, double& confidence) {
-    if (!index || embeddings.empty()) {
+    if (!is_built || person_ids.empty()) {
         std::cerr << "Error: Index empty or not built" << std::endl;
         confidence = 0.0;
         return -1;  // Unknown
@@ -167,17 +911,32 @@ int FAISSIndex::search(const std::vector<float>& query_embedding, double& confid
     }
 
     try {
-        // Brute-force search for nearest neighbor
-        float min_distance = 1e9f;
+        float query_norm = 0.0f;
+        VectorKernels::AlignedFloatVector query = pad_query(query_embedding, query_norm);
+        VectorKernels::DotProductFn dot = VectorKernels::get_dot_product_fn();
+
+        // ||q - x||² = ||q||² + ||x||² - 2·q·x, so the nearest row maximizes 2·q·x - ||x||².
+        // For L2-normalized embeddings this is a plain dot-product max; no sqrt per row.
+        float best_score = -std::numeric_limits<float>::infinity();
         int best_index = -1;
 
-        for (size_t i = 0; i < embeddings.size(); i++) {
-            float dist = compute_l2_distance(query_embedding, embeddings[i]);
-            if (dist < min_distance) {
-                min_distance = dist;
-                best_index = i;
+        std::vector<std::pair<float, int>> nearest;
+        if (is_quantized()) {
+            nearest = quantized_nearest(query.data(), query_norm, 1);
+        } else if (uses_prototypes(1)) {
+            nearest = prototype_nearest(query.data(), query_norm, 1);
+        } else {
+            nearest = nearest_candidates(query.data(), nullptr, 1, [&](size_t i) {
+                return norms[i] - 2.0f * dot(query.data(), row(i), stride);
+            });
+            if (!nearest.empty()) {
+                nearest[0].first += query_norm;
             }
         }
+        if (!nearest.empty()) {
+            best_score = query_norm - nearest[0].first;
+            best_index = nearest[0].second;
+        }
 
         if (best_index < 0) {
             std::cerr << "Error: No results found" << std::endl;
@@ -185,6 +944,8 @@ int FAISSIndex::search(const std::vector<float>& query_embedding, double& confid
             return -1;
         }
 
+        float min_distance = std::sqrt(std::max(0.0f, query_norm - best_score));
+
         // Convert distance to confidence
         confidence = distance_to_similarity(min_distance);
         int person_id = person_ids[best_index];
@@ -211,10 +972,24 @@ int FAISSIndex::search(const std::vector<float>& query_embedding, double& confid
 std::vector<int> FAISSIndex::search_k(const std::vector<float>& query_embedding,
                                       int k,
                                       std::vector<double>& confidences) {
+    return search_rows(query_embedding, k, nullptr, confidences);
+}
+
+std::vector<int> FAISSIndex::search_k(const std::vector<float>& query_embedding, int k,
+                                      const PersonFilter& filter, std::vector<double>& confidences) {
+    if (filter.empty()) {
+        confidences.clear();
+        return std::vector<int>();  // Nobody is allowed: nothing to scan
+    }
+    return search_rows(query_embedding, k, &filter, confidences);
+}
+
+std::vector<int> FAISSIndex::search_rows(const std::vector<float>& query_embedding, int k,
+                                         const PersonFilter* filter, std::vector<double>& confidences) {
     std::vector<int> results;
     confidences.clear();
 
-    if (!index || embeddings.empty()) {
+    if (!is_built || person_ids.empty()) {
         std::cerr << "Error: Index empty or not built" << std::endl;
         return results;
     }
@@ -225,22 +1000,238 @@ std::vector<int> FAISSIndex::search_k(const std::vector<float>& query_embedding,
     }
 
     try {
-        // Compute distances to all vectors
+        float query_norm = 0.0f;
+        VectorKernels::AlignedFloatVector query = pad_query(query_embedding, query_norm);
+        VectorKernels::DotProductFn dot = VectorKernels::get_dot_product_fn();
+
+        // Keep the k smallest squared distances in a bounded heap: O(N log k)
         std::vector<std::pair<float, int>> distances;
-        for (size_t i = 0; i < embeddings.size(); i++) {
-            float dist = compute_l2_distance(query_embedding, embeddings[i]);
-            distances.push_back({dist, i});
+        if (is_quantized()) {
+            distances = quantized_nearest(query.data(), query_norm, k, filter);
+        } else if (!filter && uses_prototypes(k)) {
+            distances = prototype_nearest(query.data(), query_norm, k);
+        } else if (k > 0) {
+            distances = nearest_candidates(query.data(), filter, static_cast<size_t>(k), [&](size_t i) {
+                return query_norm + norms[i] - 2.0f * dot(query.data(), row(i), stride);
+            });
         }
 
-        // Sort by distance
-        std::sort(distances.begin(), distances.end());
-
         // Return top k
-        k = std::min(k, static_cast<int>(distances.size()));
-        for (int i = 0; i < k; i++) {
-            int idx = distances[i].second;
-            results.push_back(person_ids[idx]);
-            confidences.push_back(distance_to_similarity(distances[i].first));
+        take_top_k(distances, k, results, confidences);
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error searching FAISS index: " << e.what() << std::endl;
+    }
+
+    return results;
+}
+
+void FAISSIndex::take_top_k(std::vector<std::pair<float, int>>& distances, int k,
+                            std::vector<int>& results, std::vector<double>& confidences) const {
+    k = std::min(k, static_cast<int>(distances.size()));
+    for (int i = 0; i < k; i++) {
+        int idx = distances[i].second;
+        float distance = std::sqrt(std::max(0.0f, distances[i].first));
+        results.push_back(person_ids[idx]);
+        confidences.push_back(distance_to_similarity(distance));
+    }
+}
+
+std::vector<std::vector<int>> FAISSIndex::search_batch(const std::vector<std::vector<float>>& queries,
+                                                       int k,
+                                                       std::vector<std::vector<double>>& confidences) {
+    size_t num_queries = queries.size();
+    std::vector<std::vector<int>> results(num_queries);
+    confidences.assign(num_queries, std::vector<double>());
+
+    // Probed IVF lists, quantized codes and reranked people differ per query: no shared pass
+    bool probes_lists = is_ivf_trained() && get_probe_count() < num_clusters;
+    if (num_queries < 2 || is_quantized() || probes_lists || uses_prototypes(k)) {
+        return VectorIndexBase::search_batch(queries, k, confidences);
+    }
+
+    if (!is_built || person_ids.empty()) {
+        std::cerr << "Error: Index empty or not built" << std::endl;
+        return results;
+    }
+
+    try {
+        // Padded copies of the queries, QUERY_BLOCK at a time for the kernel
+        size_t num_groups = (num_queries + VectorKernels::QUERY_BLOCK - 1) / VectorKernels::QUERY_BLOCK;
+        size_t padded_queries = num_groups * VectorKernels::QUERY_BLOCK;
+        VectorKernels::AlignedFloatVector query_matrix(padded_queries * stride, 0.0f);
+        std::vector<float> query_norms(padded_queries, 0.0f);
+        for (size_t q = 0; q < num_queries; q++) {
+            if (queries[q].size() != static_cast<size_t>(dimension)) {
+                std::cerr << "Error: Query embedding dimension mismatch" << std::endl;
+                return results;
+            }
+            float* padded = query_matrix.data() + q * stride;
+            std::memcpy(padded, queries[q].data(), sizeof(float) * dimension);
+            query_norms[q] = VectorKernels::dot_product(padded, padded, stride);
+        }
+
+        size_t num_rows = person_ids.size();
+        std::shared_ptr<ScanPool> pool = ScanPool::shared();
+        size_t num_threads = scans_in_parallel(nullptr, *pool) ? static_cast<size_t>(pool->get_num_threads()) : 1;
+        TopKSelector empty_selector(static_cast<size_t>(std::max(0, k)));
+        std::vector<std::vector<TopKSelector>> per_thread(num_threads,
+                                                          std::vector<TopKSelector>(num_queries, empty_selector));
+
+        // Rows are scanned in L1-sized blocks; within a block every query group
+        // reuses the rows from cache, so the matrix is read from memory once.
+        // Large galleries split the blocks into partitions scanned on the pool.
+        VectorKernels::DotProductX4Fn dot_x4 = VectorKernels::get_dot_product_x4_fn();
+        size_t rows_per_block = std::max<size_t>(1, static_cast<size_t>(Config::BATCH_SEARCH_BLOCK_BYTES) / (sizeof(float) * stride));
+        auto scan_rows = [&](size_t first_row, size_t last_row, std::vector<TopKSelector>& nearest) {
+            for (size_t block = first_row; block < last_row; block += rows_per_block) {
+                size_t block_end = std::min(last_row, block + rows_per_block);
+                for (size_t group = 0; group < num_groups; group++) {
+                    size_t first = group * VectorKernels::QUERY_BLOCK;
+                    const float* group_queries[VectorKernels::QUERY_BLOCK];
+                    for (int j = 0; j < VectorKernels::QUERY_BLOCK; j++) {
+                        group_queries[j] = query_matrix.data() + (first + j) * stride;
+                    }
+                    size_t group_size = std::min<size_t>(VectorKernels::QUERY_BLOCK, num_queries - first);
+
+                    float dots[VectorKernels::QUERY_BLOCK];
+                    for (size_t i = block; i < block_end; i++) {
+                        if (directory.is_deleted(i)) {
+                            continue;
+                        }
+                        dot_x4(group_queries, row(i), stride, dots);
+                        for (size_t j = 0; j < group_size; j++) {
+                            nearest[first + j].push(query_norms[first + j] + norms[i] - 2.0f * dots[j],
+                                                    static_cast<int>(i));
+                        }
+                    }
+                }
+            }
+        };
+
+        if (num_threads == 1) {
+            scan_rows(0, num_rows, per_thread[0]);
+        } else {
+            size_t partition_rows = rows_per_partition();
+            size_t num_partitions = (num_rows + partition_rows - 1) / partition_rows;
+            pool->run(num_partitions, [&](size_t partition, int slot) {
+                size_t first_row = partition * partition_rows;
+                scan_rows(first_row, std::min(num_rows, first_row + partition_rows), per_thread[slot]);
+            });
+        }
+
+        for (size_t q = 0; q < num_queries; q++) {
+            TopKSelector merged(static_cast<size_t>(std::max(0, k)));
+            for (std::vector<TopKSelector>& nearest : per_thread) {
+                for (const TopKSelector::Entry& entry : nearest[q].take_sorted()) {
+                    merged.push(entry.first, entry.second);
+                }
+            }
+            std::vector<std::pair<float, int>> distances = merged.take_sorted();
+            take_top_k(distances, k, results[q], confidences[q]);
+        }
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error searching FAISS index: " << e.what() << std::endl;
+    }
+
+    return results;
+}
+
+std::vector<int> FAISSIndex::search_identities(const std::vector<float>& query_embedding, int k,
+                                               std::vector<double>& confidences,
+                                               Config::IdentityAggregation aggregation, int top_m) {
+    // Quantized scores are approximate: aggregate the reranked shortlist instead
+    if (is_quantized()) {
+        return VectorIndexBase::search_identities(query_embedding, k, confidences, aggregation, top_m);
+    }
+
+    std::vector<int> results;
+    confidences.clear();
+
+    if (!is_built || person_ids.empty()) {
+        std::cerr << "Error: Index empty or not built" << std::endl;
+        return results;
+    }
+
+    if (query_embedding.size() != static_cast<size_t>(dimension)) {
+        std::cerr << "Error: Query embedding dimension mismatch" << std::endl;
+        return results;
+    }
+
+    try {
+        float query_norm = 0.0f;
+        VectorKernels::AlignedFloatVector query = pad_query(query_embedding, query_norm);
+        VectorKernels::DotProductFn dot = VectorKernels::get_dot_product_fn();
+
+        // Exact: every scanned row contributes to its person's score
+        IdentityAggregator aggregator(aggregation, top_m);
+        for_each_candidate(query.data(), nullptr, [&](size_t i) {
+            float d_sq = query_norm + norms[i] - 2.0f * dot(query.data(), row(i), stride);
+            aggregator.add(person_ids[i], d_sq);
+        });
+
+        for (const IdentityAggregator::Entry& person : aggregator.top(k)) {
+            results.push_back(person.second);
+            confidences.push_back(distance_to_similarity(std::sqrt(std::max(0.0f, person.first))));
+        }
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error searching FAISS index: " << e.what() << std::endl;
+    }
+
+    return results;
+}
+
+std::vector<int> FAISSIndex::range_search(const std::vector<float>& query_embedding, double min_similarity,
+                                          std::vector<double>& confidences) {
+    // Quantized scores are approximate: threshold the reranked people instead
+    if (is_quantized()) {
+        return VectorIndexBase::range_search(query_embedding, min_similarity, confidences);
+    }
+
+    std::vector<int> results;
+    confidences.clear();
+
+    if (!is_built || person_ids.empty()) {
+        return results;  // Nobody enrolled yet: nothing can match
+    }
+
+    if (query_embedding.size() != static_cast<size_t>(dimension)) {
+        std::cerr << "Error: Query embedding dimension mismatch" << std::endl;
+        return results;
+    }
+
+    try {
+        float query_norm = 0.0f;
+        VectorKernels::AlignedFloatVector query = pad_query(query_embedding, query_norm);
+        VectorKernels::DotProductFn dot = VectorKernels::get_dot_product_fn();
+
+        // similarity = 1 - d²/4, so the threshold is a bound on the squared distance
+        double clamped = std::max(0.0, std::min(1.0, min_similarity));
+        float max_d_sq = static_cast<float>(4.0 * (1.0 - clamped));
+
+        // Closest matching row per person, in one pass over the candidates
+        std::unordered_map<int, float> best;
+        for_each_candidate(query.data(), nullptr, [&](size_t i) {
+            float d_sq = query_norm + norms[i] - 2.0f * dot(query.data(), row(i), stride);
+            if (d_sq <= max_d_sq) {
+                auto inserted = best.emplace(person_ids[i], d_sq);
+                if (!inserted.second && d_sq < inserted.first->second) {
+                    inserted.first->second = d_sq;
+                }
+            }
+        });
+
+        std::vector<std::pair<float, int>> matches;
+        matches.reserve(best.size());
+        for (const auto& person : best) {
+            matches.push_back({person.second, person.first});
+        }
+        std::sort(matches.begin(), matches.end());
+        for (const auto& match : matches) {
+            results.push_back(match.second);
+            confidences.push_back(distance_to_similarity(std::sqrt(std::max(0.0f, match.first))));
         }
 
     } catch (const std::exception& e) {
@@ -250,46 +1241,472 @@ std::vector<int> FAISSIndex::search_k(const std::vector<float>& query_embedding,
     return results;
 }
 
+int FAISSIndex::verify(const std::vector<float>& query_embedding, int person_id, double& confidence) {
+    confidence = 0.0;
+    if (!is_built || person_ids.empty()) {
+        std::cerr << "Error: Index empty or not built" << std::endl;
+        return 0;
+    }
+
+    if (query_embedding.size() != static_cast<size_t>(dimension)) {
+        std::cerr << "Error: Query embedding dimension mismatch" << std::endl;
+        return 0;
+    }
+
+    try {
+        float query_norm = 0.0f;
+        VectorKernels::AlignedFloatVector query = pad_query(query_embedding, query_norm);
+        VectorKernels::DotProductFn dot = VectorKernels::get_dot_product_fn();
+
+        // Only the claimed person's rows: the rest of the gallery is never touched
+        VectorKernels::AlignedFloatVector vec(stride, 0.0f);
+        float best = std::numeric_limits<float>::infinity();
+        int scored = 0;
+        directory.for_each_slot(person_id, [&](size_t i) {
+            const float* vector = vec.data();
+            if (has_float_rows_in_memory()) {
+                vector = row(i);
+            } else if (!read_float_row(i, vec.data())) {
+                return;
+            }
+            best = std::min(best, query_norm + norms[i] - 2.0f * dot(query.data(), vector, stride));
+            scored++;
+        });
+
+        if (scored > 0) {
+            confidence = distance_to_similarity(std::sqrt(std::max(0.0f, best)));
+        }
+        return scored;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error verifying against FAISS index: " << e.what() << std::endl;
+        return 0;
+    }
+}
+
 bool FAISSIndex::save_index(const std::string& filepath) {
-    if (!index) {
+    if (!is_built) {
         std::cerr << "Error: Index not built" << std::endl;
         return false;
     }
 
+    // The file has no tombstones: deleted rows are left out of what is written
+    if (directory.has_deletions()) {
+        std::unique_ptr<VectorIndexBase> live = compacted();
+        return live && live->save_index(filepath);
+    }
+
+    // Write to a temporary file and rename it into place: readers never see a
+    // half-written index, and a live mapping of the old file stays valid.
+    std::string temp_path = filepath + ".tmp";
+
     try {
-        // Save embeddings and person_ids to file
-        std::ofstream file(filepath, std::ios::binary);
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
         if (!file) {
             std::cerr << "Error: Could not open file for writing" << std::endl;
             return false;
         }
 
-        // Save metadata
-        int num_vectors = embeddings.size();
-        file.write((const char*)&num_vectors, sizeof(int));
-        file.write((const char*)&dimension, sizeof(int));
+        size_t num_rows = person_ids.size();
+        size_t row_count = num_rows * stride;
 
-        // Save embeddings and person_ids
-        for (int i = 0; i < num_vectors; i++) {
-            file.write((const char*)embeddings[i].data(), sizeof(float) * dimension);
-            file.write((const char*)&person_ids[i], sizeof(int));
+        IndexFile::IndexFileHeader header{};
+        std::memcpy(header.magic, IndexFile::MAGIC, sizeof(header.magic));
+        header.version = IndexFile::VERSION;
+        header.header_size = sizeof(IndexFile::IndexFileHeader);
+        header.dimension = static_cast<uint32_t>(dimension);
+        header.stride = static_cast<uint32_t>(stride);
+        header.count = num_rows;
+        header.model_hash = model_hash;
+        header.storage = static_cast<uint32_t>(storage);
+        header.nlist = is_ivf_trained() ? static_cast<uint32_t>(num_clusters) : 0;
+        header.ivf_trained_size = ivf_trained_size;
+        header.int8_trained_size = int8_trained_size;
+
+        // Section writers, in file order
+        using Emit = std::function<void(const void*, size_t)>;
+        std::vector<std::pair<IndexFile::SectionType, std::function<bool(const Emit&)>>> writers;
+
+        writers.push_back({IndexFile::SectionType::ROWS_F32, [&](const Emit& emit) {
+            if (has_float_rows_in_memory()) {
+                emit(matrix_rows, sizeof(float) * row_count);
+                return true;
+            }
+            VectorKernels::AlignedFloatVector vec(stride, 0.0f);
+            for (size_t i = 0; i < num_rows; i++) {
+                if (!read_float_row(i, vec.data())) {
+                    return false;
+                }
+                emit(vec.data(), sizeof(float) * stride);
+            }
+            return true;
+        }});
+        writers.push_back({IndexFile::SectionType::NORMS, [&](const Emit& emit) {
+            emit(norms.data(), sizeof(float) * num_rows);
+            return true;
+        }});
+        writers.push_back({IndexFile::SectionType::PERSON_IDS, [&](const Emit& emit) {
+            emit(person_ids.data(), sizeof(int32_t) * num_rows);
+            return true;
+        }});
+        if (storage == Config::IndexStorage::FP16) {
+            writers.push_back({IndexFile::SectionType::CODES_F16, [&](const Emit& emit) {
+                emit(half_rows, sizeof(uint16_t) * row_count);
+                return true;
+            }});
+        } else if (storage == Config::IndexStorage::INT8) {
+            writers.push_back({IndexFile::SectionType::CODES_U8, [&](const Emit& emit) {
+                emit(byte_rows, sizeof(uint8_t) * row_count);
+                return true;
+            }});
+            writers.push_back({IndexFile::SectionType::INT8_RANGES, [&](const Emit& emit) {
+                emit(int8_scale.data(), sizeof(float) * stride);
+                emit(int8_offset.data(), sizeof(float) * stride);
+                return true;
+            }});
+        }
+        if (keeps_prototypes() && !prototype_person.empty()) {
+            // Live prototypes only, renumbered in order
+            writers.push_back({IndexFile::SectionType::PROTOTYPES_F32, [&](const Emit& emit) {
+                const float* prototype_rows = prototype_data();
+                for (size_t p = 0; p < prototype_person.size(); p++) {
+                    if (prototype_person[p] >= 0) {
+                        emit(prototype_rows + p * stride, sizeof(float) * stride);
+                    }
+                }
+                return true;
+            }});
+            writers.push_back({IndexFile::SectionType::PROTOTYPE_PERSONS, [&](const Emit& emit) {
+                for (int person_id : prototype_person) {
+                    if (person_id >= 0) {
+                        int32_t id = person_id;
+                        emit(&id, sizeof(id));
+                    }
+                }
+                return true;
+            }});
+        }
+        if (log_sequence > 0) {
+            writers.push_back({IndexFile::SectionType::LOG_SEQUENCE, [&](const Emit& emit) {
+                emit(&log_sequence, sizeof(log_sequence));
+                return true;
+            }});
+        }
+        if (is_ivf_trained()) {
+            writers.push_back({IndexFile::SectionType::IVF_CENTROIDS, [&](const Emit& emit) {
+                emit(centroids.data(), sizeof(float) * static_cast<size_t>(num_clusters) * stride);
+                return true;
+            }});
+            writers.push_back({IndexFile::SectionType::IVF_ASSIGN, [&](const Emit& emit) {
+                std::vector<int32_t> list_of_row(num_rows, -1);
+                for (int c = 0; c < num_clusters; c++) {
+                    for (int i : inverted_lists[c]) {
+                        list_of_row[i] = c;
+                    }
+                }
+                emit(list_of_row.data(), sizeof(int32_t) * num_rows);
+                return true;
+            }});
+        }
+
+        // Reserve space for header and section table, then stream the payload
+        std::vector<IndexFile::IndexFileSection> sections(writers.size());
+        header.section_count = static_cast<uint32_t>(sections.size());
+        uint64_t position = sizeof(header) + sizeof(IndexFile::IndexFileSection) * sections.size();
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)sections.data(), sizeof(IndexFile::IndexFileSection) * sections.size());
+
+        static const char zeros[IndexFile::SECTION_ALIGNMENT] = {};
+        for (size_t s = 0; s < writers.size(); s++) {
+            uint64_t padding = (IndexFile::SECTION_ALIGNMENT - position % IndexFile::SECTION_ALIGNMENT)
+                               % IndexFile::SECTION_ALIGNMENT;
+            file.write(zeros, padding);
+            position += padding;
+
+            IndexFile::Checksum sum;
+            uint64_t size = 0;
+            Emit emit = [&](const void* data, size_t bytes) {
+                file.write((const char*)data, bytes);
+                sum.update(data, bytes);
+                size += bytes;
+            };
+            if (!writers[s].second(emit)) {
+                throw std::runtime_error("could not read vectors for saving");
+            }
+
+            sections[s].type = static_cast<uint32_t>(writers[s].first);
+            sections[s].offset = position;
+            sections[s].size = size;
+            sections[s].checksum = sum.digest();
+            position += size;
         }
 
+        // Header checksum covers the header (checksum zeroed) and the section table
+        IndexFile::Checksum header_sum;
+        header_sum.update(&header, sizeof(header));
+        header_sum.update(sections.data(), sizeof(IndexFile::IndexFileSection) * sections.size());
+        header.header_checksum = header_sum.digest();
+
+        file.seekp(0);
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)sections.data(), sizeof(IndexFile::IndexFileSection) * sections.size());
         file.close();
-        std::cout << "FAISS index saved to: " << filepath << std::endl;
+        if (!file) {
+            std::cerr << "Error: Failed writing FAISS index to " << temp_path << std::endl;
+            std::remove(temp_path.c_str());
+            return false;
+        }
+
+        if (!IndexFile::replace_file(temp_path, filepath)) {
+            return false;
+        }
+
+        std::cout << "FAISS index saved to: " << filepath
+                  << " (format v" << IndexFile::VERSION << ", " << position << " bytes)" << std::endl;
         return true;
 
     } catch (const std::exception& e) {
         std::cerr << "Error saving FAISS index: " << e.what() << std::endl;
+        std::remove(temp_path.c_str());
         return false;
     }
 }
 
 bool FAISSIndex::load_index(const std::string& filepath) {
+    char magic[sizeof(IndexFile::MAGIC)] = {};
+    {
+        std::ifstream file(filepath, std::ios::binary);
+        if (!file) {
+            std::cerr << "Error: Could not open file for reading" << std::endl;
+            return false;
+        }
+        file.read(magic, sizeof(magic));
+    }
+
+    if (std::memcmp(magic, IndexFile::MAGIC, sizeof(magic)) == 0) {
+        return load_mapped_index(filepath);
+    }
+
+    clear();
+    return load_legacy_index(filepath);
+}
+
+bool FAISSIndex::load_mapped_index(const std::string& filepath) {
     try {
-        // Clean up existing index
+        auto start_time = std::chrono::steady_clock::now();
+
+        // Validate everything against a local mapping first; the current
+        // index is only replaced once the file is known to be good.
+        IndexFile::MappedFile file;
+        if (!file.open(filepath)) {
+            return false;
+        }
+        const unsigned char* data = file.get_data();
+        size_t file_size = file.get_size();
+
+        auto reject = [&](const std::string& reason) {
+            std::cerr << "Error: Rejecting FAISS index " << filepath << ": " << reason << std::endl;
+            return false;
+        };
+
+        IndexFile::IndexFileHeader header;
+        if (file_size < sizeof(header)) {
+            return reject("file too small");
+        }
+        std::memcpy(&header, data, sizeof(header));
+        if (header.version != IndexFile::VERSION) {
+            return reject("unsupported format version " + std::to_string(header.version));
+        }
+        if (header.header_size != sizeof(header) || header.section_count > IndexFile::MAX_SECTIONS ||
+            file_size < sizeof(header) + sizeof(IndexFile::IndexFileSection) * header.section_count) {
+            return reject("malformed header");
+        }
+
+        std::vector<IndexFile::IndexFileSection> sections(header.section_count);
+        std::memcpy(sections.data(), data + sizeof(header),
+                    sizeof(IndexFile::IndexFileSection) * sections.size());
+
+        IndexFile::IndexFileHeader unsigned_header = header;
+        unsigned_header.header_checksum = 0;
+        IndexFile::Checksum header_sum;
+        header_sum.update(&unsigned_header, sizeof(unsigned_header));
+        header_sum.update(sections.data(), sizeof(IndexFile::IndexFileSection) * sections.size());
+        if (header_sum.digest() != header.header_checksum) {
+            return reject("header checksum mismatch");
+        }
+
+        if (header.dimension == 0 ||
+            header.stride != static_cast<uint32_t>(VectorKernels::padded_stride(header.dimension)) ||
+            header.storage > static_cast<uint32_t>(Config::IndexStorage::INT8) ||
+            header.count > file_size / (sizeof(float) * header.stride)) {
+            return reject("invalid dimension, storage or count");
+        }
+        if (model_hash != 0 && header.model_hash != 0 && model_hash != header.model_hash) {
+            return reject("built with a different embedding model");
+        }
+
+        // Locate sections and check bounds, sizes and checksums. The row and code
+        // payloads are scanned in place and only verified on request; everything
+        // else is small, copied at load, and always verified
+        auto is_mapped_payload = [](uint32_t type) {
+            return type == static_cast<uint32_t>(IndexFile::SectionType::ROWS_F32) ||
+                   type == static_cast<uint32_t>(IndexFile::SectionType::CODES_F16) ||
+                   type == static_cast<uint32_t>(IndexFile::SectionType::CODES_U8);
+        };
+        size_t num_rows = static_cast<size_t>(header.count);
+        size_t row_count = num_rows * header.stride;
+        const unsigned char* section_data[IndexFile::MAX_SECTIONS + 1] = {};
+        for (const IndexFile::IndexFileSection& section : sections) {
+            if (section.type == 0 || section.type > IndexFile::MAX_SECTIONS || section_data[section.type] ||
+                section.offset % IndexFile::SECTION_ALIGNMENT != 0 ||
+                section.offset > file_size || section.size > file_size - section.offset) {
+                return reject("invalid section table");
+            }
+            if ((Config::INDEX_VERIFY_CHECKSUMS || !is_mapped_payload(section.type)) &&
+                IndexFile::checksum(data + section.offset, section.size) != section.checksum) {
+                return reject("payload checksum mismatch in section " + std::to_string(section.type));
+            }
+            section_data[section.type] = data + section.offset;
+        }
+
+        auto section_size = [&](IndexFile::SectionType type) -> uint64_t {
+            for (const IndexFile::IndexFileSection& section : sections) {
+                if (section.type == static_cast<uint32_t>(type)) {
+                    return section.size;
+                }
+            }
+            return UINT64_MAX;
+        };
+        auto section_ptr = [&](IndexFile::SectionType type) {
+            return section_data[static_cast<uint32_t>(type)];
+        };
+
+        if (section_size(IndexFile::SectionType::ROWS_F32) != sizeof(float) * row_count ||
+            section_size(IndexFile::SectionType::NORMS) != sizeof(float) * num_rows ||
+            section_size(IndexFile::SectionType::PERSON_IDS) != sizeof(int32_t) * num_rows) {
+            return reject("missing or truncated vector sections");
+        }
+
+        Config::IndexStorage file_storage = static_cast<Config::IndexStorage>(header.storage);
+        bool file_has_codes =
+            (file_storage == Config::IndexStorage::FP16 &&
+             section_size(IndexFile::SectionType::CODES_F16) == sizeof(uint16_t) * row_count) ||
+            (file_storage == Config::IndexStorage::INT8 &&
+             section_size(IndexFile::SectionType::CODES_U8) == sizeof(uint8_t) * row_count &&
+             section_size(IndexFile::SectionType::INT8_RANGES) == 2 * sizeof(float) * header.stride);
+
+        const int32_t* assignment = nullptr;
+        if (header.nlist > 0) {
+            if (header.nlist > num_rows ||
+                section_size(IndexFile::SectionType::IVF_CENTROIDS) !=
+                    sizeof(float) * static_cast<size_t>(header.nlist) * header.stride ||
+                section_size(IndexFile::SectionType::IVF_ASSIGN) != sizeof(int32_t) * num_rows) {
+                return reject("invalid IVF sections");
+            }
+            assignment = reinterpret_cast<const int32_t*>(section_ptr(IndexFile::SectionType::IVF_ASSIGN));
+            for (size_t i = 0; i < num_rows; i++) {
+                if (assignment[i] < 0 || static_cast<uint32_t>(assignment[i]) >= header.nlist) {
+                    return reject("invalid IVF list assignment");
+                }
+            }
+        }
+
+        // The file is valid: replace the current index with the mapped one
+        clear();
+        mapping = std::make_shared<IndexFile::MappedFile>();
+        mapping->swap(file);
+        dimension = static_cast<int>(header.dimension);
+        stride = static_cast<int>(header.stride);
+        reset_quantizer();
+
+        const float* mapped_norms = reinterpret_cast<const float*>(section_ptr(IndexFile::SectionType::NORMS));
+        const int32_t* mapped_ids = reinterpret_cast<const int32_t*>(section_ptr(IndexFile::SectionType::PERSON_IDS));
+        norms.assign(mapped_norms, mapped_norms + num_rows);
+        person_ids.assign(mapped_ids, mapped_ids + num_rows);
+        for (size_t i = 0; i < num_rows; i++) {
+            directory.add(person_ids[i], i);
+        }
+
+        matrix_rows = reinterpret_cast<const float*>(section_ptr(IndexFile::SectionType::ROWS_F32));
+        rows_mapped = true;
+
+        if (storage == Config::IndexStorage::INT8 &&
+            section_size(IndexFile::SectionType::INT8_RANGES) == 2 * sizeof(float) * header.stride) {
+            const float* ranges = reinterpret_cast<const float*>(section_ptr(IndexFile::SectionType::INT8_RANGES));
+            int8_scale.assign(ranges, ranges + stride);
+            int8_offset.assign(ranges + stride, ranges + 2 * stride);
+            int8_trained_size = static_cast<size_t>(header.int8_trained_size);
+        }
+
+        if (is_quantized() && file_has_codes && file_storage == storage) {
+            half_rows = reinterpret_cast<const uint16_t*>(section_ptr(IndexFile::SectionType::CODES_F16));
+            byte_rows = reinterpret_cast<const uint8_t*>(section_ptr(IndexFile::SectionType::CODES_U8));
+            codes_mapped = true;
+        } else if (is_quantized()) {
+            // File was written in another storage mode: encode codes from the mapped rows
+            if (storage == Config::IndexStorage::FP16) {
+                half_codes.append(row_count);
+            } else {
+                byte_codes.append(row_count);
+            }
+            for (size_t i = 0; i < num_rows; i++) {
+                encode_row(row(i), mutable_code_row(i));
+            }
+        }
+        sync_views();
+
+        is_built = true;
+        if (header.nlist > 0 && Config::IVF_ENABLED) {
+            const float* mapped_centroids =
+                reinterpret_cast<const float*>(section_ptr(IndexFile::SectionType::IVF_CENTROIDS));
+            num_clusters = static_cast<int>(header.nlist);
+            centroids.assign(mapped_centroids, mapped_centroids + static_cast<size_t>(num_clusters) * stride);
+            compute_centroid_norms();
+            rebuild_inverted_lists(assignment);
+            ivf_trained_size = static_cast<size_t>(header.ivf_trained_size);
+        } else {
+            num_clusters = calculate_optimal_clusters(static_cast<int>(num_rows));
+        }
+        if (section_size(IndexFile::SectionType::LOG_SEQUENCE) == sizeof(uint64_t)) {
+            std::memcpy(&log_sequence, section_ptr(IndexFile::SectionType::LOG_SEQUENCE), sizeof(uint64_t));
+        }
+        // Map the stored prototypes; rebuild them (one pass over the rows) if
+        // the file has none or they do not match its people
+        uint64_t person_bytes = section_size(IndexFile::SectionType::PROTOTYPE_PERSONS);
+        uint64_t num_prototypes = person_bytes / sizeof(int32_t);
+        if (!keeps_prototypes() || person_bytes == UINT64_MAX || person_bytes % sizeof(int32_t) != 0 ||
+            section_size(IndexFile::SectionType::PROTOTYPES_F32) != sizeof(float) * num_prototypes * stride ||
+            !map_prototypes(reinterpret_cast<const float*>(section_ptr(IndexFile::SectionType::PROTOTYPES_F32)),
+                            reinterpret_cast<const int32_t*>(section_ptr(IndexFile::SectionType::PROTOTYPE_PERSONS)),
+                            static_cast<size_t>(num_prototypes))) {
+            rebuild_prototypes();
+        }
+        setup_index_parameters();
+
+        auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time).count();
+        std::cout << "FAISS index mapped from: " << filepath
+                  << " (format v" << header.version << ", " << elapsed_ms << "ms)" << std::endl;
+        std::cout << "Loaded " << num_rows << " vectors with dimension " << dimension << std::endl;
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading FAISS index: " << e.what() << std::endl;
         clear();
+        return false;
+    }
+}
 
+void FAISSIndex::rebuild_inverted_lists(const int32_t* assignment) {
+    inverted_lists.assign(num_clusters, std::vector<int>());
+    size_t num_rows = person_ids.size();
+    for (size_t i = 0; i < num_rows; i++) {
+        inverted_lists[assignment[i]].push_back(static_cast<int>(i));
+    }
+}
+
+bool FAISSIndex::load_legacy_index(const std::string& filepath) {
+    try {
         // Load embeddings and person_ids from file
         std::ifstream file(filepath, std::ios::binary);
         if (!file) {
@@ -299,25 +1716,85 @@ bool FAISSIndex::load_index(const std::string& filepath) {
 
         // Load metadata
         int num_vectors = 0;
+        int file_dimension = 0;
         file.read((char*)&num_vectors, sizeof(int));
-        file.read((char*)&dimension, sizeof(int));
+        file.read((char*)&file_dimension, sizeof(int));
+
+        // Reject files that are not in this layout (e.g. an HNSW graph file)
+        file.seekg(0, std::ios::end);
+        long long file_size = static_cast<long long>(file.tellg());
+        file.seekg(2 * sizeof(int), std::ios::beg);
+        long long row_bytes = static_cast<long long>(sizeof(float)) * file_dimension + sizeof(int);
+        if (num_vectors < 0 || file_dimension <= 0 ||
+            2 * static_cast<long long>(sizeof(int)) + num_vectors * row_bytes > file_size) {
+            std::cerr << "Error: Not a flat FAISS index file: " << filepath << std::endl;
+            return false;
+        }
+        dimension = file_dimension;
+        stride = VectorKernels::padded_stride(dimension);
+        reset_quantizer();
+
+        if (is_quantized() && !open_float_rows()) {
+            return false;
+        }
+
+        if (storage == Config::IndexStorage::FP16) {
+            half_codes.reserve(static_cast<size_t>(num_vectors) * stride);
+        } else if (storage == Config::IndexStorage::INT8) {
+            byte_codes.reserve(static_cast<size_t>(num_vectors) * stride);
+        } else {
+            matrix.reserve(static_cast<size_t>(num_vectors) * stride);
+        }
+        norms.reserve(num_vectors);
+        person_ids.reserve(num_vectors);
 
         // Load embeddings and person_ids
+        std::vector<float> embedding(dimension);
         for (int i = 0; i < num_vectors; i++) {
-            std::vector<float> embedding(dimension);
             int person_id = 0;
             file.read((char*)embedding.data(), sizeof(float) * dimension);
             file.read((char*)&person_id, sizeof(int));
-            embeddings.push_back(embedding);
-            person_ids.push_back(person_id);
+            append_row(person_id, embedding.data());
+        }
+
+        if (!file) {
+            std::cerr << "Error: FAISS index file is truncated" << std::endl;
+            clear();
+            return false;
         }
 
-        file.close();
-        index = (void*)1;  // Mark as initialized
         is_built = true;
         num_clusters = calculate_optimal_clusters(num_vectors);
 
-        std::cout << "FAISS index loaded from: " << filepath << std::endl;
+        // Restore int8 ranges and IVF centroids/posting lists from the optional trailers
+        uint32_t magic = 0;
+        while (file.read((char*)&magic, sizeof(uint32_t))) {
+            if (magic == INT8_TRAILER_MAGIC) {
+                if (!load_int8_trailer(file)) {
+                    std::cerr << "Warning: Ignoring invalid int8 range data" << std::endl;
+                    break;
+                }
+            } else if (magic == IVF_TRAILER_MAGIC) {
+                if (!load_ivf_trailer(file)) {
+                    std::cerr << "Warning: Ignoring invalid IVF data, using exact search" << std::endl;
+                    reset_ivf();
+                    num_clusters = calculate_optimal_clusters(num_vectors);
+                    break;
+                }
+            } else {
+                break;
+            }
+        }
+        if (!Config::IVF_ENABLED && is_ivf_trained()) {
+            reset_ivf();  // Written with IVF on: scanned exhaustively now
+            num_clusters = calculate_optimal_clusters(num_vectors);
+        }
+
+        file.close();
+        rebuild_prototypes();
+        setup_index_parameters();
+
+        std::cout << "FAISS index loaded from: " << filepath << " (legacy format)" << std::endl;
         std::cout << "Loaded " << num_vectors << " vectors with dimension " << dimension << std::endl;
         return true;
 
@@ -327,14 +1804,163 @@ bool FAISSIndex::load_index(const std::string& filepath) {
     }
 }
 
+bool FAISSIndex::load_int8_trailer(std::ifstream& file) {
+    int trained_size = 0;
+    std::vector<float> scale(dimension);
+    std::vector<float> offset(dimension);
+    file.read((char*)&trained_size, sizeof(int));
+    file.read((char*)scale.data(), sizeof(float) * dimension);
+    file.read((char*)offset.data(), sizeof(float) * dimension);
+    if (!file) {
+        return false;
+    }
+
+    // Other storage modes just skip the ranges
+    if (storage != Config::IndexStorage::INT8) {
+        return true;
+    }
+
+    std::copy(scale.begin(), scale.end(), int8_scale.begin());
+    std::copy(offset.begin(), offset.end(), int8_offset.begin());
+    int8_trained_size = trained_size > 0 ? static_cast<size_t>(trained_size) : person_ids.size();
+
+    // Rows were encoded with the default range while loading
+    VectorKernels::AlignedFloatVector vec(stride, 0.0f);
+    for (size_t i = 0; i < person_ids.size(); i++) {
+        if (!read_float_row(i, vec.data())) {
+            return false;
+        }
+        encode_row(vec.data(), mutable_code_row(i));
+    }
+    sync_views();
+    return true;
+}
+
+bool FAISSIndex::load_ivf_trailer(std::ifstream& file) {
+    int nlist = 0;
+    int trained_size = 0;
+    file.read((char*)&nlist, sizeof(int));
+    file.read((char*)&trained_size, sizeof(int));
+    size_t num_rows = person_ids.size();
+    if (!file || nlist <= 0 || static_cast<size_t>(nlist) > num_rows) {
+        return false;
+    }
+
+    num_clusters = nlist;
+    centroids.assign(static_cast<size_t>(nlist) * stride, 0.0f);
+    for (int c = 0; c < nlist; c++) {
+        file.read((char*)(centroids.data() + static_cast<size_t>(c) * stride), sizeof(float) * dimension);
+    }
+
+    std::vector<int> list_of_row(num_rows);
+    file.read((char*)list_of_row.data(), sizeof(int) * num_rows);
+    if (!file) {
+        return false;
+    }
+
+    inverted_lists.assign(nlist, std::vector<int>());
+    for (size_t i = 0; i < num_rows; i++) {
+        int list = list_of_row[i];
+        if (list < 0 || list >= nlist) {
+            return false;
+        }
+        inverted_lists[list].push_back(static_cast<int>(i));
+    }
+
+    compute_centroid_norms();
+    ivf_trained_size = trained_size > 0 ? static_cast<size_t>(trained_size) : num_rows;
+    return true;
+}
+
+bool FAISSIndex::get_vector(int i, std::vector<float>& embedding, int& person_id) const {
+    if (i < 0 || static_cast<size_t>(i) >= person_ids.size()) {
+        return false;
+    }
+    embedding.resize(dimension);
+    person_id = person_ids[i];
+    return read_float_row(i, embedding.data());
+}
+
 int FAISSIndex::get_num_vectors() const {
-    return static_cast<int>(embeddings.size());
+    return static_cast<int>(person_ids.size() - directory.get_num_deleted());
+}
+
+int FAISSIndex::remove_person(int person_id) {
+    // Only the tombstone bits change; rows, codes and posting lists stay put
+    retire_prototype(person_id);
+    return directory.remove(person_id);
+}
+
+std::unique_ptr<VectorIndexBase> FAISSIndex::compacted() const {
+    auto copy = std::make_unique<FAISSIndex>(dimension, storage);
+    copy->set_model_hash(model_hash);
+    copy->set_projection(projection);
+    copy->set_nprobe(nprobe);
+    if (!is_built) {
+        return copy;
+    }
+
+    try {
+        size_t num_rows = person_ids.size();
+        size_t live_rows = num_rows - directory.get_num_deleted();
+        if (!copy->build_index(static_cast<int>(std::max<size_t>(live_rows, 1)))) {
+            return nullptr;
+        }
+        copy->set_log_sequence(log_sequence);
+
+        // Keep the trained state: rows are re-assigned to the same centroids
+        // and re-encoded with the same int8 ranges while they are copied
+        if (is_ivf_trained()) {
+            copy->num_clusters = num_clusters;
+            copy->centroids = centroids;
+            copy->centroid_norms = centroid_norms;
+            copy->inverted_lists.assign(num_clusters, std::vector<int>());
+            copy->ivf_trained_size = ivf_trained_size;
+        }
+        copy->int8_scale = int8_scale;
+        copy->int8_offset = int8_offset;
+        copy->int8_trained_size = int8_trained_size;
+
+        VectorKernels::AlignedFloatVector vec(stride, 0.0f);
+        for (size_t i = 0; i < num_rows; i++) {
+            if (directory.is_deleted(i)) {
+                continue;
+            }
+            if (!read_float_row(i, vec.data())) {
+                std::cerr << "Error: Could not read row " << i << " while compacting" << std::endl;
+                return nullptr;
+            }
+            copy->append_row(person_ids[i], vec.data());
+        }
+        copy->rebuild_prototypes();  // Also drops the retired prototypes
+        return copy;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error compacting FAISS index: " << e.what() << std::endl;
+        return nullptr;
+    }
 }
 
 void FAISSIndex::clear() {
-    embeddings.clear();
+    log_sequence = 0;
+    mapping.reset();
+    rows_mapped = false;
+    codes_mapped = false;
+    matrix.clear();
+    half_codes.clear();
+    byte_codes.clear();
+    float_rows.reset();
+    reset_quantizer();
+    sync_views();
+    norms.clear();
     person_ids.clear();
-    index = nullptr;
+    directory.clear();
+    prototypes.clear();
+    prototype_person.clear();
+    num_retired_prototypes = 0;
+    prototypes_mapped = false;
+    mapped_prototypes = nullptr;
+    reset_ivf();
     is_built = false;
     num_clusters = 0;
 }
@@ -0,0 +1,707 @@
+#include "faiss_library_index.h"
+
+#ifdef HAVE_FAISS
+
+#include "faiss_index.h"
+#include "index_file.h"
+#include <faiss/IndexFlat.h>
+#include <faiss/IndexHNSW.h>
+#include <faiss/IndexIVFFlat.h>
+#include <faiss/IndexIVFPQ.h>
+#include <faiss/clone_index.h>
+#include <faiss/impl/IDSelector.h>
+#include <faiss/index_io.h>
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+
+namespace {
+
+// Lets FAISS skip tombstoned rows, and rows of people outside a search
+// filter, inside its own scan. Rows appended by newer copies of the index
+// (past person_ids) are skipped too.
+struct LiveRowSelector : faiss::IDSelector {
+    const PersonDirectory& directory;
+    const std::vector<int>& person_ids;
+    const PersonFilter* filter;
+    LiveRowSelector(const PersonDirectory& rows, const std::vector<int>& ids, const PersonFilter* allowed)
+        : directory(rows), person_ids(ids), filter(allowed) {}
+    bool is_member(faiss::idx_t id) const override {
+        return static_cast<size_t>(id) < person_ids.size() && !directory.is_deleted(static_cast<size_t>(id)) &&
+               (!filter || filter->allows(person_ids[id]));
+    }
+};
+
+using FilePtr = std::unique_ptr<FILE, int (*)(FILE*)>;
+
+template <typename T>
+bool read_value(FILE* file, T& value) {
+    return std::fread(&value, sizeof(T), 1, file) == 1;
+}
+
+template <typename T>
+bool write_value(FILE* file, const T& value) {
+    return std::fwrite(&value, sizeof(T), 1, file) == 1;
+}
+
+}  // namespace
+
+FaissLibraryIndex::FaissLibraryIndex(int embedding_dimension, Config::FaissIndexType type)
+    : index_type(type),
+      dimension(embedding_dimension),
+      search_effort(type == Config::FaissIndexType::HNSW_FLAT ? Config::HNSW_EF_SEARCH : 0) {}
+
+FaissLibraryIndex::~FaissLibraryIndex() = default;
+
+bool FaissLibraryIndex::is_ivf_type() const {
+    return index_type == Config::FaissIndexType::IVF_FLAT || index_type == Config::FaissIndexType::IVF_PQ;
+}
+
+size_t FaissLibraryIndex::min_training_vectors() const {
+    if (index_type == Config::FaissIndexType::IVF_PQ) {
+        return std::max<size_t>(Config::IVF_MIN_VECTORS, size_t(39) << Config::FAISS_PQ_BITS);
+    }
+    return Config::IVF_MIN_VECTORS;
+}
+
+std::unique_ptr<faiss::Index> FaissLibraryIndex::create_initial_index() const {
+    if (index_type == Config::FaissIndexType::HNSW_FLAT) {
+        auto hnsw = std::make_unique<faiss::IndexHNSWFlat>(dimension, Config::HNSW_M, faiss::METRIC_INNER_PRODUCT);
+        hnsw->hnsw.efConstruction = Config::HNSW_EF_CONSTRUCTION;
+        return hnsw;
+    }
+    // IVF types are scanned exhaustively until train() has enough rows
+    return std::make_unique<faiss::IndexFlatIP>(dimension);
+}
+
+std::unique_ptr<faiss::Index> FaissLibraryIndex::create_ivf_index(size_t num_rows) const {
+    // About 4 * sqrt(N) lists, with at least 39 training points per list as FAISS recommends
+    size_t nlist = static_cast<size_t>(4.0 * std::sqrt(static_cast<double>(num_rows)));
+    nlist = std::max<size_t>(1, std::min(nlist, num_rows / 39));
+
+    auto quantizer = std::make_unique<faiss::IndexFlatIP>(dimension);
+    std::unique_ptr<faiss::IndexIVF> ivf;
+    if (index_type == Config::FaissIndexType::IVF_PQ) {
+        // Sub-quantizers must divide the dimension
+        int subquantizers = std::min(Config::FAISS_PQ_SUBQUANTIZERS, dimension);
+        while (dimension % subquantizers != 0) {
+            subquantizers--;
+        }
+        ivf = std::make_unique<faiss::IndexIVFPQ>(quantizer.get(), dimension, nlist, subquantizers,
+                                                  Config::FAISS_PQ_BITS, faiss::METRIC_INNER_PRODUCT);
+    } else {
+        ivf = std::make_unique<faiss::IndexIVFFlat>(quantizer.get(), dimension, nlist, faiss::METRIC_INNER_PRODUCT);
+    }
+    quantizer.release();
+    ivf->own_fields = true;
+    return ivf;
+}
+
+bool FaissLibraryIndex::build_index(int num_vectors) {
+    if (num_vectors <= 0) {
+        std::cerr << "Error: Invalid number of vectors" << std::endl;
+        return false;
+    }
+
+    try {
+        clear();
+        shared = share(create_initial_index());
+        person_ids.reserve(num_vectors);
+        norms.reserve(num_vectors);
+        is_built = true;
+
+        std::cout << "FAISS library index built successfully"
+                  << " - Type: " << get_backend_name()
+                  << ", Capacity: " << num_vectors
+                  << ", Dimension: " << dimension << std::endl;
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error building FAISS library index: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+std::shared_ptr<FaissLibraryIndex::SharedIndex> FaissLibraryIndex::share(std::unique_ptr<faiss::Index> index) {
+    auto shared_index = std::make_shared<SharedIndex>();
+    shared_index->index = std::move(index);
+    return shared_index;
+}
+
+bool FaissLibraryIndex::appends_to_shared() const {
+    std::shared_lock<std::shared_mutex> lock(shared->mutex);
+    return static_cast<size_t>(shared->index->ntotal) == person_ids.size();
+}
+
+bool FaissLibraryIndex::detach() {
+    // Rows of deleted people are copied too, so row numbers (and tombstones) hold
+    size_t count = person_ids.size();
+    std::vector<float> rows(count * dimension);
+    std::unique_ptr<faiss::Index> own;
+    {
+        std::shared_lock<std::shared_mutex> lock(shared->mutex);
+        for (size_t i = 0; i < count; i++) {
+            shared->index->reconstruct(static_cast<faiss::idx_t>(i), rows.data() + i * dimension);
+        }
+        if (ivf_trained) {
+            own.reset(faiss::clone_index(shared->index.get()));  // Keeps the trained quantizer
+            own->reset();
+        }
+    }
+    if (!own) {
+        own = create_initial_index();
+    }
+    own->add(static_cast<faiss::idx_t>(count), rows.data());
+    shared = share(std::move(own));
+    return true;
+}
+
+bool FaissLibraryIndex::append_rows(const std::vector<int>& ids, const float* rows, size_t count) {
+    // An older snapshot written to after a newer one: the shared rows past ours are not ours
+    if (!appends_to_shared() && !detach()) {
+        return false;
+    }
+    {
+        std::unique_lock<std::shared_mutex> lock(shared->mutex);
+        shared->index->add(static_cast<faiss::idx_t>(count), rows);
+    }
+    for (size_t i = 0; i < count; i++) {
+        const float* vec = rows + i * dimension;
+        norms.push_back(std::inner_product(vec, vec + dimension, vec, 0.0f));
+        person_ids.push_back(ids[i]);
+        directory.add(ids[i], person_ids.size() - 1);
+    }
+    return true;
+}
+
+bool FaissLibraryIndex::add_vector(int person_id, const std::vector<float>& embedding) {
+    return add_vectors({person_id}, {embedding});
+}
+
+bool FaissLibraryIndex::add_vectors(const std::vector<int>& ids,
+                                    const std::vector<std::vector<float>>& emb) {
+    if (!is_built) {
+        std::cerr << "Error: Index not built" << std::endl;
+        return false;
+    }
+
+    if (ids.size() != emb.size()) {
+        std::cerr << "Error: IDs and embeddings size mismatch" << std::endl;
+        return false;
+    }
+
+    // FAISS adds from one contiguous n x d block
+    std::vector<float> rows(emb.size() * dimension);
+    for (size_t i = 0; i < emb.size(); i++) {
+        if (emb[i].size() != static_cast<size_t>(dimension)) {
+            std::cerr << "Error: Embedding dimension mismatch" << std::endl;
+            return false;
+        }
+        std::memcpy(rows.data() + i * dimension, emb[i].data(), sizeof(float) * dimension);
+    }
+
+    try {
+        return append_rows(ids, rows.data(), emb.size());
+    } catch (const std::exception& e) {
+        std::cerr << "Error adding vectors to FAISS library index: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool FaissLibraryIndex::collect_live_rows(std::vector<int>& ids, std::vector<float>& rows) const {
+    // Exact for flat, HNSW-flat and IVF-flat storage; IVF_PQ returns decoded codes
+    ids.clear();
+    rows.clear();
+    rows.reserve(static_cast<size_t>(get_num_vectors()) * dimension);
+    std::vector<float> vec(dimension);
+    std::shared_lock<std::shared_mutex> lock(shared->mutex);
+    for (size_t i = 0; i < person_ids.size(); i++) {
+        if (directory.is_deleted(i)) {
+            continue;
+        }
+        shared->index->reconstruct(static_cast<faiss::idx_t>(i), vec.data());
+        rows.insert(rows.end(), vec.begin(), vec.end());
+        ids.push_back(person_ids[i]);
+    }
+    return true;
+}
+
+void FaissLibraryIndex::search_rows(const float* queries, size_t num_queries, int k, const PersonFilter* filter,
+                                    std::vector<float>& scores, std::vector<int64_t>& rows) const {
+    scores.assign(num_queries * k, 0.0f);
+    rows.assign(num_queries * k, -1);
+
+    std::shared_lock<std::shared_mutex> lock(shared->mutex);
+    const faiss::Index* index = shared->index.get();
+    bool has_newer_rows = static_cast<size_t>(index->ntotal) > person_ids.size();
+    LiveRowSelector live_rows(directory, person_ids, filter);
+    faiss::IDSelector* selector = directory.has_deletions() || filter || has_newer_rows ? &live_rows : nullptr;
+    faiss::idx_t n = static_cast<faiss::idx_t>(num_queries);
+
+    // The speed knob goes in per-call parameters, so the index itself is never modified
+    if (ivf_trained) {
+        faiss::SearchParametersIVF params;
+        size_t nlist = static_cast<const faiss::IndexIVF*>(index)->nlist;
+        params.nprobe = search_effort > 0
+                            ? static_cast<size_t>(search_effort)
+                            : std::max<size_t>(1, static_cast<size_t>(std::ceil(nlist * Config::IVF_PROBE_FRACTION)));
+        params.sel = selector;
+        index->search(n, queries, k, scores.data(), rows.data(), &params);
+    } else if (index_type == Config::FaissIndexType::HNSW_FLAT) {
+        faiss::SearchParametersHNSW params;
+        params.efSearch = std::max(search_effort, k);
+        params.sel = selector;
+        index->search(n, queries, k, scores.data(), rows.data(), &params);
+    } else {
+        faiss::SearchParameters params;
+        params.sel = selector;
+        index->search(n, queries, k, scores.data(), rows.data(), &params);
+    }
+}
+
+double FaissLibraryIndex::row_similarity(float query_norm, float score, int64_t row) const {
+    // ||q - x||² = ||q||² + ||x||² - 2·q·x
+    float squared = query_norm + norms[row] - 2.0f * score;
+    return distance_to_similarity(std::sqrt(std::max(0.0f, squared)));
+}
+
+int FaissLibraryIndex::search(const std::vector<float>& query_embedding, double& confidence) {
+    std::vector<double> confidences;
+    std::vector<int> results = search_k(query_embedding, 1, confidences);
+    if (results.empty()) {
+        std::cerr << "Error: No results found" << std::endl;
+        confidence = 0.0;
+        return -1;
+    }
+
+    confidence = confidences[0];
+    return results[0];
+}
+
+std::vector<int> FaissLibraryIndex::search_k(const std::vector<float>& query_embedding, int k,
+                                             std::vector<double>& confidences) {
+    std::vector<std::vector<double>> batch_confidences;
+    std::vector<std::vector<int>> results = search_batch({query_embedding}, k, batch_confidences);
+    confidences = batch_confidences.empty() ? std::vector<double>() : batch_confidences[0];
+    return results.empty() ? std::vector<int>() : results[0];
+}
+
+std::vector<int> FaissLibraryIndex::search_k(const std::vector<float>& query_embedding, int k,
+                                             const PersonFilter& filter, std::vector<double>& confidences) {
+    confidences.clear();
+    if (filter.empty()) {
+        return std::vector<int>();  // Nobody is allowed: nothing to search
+    }
+    std::vector<std::vector<double>> batch_confidences;
+    std::vector<std::vector<int>> results = search_queries({query_embedding}, k, &filter, batch_confidences);
+    confidences = batch_confidences.empty() ? std::vector<double>() : batch_confidences[0];
+    return results.empty() ? std::vector<int>() : results[0];
+}
+
+std::vector<std::vector<int>> FaissLibraryIndex::search_batch(const std::vector<std::vector<float>>& queries, int k,
+                                                              std::vector<std::vector<double>>& confidences) {
+    return search_queries(queries, k, nullptr, confidences);
+}
+
+std::vector<std::vector<int>> FaissLibraryIndex::search_queries(const std::vector<std::vector<float>>& queries, int k,
+                                                                const PersonFilter* filter,
+                                                                std::vector<std::vector<double>>& confidences) {
+    std::vector<std::vector<int>> results;
+    confidences.clear();
+
+    if (!is_built || get_num_vectors() == 0) {
+        std::cerr << "Error: Index empty or not built" << std::endl;
+        return results;
+    }
+    if (k <= 0 || queries.empty()) {
+        return results;
+    }
+
+    std::vector<float> query_rows(queries.size() * dimension);
+    std::vector<float> query_norms(queries.size());
+    for (size_t q = 0; q < queries.size(); q++) {
+        if (queries[q].size() != static_cast<size_t>(dimension)) {
+            std::cerr << "Error: Query embedding dimension mismatch" << std::endl;
+            return results;
+        }
+        std::memcpy(query_rows.data() + q * dimension, queries[q].data(), sizeof(float) * dimension);
+        query_norms[q] = std::inner_product(queries[q].begin(), queries[q].end(), queries[q].begin(), 0.0f);
+    }
+
+    try {
+        std::vector<float> scores;
+        std::vector<int64_t> rows;
+        search_rows(query_rows.data(), queries.size(), k, filter, scores, rows);
+
+        results.resize(queries.size());
+        confidences.resize(queries.size());
+        for (size_t q = 0; q < queries.size(); q++) {
+            for (int j = 0; j < k; j++) {
+                int64_t row = rows[q * k + j];
+                if (row < 0) {
+                    break;  // Fewer than k live rows reachable
+                }
+                results[q].push_back(person_ids[row]);
+                confidences[q].push_back(row_similarity(query_norms[q], scores[q * k + j], row));
+            }
+        }
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error searching FAISS library index: " << e.what() << std::endl;
+        results.clear();
+        confidences.clear();
+    }
+
+    return results;
+}
+
+int FaissLibraryIndex::verify(const std::vector<float>& query_embedding, int person_id, double& confidence) {
+    confidence = 0.0;
+    if (!is_built || get_num_vectors() == 0) {
+        std::cerr << "Error: Index empty or not built" << std::endl;
+        return 0;
+    }
+    if (query_embedding.size() != static_cast<size_t>(dimension)) {
+        std::cerr << "Error: Query embedding dimension mismatch" << std::endl;
+        return 0;
+    }
+
+    try {
+        float query_norm = std::inner_product(query_embedding.begin(), query_embedding.end(),
+                                              query_embedding.begin(), 0.0f);
+        std::vector<float> vec(dimension);
+        double best = 0.0;
+        int scored = 0;
+        std::shared_lock<std::shared_mutex> lock(shared->mutex);
+        directory.for_each_slot(person_id, [&](size_t i) {
+            shared->index->reconstruct(static_cast<faiss::idx_t>(i), vec.data());
+            float score = std::inner_product(query_embedding.begin(), query_embedding.end(), vec.begin(), 0.0f);
+            best = std::max(best, row_similarity(query_norm, score, static_cast<int64_t>(i)));
+            scored++;
+        });
+        confidence = best;
+        return scored;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error verifying against FAISS library index: " << e.what() << std::endl;
+        return 0;
+    }
+}
+
+bool FaissLibraryIndex::needs_training() const {
+    if (!is_built || !is_ivf_type()) {
+        return false;
+    }
+    size_t live_rows = static_cast<size_t>(get_num_vectors());
+    if (!ivf_trained) {
+        return live_rows >= min_training_vectors();
+    }
+    // Retrain once the gallery has doubled. PQ codes only decode approximately,
+    // so IVF_PQ is refit by a full retrain from the database instead.
+    return index_type == Config::FaissIndexType::IVF_FLAT && live_rows >= 2 * trained_size;
+}
+
+bool FaissLibraryIndex::train() {
+    if (!is_built || !is_ivf_type()) {
+        return true;
+    }
+
+    try {
+        auto start_time = std::chrono::steady_clock::now();
+
+        std::vector<int> ids;
+        std::vector<float> rows;
+        collect_live_rows(ids, rows);
+        if (ids.size() < min_training_vectors()) {
+            std::cerr << "Error: Not enough vectors (" << ids.size()
+                      << ") to train a FAISS " << get_backend_name() << " index" << std::endl;
+            return false;
+        }
+
+        // FAISS subsamples the training set itself (256 points per list)
+        std::unique_ptr<faiss::Index> trained = create_ivf_index(ids.size());
+        trained->train(static_cast<faiss::idx_t>(ids.size()), rows.data());
+        static_cast<faiss::IndexIVF*>(trained.get())->make_direct_map(true);  // Keeps reconstruct() working
+
+        // Re-add every live row; tombstoned rows are dropped on the way.
+        // Copies sharing the old FAISS index keep it.
+        shared = share(std::move(trained));
+        person_ids.clear();
+        norms.clear();
+        directory.clear();
+        append_rows(ids, rows.data(), ids.size());
+        ivf_trained = true;
+        trained_size = ids.size();
+
+        auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time).count();
+        std::cout << "FAISS " << get_backend_name() << " index trained on " << trained_size
+                  << " vectors (" << elapsed_ms << "ms)" << std::endl;
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error training FAISS library index: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+int FaissLibraryIndex::remove_person(int person_id) {
+    return directory.remove(person_id);
+}
+
+std::unique_ptr<VectorIndexBase> FaissLibraryIndex::compacted() const {
+    auto copy = std::make_unique<FaissLibraryIndex>(dimension, index_type);
+    copy->set_model_hash(model_hash);
+    copy->set_projection(projection);
+    copy->set_search_effort(search_effort);
+    if (!is_built) {
+        return copy;
+    }
+
+    try {
+        std::vector<int> ids;
+        std::vector<float> rows;
+        collect_live_rows(ids, rows);
+        if (!copy->build_index(static_cast<int>(std::max<size_t>(ids.size(), 1)))) {
+            return nullptr;
+        }
+        copy->set_log_sequence(log_sequence);
+
+        // Keep the trained quantizer (and PQ codebooks): reset() only drops the vectors
+        if (ivf_trained) {
+            std::unique_ptr<faiss::Index> trained;
+            {
+                std::shared_lock<std::shared_mutex> lock(shared->mutex);
+                trained.reset(faiss::clone_index(shared->index.get()));
+            }
+            trained->reset();
+            copy->shared = share(std::move(trained));
+            copy->ivf_trained = true;
+            copy->trained_size = trained_size;
+        }
+        copy->append_rows(ids, rows.data(), ids.size());
+        return copy;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error compacting FAISS library index: " << e.what() << std::endl;
+        return nullptr;
+    }
+}
+
+bool FaissLibraryIndex::save_index(const std::string& filepath) {
+    if (!is_built) {
+        std::cerr << "Error: Index not built" << std::endl;
+        return false;
+    }
+
+    // The file has no tombstones: deleted rows are left out of what is written,
+    // as are rows newer copies appended to the shared FAISS index
+    if (directory.has_deletions() || !appends_to_shared()) {
+        std::unique_ptr<VectorIndexBase> live = compacted();
+        return live && live->save_index(filepath);
+    }
+
+    // Written beside the target and renamed into place, like the other backends
+    std::string temp_path = filepath + ".tmp";
+
+    try {
+        FilePtr file(std::fopen(temp_path.c_str(), "wb"), &std::fclose);
+        if (!file) {
+            std::cerr << "Error: Could not open file for writing" << std::endl;
+            return false;
+        }
+
+        // Header and row metadata, then FAISS's own serialization of the index
+        uint64_t count = person_ids.size();
+        uint64_t file_trained_size = trained_size;
+        int type = static_cast<int>(index_type);
+        int trained = ivf_trained ? 1 : 0;
+        bool ok = write_value(file.get(), FILE_MAGIC) &&
+                  write_value(file.get(), FILE_VERSION) &&
+                  write_value(file.get(), dimension) &&
+                  write_value(file.get(), type) &&
+                  write_value(file.get(), trained) &&
+                  write_value(file.get(), count) &&
+                  write_value(file.get(), file_trained_size) &&
+                  write_value(file.get(), model_hash) &&
+                  write_value(file.get(), log_sequence) &&
+                  std::fwrite(person_ids.data(), sizeof(int), count, file.get()) == count &&
+                  std::fwrite(norms.data(), sizeof(float), count, file.get()) == count;
+        if (ok) {
+            std::shared_lock<std::shared_mutex> lock(shared->mutex);
+            faiss::write_index(shared->index.get(), file.get());
+        }
+        ok = ok && std::fflush(file.get()) == 0;
+        file.reset();
+
+        if (!ok) {
+            std::cerr << "Error: Failed writing FAISS library index to " << filepath << std::endl;
+            std::remove(temp_path.c_str());
+            return false;
+        }
+        if (!IndexFile::replace_file(temp_path, filepath)) {
+            return false;
+        }
+        std::cout << "FAISS library index saved to: " << filepath << std::endl;
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error saving FAISS library index: " << e.what() << std::endl;
+        std::remove(temp_path.c_str());
+        return false;
+    }
+}
+
+bool FaissLibraryIndex::load_index(const std::string& filepath) {
+    try {
+        clear();
+
+        FilePtr file(std::fopen(filepath.c_str(), "rb"), &std::fclose);
+        if (!file) {
+            std::cerr << "Error: Could not open file for reading" << std::endl;
+            return false;
+        }
+
+        uint32_t magic = 0;
+        if (!read_value(file.get(), magic)) {
+            std::cerr << "Error: FAISS library index file is empty" << std::endl;
+            return false;
+        }
+        if (magic != FILE_MAGIC) {
+            // In-house flat index file: add its rows to a fresh FAISS index
+            std::cout << "Building FAISS library index from flat index file: " << filepath << std::endl;
+            file.reset();
+            if (!load_flat_index(filepath)) {
+                clear();
+                return false;
+            }
+            return true;
+        }
+
+        int version = 0, file_dimension = 0, type = 0, trained = 0;
+        uint64_t count = 0, file_trained_size = 0, file_model_hash = 0, file_log_sequence = 0;
+        bool ok = read_value(file.get(), version) && read_value(file.get(), file_dimension) &&
+                  read_value(file.get(), type) && read_value(file.get(), trained) &&
+                  read_value(file.get(), count) && read_value(file.get(), file_trained_size) &&
+                  read_value(file.get(), file_model_hash) && read_value(file.get(), file_log_sequence);
+        if (!ok || version != FILE_VERSION || file_dimension <= 0 ||
+            type < 0 || type > static_cast<int>(Config::FaissIndexType::IVF_PQ)) {
+            std::cerr << "Error: Invalid FAISS library index file: " << filepath << std::endl;
+            return false;
+        }
+        if (model_hash != 0 && file_model_hash != 0 && model_hash != file_model_hash) {
+            std::cerr << "Error: FAISS library index was built with a different embedding model" << std::endl;
+            return false;
+        }
+
+        person_ids.resize(count);
+        norms.resize(count);
+        if (std::fread(person_ids.data(), sizeof(int), count, file.get()) != count ||
+            std::fread(norms.data(), sizeof(float), count, file.get()) != count) {
+            std::cerr << "Error: Truncated FAISS library index file: " << filepath << std::endl;
+            clear();
+            return false;
+        }
+
+        std::unique_ptr<faiss::Index> loaded(faiss::read_index(file.get()));
+        if (!loaded || loaded->d != file_dimension || static_cast<uint64_t>(loaded->ntotal) != count) {
+            std::cerr << "Error: FAISS index in " << filepath << " does not match its header" << std::endl;
+            clear();
+            return false;
+        }
+
+        // The index type comes from the file so the stored structure stays valid
+        index_type = static_cast<Config::FaissIndexType>(type);
+        dimension = file_dimension;
+        shared = share(std::move(loaded));
+        ivf_trained = trained != 0;
+        trained_size = file_trained_size;
+        log_sequence = file_log_sequence;
+        for (size_t i = 0; i < person_ids.size(); i++) {
+            directory.add(person_ids[i], i);
+        }
+        is_built = true;
+
+        std::cout << "FAISS library index loaded from: " << filepath << std::endl;
+        std::cout << "Loaded " << count << " vectors with dimension " << dimension
+                  << " (" << get_backend_name() << ")" << std::endl;
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading FAISS library index: " << e.what() << std::endl;
+        clear();
+        return false;
+    }
+}
+
+bool FaissLibraryIndex::load_flat_index(const std::string& filepath) {
+    // Let the flat index validate and decode its own file format
+    FAISSIndex flat(dimension, Config::IndexStorage::FLOAT32);
+    flat.set_model_hash(model_hash);
+    if (!flat.load_index(filepath)) {
+        return false;
+    }
+
+    dimension = flat.get_dimension();
+    int num_vectors = flat.get_num_vectors();
+    if (!build_index(std::max(num_vectors, 1))) {
+        return false;
+    }
+    log_sequence = flat.get_log_sequence();
+
+    std::vector<int> ids(num_vectors);
+    std::vector<float> rows(static_cast<size_t>(num_vectors) * dimension);
+    std::vector<float> embedding;
+    for (int i = 0; i < num_vectors; i++) {
+        if (!flat.get_vector(i, embedding, ids[i])) {
+            return false;
+        }
+        std::memcpy(rows.data() + static_cast<size_t>(i) * dimension, embedding.data(), sizeof(float) * dimension);
+    }
+    append_rows(ids, rows.data(), ids.size());
+    return !needs_training() || train();
+}
+
+const char* FaissLibraryIndex::get_backend_name() const {
+    switch (index_type) {
+        case Config::FaissIndexType::FLAT_IP:   return "faiss-flat";
+        case Config::FaissIndexType::IVF_FLAT:  return "faiss-ivf";
+        case Config::FaissIndexType::HNSW_FLAT: return "faiss-hnsw";
+        case Config::FaissIndexType::IVF_PQ:    return "faiss-ivfpq";
+    }
+    return "faiss";
+}
+
+void FaissLibraryIndex::clear() {
+    log_sequence = 0;
+    shared.reset();
+    person_ids.clear();
+    norms.clear();
+    directory.clear();
+    ivf_trained = false;
+    trained_size = 0;
+    is_built = false;
+}
+
+std::unique_ptr<VectorIndexBase> FaissLibraryIndex::clone() const {
+    // The FAISS index is shared, not copied; the copy's appends go past our rows
+    auto copy = std::make_unique<FaissLibraryIndex>(dimension, index_type);
+    copy->model_hash = model_hash;
+    copy->log_sequence = log_sequence;
+    copy->projection = projection;
+    copy->is_built = is_built;
+    copy->ivf_trained = ivf_trained;
+    copy->trained_size = trained_size;
+    copy->person_ids = person_ids;
+    copy->norms = norms;
+    copy->directory = directory;
+    copy->search_effort = search_effort;
+    copy->shared = shared;
+    return copy;
+}
+
+#endif // HAVE_FAISS
@@ -123,32 +123,39 @@ ProcessedFrame FrameProcessor::process_frame(const cv::Mat& frame, bool enable_r
                 // Check if recognizer is trained
                 if (is_recognizer_ready()) {
                     result.recognition_ran = true;  // Mark that recognition ran this frame
-                    for (auto& face : result.faces) {
-                        double confidence = 0.0;
 
-                        // Extract face ROI from bounding box for recognition
+                    // Collect the ROIs inside the frame, then recognize them in one batch
+                    // so the gallery is scanned once per frame rather than once per face
+                    std::vector<cv::Mat> face_rois;
+                    std::vector<size_t> roi_faces;
+                    for (size_t i = 0; i < result.faces.size(); i++) {
+                        Face& face = result.faces[i];
+                        face.id = -1;
+                        face.name = "Unknown";
+
                         cv::Rect bbox = face.bbox;
                         if (!bbox.empty() && bbox.x >= 0 && bbox.y >= 0 &&
                             bbox.x + bbox.width <= result.frame.cols &&
                             bbox.y + bbox.height <= result.frame.rows) {
-                            try {
-                                cv::Mat face_roi = result.frame(bbox);
-                                face.id = recognizer->recognize(face_roi, confidence);
-                                face.confidence = confidence * 100.0;  // Convert to percentage
+                            face_rois.push_back(result.frame(bbox));
+                            roi_faces.push_back(i);
+                        }
+                    }
 
-                                if (face.id > 0) {
+                    if (!face_rois.empty()) {
+                        try {
+                            std::vector<double> confidences;
+                            std::vector<int> ids = recognizer->recognize_batch(face_rois, confidences);
+                            for (size_t r = 0; r < roi_faces.size() && r < ids.size(); r++) {
+                                Face& face = result.faces[roi_faces[r]];
+                                face.confidence = confidences[r] * 100.0;  // Convert to percentage
+                                if (ids[r] > 0) {
+                                    face.id = ids[r];
                                     face.name = recognizer->get_label_name(face.id);
-                                } else {
-                                    face.name = "Unknown";
-                                    face.id = -1;
                                 }
-                            } catch (const std::exception& e) {
-                                face.id = -1;
-                                face.name = "Unknown";
                             }
-                        } else {
-                            face.id = -1;
-                            face.name = "Unknown";
+                        } catch (const std::exception& e) {
+                            LOG_ERROR("Exception in batch recognition: " << e.what());
                         }
                     }
                     // Cache the recognition results
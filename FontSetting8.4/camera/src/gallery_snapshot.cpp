@@ -0,0 +1,315 @@
+#include "gallery_snapshot.h"
+#include "index_log.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <unistd.h>
+
+namespace GallerySnapshot {
+
+static uint64_t header_digest(SnapshotHeader header) {
+    header.header_checksum = 0;
+    return IndexFile::checksum(&header, sizeof(header));
+}
+
+// ========================
+// Records
+// ========================
+
+void RecordEncoder::put_i32(int32_t value) {
+    const unsigned char* raw = reinterpret_cast<const unsigned char*>(&value);
+    bytes.insert(bytes.end(), raw, raw + sizeof(value));
+}
+
+void RecordEncoder::put_string(const std::string& value) {
+    put_blob(value.data(), value.size());
+}
+
+void RecordEncoder::put_blob(const void* data, size_t size) {
+    uint32_t length = static_cast<uint32_t>(size);
+    const unsigned char* raw = reinterpret_cast<const unsigned char*>(&length);
+    bytes.insert(bytes.end(), raw, raw + sizeof(length));
+    const unsigned char* payload = static_cast<const unsigned char*>(data);
+    bytes.insert(bytes.end(), payload, payload + size);
+}
+
+bool RecordDecoder::get_i32(int32_t& value) {
+    if (offset > size || size - offset < sizeof(value)) {
+        offset = size + 1;  // Stays failed; at_end() is false from now on
+        return false;
+    }
+    std::memcpy(&value, data + offset, sizeof(value));
+    offset += sizeof(value);
+    return true;
+}
+
+bool RecordDecoder::get_length(uint32_t& length) {
+    if (offset > size || size - offset < sizeof(length)) {
+        offset = size + 1;
+        return false;
+    }
+    std::memcpy(&length, data + offset, sizeof(length));
+    offset += sizeof(length);
+    if (size - offset < length) {
+        offset = size + 1;
+        return false;
+    }
+    return true;
+}
+
+bool RecordDecoder::get_string(std::string& value) {
+    uint32_t length = 0;
+    if (!get_length(length)) {
+        return false;
+    }
+    value.assign(reinterpret_cast<const char*>(data + offset), length);
+    offset += length;
+    return true;
+}
+
+bool RecordDecoder::get_blob(std::vector<unsigned char>& value) {
+    uint32_t length = 0;
+    if (!get_length(length)) {
+        return false;
+    }
+    value.assign(data + offset, data + offset + length);
+    offset += length;
+    return true;
+}
+
+// ========================
+// Writer
+// ========================
+
+Writer::~Writer() {
+    abort();
+}
+
+bool Writer::open(const std::string& snapshot_path, uint64_t model_hash, int dimension, size_t max_chunk) {
+    abort();
+    path = snapshot_path;
+    temp_path = snapshot_path + ".tmp";
+    chunk_bytes = std::max<size_t>(std::min<uint64_t>(max_chunk, MAX_CHUNK_BYTES), 4096);
+    pending.clear();
+    pending.reserve(chunk_bytes);
+    chain = IndexFile::Checksum();
+    num_chunks = 0;
+    bytes_written = 0;
+    failed = false;
+
+    file = std::fopen(temp_path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error: Could not create " << temp_path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    header = SnapshotHeader{};
+    std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.header_size = sizeof(SnapshotHeader);
+    header.model_hash = model_hash;
+    header.dimension = static_cast<uint32_t>(dimension);
+    header.max_chunk_bytes = static_cast<uint32_t>(chunk_bytes);
+    header.created_at = static_cast<int64_t>(std::time(nullptr));
+    header.header_checksum = header_digest(header);
+
+    // Rewritten with the final counts by finish()
+    return write_bytes(&header, sizeof(header));
+}
+
+bool Writer::write_bytes(const void* data, size_t size) {
+    if (failed || !file) {
+        return false;
+    }
+    if (size > 0 && std::fwrite(data, 1, size, file) != size) {
+        std::cerr << "Error: Could not write " << temp_path << ": " << std::strerror(errno) << std::endl;
+        failed = true;
+        return false;
+    }
+    bytes_written += size;
+    return true;
+}
+
+bool Writer::write_chunk(SectionType type, const unsigned char* payload, size_t size) {
+    ChunkHeader chunk{};
+    chunk.type = static_cast<uint32_t>(type);
+    chunk.size = size;
+    chunk.checksum = IndexFile::checksum(payload, size);
+    chain.update(&chunk, sizeof(chunk));
+    num_chunks++;
+    return write_bytes(&chunk, sizeof(chunk)) && write_bytes(payload, size);
+}
+
+bool Writer::flush_chunk() {
+    if (pending.empty()) {
+        return !failed;
+    }
+    bool ok = write_chunk(pending_type, pending.data(), pending.size());
+    pending.clear();
+    return ok;
+}
+
+bool Writer::append_record(SectionType type, const RecordEncoder& record) {
+    const std::vector<unsigned char>& bytes = record.get_bytes();
+    if (bytes.size() > chunk_bytes) {
+        std::cerr << "Error: Snapshot record of " << bytes.size() << " bytes exceeds the chunk size" << std::endl;
+        failed = true;
+        return false;
+    }
+    if ((type != pending_type || pending.size() + bytes.size() > chunk_bytes) && !flush_chunk()) {
+        return false;
+    }
+    pending_type = type;
+    pending.insert(pending.end(), bytes.begin(), bytes.end());
+    return !failed;
+}
+
+bool Writer::append_file(SectionType type, const std::string& file_path) {
+    if (!flush_chunk()) {
+        return false;
+    }
+    std::FILE* input = std::fopen(file_path.c_str(), "rb");
+    if (!input) {
+        std::cerr << "Error: Could not open " << file_path << ": " << std::strerror(errno) << std::endl;
+        failed = true;
+        return false;
+    }
+
+    // The pending buffer is empty here and already holds chunk_bytes of capacity
+    pending.resize(chunk_bytes);
+    bool ok = true;
+    size_t got;
+    while (ok && (got = std::fread(pending.data(), 1, chunk_bytes, input)) > 0) {
+        ok = write_chunk(type, pending.data(), got);
+    }
+    if (ok && std::ferror(input)) {
+        std::cerr << "Error: Could not read " << file_path << std::endl;
+        failed = true;
+        ok = false;
+    }
+    std::fclose(input);
+    pending.clear();
+    return ok;
+}
+
+bool Writer::finish(uint64_t num_people, uint64_t num_embeddings) {
+    if (!flush_chunk()) {
+        abort();
+        return false;
+    }
+
+    uint64_t end[2] = {num_chunks, chain.digest()};
+    header.num_people = num_people;
+    header.num_embeddings = num_embeddings;
+    header.header_checksum = header_digest(header);
+    bool ok = write_chunk(SectionType::END, reinterpret_cast<const unsigned char*>(end), sizeof(end)) &&
+              std::fseek(file, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              std::fflush(file) == 0 && fsync(fileno(file)) == 0;
+    ok = (std::fclose(file) == 0) && ok;
+    file = nullptr;
+    if (!ok || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Error: Could not write " << path << ": " << std::strerror(errno) << std::endl;
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    IndexLog::sync_path(path);
+    return true;
+}
+
+void Writer::abort() {
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+        std::remove(temp_path.c_str());
+    }
+}
+
+// ========================
+// Reader
+// ========================
+
+Reader::~Reader() {
+    if (file) {
+        std::fclose(file);
+    }
+}
+
+bool Reader::read_bytes(void* data, size_t size) {
+    return size == 0 || std::fread(data, 1, size, file) == size;
+}
+
+bool Reader::open(const std::string& snapshot_path) {
+    if (file) {
+        std::fclose(file);
+    }
+    path = snapshot_path;
+    chain = IndexFile::Checksum();
+    num_chunks = 0;
+    complete = false;
+
+    file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        std::cerr << "Error: Could not open " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (!read_bytes(&header, sizeof(header)) || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        std::cerr << "Error: " << path << " is not a gallery snapshot" << std::endl;
+        return false;
+    }
+    if (header.version != VERSION || header.header_size != sizeof(SnapshotHeader)) {
+        std::cerr << "Error: Unsupported gallery snapshot version " << header.version << std::endl;
+        return false;
+    }
+    if (header.header_checksum != header_digest(header) || header.max_chunk_bytes > MAX_CHUNK_BYTES) {
+        std::cerr << "Error: Corrupt gallery snapshot header in " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Reader::next_chunk(SectionType& type, std::vector<unsigned char>& payload) {
+    if (!file || complete) {
+        return false;
+    }
+
+    ChunkHeader chunk{};
+    if (!read_bytes(&chunk, sizeof(chunk))) {
+        std::cerr << "Error: Gallery snapshot " << path << " is truncated" << std::endl;
+        return false;
+    }
+    if (chunk.size > header.max_chunk_bytes && chunk.type != static_cast<uint32_t>(SectionType::END)) {
+        std::cerr << "Error: Corrupt chunk header in gallery snapshot " << path << std::endl;
+        return false;
+    }
+
+    if (chunk.type == static_cast<uint32_t>(SectionType::END)) {
+        uint64_t end[2] = {0, 0};
+        if (chunk.size != sizeof(end) || !read_bytes(end, sizeof(end)) ||
+            chunk.checksum != IndexFile::checksum(end, sizeof(end)) ||
+            end[0] != num_chunks || end[1] != chain.digest()) {
+            std::cerr << "Error: Gallery snapshot " << path << " is incomplete or corrupt" << std::endl;
+            return false;
+        }
+        complete = true;
+        return false;
+    }
+
+    payload.resize(chunk.size);
+    if (!read_bytes(payload.data(), payload.size())) {
+        std::cerr << "Error: Gallery snapshot " << path << " is truncated" << std::endl;
+        return false;
+    }
+    if (IndexFile::checksum(payload.data(), payload.size()) != chunk.checksum) {
+        std::cerr << "Error: Checksum mismatch in gallery snapshot " << path << " (chunk " << num_chunks
+                  << ")" << std::endl;
+        return false;
+    }
+    chain.update(&chunk, sizeof(chunk));
+    num_chunks++;
+    type = static_cast<SectionType>(chunk.type);
+    return true;
+}
+
+} // namespace GallerySnapshot
@@ -260,7 +260,8 @@ gboolean GTKApp::refresh_frame() {
         return FALSE; // Stop timer
     }
 
-    if (!camera_running || capture_in_progress || training_in_progress) {
+    // Training swaps in its index atomically, so frames keep flowing meanwhile
+    if (!camera_running || capture_in_progress) {
         return TRUE; // Continue timer but don't process frames
     }
 
@@ -399,7 +400,8 @@ gboolean GTKApp::process_recognition() {
         return FALSE; // Stop timer
     }
 
-    if (!camera_running || !face_recognition_enabled || capture_in_progress || training_in_progress) {
+    // Recognition searches the last published index while training runs
+    if (!camera_running || !face_recognition_enabled || capture_in_progress) {
         return TRUE; // Continue timer but don't process
     }
 
@@ -454,7 +456,8 @@ gboolean GTKApp::process_recognition() {
         int recognized_count = 0;
         int unknown_count = 0;
 
-        // Count recognized vs unknown faces
+        // Count recognized vs unknown faces; the cached result is read by stream clients
+        std::lock_guard<std::mutex> lock(recognition_mutex);
         for (const auto& face : processed.faces) {
             if (face.id != -1) {
                 recognized_count++;
@@ -817,7 +820,7 @@ void GTKApp::load_face_recognizer() {
         face_recognizer.set_database(&face_database);
 
         // Load ArcFace ONNX model (InsightFace w600k_r50)
-        std::string model_path = "models/arcface_w600k_r50.onnx";
+        std::string model_path = Config::ARCFACE_MODEL_PATH;
         if (!std::filesystem::exists(model_path)) {
             LOG_WARN("ArcFace model not found at " << model_path);
             LOG_INFO("Please download the model and place it at: " << model_path);
@@ -895,8 +898,8 @@ void GTKApp::train_model() {
         gtk_message_dialog_format_secondary_text(
             GTK_MESSAGE_DIALOG(error_dialog),
             "Cannot train the model because the ArcFace ONNX model is missing or failed to load.\n\n"
-            "Please download the ArcFace ONNX model to models/arcface_w600k_r50.onnx\n"
-            "Visit: https://huggingface.co/public-data/insightface");
+            "Please download the ArcFace ONNX model to %s\n"
+            "Visit: https://huggingface.co/public-data/insightface", Config::ARCFACE_MODEL_PATH);
         gtk_dialog_run(GTK_DIALOG(error_dialog));
         gtk_widget_destroy(error_dialog);
         gtk_label_set_text(GTK_LABEL(status_label), "Status: Model not loaded - cannot train");
@@ -981,8 +984,8 @@ void GTKApp::capture_photo() {
         gtk_message_dialog_format_secondary_text(
             GTK_MESSAGE_DIALOG(error_dialog),
             "Cannot capture photos because the ArcFace model is missing or failed to load.\n\n"
-            "Please download the ArcFace ONNX model to models/arcface_w600k_r50.onnx\n"
-            "Visit: https://huggingface.co/public-data/insightface");
+            "Please download the ArcFace ONNX model to %s\n"
+            "Visit: https://huggingface.co/public-data/insightface", Config::ARCFACE_MODEL_PATH);
         gtk_dialog_run(GTK_DIALOG(error_dialog));
         gtk_widget_destroy(error_dialog);
         gtk_label_set_text(GTK_LABEL(status_label), "Status: Model not loaded - cannot capture");
@@ -1041,6 +1044,26 @@ void GTKApp::capture_photo() {
 
             // Create person-specific subdirectory: dataset/A1/, dataset/B2/, etc.
             std::string person_name = initial_str + id_num;  // e.g., "A1", "B2"
+
+            // Stop before anything is saved if this face is enrolled under another ID
+            std::string duplicate = check_duplicate_capture(last_frame, person_name);
+            if (!duplicate.empty()) {
+                GtkWidget* duplicate_dialog = gtk_message_dialog_new(
+                    GTK_WINDOW(window),
+                    GTK_DIALOG_MODAL,
+                    GTK_MESSAGE_WARNING,
+                    GTK_BUTTONS_OK,
+                    "Face Already Enrolled");
+                gtk_message_dialog_format_secondary_text(
+                    GTK_MESSAGE_DIALOG(duplicate_dialog), "%s", duplicate.c_str());
+                gtk_dialog_run(GTK_DIALOG(duplicate_dialog));
+                gtk_widget_destroy(duplicate_dialog);
+                gtk_widget_destroy(dialog);
+                capture_in_progress = false;
+                gtk_label_set_text(GTK_LABEL(status_label), "Status: Capture refused - face already enrolled");
+                return;
+            }
+
             std::string person_dir = "dataset/" + person_name;
 
             try {
@@ -1196,17 +1219,8 @@ void GTKApp::capture_photo() {
                                 gtk_label_set_text(GTK_LABEL(status_label), add_text);
                                 LOG_INFO("Person added to recognition model: " << person_name);
 
-                                // Reload FAISS index from disk to ensure memory reflects saved state
-                                std::string faiss_index_path = "faiss_index.bin";
-                                if (std::filesystem::exists(faiss_index_path)) {
-                                    if (face_recognizer.load_index(faiss_index_path)) {
-                                        // Index reloaded successfully
-                                    } else {
-                                        LOG_ERROR("Failed to reload FAISS index");
-                                    }
-                                }
-
-                                // Ensure label maps are up-to-date after reload
+                                // The in-memory index already has the new embedding and it is
+                                // persisted in the index log, so no reload from disk is needed
                                 face_recognizer.load_labels_from_database();
 
                                 // Verify person is in label maps
@@ -1216,14 +1230,6 @@ void GTKApp::capture_photo() {
                                     face_recognizer.register_person(person.name);
                                 }
 
-                                // Verify model is trained
-                                if (!face_recognizer.is_trained()) {
-                                    // Force train by loading the index again
-                                    if (std::filesystem::exists(faiss_index_path)) {
-                                        face_recognizer.load_index(faiss_index_path);
-                                    }
-                                }
-
                                 // Enable face recognition if not already enabled
                                 if (!face_recognition_enabled) {
                                     face_recognition_enabled = true;
@@ -1281,6 +1287,78 @@ void GTKApp::capture_photo() {
     gtk_label_set_text(GTK_LABEL(status_label), "Status: Live stream resumed");
 }
 
+std::string GTKApp::check_duplicate_capture(const cv::Mat& frame, std::string& person_name) {
+    if (frame.empty() || !face_recognizer.is_trained()) {
+        return "";  // Nobody enrolled yet
+    }
+
+    // Embed the same face region the enrollment will use (largest detected face)
+    cv::Rect face_box = find_largest_face(frame);
+    cv::Mat face_image = face_box.area() > 0 ? frame(face_box) : frame;
+
+    std::vector<float> embedding = face_recognizer.extract_embedding(face_image);
+    std::vector<double> similarities;
+    std::vector<int> matches = face_recognizer.find_matching_people(
+        embedding, Config::DUPLICATE_FACE_SIMILARITY, similarities);
+
+    // Another photo of the requested person is not a duplicate
+    int requested_id = face_recognizer.get_label_from_name(person_name);
+    if (matches.empty() || matches[0] == requested_id) {
+        return "";
+    }
+
+    std::ostringstream conflicts;
+    int listed = 0;
+    for (size_t i = 0; i < matches.size() && listed < Config::DUPLICATE_FACE_REPORT_LIMIT; i++) {
+        if (matches[i] == requested_id) {
+            continue;
+        }
+        conflicts << (listed++ > 0 ? ", " : "") << face_recognizer.get_label_name(matches[i])
+                  << " (" << static_cast<int>(similarities[i] * 100.0) << "%)";
+    }
+
+    std::string matched_name = face_recognizer.get_label_name(matches[0]);
+    switch (Config::DUPLICATE_CAPTURE_POLICY) {
+        case Config::DuplicateCapturePolicy::ALLOW:
+            LOG_WARN("Capture for " << person_name << " matches " << conflicts.str() << ", enrolling anyway");
+            return "";
+        case Config::DuplicateCapturePolicy::MERGE:
+            if (matched_name != "Unknown") {
+                LOG_INFO("Capture for " << person_name << " matches " << conflicts.str()
+                         << ", merging into " << matched_name);
+                person_name = matched_name;
+                return "";
+            }
+            break;  // No name to merge into: refuse
+        case Config::DuplicateCapturePolicy::REFUSE:
+        default:
+            break;
+    }
+
+    LOG_WARN("Capture for " << person_name << " refused, face matches " << conflicts.str());
+    return "Duplicate face - already enrolled as " + conflicts.str();
+}
+
+cv::Rect GTKApp::find_largest_face(const cv::Mat& frame) {
+    std::vector<Face> detected_faces = face_detector.detect_faces(frame);
+    if (detected_faces.empty()) {
+        return cv::Rect();
+    }
+
+    cv::Rect best_bbox = detected_faces[0].bbox;
+    for (const auto& face : detected_faces) {
+        if (face.bbox.area() > best_bbox.area()) {
+            best_bbox = face.bbox;
+        }
+    }
+    if (best_bbox.x >= 0 && best_bbox.y >= 0 &&
+        best_bbox.x + best_bbox.width <= frame.cols &&
+        best_bbox.y + best_bbox.height <= frame.rows) {
+        return best_bbox;
+    }
+    return cv::Rect();
+}
+
 void GTKApp::setup_socket_server() {
     socket_server = std::make_unique<SocketServer>();
 
@@ -1309,6 +1387,34 @@ void GTKApp::setup_socket_server() {
         return handle_list_persons(args);
     });
 
+    socket_server->register_command("delete", [this](const std::string& args) {
+        return handle_delete_person(args);
+    });
+
+    socket_server->register_command("group", [this](const std::string& args) {
+        return handle_group(args, true);
+    });
+
+    socket_server->register_command("ungroup", [this](const std::string& args) {
+        return handle_group(args, false);
+    });
+
+    socket_server->register_command("door", [this](const std::string& args) {
+        return handle_door(args);
+    });
+
+    socket_server->register_command("verify", [this](const std::string& args) {
+        return handle_verify(args);
+    });
+
+    socket_server->register_command("export", [this](const std::string& args) {
+        return handle_snapshot(args, false);
+    });
+
+    socket_server->register_command("import", [this](const std::string& args) {
+        return handle_snapshot(args, true);
+    });
+
     socket_server->register_streaming_command("stream_recognition", [this](int client_fd) {
         handle_stream_recognition(client_fd);
     });
@@ -1362,6 +1468,19 @@ std::string GTKApp::handle_capture(const std::string& args) {
     // Use the person_id directly as the folder name
     std::string person_name = id_str;
 
+    // One frame for both the duplicate check and the saved photo
+    cv::Mat frame = last_frame.clone();
+    if (frame.empty()) {
+        return "ERROR:Failed to capture photo";
+    }
+
+    // Refuse (or merge) before anything is saved if the face is already enrolled
+    std::string duplicate = check_duplicate_capture(frame, person_name);
+    if (!duplicate.empty()) {
+        return "ERROR:" + duplicate;
+    }
+    bool merged = person_name != id_str;
+
     // Create dataset directory if it doesn't exist
     if (!std::filesystem::exists("dataset")) {
         std::filesystem::create_directory("dataset");
@@ -1386,7 +1505,7 @@ std::string GTKApp::handle_capture(const std::string& args) {
     std::string filename = person_dir + "/" + std::to_string(sequence) + ".jpg";
 
     // Save the current frame
-    if (last_frame.empty() || !cv::imwrite(filename, last_frame)) {
+    if (!cv::imwrite(filename, frame)) {
         return "ERROR:Failed to capture photo";
     }
 
@@ -1440,16 +1559,16 @@ std::string GTKApp::handle_capture(const std::string& args) {
 
             if (face_database.add_face_embedding(person.id, filename, embedding_bytes)) {
                 if (face_recognizer.add_training_data(image_for_training, person.id)) {
-                    std::string faiss_index_path = "faiss_index.bin";
-                    if (std::filesystem::exists(faiss_index_path)) {
-                        face_recognizer.load_index(faiss_index_path);
-                    }
                     face_recognizer.load_labels_from_database();
 
                     if (!face_recognition_enabled) {
                         face_recognition_enabled = true;
                     }
 
+                    if (merged) {
+                        return "OK:Photo captured and merged into " + person_name +
+                               " (face matches, requested " + id_str + ")";
+                    }
                     return "OK:Photo captured and person added - " + person_name;
                 } else {
                     return "ERROR:Failed to add to recognition model";
@@ -1503,6 +1622,155 @@ std::string GTKApp::handle_list_persons(const std::string& /* args */) {
     }
 }
 
+std::string GTKApp::handle_delete_person(const std::string& args) {
+    // Text clients send a trailing newline
+    std::string name = args;
+    name.erase(name.find_last_not_of(" \t\n\r") + 1);
+    if (name.empty()) {
+        return "ERROR:Missing arguments. Usage: delete:Person";
+    }
+
+    PersonRecord person;
+    if (!face_database.get_person_by_name(name, person)) {
+        return "ERROR:Person not found - " + name;
+    }
+
+    // Tombstones the person's rows in the live index; no retraining needed
+    if (!face_recognizer.delete_person(person.id)) {
+        return "ERROR:Failed to delete person - " + name;
+    }
+
+    // The captured photos would bring the person back on the next retrain
+    std::error_code ec;
+    std::filesystem::remove_all("dataset/" + name, ec);
+    if (ec) {
+        LOG_WARN("Could not remove dataset folder for " << name << ": " << ec.message());
+    }
+
+    LOG_INFO("Deleted person " << name);
+    return "OK:Person deleted - " + name;
+}
+
+std::string GTKApp::handle_group(const std::string& args, bool add) {
+    // Parse arguments: "Person:group" (text clients send a trailing newline)
+    std::string trimmed = args;
+    trimmed.erase(trimmed.find_last_not_of(" \t\n\r") + 1);
+    size_t colon = trimmed.find(':');
+    std::string name = trimmed.substr(0, colon);
+    std::string group = colon == std::string::npos ? "" : trimmed.substr(colon + 1);
+    if (name.empty() || group.empty() || group.find(',') != std::string::npos) {
+        return add ? "ERROR:Missing arguments. Usage: group:Person:group"
+                   : "ERROR:Missing arguments. Usage: ungroup:Person:group";
+    }
+
+    PersonRecord person;
+    if (!face_database.get_person_by_name(name, person)) {
+        return "ERROR:Person not found - " + name;
+    }
+
+    bool updated = add ? face_recognizer.add_person_to_group(person.id, group)
+                       : face_recognizer.remove_person_from_group(person.id, group);
+    if (!updated) {
+        return "ERROR:Failed to update group " + group + " for " + name;
+    }
+
+    LOG_INFO((add ? "Added " : "Removed ") << name << (add ? " to group " : " from group ") << group);
+    return std::string(add ? "OK:Added to group - " : "OK:Removed from group - ") + name + ":" + group;
+}
+
+std::string GTKApp::handle_door(const std::string& args) {
+    // Parse arguments: "groupA,groupB" admits either group; empty admits everyone
+    std::string trimmed = args;
+    trimmed.erase(trimmed.find_last_not_of(" \t\n\r") + 1);
+    std::vector<std::string> groups;
+    std::istringstream iss(trimmed);
+    std::string group;
+    while (std::getline(iss, group, ',')) {
+        if (!group.empty()) {
+            groups.push_back(group);
+        }
+    }
+
+    if (!face_recognizer.set_access_groups(groups)) {
+        return "ERROR:Could not save door groups";
+    }
+    if (groups.empty()) {
+        LOG_INFO("Door admits everyone");
+        return "OK:Door admits everyone";
+    }
+    LOG_INFO("Door admits groups " << trimmed << " ("
+             << face_recognizer.get_group_filter(groups).count() << " people)");
+    return "OK:Door admits - " + trimmed;
+}
+
+std::string GTKApp::handle_verify(const std::string& args) {
+    if (!camera_running) {
+        return "ERROR:Camera not running";
+    }
+
+    // Parse arguments: "id" (the claimed person, as entered on the PIN pad)
+    std::string id_str = args;
+    id_str.erase(id_str.find_last_not_of(" \t\n\r") + 1);
+    if (id_str.empty()) {
+        return "ERROR:Missing arguments. Usage: verify:12345";
+    }
+
+    int person_id = face_recognizer.get_label_from_name(id_str);
+    if (person_id < 0) {
+        return "ERROR:Person not found - " + id_str;
+    }
+
+    cv::Mat frame = last_frame.clone();
+    if (frame.empty()) {
+        return "ERROR:Failed to capture photo";
+    }
+    cv::Rect face_box = find_largest_face(frame);
+    if (face_box.area() == 0) {
+        return "ERROR:No face detected";
+    }
+
+    double confidence = 0.0;
+    bool verified = face_recognizer.verify(frame(face_box), person_id, confidence);
+    std::string score = " (" + std::to_string(static_cast<int>(confidence * 100.0)) + "%)";
+    LOG_INFO("Verification of " << id_str << (verified ? " passed" : " failed") << score);
+    if (!verified) {
+        return "ERROR:Not verified - " + id_str + score;
+    }
+    return "OK:Verified - " + id_str + score;
+}
+
+std::string GTKApp::handle_snapshot(const std::string& args, bool import) {
+    // Parse arguments: "path" of the snapshot file on the kiosk
+    std::string path = args;
+    path.erase(path.find_last_not_of(" \t\n\r") + 1);
+    if (path.empty()) {
+        return import ? "ERROR:Missing arguments. Usage: import:/path/gallery.snap"
+                      : "ERROR:Missing arguments. Usage: export:/path/gallery.snap";
+    }
+    if (training_in_progress) {
+        return "ERROR:Training already in progress";
+    }
+
+    if (!import) {
+        if (!face_recognizer.export_snapshot(path)) {
+            return "ERROR:Export failed - " + path;
+        }
+        LOG_INFO("Exported gallery snapshot to " << path);
+        return "OK:Exported - " + path;
+    }
+
+    if (!std::filesystem::exists(path)) {
+        return "ERROR:Snapshot not found - " + path;
+    }
+    // Recognition keeps using the old gallery until the new one is published
+    if (!face_recognizer.import_snapshot(path)) {
+        return "ERROR:Snapshot rejected - " + path;
+    }
+    face_recognition_enabled = face_recognizer.is_trained();
+    LOG_INFO("Imported gallery snapshot " << path << " (" << face_database.get_num_people() << " people)");
+    return "OK:Imported - " + std::to_string(face_database.get_num_people()) + " people";
+}
+
 void GTKApp::handle_stream_recognition(int client_fd) {
     // Send initial status
     std::string initial_response = "OK:Stream started\n";
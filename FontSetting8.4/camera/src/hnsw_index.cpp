@@ -0,0 +1,735 @@
+#include "hnsw_index.h"
+#include "faiss_index.h"
+#include "index_file.h"
+#include "top_k.h"
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <queue>
+#include <cstdio>
+
+HNSWIndex::HNSWIndex(int embedding_dimension, int M, int ef_construction_size)
+    : dimension(embedding_dimension),
+      stride(VectorKernels::padded_stride(embedding_dimension)),
+      max_links(std::max(2, M)),
+      max_links_base(2 * std::max(2, M)),
+      ef_construction(std::max(ef_construction_size, std::max(2, M))),
+      level_multiplier(1.0 / std::log(static_cast<double>(std::max(2, M)))) {}
+
+HNSWIndex::~HNSWIndex() {
+    clear();
+}
+
+bool HNSWIndex::build_index(int num_vectors) {
+    if (num_vectors <= 0) {
+        std::cerr << "Error: Invalid number of vectors" << std::endl;
+        return false;
+    }
+
+    try {
+        clear();
+
+        size_t capacity = static_cast<size_t>(num_vectors);
+        matrix.reserve(capacity * stride);
+        norms.reserve(capacity);
+        person_ids.reserve(capacity);
+        node_levels.reserve(capacity);
+        base_links.reserve(capacity * (max_links_base + 1));
+
+        std::cout << "HNSW index built successfully"
+                  << " - Capacity: " << num_vectors
+                  << ", Dimension: " << dimension
+                  << ", M: " << max_links
+                  << ", efConstruction: " << ef_construction
+                  << ", efSearch: " << ef_search
+                  << ", Kernel: " << VectorKernels::get_active_isa() << std::endl;
+
+        is_built = true;
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error building HNSW index: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool HNSWIndex::add_vector(int person_id, const std::vector<float>& embedding) {
+    if (!is_built) {
+        std::cerr << "Error: Index not built" << std::endl;
+        return false;
+    }
+
+    if (embedding.size() != static_cast<size_t>(dimension)) {
+        std::cerr << "Error: Embedding dimension mismatch. Expected "
+                  << dimension << ", got " << embedding.size() << std::endl;
+        return false;
+    }
+
+    return append_node(person_id, embedding.data());
+}
+
+bool HNSWIndex::add_vectors(const std::vector<int>& ids,
+                            const std::vector<std::vector<float>>& emb) {
+    if (!is_built) {
+        std::cerr << "Error: Index not built" << std::endl;
+        return false;
+    }
+
+    if (ids.size() != emb.size()) {
+        std::cerr << "Error: IDs and embeddings size mismatch" << std::endl;
+        return false;
+    }
+
+    for (size_t i = 0; i < emb.size(); i++) {
+        if (emb[i].size() != static_cast<size_t>(dimension)) {
+            std::cerr << "Error: Embedding dimension mismatch" << std::endl;
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < emb.size(); i++) {
+        if (!append_node(ids[i], emb[i].data())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool HNSWIndex::append_node(int person_id, const float* embedding) {
+    try {
+        // Rows are zero-padded up to stride so kernels never read past the data
+        float* new_row = matrix.append(stride);
+        std::memcpy(new_row, embedding, sizeof(float) * dimension);
+        norms.push_back(VectorKernels::dot_product(new_row, new_row, stride));
+        person_ids.push_back(person_id);
+        directory.add(person_id, person_ids.size() - 1);
+
+        int level = random_level();
+        node_levels.push_back(level);
+        base_links.resize(base_links.size() + max_links_base + 1, 0);
+        upper_links.emplace_back(static_cast<size_t>(level) * (max_links + 1), 0);
+
+        insert_node(static_cast<int>(person_ids.size() - 1));
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error adding vector to HNSW index: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+VectorKernels::AlignedFloatVector HNSWIndex::pad_query(const std::vector<float>& query,
+                                                       float& query_norm) const {
+    VectorKernels::AlignedFloatVector padded(stride, 0.0f);
+    std::memcpy(padded.data(), query.data(), sizeof(float) * dimension);
+    query_norm = VectorKernels::dot_product(padded.data(), padded.data(), stride);
+    return padded;
+}
+
+int* HNSWIndex::links_of(int node, int level) {
+    if (level == 0) {
+        return base_links.data() + static_cast<size_t>(node) * (max_links_base + 1);
+    }
+    return upper_links[node].data() + static_cast<size_t>(level - 1) * (max_links + 1);
+}
+
+const int* HNSWIndex::links_of(int node, int level) const {
+    if (level == 0) {
+        return base_links.data() + static_cast<size_t>(node) * (max_links_base + 1);
+    }
+    return upper_links[node].data() + static_cast<size_t>(level - 1) * (max_links + 1);
+}
+
+int HNSWIndex::random_level() {
+    // Exponentially decaying level distribution: P(level >= l) = M^-l
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    double r = uniform(level_rng);
+    if (r <= 0.0) {
+        r = std::numeric_limits<double>::min();
+    }
+    return static_cast<int>(-std::log(r) * level_multiplier);
+}
+
+float HNSWIndex::distance(const float* query, float query_norm, int node) const {
+    // ||q - x||² = ||q||² + ||x||² - 2·q·x
+    return query_norm + norms[node] - 2.0f * VectorKernels::dot_product(query, row(node), stride);
+}
+
+HNSWIndex::VisitedMarks& HNSWIndex::begin_visit(size_t num_nodes) {
+    // One set per thread, so concurrent searches of the same graph never share
+    // marks. Tags only grow, so marks left by any earlier search are stale.
+    thread_local VisitedMarks marks;
+    if (marks.tags.size() < num_nodes) {
+        marks.tags.resize(num_nodes, 0);
+    }
+    marks.tag++;
+    if (marks.tag == 0) {
+        // Tag wrapped around: old marks could alias, so clear them once
+        std::fill(marks.tags.begin(), marks.tags.end(), 0);
+        marks.tag = 1;
+    }
+    return marks;
+}
+
+int HNSWIndex::greedy_descend(const float* query, float query_norm,
+                              int start, int from_level, int to_level) const {
+    int current = start;
+    float current_dist = distance(query, query_norm, current);
+
+    for (int level = from_level; level > to_level; level--) {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            const int* links = links_of(current, level);
+            for (int j = 1; j <= links[0]; j++) {
+                float d = distance(query, query_norm, links[j]);
+                if (d < current_dist) {
+                    current_dist = d;
+                    current = links[j];
+                    changed = true;
+                }
+            }
+        }
+    }
+    return current;
+}
+
+std::vector<HNSWIndex::Candidate> HNSWIndex::search_layer(const float* query, float query_norm,
+                                                           int start, int ef, int level,
+                                                           bool skip_deleted, const PersonFilter* filter) const {
+    VisitedMarks& visited = begin_visit(person_ids.size());
+
+    // candidates: closest first; results: farthest first, capped at ef.
+    // Deleted nodes and nodes of people outside the filter are still traversed
+    // (they keep the graph connected) but never returned.
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+    std::priority_queue<Candidate> results;
+    auto returnable = [&](int node) {
+        return (!skip_deleted || !directory.is_deleted(node)) && (!filter || filter->allows(person_ids[node]));
+    };
+
+    float start_dist = distance(query, query_norm, start);
+    candidates.push({start_dist, start});
+    if (returnable(start)) {
+        results.push({start_dist, start});
+    }
+    visited.tags[start] = visited.tag;
+
+    while (!candidates.empty()) {
+        Candidate closest = candidates.top();
+        if (static_cast<int>(results.size()) >= ef && closest.first > results.top().first) {
+            break;
+        }
+        candidates.pop();
+
+        const int* links = links_of(closest.second, level);
+        for (int j = 1; j <= links[0]; j++) {
+            int neighbor = links[j];
+            if (visited.tags[neighbor] == visited.tag) {
+                continue;
+            }
+            visited.tags[neighbor] = visited.tag;
+
+            float d = distance(query, query_norm, neighbor);
+            if (static_cast<int>(results.size()) < ef || d < results.top().first) {
+                candidates.push({d, neighbor});
+                if (!returnable(neighbor)) {
+                    continue;
+                }
+                results.push({d, neighbor});
+                if (static_cast<int>(results.size()) > ef) {
+                    results.pop();
+                }
+            }
+        }
+    }
+
+    std::vector<Candidate> found;
+    found.reserve(results.size());
+    while (!results.empty()) {
+        found.push_back(results.top());
+        results.pop();
+    }
+    std::reverse(found.begin(), found.end());  // Nearest first
+    return found;
+}
+
+std::vector<int> HNSWIndex::select_neighbors(std::vector<Candidate> candidates,
+                                             int max_count) const {
+    std::sort(candidates.begin(), candidates.end());
+
+    // Heuristic from the HNSW paper: skip a candidate that is closer to an
+    // already selected neighbor than to the base node, which keeps links
+    // spread across directions instead of all pointing into one cluster.
+    std::vector<int> selected;
+    selected.reserve(max_count);
+    for (const Candidate& candidate : candidates) {
+        if (static_cast<int>(selected.size()) >= max_count) {
+            break;
+        }
+        const float* vec = row(candidate.second);
+        bool keep = true;
+        for (int chosen : selected) {
+            float d = distance(vec, norms[candidate.second], chosen);
+            if (d < candidate.first) {
+                keep = false;
+                break;
+            }
+        }
+        if (keep) {
+            selected.push_back(candidate.second);
+        }
+    }
+    return selected;
+}
+
+void HNSWIndex::connect(int node, int neighbor, int level) {
+    int* links = links_of(neighbor, level);
+    int limit = max_links_at(level);
+
+    if (links[0] < limit) {
+        links[++links[0]] = node;
+        return;
+    }
+
+    // Neighbor list is full: re-select among the old links plus the new node
+    const float* base = row(neighbor);
+    std::vector<Candidate> candidates;
+    candidates.reserve(limit + 1);
+    candidates.push_back({distance(base, norms[neighbor], node), node});
+    for (int j = 1; j <= links[0]; j++) {
+        candidates.push_back({distance(base, norms[neighbor], links[j]), links[j]});
+    }
+
+    std::vector<int> selected = select_neighbors(candidates, limit);
+    links[0] = static_cast<int>(selected.size());
+    std::copy(selected.begin(), selected.end(), links + 1);
+}
+
+void HNSWIndex::insert_node(int node) {
+    int level = node_levels[node];
+
+    if (entry_point < 0) {
+        entry_point = node;
+        max_level = level;
+        return;
+    }
+
+    const float* vec = row(node);
+    float vec_norm = norms[node];
+
+    // Greedy descent through the layers above the new node's top level
+    int current = greedy_descend(vec, vec_norm, entry_point, max_level, level);
+
+    for (int l = std::min(level, max_level); l >= 0; l--) {
+        std::vector<Candidate> candidates = search_layer(vec, vec_norm, current, ef_construction, l);
+        std::vector<int> neighbors = select_neighbors(candidates, max_links_at(l));
+
+        int* links = links_of(node, l);
+        links[0] = static_cast<int>(neighbors.size());
+        std::copy(neighbors.begin(), neighbors.end(), links + 1);
+
+        for (int neighbor : neighbors) {
+            connect(node, neighbor, l);
+        }
+        current = candidates.front().second;
+    }
+
+    if (level > max_level) {
+        entry_point = node;
+        max_level = level;
+    }
+}
+
+int HNSWIndex::search(const std::vector<float>& query_embedding, double& confidence) {
+    std::vector<double> confidences;
+    std::vector<int> results = search_k(query_embedding, 1, confidences);
+    if (results.empty()) {
+        std::cerr << "Error: No results found" << std::endl;
+        confidence = 0.0;
+        return -1;
+    }
+
+    confidence = confidences[0];
+    return results[0];
+}
+
+std::vector<int> HNSWIndex::search_k(const std::vector<float>& query_embedding,
+                                     int k,
+                                     std::vector<double>& confidences) {
+    return search_nodes(query_embedding, k, nullptr, confidences);
+}
+
+std::vector<int> HNSWIndex::search_k(const std::vector<float>& query_embedding, int k,
+                                     const PersonFilter& filter, std::vector<double>& confidences) {
+    if (filter.empty()) {
+        confidences.clear();
+        return std::vector<int>();  // Nobody is allowed: nothing to search
+    }
+    return search_nodes(query_embedding, k, &filter, confidences);
+}
+
+int HNSWIndex::verify(const std::vector<float>& query_embedding, int person_id, double& confidence) {
+    confidence = 0.0;
+    if (!is_built || get_num_vectors() == 0) {
+        std::cerr << "Error: Index empty or not built" << std::endl;
+        return 0;
+    }
+
+    if (query_embedding.size() != static_cast<size_t>(dimension)) {
+        std::cerr << "Error: Query embedding dimension mismatch" << std::endl;
+        return 0;
+    }
+
+    float query_norm = 0.0f;
+    VectorKernels::AlignedFloatVector query = pad_query(query_embedding, query_norm);
+    float best = std::numeric_limits<float>::infinity();
+    int scored = 0;
+    directory.for_each_slot(person_id, [&](size_t node) {
+        best = std::min(best, distance(query.data(), query_norm, static_cast<int>(node)));
+        scored++;
+    });
+
+    if (scored > 0) {
+        confidence = distance_to_similarity(std::sqrt(std::max(0.0f, best)));
+    }
+    return scored;
+}
+
+std::vector<int> HNSWIndex::search_nodes(const std::vector<float>& query_embedding, int k,
+                                         const PersonFilter* filter, std::vector<double>& confidences) const {
+    std::vector<int> results;
+    confidences.clear();
+
+    if (!is_built || get_num_vectors() == 0) {
+        std::cerr << "Error: Index empty or not built" << std::endl;
+        return results;
+    }
+
+    if (query_embedding.size() != static_cast<size_t>(dimension)) {
+        std::cerr << "Error: Query embedding dimension mismatch" << std::endl;
+        return results;
+    }
+
+    try {
+        float query_norm = 0.0f;
+        VectorKernels::AlignedFloatVector query = pad_query(query_embedding, query_norm);
+
+        // A filtered walk must visit about 1/selectivity times more nodes to
+        // collect ef allowed ones; once that costs more distances than the
+        // allowed nodes themselves, score those directly (exact, and cheaper)
+        bool direct = false;
+        if (filter) {
+            double people = static_cast<double>(std::max<size_t>(1, directory.get_num_people()));
+            double selectivity = std::max(1e-6, filter->count() / people);
+            double allowed_nodes = selectivity * get_num_vectors();
+            double walk_distances = std::max(ef_search, k) * static_cast<double>(max_links_base) / selectivity;
+            direct = selectivity <= Config::FILTER_DIRECT_SCAN_FRACTION || allowed_nodes <= walk_distances;
+        }
+
+        std::vector<Candidate> found;
+        if (direct) {
+            TopKSelector nearest(static_cast<size_t>(std::max(0, k)));
+            filter->for_each([&](int person_id) {
+                directory.for_each_slot(person_id, [&](size_t node) {
+                    nearest.push(distance(query.data(), query_norm, static_cast<int>(node)), static_cast<int>(node));
+                });
+            });
+            found = nearest.take_sorted();
+        } else {
+            int start = greedy_descend(query.data(), query_norm, entry_point, max_level, 0);
+            found = search_layer(query.data(), query_norm, start, std::max(ef_search, k), 0, true, filter);
+        }
+
+        k = std::min(k, static_cast<int>(found.size()));
+        for (int i = 0; i < k; i++) {
+            float dist = std::sqrt(std::max(0.0f, found[i].first));
+            results.push_back(person_ids[found[i].second]);
+            confidences.push_back(distance_to_similarity(dist));
+        }
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error searching HNSW index: " << e.what() << std::endl;
+    }
+
+    return results;
+}
+
+bool HNSWIndex::save_index(const std::string& filepath) {
+    if (!is_built) {
+        std::cerr << "Error: Index not built" << std::endl;
+        return false;
+    }
+
+    // The file has no tombstones: the graph is rebuilt from the live nodes
+    if (directory.has_deletions()) {
+        std::unique_ptr<VectorIndexBase> live = compacted();
+        return live && live->save_index(filepath);
+    }
+
+    // Written beside the target and renamed into place, like the flat index
+    std::string temp_path = filepath + ".tmp";
+
+    try {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "Error: Could not open file for writing" << std::endl;
+            return false;
+        }
+
+        // Header
+        uint32_t magic = FILE_MAGIC;
+        int version = FILE_VERSION;
+        int num_vectors = static_cast<int>(person_ids.size());
+        file.write((const char*)&magic, sizeof(uint32_t));
+        file.write((const char*)&version, sizeof(int));
+        file.write((const char*)&dimension, sizeof(int));
+        file.write((const char*)&num_vectors, sizeof(int));
+        file.write((const char*)&max_links, sizeof(int));
+        file.write((const char*)&ef_construction, sizeof(int));
+        file.write((const char*)&entry_point, sizeof(int));
+        file.write((const char*)&max_level, sizeof(int));
+        file.write((const char*)&model_hash, sizeof(uint64_t));
+        file.write((const char*)&log_sequence, sizeof(uint64_t));
+
+        // Nodes: embedding, person_id, level, then the links of each level
+        for (int i = 0; i < num_vectors; i++) {
+            file.write((const char*)row(i), sizeof(float) * dimension);
+            file.write((const char*)&person_ids[i], sizeof(int));
+            file.write((const char*)&node_levels[i], sizeof(int));
+            for (int l = 0; l <= node_levels[i]; l++) {
+                const int* links = links_of(i, l);
+                file.write((const char*)links, sizeof(int) * (links[0] + 1));
+            }
+        }
+
+        file.close();
+        if (!file) {
+            std::cerr << "Error: Failed writing HNSW index to " << filepath << std::endl;
+            std::remove(temp_path.c_str());
+            return false;
+        }
+        if (!IndexFile::replace_file(temp_path, filepath)) {
+            return false;
+        }
+        std::cout << "HNSW index saved to: " << filepath << std::endl;
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error saving HNSW index: " << e.what() << std::endl;
+        std::remove(temp_path.c_str());
+        return false;
+    }
+}
+
+bool HNSWIndex::load_index(const std::string& filepath) {
+    try {
+        clear();
+
+        std::ifstream file(filepath, std::ios::binary);
+        if (!file) {
+            std::cerr << "Error: Could not open file for reading" << std::endl;
+            return false;
+        }
+
+        uint32_t magic = 0;
+        file.read((char*)&magic, sizeof(uint32_t));
+        if (!file) {
+            std::cerr << "Error: HNSW index file is empty" << std::endl;
+            return false;
+        }
+
+        bool loaded = false;
+        if (magic == FILE_MAGIC) {
+            loaded = load_graph(file);
+        } else {
+            // Flat index file (either layout): rebuild the graph from its rows
+            std::cout << "Building HNSW graph from flat index file: " << filepath << std::endl;
+            file.close();
+            loaded = load_flat_index(filepath);
+        }
+
+        if (!loaded) {
+            std::cerr << "Error: Invalid or truncated HNSW index file: " << filepath << std::endl;
+            clear();
+            return false;
+        }
+
+        std::cout << "HNSW index loaded from: " << filepath << std::endl;
+        std::cout << "Loaded " << person_ids.size() << " vectors with dimension " << dimension
+                  << ", max level " << max_level << std::endl;
+        return true;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading HNSW index: " << e.what() << std::endl;
+        clear();
+        return false;
+    }
+}
+
+bool HNSWIndex::load_graph(std::ifstream& file) {
+    int version = 0, file_dimension = 0, num_vectors = 0, file_m = 0, file_ef_construction = 0;
+    int file_entry_point = -1, file_max_level = -1;
+    file.read((char*)&version, sizeof(int));
+    file.read((char*)&file_dimension, sizeof(int));
+    file.read((char*)&num_vectors, sizeof(int));
+    file.read((char*)&file_m, sizeof(int));
+    file.read((char*)&file_ef_construction, sizeof(int));
+    file.read((char*)&file_entry_point, sizeof(int));
+    file.read((char*)&file_max_level, sizeof(int));
+
+    // Version 1 files predate the model hash, version 2 the log sequence
+    uint64_t file_model_hash = 0;
+    uint64_t file_log_sequence = 0;
+    if (version >= 2) {
+        file.read((char*)&file_model_hash, sizeof(uint64_t));
+    }
+    if (version >= 3) {
+        file.read((char*)&file_log_sequence, sizeof(uint64_t));
+    }
+    if (model_hash != 0 && file_model_hash != 0 && model_hash != file_model_hash) {
+        std::cerr << "Error: HNSW index was built with a different embedding model" << std::endl;
+        return false;
+    }
+
+    if (!file || version < 1 || version > FILE_VERSION || file_dimension <= 0 || num_vectors < 0 || file_m < 2 ||
+        file_entry_point >= num_vectors || (num_vectors > 0 && file_entry_point < 0)) {
+        return false;
+    }
+
+    // Graph parameters come from the file so the stored links stay valid
+    dimension = file_dimension;
+    stride = VectorKernels::padded_stride(dimension);
+    max_links = file_m;
+    max_links_base = 2 * file_m;
+    ef_construction = std::max(file_ef_construction, file_m);
+    level_multiplier = 1.0 / std::log(static_cast<double>(file_m));
+
+    size_t count = static_cast<size_t>(num_vectors);
+    matrix.clear();
+    float* rows = matrix.append(count * stride);
+    norms.resize(count);
+    person_ids.resize(count);
+    node_levels.resize(count);
+    base_links.assign(count * (max_links_base + 1), 0);
+    upper_links.resize(count);
+
+    for (int i = 0; i < num_vectors; i++) {
+        float* vec = rows + static_cast<size_t>(i) * stride;
+        file.read((char*)vec, sizeof(float) * dimension);
+        file.read((char*)&person_ids[i], sizeof(int));
+        file.read((char*)&node_levels[i], sizeof(int));
+        if (!file || node_levels[i] < 0 || node_levels[i] > file_max_level) {
+            return false;
+        }
+        norms[i] = VectorKernels::dot_product(vec, vec, stride);
+        directory.add(person_ids[i], static_cast<size_t>(i));
+        upper_links[i].assign(static_cast<size_t>(node_levels[i]) * (max_links + 1), 0);
+
+        for (int l = 0; l <= node_levels[i]; l++) {
+            int* links = links_of(i, l);
+            file.read((char*)links, sizeof(int));
+            if (!file || links[0] < 0 || links[0] > max_links_at(l)) {
+                return false;
+            }
+            file.read((char*)(links + 1), sizeof(int) * links[0]);
+            if (!file) {
+                return false;
+            }
+        }
+    }
+
+    // Links may point forward, so validate them once every node is known
+    for (int i = 0; i < num_vectors; i++) {
+        for (int l = 0; l <= node_levels[i]; l++) {
+            const int* links = links_of(i, l);
+            for (int j = 1; j <= links[0]; j++) {
+                if (links[j] < 0 || links[j] >= num_vectors || node_levels[links[j]] < l) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    entry_point = file_entry_point;
+    max_level = num_vectors > 0 ? file_max_level : -1;
+    log_sequence = file_log_sequence;
+    is_built = true;
+    return true;
+}
+
+bool HNSWIndex::load_flat_index(const std::string& filepath) {
+    // Let the flat index validate and decode its own file format
+    FAISSIndex flat(dimension, Config::IndexStorage::FLOAT32);
+    flat.set_model_hash(model_hash);
+    if (!flat.load_index(filepath)) {
+        return false;
+    }
+
+    dimension = flat.get_dimension();
+    stride = VectorKernels::padded_stride(dimension);
+    log_sequence = flat.get_log_sequence();
+    is_built = true;
+
+    std::vector<float> embedding;
+    int num_vectors = flat.get_num_vectors();
+    for (int i = 0; i < num_vectors; i++) {
+        int person_id = 0;
+        if (!flat.get_vector(i, embedding, person_id) || !append_node(person_id, embedding.data())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void HNSWIndex::clear() {
+    log_sequence = 0;
+    matrix.clear();
+    norms.clear();
+    person_ids.clear();
+    directory.clear();
+    node_levels.clear();
+    base_links.clear();
+    upper_links.clear();
+    entry_point = -1;
+    max_level = -1;
+    level_rng.seed(42);
+    is_built = false;
+}
+
+std::unique_ptr<VectorIndexBase> HNSWIndex::clone() const {
+    return std::make_unique<HNSWIndex>(*this);
+}
+
+int HNSWIndex::remove_person(int person_id) {
+    // Nodes stay in the graph as waypoints; only search results skip them
+    return directory.remove(person_id);
+}
+
+std::unique_ptr<VectorIndexBase> HNSWIndex::compacted() const {
+    auto copy = std::make_unique<HNSWIndex>(dimension, max_links, ef_construction);
+    copy->set_model_hash(model_hash);
+    copy->set_projection(projection);
+    copy->set_ef_search(ef_search);
+    if (!is_built) {
+        return copy;
+    }
+
+    size_t num_nodes = person_ids.size();
+    size_t live_nodes = num_nodes - directory.get_num_deleted();
+    if (!copy->build_index(static_cast<int>(std::max<size_t>(live_nodes, 1)))) {
+        return nullptr;
+    }
+    copy->set_log_sequence(log_sequence);
+
+    // Links into deleted nodes cannot be patched cheaply, so the live nodes
+    // are re-inserted into a fresh graph
+    for (size_t i = 0; i < num_nodes; i++) {
+        if (!directory.is_deleted(i) && !copy->append_node(person_ids[i], row(i))) {
+            return nullptr;
+        }
+    }
+    return copy;
+}
@@ -0,0 +1,240 @@
+#include "index_file.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace IndexFile {
+
+static constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+static constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+static constexpr uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+
+static inline uint64_t rotate_left(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t load_u64(const unsigned char* bytes) {
+    uint64_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+static inline uint64_t mix_lane(uint64_t lane, uint64_t input) {
+    lane += input * PRIME2;
+    lane = rotate_left(lane, 31);
+    return lane * PRIME1;
+}
+
+Checksum::Checksum(uint64_t seed) {
+    lanes[0] = seed + PRIME1 + PRIME2;
+    lanes[1] = seed + PRIME2;
+    lanes[2] = seed;
+    lanes[3] = seed - PRIME1;
+}
+
+void Checksum::update(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    total += size;
+
+    // Complete a partially filled block first
+    if (buffered > 0) {
+        size_t take = std::min(size, sizeof(buffer) - buffered);
+        std::memcpy(buffer + buffered, bytes, take);
+        buffered += take;
+        bytes += take;
+        size -= take;
+        if (buffered < sizeof(buffer)) {
+            return;
+        }
+        for (int lane = 0; lane < 4; lane++) {
+            lanes[lane] = mix_lane(lanes[lane], load_u64(buffer + lane * 8));
+        }
+        buffered = 0;
+    }
+
+    while (size >= 32) {
+        lanes[0] = mix_lane(lanes[0], load_u64(bytes));
+        lanes[1] = mix_lane(lanes[1], load_u64(bytes + 8));
+        lanes[2] = mix_lane(lanes[2], load_u64(bytes + 16));
+        lanes[3] = mix_lane(lanes[3], load_u64(bytes + 24));
+        bytes += 32;
+        size -= 32;
+    }
+
+    std::memcpy(buffer, bytes, size);
+    buffered = size;
+}
+
+uint64_t Checksum::digest() const {
+    uint64_t hash = rotate_left(lanes[0], 1) + rotate_left(lanes[1], 7) +
+                    rotate_left(lanes[2], 12) + rotate_left(lanes[3], 18);
+    hash += total;
+
+    size_t i = 0;
+    for (; i + 8 <= buffered; i += 8) {
+        hash ^= mix_lane(0, load_u64(buffer + i));
+        hash = rotate_left(hash, 27) * PRIME1 + PRIME3;
+    }
+    for (; i < buffered; i++) {
+        hash ^= buffer[i] * PRIME3;
+        hash = rotate_left(hash, 11) * PRIME1;
+    }
+
+    // Final avalanche
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t checksum(const void* data, size_t size) {
+    Checksum sum;
+    sum.update(data, size);
+    return sum.digest();
+}
+
+uint64_t checksum_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return 0;
+    }
+
+    Checksum sum;
+    std::vector<char> chunk(1 << 20);
+    while (file) {
+        file.read(chunk.data(), chunk.size());
+        std::streamsize got = file.gcount();
+        if (got <= 0) {
+            break;
+        }
+        sum.update(chunk.data(), static_cast<size_t>(got));
+    }
+    return sum.digest();
+}
+
+uint64_t cached_checksum_file(const std::string& path) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        return 0;
+    }
+    uint64_t size = static_cast<uint64_t>(info.st_size);
+    uint64_t mtime_ns = static_cast<uint64_t>(info.st_mtim.tv_sec) * 1000000000ULL +
+                        static_cast<uint64_t>(info.st_mtim.tv_nsec);
+
+    // "<size> <mtime ns> <checksum>" of the file as it was when hashed
+    std::string cache_path = path + ".hash";
+    std::ifstream cache(cache_path);
+    uint64_t cached_size = 0, cached_mtime_ns = 0, cached_checksum = 0;
+    if (cache >> cached_size >> cached_mtime_ns >> cached_checksum &&
+        cached_size == size && cached_mtime_ns == mtime_ns && cached_checksum != 0) {
+        return cached_checksum;
+    }
+    cache.close();
+
+    uint64_t file_checksum = checksum_file(path);
+    if (file_checksum != 0) {
+        std::string temp_path = cache_path + ".tmp";
+        std::ofstream out(temp_path, std::ios::trunc);
+        out << size << ' ' << mtime_ns << ' ' << file_checksum << '\n';
+        out.close();
+        if (!out || std::rename(temp_path.c_str(), cache_path.c_str()) != 0) {
+            std::remove(temp_path.c_str());  // Read-only model directory: hash again next time
+        }
+    }
+    return file_checksum;
+}
+
+uint64_t stamp_file(const std::string& path) {
+    IndexFileHeader header{};
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return 0;
+    }
+    if (file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+        std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == VERSION &&
+        header.header_size == sizeof(IndexFileHeader) && header.header_checksum != 0) {
+        return header.header_checksum;
+    }
+    return cached_checksum_file(path);
+}
+
+bool replace_file(const std::string& temp_path, const std::string& path) {
+    int file_fd = ::open(temp_path.c_str(), O_RDONLY);
+    bool ok = file_fd >= 0 && fsync(file_fd) == 0;
+    if (file_fd >= 0) {
+        ::close(file_fd);
+    }
+    if (!ok || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Error: Could not replace " << path << ": " << std::strerror(errno) << std::endl;
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    // The rename is only durable once the directory entry is synced
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+    int dir_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir_fd >= 0) {
+        ok = fsync(dir_fd) == 0;
+        ::close(dir_fd);
+    }
+    return ok;
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: Could not open " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        std::cerr << "Error: Could not stat " << path << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    void* mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // The mapping keeps the file alive
+    if (mapped == MAP_FAILED) {
+        std::cerr << "Error: Could not mmap " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    data = static_cast<unsigned char*>(mapped);
+    size = static_cast<size_t>(info.st_size);
+    return true;
+}
+
+void MappedFile::swap(MappedFile& other) {
+    std::swap(data, other.data);
+    std::swap(size, other.size);
+}
+
+void MappedFile::close() {
+    if (data) {
+        munmap(data, size);
+        data = nullptr;
+        size = 0;
+    }
+}
+
+} // namespace IndexFile
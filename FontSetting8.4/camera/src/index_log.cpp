@@ -0,0 +1,343 @@
+#include "index_log.h"
+#include "index_file.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+constexpr char IndexLog::MAGIC[8];
+
+static bool write_all(int fd, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = ::write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+static bool read_all(int fd, void* data, size_t size, off_t offset) {
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t got = ::pread(fd, bytes, size, offset);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        bytes += got;
+        size -= static_cast<size_t>(got);
+        offset += got;
+    }
+    return true;
+}
+
+IndexLog::~IndexLog() {
+    close();
+}
+
+size_t IndexLog::record_size() const {
+    return sizeof(uint64_t) + 2 * sizeof(int32_t) + sizeof(float) * dimension + sizeof(uint64_t);
+}
+
+bool IndexLog::write_header(int file_descriptor) const {
+    IndexLogHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.dimension = static_cast<uint32_t>(dimension);
+    header.model_hash = model_hash;
+    return write_all(file_descriptor, &header, sizeof(header));
+}
+
+bool IndexLog::open(const std::string& log_path, int embedding_dimension,
+                    uint64_t embedding_model_hash, uint64_t base_sequence) {
+    return open_file(log_path, embedding_dimension, embedding_model_hash, base_sequence, O_RDWR | O_CREAT);
+}
+
+bool IndexLog::open_read_only(const std::string& log_path, int embedding_dimension,
+                              uint64_t embedding_model_hash, uint64_t base_sequence) {
+    return open_file(log_path, embedding_dimension, embedding_model_hash, base_sequence, O_RDONLY);
+}
+
+bool IndexLog::open_file(const std::string& log_path, int embedding_dimension,
+                         uint64_t embedding_model_hash, uint64_t base_sequence, int flags) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+
+    path = log_path;
+    dimension = embedding_dimension;
+    model_hash = embedding_model_hash;
+    num_records = 0;
+    last_sequence = base_sequence;
+
+    if (dimension <= 0) {
+        return false;
+    }
+
+    fd = ::open(path.c_str(), flags, 0644);
+    if (fd < 0) {
+        if (errno != ENOENT || (flags & O_CREAT)) {
+            std::cerr << "Error: Could not open index log " << path << ": " << std::strerror(errno) << std::endl;
+        }
+        return false;
+    }
+
+    if (!recover((flags & O_ACCMODE) != O_RDONLY)) {
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    return true;
+}
+
+bool IndexLog::recover(bool repair) {
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        return false;
+    }
+
+    // Start over when the log is empty or belongs to another model/dimension
+    IndexLogHeader header{};
+    bool header_valid = info.st_size >= static_cast<off_t>(sizeof(header)) &&
+                        read_all(fd, &header, sizeof(header), 0) &&
+                        std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                        header.version == VERSION &&
+                        header.dimension == static_cast<uint32_t>(dimension) &&
+                        (model_hash == 0 || header.model_hash == 0 || header.model_hash == model_hash);
+    if (!header_valid) {
+        if (!repair) {
+            return true;  // Read as empty
+        }
+        if (info.st_size > 0) {
+            std::cerr << "Warning: Discarding incompatible index log " << path << std::endl;
+        }
+        return ftruncate(fd, 0) == 0 && lseek(fd, 0, SEEK_SET) == 0 && write_header(fd) && fdatasync(fd) == 0;
+    }
+
+    // Keep the valid prefix; a torn tail from a crash mid-append is cut off
+    size_t size = record_size();
+    std::vector<unsigned char> buffer(size);
+    off_t offset = sizeof(header);
+    uint64_t previous = 0;
+    while (offset + static_cast<off_t>(size) <= info.st_size) {
+        if (!read_all(fd, buffer.data(), size, offset)) {
+            break;
+        }
+        uint64_t sequence = 0, stored_checksum = 0;
+        std::memcpy(&sequence, buffer.data(), sizeof(sequence));
+        std::memcpy(&stored_checksum, buffer.data() + size - sizeof(uint64_t), sizeof(uint64_t));
+        if (stored_checksum != IndexFile::checksum(buffer.data(), size - sizeof(uint64_t)) ||
+            sequence <= previous) {
+            break;
+        }
+        previous = sequence;
+        num_records++;
+        last_sequence = std::max(last_sequence, sequence);
+        offset += static_cast<off_t>(size);
+    }
+
+    if (offset < info.st_size && repair) {
+        std::cerr << "Warning: Truncating index log " << path << " at byte " << offset
+                  << " (" << (info.st_size - offset) << " bytes of incomplete records)" << std::endl;
+        if (ftruncate(fd, offset) != 0 || fdatasync(fd) != 0) {
+            return false;
+        }
+    }
+    return lseek(fd, offset, SEEK_SET) == offset;
+}
+
+void IndexLog::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    num_records = 0;
+}
+
+bool IndexLog::is_open() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return fd >= 0;
+}
+
+void IndexLog::encode_record(const Record& record, std::vector<unsigned char>& buffer) const {
+    size_t size = record_size();
+    buffer.assign(size, 0);
+    int32_t id = record.person_id;
+    uint32_t kind = static_cast<uint32_t>(record.kind);
+    std::memcpy(buffer.data(), &record.sequence, sizeof(uint64_t));
+    std::memcpy(buffer.data() + sizeof(uint64_t), &id, sizeof(id));
+    std::memcpy(buffer.data() + sizeof(uint64_t) + sizeof(int32_t), &kind, sizeof(kind));
+    if (!record.embedding.empty()) {
+        std::memcpy(buffer.data() + sizeof(uint64_t) + 2 * sizeof(int32_t), record.embedding.data(),
+                    sizeof(float) * dimension);
+    }
+    uint64_t record_checksum = IndexFile::checksum(buffer.data(), size - sizeof(uint64_t));
+    std::memcpy(buffer.data() + size - sizeof(uint64_t), &record_checksum, sizeof(record_checksum));
+}
+
+bool IndexLog::append_record(Record& record, uint64_t& sequence) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd < 0) {
+        return false;
+    }
+
+    record.sequence = last_sequence + 1;
+    std::vector<unsigned char> buffer;
+    encode_record(record, buffer);
+
+    // The record is durable once fdatasync returns; a partial write is cut off on recovery
+    if (!write_all(fd, buffer.data(), buffer.size()) || fdatasync(fd) != 0) {
+        std::cerr << "Error: Could not append to index log " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    last_sequence = record.sequence;
+    num_records++;
+    sequence = record.sequence;
+    return true;
+}
+
+bool IndexLog::append(int person_id, const std::vector<float>& embedding, uint64_t& sequence) {
+    if (embedding.size() != static_cast<size_t>(dimension)) {
+        return false;
+    }
+    Record record;
+    record.person_id = person_id;
+    record.kind = RecordKind::INSERT;
+    record.embedding = embedding;
+    return append_record(record, sequence);
+}
+
+bool IndexLog::append_delete(int person_id, uint64_t& sequence) {
+    Record record;
+    record.person_id = person_id;
+    record.kind = RecordKind::DELETE_PERSON;
+    return append_record(record, sequence);
+}
+
+bool IndexLog::read_records(uint64_t after_sequence, std::vector<Record>& records) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return read_records_locked(after_sequence, records);
+}
+
+bool IndexLog::read_records_locked(uint64_t after_sequence, std::vector<Record>& records) const {
+    records.clear();
+    if (fd < 0) {
+        return false;
+    }
+
+    // Records were validated on open and appended by us since
+    size_t size = record_size();
+    std::vector<unsigned char> buffer(size);
+    for (size_t i = 0; i < num_records; i++) {
+        off_t offset = static_cast<off_t>(sizeof(IndexLogHeader) + i * size);
+        if (!read_all(fd, buffer.data(), size, offset)) {
+            return false;
+        }
+
+        Record record;
+        int32_t id = 0;
+        std::memcpy(&record.sequence, buffer.data(), sizeof(uint64_t));
+        if (record.sequence <= after_sequence) {
+            continue;
+        }
+        uint32_t kind = 0;
+        std::memcpy(&id, buffer.data() + sizeof(uint64_t), sizeof(id));
+        std::memcpy(&kind, buffer.data() + sizeof(uint64_t) + sizeof(int32_t), sizeof(kind));
+        record.person_id = id;
+        record.kind = kind == static_cast<uint32_t>(RecordKind::DELETE_PERSON) ? RecordKind::DELETE_PERSON
+                                                                               : RecordKind::INSERT;
+        if (record.kind == RecordKind::INSERT) {
+            record.embedding.resize(dimension);
+            std::memcpy(record.embedding.data(), buffer.data() + sizeof(uint64_t) + 2 * sizeof(int32_t),
+                        sizeof(float) * dimension);
+        }
+        records.push_back(std::move(record));
+    }
+    return true;
+}
+
+bool IndexLog::discard_through(uint64_t sequence) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd < 0) {
+        return false;
+    }
+
+    std::vector<Record> remaining;
+    if (!read_records_locked(sequence, remaining)) {
+        return false;
+    }
+
+    // Write the surviving records to a new log and swap it in atomically
+    std::string temp_path = path + ".tmp";
+    int temp_fd = ::open(temp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (temp_fd < 0) {
+        std::cerr << "Error: Could not create " << temp_path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    bool ok = write_header(temp_fd);
+    std::vector<unsigned char> buffer;
+    for (const Record& record : remaining) {
+        encode_record(record, buffer);
+        ok = ok && write_all(temp_fd, buffer.data(), buffer.size());
+    }
+    ok = ok && fsync(temp_fd) == 0 && std::rename(temp_path.c_str(), path.c_str()) == 0;
+    if (!ok) {
+        std::cerr << "Error: Could not compact index log " << path << std::endl;
+        ::close(temp_fd);
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    ::close(fd);
+    fd = temp_fd;
+    num_records = remaining.size();
+    sync_path(path);
+    return true;
+}
+
+size_t IndexLog::get_num_records() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return num_records;
+}
+
+uint64_t IndexLog::get_last_sequence() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return last_sequence;
+}
+
+bool IndexLog::sync_path(const std::string& file_path) {
+    int file_fd = ::open(file_path.c_str(), O_RDONLY);
+    if (file_fd < 0) {
+        return false;
+    }
+    bool ok = fsync(file_fd) == 0;
+    ::close(file_fd);
+
+    // The rename that published the file is only durable once its directory is synced
+    size_t slash = file_path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : file_path.substr(0, slash + 1);
+    int dir_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir_fd >= 0) {
+        ok = (fsync(dir_fd) == 0) && ok;
+        ::close(dir_fd);
+    }
+    return ok;
+}
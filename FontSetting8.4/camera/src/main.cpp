@@ -1,8 +1,13 @@
 #include "gtk_app.h"
+#include "deep_face_recognizer.h"
+#include "face_database.h"
 #include "logger.h"
 #include <signal.h>
 #include <csignal>
 #include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <string>
 
 // Global flag for shutdown request (atomic and signal-safe)
 static std::atomic<int> shutdown_requested(0);
@@ -27,7 +32,62 @@ static gboolean on_shutdown_idle(gpointer /* user_data */) {
     return FALSE;  // Remove from idle queue
 }
 
-int main(int /*argc*/, char* /*argv*/[]) {
+// Headless provisioning: "--export-snapshot FILE" or "--import-snapshot FILE".
+// Works on the same database, model and index files as the kiosk, without opening a window.
+static int run_snapshot_command(bool import, const std::string& path) {
+    FaceDatabase database;
+    if (!database.open() || !database.initialize()) {
+        LOG_ERROR("Failed to open face database");
+        return 1;
+    }
+
+    // The model is loaded for its hash: snapshots of another model are refused
+    DeepFaceRecognizer recognizer;
+    recognizer.set_database(&database);
+    const std::string model_path = Config::ARCFACE_MODEL_PATH;
+    if (!recognizer.load_model(model_path)) {
+        LOG_ERROR("Failed to load ArcFace model from " << model_path);
+        return 1;
+    }
+
+    if (import) {
+        if (!recognizer.import_snapshot(path)) {
+            LOG_ERROR("Failed to import gallery snapshot " << path);
+            return 1;
+        }
+        LOG_INFO("Imported " << database.get_num_people() << " people from " << path);
+        return 0;
+    }
+
+    // Export the saved index (with its logged enrollments) without writing to it or its log.
+    // A snapshot without an index is still complete: the importer rebuilds it.
+    const std::string index_path = "faiss_index.bin";
+    if (!std::filesystem::exists(index_path) || !recognizer.load_index(index_path, true)) {
+        LOG_WARN("No index to export; the importing kiosk will build it from the embeddings");
+    }
+    if (!recognizer.export_snapshot(path)) {
+        LOG_ERROR("Failed to export gallery snapshot " << path);
+        return 1;
+    }
+    LOG_INFO("Exported " << database.get_num_people() << " people to " << path);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 3 && (std::strcmp(argv[1], "--export-snapshot") == 0 ||
+                      std::strcmp(argv[1], "--import-snapshot") == 0)) {
+        try {
+            return run_snapshot_command(std::strcmp(argv[1], "--import-snapshot") == 0, argv[2]);
+        } catch (const std::exception& e) {
+            LOG_ERROR("Exception occurred: " << e.what());
+            return 1;
+        }
+    }
+    if (argc > 1) {
+        LOG_ERROR("Usage: " << argv[0] << " [--export-snapshot FILE | --import-snapshot FILE]");
+        return 1;
+    }
+
     try {
         GTKApp app;
         g_app = &app;
@@ -1,31 +1,66 @@
 #include "model_loader.h"
+#include "face_preprocess.h"
+#include "config.h"
 #include <iostream>
+#include <algorithm>
 #include <cmath>
 
-ModelLoader::ModelLoader() {
-    // Create ONNX Runtime environment
-    try {
-        env = std::make_unique<Ort::Env>(ORT_LOGGING_LEVEL_WARNING, "ArcFace");
-    } catch (const std::exception& e) {
-        std::cerr << "Error creating ONNX Runtime environment: " << e.what() << std::endl;
-    }
+ModelLoader::ModelLoader()
+    : intra_op_threads(Config::INFERENCE_INTRA_OP_THREADS),
+      inter_op_threads(Config::INFERENCE_INTER_OP_THREADS) {
+}
+
+int ModelLoader::get_session_count() const {
+    return std::max(1, pool_size > 0 ? pool_size : Config::ARCFACE_SESSIONS);
 }
 
 bool ModelLoader::load_model(const std::string& model_path) {
-    if (!env) {
-        std::cerr << "Error: ONNX Runtime environment not initialized" << std::endl;
-        return false;
-    }
+    // New callers wait for the new sessions; calls in flight finish on the old ones first
+    std::unique_lock<std::mutex> lock(pool_mutex);
+    loading = true;
+    pool_cv.wait(lock, [this] { return busy_sessions == 0; });
+    bool loaded = create_sessions(model_path);
+    loading = false;
+    lock.unlock();
+    pool_cv.notify_all();
+    return loaded;
+}
+
+bool ModelLoader::create_sessions(const std::string& model_path) {
+    is_loaded = false;
+    idle_sessions.clear();
+    sessions.clear();
+    quantization.clear();
+    input_names.clear();
+    input_names_cstr.clear();
+    output_names.clear();
+    output_names_cstr.clear();
 
     try {
+        // One environment owns the intra/inter-op thread pools of every session,
+        // so concurrent calls share the thread budget instead of each bringing its own
+        if (!env) {
+            Ort::ThreadingOptions threading_options;
+            threading_options.SetGlobalIntraOpNumThreads(intra_op_threads);
+            threading_options.SetGlobalInterOpNumThreads(inter_op_threads);
+            env = std::make_unique<Ort::Env>(threading_options, ORT_LOGGING_LEVEL_WARNING, "ArcFace");
+        }
+
         // Set session options
         Ort::SessionOptions session_options;
-        session_options.SetIntraOpNumThreads(4);
+        session_options.DisablePerSessionThreads();  // Use the environment's pools
         session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
 
-        // Create session from model file
-        std::string model_path_str = model_path;
-        session = std::make_unique<Ort::Session>(*env, model_path_str.c_str(), session_options);
+        // Create the pool from the model file; the sessions share one copy of the prepacked weights
+        prepacked_weights = std::make_unique<Ort::PrepackedWeightsContainer>();
+        int count = get_session_count();
+        for (int i = 0; i < count; i++) {
+            auto pooled = std::make_unique<PooledSession>();
+            pooled->session = std::make_unique<Ort::Session>(*env, model_path.c_str(), session_options,
+                                                             *prepacked_weights);
+            sessions.push_back(std::move(pooled));
+        }
+        Ort::Session* session = sessions[0]->session.get();
 
         // Get input names and shapes
         Ort::AllocatorWithDefaultOptions allocator;
@@ -75,150 +110,271 @@ bool ModelLoader::load_model(const std::string& model_path) {
         }
         std::cout << "]" << std::endl;
 
+        // Quantized models (static QDQ or dynamic) keep float inputs and outputs;
+        // only the weights and activations inside the graph are 8-bit
+        ONNXTensorElementDataType input_type = session->GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetElementType();
+        ONNXTensorElementDataType output_type = session->GetOutputTypeInfo(0).GetTensorTypeAndShapeInfo().GetElementType();
+        if (input_type != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT || output_type != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT) {
+            std::cerr << "Error: Model must take and return float tensors "
+                      << "(quantize it with float inputs and outputs)" << std::endl;
+            return false;
+        }
+
+        // tools/quantize_arcface.py tags the models it writes
+        auto quantization_tag = session->GetModelMetadata().LookupCustomMetadataMapAllocated("quantization", allocator);
+        quantization = quantization_tag ? quantization_tag.get() : "";
+
+        for (const auto& pooled : sessions) {
+            idle_sessions.push_back(pooled.get());
+        }
         is_loaded = true;
-        std::cout << "Model loaded successfully from: " << model_path << std::endl;
+        std::cout << "Model loaded successfully from: " << model_path << " ("
+                  << (quantization.empty() ? "fp32" : quantization) << ", " << count << " sessions, "
+                  << intra_op_threads << " shared intra-op threads)" << std::endl;
         return true;
 
     } catch (const Ort::Exception& e) {
         std::cerr << "ONNX Runtime error: " << e.what() << std::endl;
+        sessions.clear();
         return false;
     } catch (const std::exception& e) {
         std::cerr << "Error loading model: " << e.what() << std::endl;
+        sessions.clear();
         return false;
     }
 }
 
-cv::Mat ModelLoader::normalize_image(const cv::Mat& image) {
-    cv::Mat normalized;
-    // ArcFace (InsightFace) normalization: (pixel - 127.5) / 128.0
-    // This maps [0, 255] to approximately [-1, 1]
-    image.convertTo(normalized, CV_32F);
-    normalized = (normalized - 127.5) / 128.0;
+ModelLoader::PooledSession* ModelLoader::acquire_session() {
+    std::unique_lock<std::mutex> lock(pool_mutex);
+    pool_cv.wait(lock, [this] { return !loading && (!is_loaded || !idle_sessions.empty()); });
+    if (!is_loaded) {
+        return nullptr;
+    }
+    PooledSession* pooled = idle_sessions.back();
+    idle_sessions.pop_back();
+    busy_sessions++;
+    return pooled;
+}
 
-    return normalized;
+void ModelLoader::release_session(PooledSession* pooled) {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        idle_sessions.push_back(pooled);
+        busy_sessions--;
+    }
+    // Both waiting callers and a pending load_model() wait on this
+    pool_cv.notify_all();
 }
 
-std::vector<float> ModelLoader::preprocess_image(const cv::Mat& image) {
+bool ModelLoader::preprocess_into(PooledSession& pooled, const cv::Mat& image, float* chw) {
     if (image.empty()) {
         std::cerr << "Error: Input image is empty" << std::endl;
-        return std::vector<float>();
+        return false;
+    }
+    if (get_input_channels() != 3) {
+        std::cerr << "Error: Model expects " << get_input_channels() << " input channels, not RGB" << std::endl;
+        return false;
     }
 
-    // ArcFace input: [1, 3, 112, 112] (batch_size=1, channels=3, height=112, width=112)
-    // Model will dynamically read the actual dimensions
-    int expected_width = get_input_width();
-    int expected_height = get_input_height();
-    int expected_channels = get_input_channels();
-
-    cv::Mat img = image.clone();
-
-    // Convert to RGB (ArcFace expects RGB, OpenCV uses BGR)
-    if (img.channels() == 1) {
-        cv::cvtColor(img, img, cv::COLOR_GRAY2RGB);
-    } else if (img.channels() == 4) {
-        cv::cvtColor(img, img, cv::COLOR_BGRA2RGB);
-    } else if (img.channels() == 3) {
-        cv::cvtColor(img, img, cv::COLOR_BGR2RGB);
+    // The fused kernel reads 8-bit pixels; other depths are converted first
+    const cv::Mat* source = &image;
+    if (image.depth() != CV_8U) {
+        image.convertTo(pooled.depth_scratch, CV_8U);
+        source = &pooled.depth_scratch;
     }
 
-    // Resize to model input size (112x112 for ArcFace)
-    cv::Mat resized;
-    cv::resize(img, resized, cv::Size(expected_width, expected_height), 0, 0, cv::INTER_LINEAR);
+    // Bilinear resize to the model input (112x112 for ArcFace), BGR -> RGB,
+    // (pixel - 127.5) / 128.0 and HWC -> CHW in one pass over the crop,
+    // which may be a ROI of the camera frame (read in place through its stride)
+    FacePreprocess::SourceImage face{source->data, source->cols, source->rows, source->step, source->channels()};
+    return FacePreprocess::preprocess(face, chw, get_input_width(), get_input_height(),
+                                      Config::ARCFACE_NORM_MEAN, Config::ARCFACE_NORM_SCALE);
+}
 
-    // Normalize using ArcFace normalization: (pixel - 127.5) / 128.0
-    cv::Mat normalized = normalize_image(resized);
+ModelLoader::BatchBinding* ModelLoader::get_binding(PooledSession& pooled, int batch) {
+    std::vector<std::unique_ptr<BatchBinding>>& bindings = pooled.bindings;
+    if (static_cast<int>(bindings.size()) <= batch) {
+        bindings.resize(batch + 1);
+    }
+    if (bindings[batch]) {
+        return bindings[batch].get();
+    }
 
-    // Convert to float array in CHW format (Channels, Height, Width)
-    std::vector<float> input_data;
-    input_data.reserve(expected_channels * expected_height * expected_width);
+    // Batch axis set to this batch size; other dynamic dimensions are 1
+    std::vector<int64_t> inference_shape = input_shape;
+    for (auto& dim : inference_shape) {
+        if (dim < 0) dim = 1;  // Replace dynamic dimensions with 1
+    }
+    if (!inference_shape.empty()) {
+        inference_shape[0] = batch;
+    }
 
-    // OpenCV Mat is HWC format, convert to CHW for ONNX
-    for (int c = 0; c < expected_channels; ++c) {
-        for (int h = 0; h < expected_height; ++h) {
-            for (int w = 0; w < expected_width; ++w) {
-                float value = normalized.at<cv::Vec3f>(h, w)[c];
-                input_data.push_back(value);
-            }
-        }
+    auto bound = std::make_unique<BatchBinding>();
+    size_t face_size = static_cast<size_t>(get_input_channels()) * get_input_height() * get_input_width();
+    bound->input.assign(face_size * batch, 0.0f);
+
+    // The tensors wrap our buffers, so ORT reads and writes them in place
+    Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+    bound->input_tensor = Ort::Value::CreateTensor<float>(
+        memory_info,
+        bound->input.data(),
+        bound->input.size(),
+        inference_shape.data(),
+        inference_shape.size()
+    );
+    bound->binding = std::make_unique<Ort::IoBinding>(*pooled.session);
+    bound->binding->BindInput(input_names_cstr[0], bound->input_tensor);
+
+    // The output can only be preallocated when every non-batch dimension is known
+    std::vector<int64_t> batch_output_shape = output_shape;
+    bool known_output = !batch_output_shape.empty();
+    for (size_t i = 1; i < batch_output_shape.size(); ++i) {
+        known_output = known_output && batch_output_shape[i] > 0;
+    }
+    if (known_output) {
+        batch_output_shape[0] = batch;
+        bound->output.assign(static_cast<size_t>(get_flattened_output_size()) * batch, 0.0f);
+        bound->output_tensor = Ort::Value::CreateTensor<float>(
+            memory_info,
+            bound->output.data(),
+            bound->output.size(),
+            batch_output_shape.data(),
+            batch_output_shape.size()
+        );
+        bound->binding->BindOutput(output_names_cstr[0], bound->output_tensor);
+    } else {
+        bound->binding->BindOutput(output_names_cstr[0], memory_info);
     }
 
-    return input_data;
+    bindings[batch] = std::move(bound);
+    return bindings[batch].get();
 }
 
-std::vector<float> ModelLoader::inference(const cv::Mat& face_image) {
-    std::vector<float> output;
-
-    if (!is_loaded) {
-        std::cerr << "Error: Model not loaded" << std::endl;
-        return output;
+bool ModelLoader::run_batch(PooledSession& pooled, BatchBinding& bound, int batch,
+                            std::vector<float>* embeddings) {
+    // Run inference on the bound tensors
+    pooled.session->Run(Ort::RunOptions{nullptr}, *bound.binding);
+    const std::vector<size_t>& slot_faces = pooled.slot_faces;
+
+    const float* output_data = bound.output.data();
+    size_t output_size = bound.output.size();
+    std::vector<Ort::Value> output_tensors;
+    if (bound.output.empty()) {
+        // Output shape only known after the run: ORT allocated it
+        output_tensors = bound.binding->GetOutputValues();
+        if (output_tensors.empty() || !output_tensors[0].IsTensor()) {
+            return false;
+        }
+        output_data = output_tensors[0].GetTensorMutableData<float>();
+        output_size = output_tensors[0].GetTensorTypeAndShapeInfo().GetElementCount();
     }
 
-    try {
-        // Preprocess image
-        std::vector<float> input_data = preprocess_image(face_image);
-
-        if (input_data.empty()) {
-            std::cerr << "Error: Failed to preprocess image" << std::endl;
-            return output;
+    // Model outputs [batch, ...] - flatten each face's slice and use it as the embedding
+    size_t per_face = output_size / batch;
+    for (size_t slot = 0; slot < slot_faces.size(); slot++) {
+        const float* face_output = output_data + slot * per_face;
+        std::vector<float>& output = embeddings[slot_faces[slot]];
+        output.assign(face_output, face_output + per_face);  // Reuses the caller's capacity
+
+        // Normalize embedding to unit length (L2 normalization)
+        float norm = 0.0f;
+        for (float val : output) {
+            norm += val * val;
         }
+        norm = std::sqrt(norm);
 
-        // Create a fixed shape for inference (handle dynamic batch dimension)
-        // Replace -1 (dynamic) with 1 for single image inference
-        std::vector<int64_t> inference_shape = input_shape;
-        for (auto& dim : inference_shape) {
-            if (dim < 0) dim = 1;  // Replace dynamic dimensions with 1
+        if (norm > 1e-6) {
+            for (float& val : output) {
+                val /= norm;
+            }
         }
+    }
+    return true;
+}
 
-        // Prepare input tensor
-        Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-        Ort::Value input_tensor = Ort::Value::CreateTensor<float>(
-            memory_info,
-            input_data.data(),
-            input_data.size(),
-            inference_shape.data(),
-            inference_shape.size()
-        );
+std::vector<float> ModelLoader::inference(const cv::Mat& face_image) {
+    std::vector<float> embedding;
+    inference(face_image, embedding);
+    return embedding;
+}
 
-        // Run inference
-        auto output_tensors = session->Run(
-            Ort::RunOptions{nullptr},
-            input_names_cstr.data(),
-            &input_tensor,
-            input_names_cstr.size(),
-            output_names_cstr.data(),
-            output_names_cstr.size()
-        );
+bool ModelLoader::inference(const cv::Mat& face_image, std::vector<float>& embedding) {
+    embedding.clear();  // Keeps the capacity for this call's result
+    return run_faces(&face_image, 1, &embedding) && !embedding.empty();
+}
 
-        // Extract output
-        if (output_tensors.size() > 0 && output_tensors[0].IsTensor()) {
-            float* output_data = output_tensors[0].GetTensorMutableData<float>();
-            int64_t output_size = output_tensors[0].GetTensorTypeAndShapeInfo().GetElementCount();
+std::vector<std::vector<float>> ModelLoader::inference_batch(const std::vector<cv::Mat>& face_images) {
+    std::vector<std::vector<float>> outputs;
+    inference_batch(face_images, outputs);
+    return outputs;
+}
 
-            // Model outputs [batch, channels, height, width] - flatten and use as embedding
-            // For FaceNet-like models, this gives us a high-dimensional feature vector
-            output.assign(output_data, output_data + output_size);
+bool ModelLoader::inference_batch(const std::vector<cv::Mat>& face_images,
+                                  std::vector<std::vector<float>>& embeddings) {
+    embeddings.resize(face_images.size());
+    for (std::vector<float>& embedding : embeddings) {
+        embedding.clear();  // Keeps the capacity for this call's results
+    }
+    return run_faces(face_images.data(), face_images.size(), embeddings.data());
+}
 
-            // Normalize embedding to unit length (L2 normalization)
-            float norm = 0.0f;
-            for (float val : output) {
-                norm += val * val;
-            }
-            norm = std::sqrt(norm);
+bool ModelLoader::run_faces(const cv::Mat* face_images, size_t count, std::vector<float>* embeddings) {
+    // The session's bound tensors and scratch buffers are ours until it is released
+    PooledSession* pooled = acquire_session();
+    if (!pooled) {
+        std::cerr << "Error: Model not loaded" << std::endl;
+        return false;
+    }
+    std::vector<size_t>& slot_faces = pooled->slot_faces;
 
-            if (norm > 1e-6) {
-                for (float& val : output) {
-                    val /= norm;
+    // Faces that fail preprocessing get no slot and an empty embedding
+    size_t face_size = static_cast<size_t>(get_input_channels()) * get_input_height() * get_input_width();
+    int batch_size = get_max_batch_size();
+    bool ok = true;
+
+    try {
+        size_t next = 0;
+        while (next < count) {
+            // A dynamic batch axis takes exactly the faces left (up to batch_size);
+            // a fixed one always runs full, with the unused slots zeroed
+            size_t remaining = count - next;
+            int batch = has_dynamic_batch() ? static_cast<int>(std::min<size_t>(remaining, batch_size))
+                                            : batch_size;
+            BatchBinding& bound = *get_binding(*pooled, batch);
+
+            // Pack the faces into the bound NCHW tensor
+            slot_faces.clear();
+            for (; next < count && static_cast<int>(slot_faces.size()) < batch; next++) {
+                if (preprocess_into(*pooled, face_images[next], bound.input.data() + slot_faces.size() * face_size)) {
+                    slot_faces.push_back(next);
+                } else {
+                    std::cerr << "Error: Failed to preprocess image" << std::endl;
                 }
             }
-        }
+            if (slot_faces.empty()) {
+                continue;
+            }
+            std::fill(bound.input.begin() + slot_faces.size() * face_size, bound.input.end(), 0.0f);
 
+            ok = run_batch(*pooled, bound, batch, embeddings) && ok;
+        }
     } catch (const Ort::Exception& e) {
         std::cerr << "ONNX Runtime inference error: " << e.what() << std::endl;
+        ok = false;
     } catch (const std::exception& e) {
         std::cerr << "Error during inference: " << e.what() << std::endl;
+        ok = false;
     }
 
-    return output;
+    release_session(pooled);
+    return ok;
+}
+
+int ModelLoader::get_max_batch_size() const {
+    if (input_shape.empty() || input_shape[0] < 0) {
+        return std::max(1, max_batch > 0 ? max_batch : Config::ARCFACE_MAX_BATCH);
+    }
+    return static_cast<int>(std::max<int64_t>(1, input_shape[0]));
 }
 
 int ModelLoader::get_embedding_dimension() const {
@@ -228,9 +384,11 @@ int ModelLoader::get_embedding_dimension() const {
 
 int ModelLoader::get_flattened_output_size() const {
     if (output_shape.empty()) return 0;
+    // Per face: the leading batch axis is left out (it is 1 or dynamic for
+    // single-face models, and inference_batch() splits it into faces)
     int64_t total_size = 1;
-    for (int64_t dim : output_shape) {
-        if (dim > 0) total_size *= dim;
+    for (size_t i = output_shape.size() > 1 ? 1 : 0; i < output_shape.size(); ++i) {
+        if (output_shape[i] > 0) total_size *= output_shape[i];
     }
     return static_cast<int>(total_size);
 }
@@ -217,6 +217,9 @@ const char* get_message_type_name(MessageType type) {
         case MessageType::REQ_LIST_PERSONS: return "REQ_LIST_PERSONS";
         case MessageType::REQ_GET_SETTINGS: return "REQ_GET_SETTINGS";
         case MessageType::REQ_SET_SETTINGS: return "REQ_SET_SETTINGS";
+        case MessageType::REQ_VERIFY: return "REQ_VERIFY";
+        case MessageType::REQ_EXPORT_SNAPSHOT: return "REQ_EXPORT_SNAPSHOT";
+        case MessageType::REQ_IMPORT_SNAPSHOT: return "REQ_IMPORT_SNAPSHOT";
 
         // Response messages
         case MessageType::RESP_SUCCESS: return "RESP_SUCCESS";
@@ -0,0 +1,111 @@
+#include "scan_pool.h"
+#include "config.h"
+#include <algorithm>
+
+static std::shared_ptr<ScanPool> shared_pool;  // Only accessed with atomic_load / atomic_store
+static std::mutex shared_pool_mutex;           // Serializes creating and replacing it
+
+ScanPool::ScanPool(int num_threads) {
+    if (num_threads <= 0) {
+        num_threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    for (int slot = 1; slot < num_threads; slot++) {
+        workers.emplace_back(&ScanPool::worker_loop, this, slot);
+    }
+}
+
+ScanPool::~ScanPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_ready.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ScanPool::run(size_t num_tasks, const TaskFn& task) {
+    if (num_tasks == 0) {
+        return;
+    }
+    if (workers.empty() || num_tasks == 1) {
+        for (size_t t = 0; t < num_tasks; t++) {
+            task(t, 0);
+        }
+        return;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->task = &task;
+    job->num_tasks = num_tasks;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(job);
+    }
+    work_ready.notify_all();
+
+    // The caller scans too, and waits only for partitions a worker already claimed
+    run_tasks(*job, 0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    job_done.wait(lock, [&job]() { return job->done.load() == job->num_tasks; });
+    auto queued = std::find(jobs.begin(), jobs.end(), job);
+    if (queued != jobs.end()) {
+        jobs.erase(queued);
+    }
+}
+
+void ScanPool::run_tasks(Job& job, int slot) {
+    for (;;) {
+        size_t t = job.next.fetch_add(1);
+        if (t >= job.num_tasks) {
+            return;
+        }
+        (*job.task)(t, slot);
+
+        // The lock orders the notification after the waiter's predicate check
+        if (job.done.fetch_add(1) + 1 == job.num_tasks) {
+            std::lock_guard<std::mutex> lock(mutex);
+            job_done.notify_all();
+        }
+    }
+}
+
+void ScanPool::worker_loop(int slot) {
+    for (;;) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work_ready.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if (stopping) {
+                return;
+            }
+            job = jobs.front();
+            if (job->next.load() >= job->num_tasks) {
+                jobs.pop_front();  // Every task claimed: nothing left to help with
+                continue;
+            }
+        }
+        run_tasks(*job, slot);
+    }
+}
+
+std::shared_ptr<ScanPool> ScanPool::shared() {
+    std::shared_ptr<ScanPool> pool = std::atomic_load(&shared_pool);
+    if (pool) {
+        return pool;
+    }
+    std::lock_guard<std::mutex> lock(shared_pool_mutex);
+    pool = std::atomic_load(&shared_pool);
+    if (!pool) {
+        pool = std::make_shared<ScanPool>(Config::SCAN_THREADS);
+        std::atomic_store(&shared_pool, pool);
+    }
+    return pool;
+}
+
+void ScanPool::set_shared_threads(int num_threads) {
+    std::lock_guard<std::mutex> lock(shared_pool_mutex);
+    std::atomic_store(&shared_pool, std::make_shared<ScanPool>(num_threads));
+}
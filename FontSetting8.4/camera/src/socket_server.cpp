@@ -385,7 +385,9 @@ bool SocketServer::handle_binary_message(int client_fd, const Protocol::Message&
                     SuccessResponse response(result.substr(3));
                     send_binary_response(client_fd, response);
                 } else if (result.find("ERROR") == 0) {
-                    ErrorResponse error(static_cast<uint32_t>(ErrorCode::CAPTURE_FAILED), result.substr(6));
+                    ErrorCode code = result.find("Duplicate face") != std::string::npos ? ErrorCode::DUPLICATE_FACE
+                                                                                        : ErrorCode::CAPTURE_FAILED;
+                    ErrorResponse error(static_cast<uint32_t>(code), result.substr(6));
                     send_binary_response(client_fd, error);
                 } else {
                     SuccessResponse response(result);
@@ -489,6 +491,74 @@ bool SocketServer::handle_binary_message(int client_fd, const Protocol::Message&
                 return false;
             }
             
+            case MessageType::REQ_DELETE_PERSON: {
+                auto cmd = DeletePersonMessage::from_message(request);
+                std::string result = execute_command("delete:" + cmd.person_name);
+
+                if (result.find("OK:") == 0) {
+                    SuccessResponse response(result.substr(3));
+                    send_binary_response(client_fd, response);
+                } else if (result.find("ERROR") == 0) {
+                    ErrorCode code = result.find("not found") != std::string::npos ? ErrorCode::PERSON_NOT_FOUND
+                                                                                   : ErrorCode::DATABASE_ERROR;
+                    ErrorResponse error(static_cast<uint32_t>(code), result.substr(6));
+                    send_binary_response(client_fd, error);
+                } else {
+                    SuccessResponse response(result);
+                    send_binary_response(client_fd, response);
+                }
+                return false;
+            }
+            
+            case MessageType::REQ_VERIFY: {
+                auto cmd = VerifyMessage::from_message(request);
+                std::string result = execute_command("verify:" + std::to_string(cmd.person_id));
+
+                if (result.find("OK:") == 0) {
+                    SuccessResponse response(result.substr(3));
+                    send_binary_response(client_fd, response);
+                } else if (result.find("ERROR") == 0) {
+                    ErrorCode code = ErrorCode::VERIFICATION_FAILED;
+                    if (result.find("not found") != std::string::npos) {
+                        code = ErrorCode::PERSON_NOT_FOUND;
+                    } else if (result.find("No face") != std::string::npos) {
+                        code = ErrorCode::NO_FACE_DETECTED;
+                    } else if (result.find("Camera not running") != std::string::npos) {
+                        code = ErrorCode::CAMERA_NOT_RUNNING;
+                    }
+                    ErrorResponse error(static_cast<uint32_t>(code), result.substr(6));
+                    send_binary_response(client_fd, error);
+                } else {
+                    SuccessResponse response(result);
+                    send_binary_response(client_fd, response);
+                }
+                return false;
+            }
+
+            case MessageType::REQ_EXPORT_SNAPSHOT:
+            case MessageType::REQ_IMPORT_SNAPSHOT: {
+                auto cmd = SnapshotMessage::from_message(request);
+                std::string result = execute_command((cmd.import ? "import:" : "export:") + cmd.path);
+
+                if (result.find("OK:") == 0) {
+                    SuccessResponse response(result.substr(3));
+                    send_binary_response(client_fd, response);
+                } else if (result.find("ERROR") == 0) {
+                    ErrorCode code = ErrorCode::DATABASE_ERROR;
+                    if (result.find("Snapshot") != std::string::npos) {
+                        code = ErrorCode::SNAPSHOT_REJECTED;
+                    } else if (result.find("Training") != std::string::npos) {
+                        code = ErrorCode::TRAINING_IN_PROGRESS;
+                    }
+                    ErrorResponse error(static_cast<uint32_t>(code), result.substr(6));
+                    send_binary_response(client_fd, error);
+                } else {
+                    SuccessResponse response(result);
+                    send_binary_response(client_fd, response);
+                }
+                return false;
+            }
+
             case MessageType::REQ_STREAM_START: {
                 // Streaming command - hand off to streaming handler (don't close socket)
                 LOG_INFO("Starting recognition stream");
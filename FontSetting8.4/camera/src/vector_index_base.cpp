@@ -0,0 +1,178 @@
+#include "vector_index_base.h"
+#include "faiss_index.h"
+#include "hnsw_index.h"
+#include "faiss_library_index.h"
+#include "top_k.h"
+#include <algorithm>
+#include <iostream>
+
+double VectorIndexBase::distance_to_similarity(float distance) {
+    // For ArcFace with L2-normalized embeddings:
+    // L2 distance range: [0, 2] where 0 = identical, 2 = opposite
+    //
+    // Typical thresholds for face recognition:
+    // - Same person: distance < 1.0 (similarity > 0.75)
+    // - Different person: distance > 1.2 (similarity < 0.64)
+    //
+    // Using cosine similarity derived from L2 distance:
+    // d² = 2 - 2·cos(θ)  =>  cos(θ) = 1 - d²/2
+    // Then map cos(θ) from [-1, 1] to [0, 1]
+
+    float d_squared = distance * distance;
+
+    // Clamp d² to valid range [0, 4] for normalized vectors
+    d_squared = std::min(d_squared, 4.0f);
+
+    float cos_theta = 1.0f - (d_squared / 2.0f);
+
+    // Clamp to valid cosine range
+    cos_theta = std::max(-1.0f, std::min(1.0f, cos_theta));
+
+    // Convert to 0-1 similarity (0 = opposite, 1 = identical)
+    double similarity = (1.0 + cos_theta) / 2.0;
+
+    return similarity;
+}
+
+std::vector<std::vector<int>> VectorIndexBase::search_batch(const std::vector<std::vector<float>>& queries,
+                                                            int k,
+                                                            std::vector<std::vector<double>>& confidences) {
+    std::vector<std::vector<int>> results(queries.size());
+    confidences.assign(queries.size(), std::vector<double>());
+    for (size_t q = 0; q < queries.size(); q++) {
+        results[q] = search_k(queries[q], k, confidences[q]);
+    }
+    return results;
+}
+
+std::vector<int> VectorIndexBase::search_k(const std::vector<float>& query_embedding, int k,
+                                           const PersonFilter& filter, std::vector<double>& confidences) {
+    std::vector<int> results;
+    confidences.clear();
+    if (k <= 0 || filter.empty()) {
+        return results;
+    }
+
+    // Fetch 4x more rows each round until k of them pass the filter
+    int num_vectors = get_num_vectors();
+    for (int fetch = std::min(num_vectors, 4 * std::max(k, 16));; fetch = std::min(num_vectors, fetch * 4)) {
+        std::vector<double> hit_confidences;
+        std::vector<int> hits = search_k(query_embedding, fetch, hit_confidences);
+        results.clear();
+        confidences.clear();
+        for (size_t i = 0; i < hits.size() && static_cast<int>(results.size()) < k; i++) {
+            if (filter.allows(hits[i])) {
+                results.push_back(hits[i]);
+                confidences.push_back(hit_confidences[i]);
+            }
+        }
+        if (static_cast<int>(results.size()) == k || static_cast<int>(hits.size()) < fetch ||
+            fetch >= num_vectors) {
+            return results;
+        }
+    }
+}
+
+int VectorIndexBase::search(const std::vector<float>& query_embedding, const PersonFilter& filter,
+                            double& confidence) {
+    std::vector<double> confidences;
+    std::vector<int> results = search_k(query_embedding, 1, filter, confidences);
+    if (results.empty()) {
+        confidence = 0.0;
+        return -1;
+    }
+    confidence = confidences[0];
+    return results[0];
+}
+
+std::vector<int> VectorIndexBase::search_identities(const std::vector<float>& query_embedding, int k,
+                                                    std::vector<double>& confidences,
+                                                    Config::IdentityAggregation aggregation, int top_m) {
+    std::vector<int> results;
+    confidences.clear();
+    if (k <= 0) {
+        return results;
+    }
+
+    // Fetch enough rows that k people with top_m hits each are likely covered
+    int m = aggregation == Config::IdentityAggregation::BEST ? 1 : std::max(1, top_m);
+    std::vector<double> hit_confidences;
+    std::vector<int> hits = search_k(query_embedding, k * m * Config::IDENTITY_CANDIDATE_FACTOR,
+                                     hit_confidences);
+
+    // Similarity is affine in the squared distance, so averaging it is equivalent
+    IdentityAggregator aggregator(aggregation, top_m);
+    for (size_t i = 0; i < hits.size(); i++) {
+        aggregator.add(hits[i], -static_cast<float>(hit_confidences[i]));
+    }
+    for (const IdentityAggregator::Entry& person : aggregator.top(k)) {
+        results.push_back(person.second);
+        confidences.push_back(-person.first);
+    }
+    return results;
+}
+
+std::vector<int> VectorIndexBase::range_search(const std::vector<float>& query_embedding, double min_similarity,
+                                               std::vector<double>& confidences) {
+    // Ask for 4x more people each round until the last one falls below the threshold
+    int num_vectors = get_num_vectors();
+    for (int k = 16;; k *= 4) {
+        std::vector<int> results = search_identities(query_embedding, k, confidences,
+                                                     Config::IdentityAggregation::BEST, 1);
+        size_t matches = 0;
+        while (matches < results.size() && confidences[matches] >= min_similarity) {
+            matches++;
+        }
+        if (matches < results.size() || static_cast<int>(results.size()) < k || k >= num_vectors) {
+            results.resize(matches);
+            confidences.resize(matches);
+            return results;
+        }
+    }
+}
+
+int VectorIndexBase::verify(const std::vector<float>& query_embedding, int person_id, double& confidence) {
+    confidence = 0.0;
+    int num_rows = get_person_vector_count(person_id);
+    if (num_rows == 0) {
+        return 0;
+    }
+    PersonFilter claimed;
+    claimed.add(person_id);
+    return search(query_embedding, claimed, confidence) == person_id ? num_rows : 0;
+}
+
+bool VectorIndexBase::replace_person(int person_id, const std::vector<std::vector<float>>& embeddings) {
+    remove_person(person_id);
+    if (embeddings.empty()) {
+        return true;
+    }
+    return add_vectors(std::vector<int>(embeddings.size(), person_id), embeddings);
+}
+
+std::unique_ptr<VectorIndexBase> create_vector_index(Config::IndexBackend backend,
+                                                     int embedding_dimension) {
+    switch (backend) {
+        case Config::IndexBackend::HNSW:
+            return std::make_unique<HNSWIndex>(embedding_dimension);
+        case Config::IndexBackend::FAISS_LIBRARY: {
+#ifdef HAVE_FAISS
+            return std::make_unique<FaissLibraryIndex>(embedding_dimension, Config::FAISS_INDEX_TYPE);
+#else
+            // Built without libfaiss: use the closest in-house structure
+            static bool warned = false;
+            if (!warned) {
+                std::cerr << "Warning: FAISS library not available, using the in-house index" << std::endl;
+                warned = true;
+            }
+            if (Config::FAISS_INDEX_TYPE == Config::FaissIndexType::HNSW_FLAT) {
+                return std::make_unique<HNSWIndex>(embedding_dimension);
+            }
+            return std::make_unique<FAISSIndex>(embedding_dimension);
+#endif
+        }
+        case Config::IndexBackend::FLAT:
+        default:
+            return std::make_unique<FAISSIndex>(embedding_dimension);
+    }
+}
@@ -0,0 +1,450 @@
+#include "vector_kernels.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VECTOR_KERNELS_X86 1
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define VECTOR_KERNELS_NEON 1
+#endif
+
+namespace VectorKernels {
+
+uint16_t float_to_half(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t exponent = (bits >> 23) & 0xFFu;
+    uint32_t mantissa = bits & 0x7FFFFFu;
+
+    if (exponent == 0xFFu) {
+        // Inf / NaN
+        return static_cast<uint16_t>(sign | 0x7C00u | (mantissa ? 0x200u : 0u));
+    }
+
+    int half_exponent = static_cast<int>(exponent) - 127 + 15;
+    if (half_exponent >= 0x1F) {
+        return static_cast<uint16_t>(sign | 0x7C00u);  // Overflow to infinity
+    }
+
+    if (half_exponent <= 0) {
+        // Subnormal half (or zero)
+        if (half_exponent < -10) {
+            return static_cast<uint16_t>(sign);
+        }
+        mantissa |= 0x800000u;
+        int shift = 14 - half_exponent;
+        uint32_t half_mantissa = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half_mantissa & 1u))) {
+            half_mantissa++;
+        }
+        return static_cast<uint16_t>(sign | half_mantissa);
+    }
+
+    uint32_t half = sign | (static_cast<uint32_t>(half_exponent) << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1FFFu;
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) {
+        half++;  // May carry into the exponent, which is the correct rounding
+    }
+    return static_cast<uint16_t>(half);
+}
+
+float half_to_float(uint16_t value) {
+    uint32_t sign = (static_cast<uint32_t>(value) & 0x8000u) << 16;
+    uint32_t exponent = (value >> 10) & 0x1Fu;
+    uint32_t mantissa = value & 0x3FFu;
+    uint32_t bits;
+
+    if (exponent == 0) {
+        if (mantissa == 0) {
+            bits = sign;
+        } else {
+            // Normalize the subnormal half
+            exponent = 127 - 15 + 1;
+            while ((mantissa & 0x400u) == 0) {
+                mantissa <<= 1;
+                exponent--;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+        }
+    } else if (exponent == 0x1F) {
+        bits = sign | 0x7F800000u | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+static float dot_product_f16_scalar(const float* a, const uint16_t* b, int n) {
+    float sum = 0.0f;
+    for (int i = 0; i < n; i++) {
+        sum += a[i] * half_to_float(b[i]);
+    }
+    return sum;
+}
+
+static float dot_product_u8_scalar(const float* a, const uint8_t* b, int n) {
+    float s0 = 0.0f, s1 = 0.0f;
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+    }
+    for (; i < n; i++) {
+        s0 += a[i] * b[i];
+    }
+    return s0 + s1;
+}
+
+float dot_product_scalar(const float* a, const float* b, int n) {
+    // Four independent accumulators so the compiler can pipeline the adds
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; i++) {
+        s0 += a[i] * b[i];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+static void dot_product_x4_scalar(const float* const* q, const float* row, int n, float* out) {
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    for (int i = 0; i < n; i++) {
+        float x = row[i];
+        s0 += q[0][i] * x;
+        s1 += q[1][i] * x;
+        s2 += q[2][i] * x;
+        s3 += q[3][i] * x;
+    }
+    out[0] = s0;
+    out[1] = s1;
+    out[2] = s2;
+    out[3] = s3;
+}
+
+#ifdef VECTOR_KERNELS_X86
+
+// SSE2-only horizontal add so it can be shared by every x86 kernel
+static inline float horizontal_sum_128(__m128 v) {
+    __m128 high = _mm_movehl_ps(v, v);
+    __m128 sums = _mm_add_ps(v, high);
+    __m128 odd = _mm_shuffle_ps(sums, sums, 0x55);
+    sums = _mm_add_ss(sums, odd);
+    return _mm_cvtss_f32(sums);
+}
+
+__attribute__((target("sse2")))
+static float dot_product_sse(const float* a, const float* b, int n) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    float sum = horizontal_sum_128(_mm_add_ps(acc0, acc1));
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_product_avx2(const float* a, const float* b, int n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), acc3);
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+    __m256 acc = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+    __m128 lo = _mm256_castps256_ps128(acc);
+    __m128 hi = _mm256_extractf128_ps(acc, 1);
+    float sum = horizontal_sum_128(_mm_add_ps(lo, hi));
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static float dot_product_f16_avx2(const float* a, const uint16_t* b, int n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 b0 = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        __m256 b1 = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 8)));
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), b0, acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), b1, acc1);
+    }
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    float sum = horizontal_sum_128(_mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1)));
+    for (; i < n; i++) {
+        sum += a[i] * half_to_float(b[i]);
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_product_u8_avx2(const float* a, const uint8_t* b, int n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m256 b0 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+        __m256 b1 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8)));
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), b0, acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), b1, acc1);
+    }
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    float sum = horizontal_sum_128(_mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1)));
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+static inline float horizontal_sum_256(__m256 v) {
+    return horizontal_sum_128(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+}
+
+__attribute__((target("avx2,fma")))
+static void dot_product_x4_avx2(const float* const* q, const float* row, int n, float* out) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(row + i);
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(q[0] + i), x, acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(q[1] + i), x, acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(q[2] + i), x, acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(q[3] + i), x, acc3);
+    }
+    out[0] = horizontal_sum_256(acc0);
+    out[1] = horizontal_sum_256(acc1);
+    out[2] = horizontal_sum_256(acc2);
+    out[3] = horizontal_sum_256(acc3);
+    for (; i < n; i++) {
+        out[0] += q[0][i] * row[i];
+        out[1] += q[1][i] * row[i];
+        out[2] += q[2][i] * row[i];
+        out[3] += q[3][i] * row[i];
+    }
+}
+
+#endif // VECTOR_KERNELS_X86
+
+#ifdef VECTOR_KERNELS_NEON
+
+static float dot_product_neon(const float* a, const float* b, int n) {
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    float32x4_t acc2 = vdupq_n_f32(0.0f);
+    float32x4_t acc3 = vdupq_n_f32(0.0f);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        acc2 = vmlaq_f32(acc2, vld1q_f32(a + i + 8), vld1q_f32(b + i + 8));
+        acc3 = vmlaq_f32(acc3, vld1q_f32(a + i + 12), vld1q_f32(b + i + 12));
+    }
+    for (; i + 4 <= n; i += 4) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+    }
+    float32x4_t acc = vaddq_f32(vaddq_f32(acc0, acc1), vaddq_f32(acc2, acc3));
+    float32x2_t pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    float sum = vget_lane_f32(vpadd_f32(pair, pair), 0);
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+#if defined(__aarch64__)
+static float dot_product_f16_neon(const float* a, const uint16_t* b, int n) {
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        float16x8_t halves = vreinterpretq_f16_u16(vld1q_u16(b + i));
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vcvt_f32_f16(vget_low_f16(halves)));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vcvt_high_f32_f16(halves));
+    }
+    float sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+    for (; i < n; i++) {
+        sum += a[i] * half_to_float(b[i]);
+    }
+    return sum;
+}
+#endif
+
+static float dot_product_u8_neon(const float* a, const uint8_t* b, int n) {
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint16x8_t wide = vmovl_u8(vld1_u8(b + i));
+        float32x4_t b0 = vcvtq_f32_u32(vmovl_u16(vget_low_u16(wide)));
+        float32x4_t b1 = vcvtq_f32_u32(vmovl_u16(vget_high_u16(wide)));
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), b0);
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), b1);
+    }
+    float32x4_t acc = vaddq_f32(acc0, acc1);
+    float32x2_t pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    float sum = vget_lane_f32(vpadd_f32(pair, pair), 0);
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+static void dot_product_x4_neon(const float* const* q, const float* row, int n, float* out) {
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    float32x4_t acc2 = vdupq_n_f32(0.0f);
+    float32x4_t acc3 = vdupq_n_f32(0.0f);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t x = vld1q_f32(row + i);
+        acc0 = vmlaq_f32(acc0, vld1q_f32(q[0] + i), x);
+        acc1 = vmlaq_f32(acc1, vld1q_f32(q[1] + i), x);
+        acc2 = vmlaq_f32(acc2, vld1q_f32(q[2] + i), x);
+        acc3 = vmlaq_f32(acc3, vld1q_f32(q[3] + i), x);
+    }
+    float32x4_t accs[4] = {acc0, acc1, acc2, acc3};
+    for (int j = 0; j < 4; j++) {
+        float32x2_t pair = vadd_f32(vget_low_f32(accs[j]), vget_high_f32(accs[j]));
+        out[j] = vget_lane_f32(vpadd_f32(pair, pair), 0);
+    }
+    for (; i < n; i++) {
+        out[0] += q[0][i] * row[i];
+        out[1] += q[1][i] * row[i];
+        out[2] += q[2][i] * row[i];
+        out[3] += q[3][i] * row[i];
+    }
+}
+
+#endif // VECTOR_KERNELS_NEON
+
+static DotProductFn select_dot_product() {
+#ifdef VECTOR_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return dot_product_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return dot_product_sse;
+    }
+#endif
+#ifdef VECTOR_KERNELS_NEON
+    return dot_product_neon;
+#endif
+    return dot_product_scalar;
+}
+
+static const char* isa_name(DotProductFn fn) {
+#ifdef VECTOR_KERNELS_X86
+    if (fn == dot_product_avx2) return "avx2";
+    if (fn == dot_product_sse) return "sse";
+#endif
+#ifdef VECTOR_KERNELS_NEON
+    if (fn == dot_product_neon) return "neon";
+#endif
+    (void)fn;
+    return "scalar";
+}
+
+DotProductFn get_dot_product_fn() {
+    // Resolved once, thread-safe static initialization
+    static const DotProductFn fn = select_dot_product();
+    return fn;
+}
+
+float dot_product(const float* a, const float* b, int n) {
+    return get_dot_product_fn()(a, b, n);
+}
+
+const char* get_active_isa() {
+    return isa_name(get_dot_product_fn());
+}
+
+static DotProductF16Fn select_dot_product_f16() {
+#ifdef VECTOR_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+        __builtin_cpu_supports("f16c")) {
+        return dot_product_f16_avx2;
+    }
+#endif
+#if defined(VECTOR_KERNELS_NEON) && defined(__aarch64__)
+    return dot_product_f16_neon;
+#endif
+    return dot_product_f16_scalar;
+}
+
+static DotProductU8Fn select_dot_product_u8() {
+#ifdef VECTOR_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return dot_product_u8_avx2;
+    }
+#endif
+#ifdef VECTOR_KERNELS_NEON
+    return dot_product_u8_neon;
+#endif
+    return dot_product_u8_scalar;
+}
+
+DotProductF16Fn get_dot_product_f16_fn() {
+    static const DotProductF16Fn fn = select_dot_product_f16();
+    return fn;
+}
+
+DotProductU8Fn get_dot_product_u8_fn() {
+    static const DotProductU8Fn fn = select_dot_product_u8();
+    return fn;
+}
+
+static DotProductX4Fn select_dot_product_x4() {
+#ifdef VECTOR_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return dot_product_x4_avx2;
+    }
+#endif
+#ifdef VECTOR_KERNELS_NEON
+    return dot_product_x4_neon;
+#endif
+    return dot_product_x4_scalar;
+}
+
+DotProductX4Fn get_dot_product_x4_fn() {
+    static const DotProductX4Fn fn = select_dot_product_x4();
+    return fn;
+}
+
+} // namespace VectorKernels
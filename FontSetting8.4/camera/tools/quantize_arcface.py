@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+"""Quantize the ArcFace ONNX model to INT8.
+
+Static quantization (default) calibrates the activation ranges on a folder
+of face crops, searched recursively (e.g. the crops written by
+`model_compare --export-crops`). Dynamic quantization only converts the
+weights and needs no calibration faces. Crops are preprocessed exactly like
+ModelLoader does: bilinear resize to the model input, BGR -> RGB,
+(pixel - 127.5) / 128, CHW.
+
+Inputs and outputs stay float, so ModelLoader loads the result like the FP32
+model. The output is tagged with a "quantization" metadata entry
+("int8-static" / "int8-dynamic") that ModelLoader reports.
+
+Requires: pip install onnxruntime onnx numpy opencv-python-headless
+
+Usage: quantize_arcface.py --model models/arcface_w600k_r50.onnx
+                           --output models/arcface_w600k_r50_int8.onnx
+                           [--calibration DIR] [--mode static|dynamic]
+                           [--max-images 500] [--per-tensor] [--reduce-range]
+"""
+
+import argparse
+import os
+import random
+import sys
+import tempfile
+
+import cv2
+import numpy as np
+import onnx
+from onnxruntime.quantization import (CalibrationDataReader, CalibrationMethod, QuantFormat, QuantType,
+                                      quantize_dynamic, quantize_static)
+from onnxruntime.quantization.shape_inference import quant_pre_process
+
+IMAGE_EXTENSIONS = {".jpg", ".jpeg", ".png", ".bmp"}
+NORM_MEAN = 127.5  # Config::ARCFACE_NORM_MEAN
+NORM_SCALE = 128.0  # Config::ARCFACE_NORM_SCALE
+
+
+def find_images(directory):
+    images = []
+    for root, _, files in os.walk(directory):
+        for name in files:
+            if os.path.splitext(name)[1].lower() in IMAGE_EXTENSIONS:
+                images.append(os.path.join(root, name))
+    return sorted(images)
+
+
+def model_input(model_path):
+    """Name, height and width of the model's image input."""
+    graph = onnx.load(model_path, load_external_data=False).graph
+    initializers = {init.name for init in graph.initializer}
+    for tensor in graph.input:
+        if tensor.name not in initializers:
+            dims = [d.dim_value for d in tensor.type.tensor_type.shape.dim]
+            return tensor.name, dims[2] or 112, dims[3] or 112
+    raise ValueError("model has no input")
+
+
+def preprocess(image, height, width):
+    resized = cv2.resize(image, (width, height), interpolation=cv2.INTER_LINEAR)
+    rgb = cv2.cvtColor(resized, cv2.COLOR_BGR2RGB).astype(np.float32)
+    normalized = (rgb - NORM_MEAN) / NORM_SCALE
+    return normalized.transpose(2, 0, 1)[np.newaxis]
+
+
+class FaceCalibrationReader(CalibrationDataReader):
+    """Feeds one preprocessed face crop per calibration step."""
+
+    def __init__(self, paths, input_name, height, width):
+        self.paths = iter(paths)
+        self.input_name = input_name
+        self.height = height
+        self.width = width
+        self.count = 0
+
+    def get_next(self):
+        for path in self.paths:
+            image = cv2.imread(path, cv2.IMREAD_COLOR)
+            if image is None:
+                print(f"Warning: could not read {path}", file=sys.stderr)
+                continue
+            self.count += 1
+            return {self.input_name: preprocess(image, self.height, self.width)}
+        return None
+
+
+def tag_model(path, mode):
+    model = onnx.load(path, load_external_data=False)
+    entry = next((p for p in model.metadata_props if p.key == "quantization"), None)
+    if entry is None:
+        entry = model.metadata_props.add()
+        entry.key = "quantization"
+    entry.value = f"int8-{mode}"
+    onnx.save(model, path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Quantize the ArcFace ONNX model to INT8")
+    parser.add_argument("--model", default="models/arcface_w600k_r50.onnx", help="FP32 model")
+    parser.add_argument("--output", default="models/arcface_w600k_r50_int8.onnx", help="INT8 model to write")
+    parser.add_argument("--calibration", help="Folder of face crops (static mode)")
+    parser.add_argument("--mode", choices=["static", "dynamic"], default="static")
+    parser.add_argument("--max-images", type=int, default=500, help="Calibration faces used (random sample)")
+    parser.add_argument("--per-tensor", action="store_true", help="One weight scale per tensor, not per channel")
+    parser.add_argument("--reduce-range", action="store_true",
+                        help="7-bit weights; avoids saturation on x86 CPUs without VNNI")
+    args = parser.parse_args()
+
+    if args.mode == "static" and not args.calibration:
+        parser.error("--calibration is required for static quantization")
+
+    with tempfile.TemporaryDirectory() as work:
+        # Shape inference and graph cleanup make more of the graph quantizable
+        prepared = os.path.join(work, "prepared.onnx")
+        try:
+            quant_pre_process(args.model, prepared, skip_symbolic_shape=True)
+        except Exception as error:  # Older models may not pass; quantize them as they are
+            print(f"Warning: pre-processing skipped ({error})", file=sys.stderr)
+            prepared = args.model
+
+        if args.mode == "dynamic":
+            quantize_dynamic(prepared, args.output, weight_type=QuantType.QUInt8,
+                             per_channel=not args.per_tensor, reduce_range=args.reduce_range)
+        else:
+            images = find_images(args.calibration)
+            if not images:
+                print(f"Error: no face images in {args.calibration}", file=sys.stderr)
+                return 1
+            random.Random(42).shuffle(images)
+            input_name, height, width = model_input(args.model)
+            reader = FaceCalibrationReader(images[:args.max_images], input_name, height, width)
+            # QDQ with U8 activations and S8 weights runs on the x86 and ARM CPU kernels
+            quantize_static(prepared, args.output, reader, quant_format=QuantFormat.QDQ,
+                            activation_type=QuantType.QUInt8, weight_type=QuantType.QInt8,
+                            per_channel=not args.per_tensor, reduce_range=args.reduce_range,
+                            calibrate_method=CalibrationMethod.MinMax)
+            print(f"Calibrated on {reader.count} faces from {args.calibration}")
+
+    tag_model(args.output, args.mode)
+    size_in = os.path.getsize(args.model) / 1e6
+    size_out = os.path.getsize(args.output) / 1e6
+    print(f"Wrote {args.output} (int8-{args.mode}, {size_in:.1f} MB -> {size_out:.1f} MB)")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -2,6 +2,8 @@
 #define CAMERA_H
 
 #include "lvgl/lvgl.h"
+#include "socket.h"
+#include <stdint.h>
 
 // ============================================================================
 // CAMERA SCREEN API
@@ -28,4 +30,19 @@ void create_camera_screen(void);
  */
 void cleanup_camera_screen(void);
 
+/**
+ * @brief Get the face recognition server client shared by the screens
+ *
+ * Created on first use; cleanup_camera_screen() destroys it
+ * @return SocketClient pointer or NULL on error
+ */
+SocketClient *camera_get_socket(void);
+
+/**
+ * @brief Parse a keypad-entered person ID the way capture enrolls it
+ * @param text Digits as entered ("007" is person 7)
+ * @return Person ID sent to the server
+ */
+uint64_t camera_parse_person_id(const char *text);
+
 #endif /* CAMERA_H */
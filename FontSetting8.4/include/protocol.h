@@ -50,6 +50,9 @@ typedef enum {
     REQ_DETECT_FACES = 0x000C,
     REQ_FAS_ON = 0x000D,
     REQ_FAS_OFF = 0x000E,
+    REQ_VERIFY = 0x000F,  /* 1:1 check of a claimed ID (uint64 person ID) */
+    REQ_EXPORT_SNAPSHOT = 0x0010,  /* Write a gallery snapshot (string path on the kiosk) */
+    REQ_IMPORT_SNAPSHOT = 0x0011,  /* Replace the gallery with a snapshot (string path) */
 
     /* Response messages (Server -> Client) */
     RESP_SUCCESS = 0x1001,
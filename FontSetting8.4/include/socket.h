@@ -6,6 +6,12 @@
 #define MAX_STRING_LEN 256
 #define MAX_SOCKET_PATH 108
 
+/* Server error codes (Protocol::ErrorCode) the UI reacts to */
+#define SOCKET_ERROR_NO_FACE 21              /* No face in front of the camera */
+#define SOCKET_ERROR_DUPLICATE_FACE 24        /* Capture refused: face enrolled under another ID */
+#define SOCKET_ERROR_PERSON_NOT_FOUND 40      /* No person enrolled under the ID */
+#define SOCKET_ERROR_VERIFICATION_FAILED 41   /* Face does not match the claimed ID */
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -28,6 +34,7 @@ typedef struct {
  */
 typedef struct {
     int success;                    /* 1 if OK, 0 if ERROR */
+    uint32_t error_code;            /* Server error code if ERROR, 0 otherwise */
     char message[MAX_STRING_LEN];   /* Response message */
 } Response;
 
@@ -78,6 +85,19 @@ int socket_client_camera_off(SocketClient *client, Response *response);
  */
 int socket_client_capture(SocketClient *client, const char *initial, uint64_t id, Response *response);
 
+/**
+ * @brief Verify the face in front of the camera against a claimed person ID
+ *
+ * 1:1 check: the server scores only that person's enrolled faces. A face
+ * that does not match fails with SOCKET_ERROR_VERIFICATION_FAILED.
+ *
+ * @param client Socket client
+ * @param id Claimed person ID (as entered on the PIN pad)
+ * @param response Response structure to fill
+ * @return 0 on success, -1 on error
+ */
+int socket_client_verify(SocketClient *client, uint64_t id, Response *response);
+
 /**
  * @brief Start training recognition model
  * @param client Socket client
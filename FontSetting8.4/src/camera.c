@@ -43,6 +43,14 @@ static SocketClient* ensure_socket_connection(void) {
     return camera_socket;
 }
 
+SocketClient *camera_get_socket(void) {
+    return ensure_socket_connection();
+}
+
+uint64_t camera_parse_person_id(const char *text) {
+    return (uint64_t)atoll(text);
+}
+
 /**
  * @brief Execute socket command and display response
  * @param cmd_func Socket command function pointer
@@ -87,9 +95,17 @@ static void execute_socket_command_with_capture(SocketCmdWithCapture cmd_func,
         return;
     }
 
-    Response response;
+    Response response = {0};
     cmd_func(socket, initial, id, &response);
     
+    if (!response.success && response.error_code == SOCKET_ERROR_DUPLICATE_FACE) {
+        // The server lists who the face already belongs to
+        char text[MAX_STRING_LEN * 2];
+        snprintf(text, sizeof(text), "%s\n%s", get_label("camera_screen.duplicate_face"), response.message);
+        lv_label_set_text(status_label, text);
+        return;
+    }
+    
     lv_label_set_text(status_label, response.message);
 }
 
@@ -107,7 +123,7 @@ static void person_id_save_callback(lv_event_t *e) {
     }
     
     // Convert person ID to uint64_t
-    uint64_t person_id = (uint64_t)atoll(temp_person_id);
+    uint64_t person_id = camera_parse_person_id(temp_person_id);
     
     // Execute capture command
     execute_socket_command_with_capture(socket_client_capture, "Person", person_id);
@@ -9,7 +9,10 @@
 #include "../include/border.h"
 #include "../include/label.h"
 #include "../include/ui_helpers.h"
+#include "../include/socket.h"
+#include "../include/camera.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 // ============================================================================
@@ -143,6 +146,41 @@ static void msgbox_event_callback(lv_event_t *e) {
     remove_green_border();
 }
 
+/**
+ * @brief Verify the face at the camera against the entered ID (1:1)
+ *
+ * The server scores only the claimed person's enrolled faces, so the check
+ * costs the same however many people are enrolled.
+ *
+ * @param id_text Entered person ID
+ * @param result Filled with the text for the result message box
+ * @param result_size Size of result
+ * @return true if the face matches the ID
+ */
+static bool verify_entered_id(const char *id_text, char *result, size_t result_size) {
+    SocketClient *socket = camera_get_socket();
+    Response response = {0};
+    uint64_t id = camera_parse_person_id(id_text);  // Same ID capture enrolled
+
+    if (!socket || socket_client_verify(socket, id, &response) < 0) {
+        snprintf(result, result_size, "%s\n%s", get_label("number_input_screen.server_unreachable"), id_text);
+        return false;
+    }
+
+    const char *label_key;
+    if (response.success) {
+        label_key = "number_input_screen.verified";
+    } else if (response.error_code == SOCKET_ERROR_PERSON_NOT_FOUND) {
+        label_key = "number_input_screen.unknown_id";
+    } else if (response.error_code == SOCKET_ERROR_NO_FACE) {
+        label_key = "number_input_screen.no_face";
+    } else {
+        label_key = "number_input_screen.not_verified";
+    }
+    snprintf(result, result_size, "%s\n%s", get_label(label_key), id_text);
+    return response.success != 0;
+}
+
 static void close_btn_callback(lv_event_t *e) {
     (void)e;
     hide_keyboard_popup();
@@ -170,8 +208,12 @@ static void enter_btn_callback(lv_event_t *e) {
     // Only show message box if there's text
     if (text_copy[0] != '\0') {
         // Create a message box with OK button and no close icon
+        // The entered number is the claimed person ID
+        static char result_text[MAX_STRING_LEN * 2];
+        bool verified = verify_entered_id(text_copy, result_text, sizeof(result_text));
+
         static const char *btns[] = {"OK", ""};
-        lv_obj_t *mbox = lv_msgbox_create(NULL, get_label("number_input_screen.result_title"), text_copy, btns, false);
+        lv_obj_t *mbox = lv_msgbox_create(NULL, get_label("number_input_screen.result_title"), result_text, btns, false);
 
         if (mbox) {
             setup_msgbox_timer_management(mbox);
@@ -225,8 +267,12 @@ static void enter_btn_callback(lv_event_t *e) {
             // Add event callback to close the message box when OK is clicked
             lv_obj_add_event_cb(mbox, msgbox_event_callback, LV_EVENT_VALUE_CHANGED, NULL);
 
-            // Show the green rectangle border
-            show_green_border();
+            // Green border when the face matches the ID, red otherwise
+            if (verified) {
+                show_green_border();
+            } else {
+                show_red_border();
+            }
         }
     }
 }
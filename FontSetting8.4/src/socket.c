@@ -32,6 +32,7 @@ typedef enum {
     REQ_FAS_ON = 0x000D,
     REQ_FAS_OFF = 0x000E,
     REQ_SET_SETTINGS = 0x000B,
+    REQ_VERIFY = 0x000F,
 
     RESP_SUCCESS = 0x1001,
     RESP_ERROR = 0x1002,
@@ -322,6 +323,7 @@ static int execute_binary(SocketClient *client, const uint8_t *request_data,
     int result = -1;
 
     response->success = 0;
+    response->error_code = 0;
     response->message[0] = '\0';
 
     sock = socket_connect(client);
@@ -405,6 +407,7 @@ static int execute_binary(SocketClient *client, const uint8_t *request_data,
             response->success = 0;
             uint32_t error_code;
             if (read_uint32_safe(payload_buf, payload_length, &offset, &error_code) < 0) goto cleanup;
+            response->error_code = error_code;
             char error_msg[MAX_STRING_LEN];
             if (read_string_safe(payload_buf, payload_length, &offset, error_msg, MAX_STRING_LEN) < 0) {
                 snprintf(response->message, MAX_STRING_LEN, "Invalid error message");
@@ -604,6 +607,27 @@ int socket_client_capture(SocketClient *client, const char *initial, uint64_t id
     return execute_binary(client, request, size, response);
 }
 
+int socket_client_verify(SocketClient *client, uint64_t id, Response *response) {
+    Buffer buf;
+    buffer_init(&buf);
+
+    if (buffer_write_uint64(&buf, id) < 0) {
+        snprintf(response->message, MAX_STRING_LEN, "Failed to build request");
+        response->success = 0;
+        return -1;
+    }
+
+    uint8_t request[MAX_BUFFER_SIZE];
+    uint32_t size = 0;
+    if (create_request(REQ_VERIFY, &buf, request, sizeof(request), &size) < 0) {
+        snprintf(response->message, MAX_STRING_LEN, "Failed to create request");
+        response->success = 0;
+        return -1;
+    }
+
+    return execute_binary(client, request, size, response);
+}
+
 int socket_client_train(SocketClient *client, Response *response) {
     uint8_t request[HEADER_SIZE];
     uint32_t size = 0;